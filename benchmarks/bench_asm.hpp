@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "core/cpu/CPU.hpp"
+
+// Minimal RV32IM encoder for the guest programs of the benchmarks, with the few A and Zicsr
+// instructions they need. Branch and jump offsets are in bytes relative to the instruction itself.
+namespace bench::rv {
+
+enum Reg : uint32_t {
+    zero = 0, ra = 1, sp = 2, t0 = 5, t1 = 6, t2 = 7, s0 = 8, s1 = 9,
+    a0 = 10, a1 = 11, a2 = 12, a3 = 13, a4 = 14, a5 = 15, t3 = 28, t4 = 29, t5 = 30, t6 = 31
+};
+
+constexpr uint32_t r_type(uint32_t opcode, uint32_t rd, uint32_t funct3, uint32_t rs1, uint32_t rs2, uint32_t funct7) {
+    return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+
+constexpr uint32_t i_type(uint32_t opcode, uint32_t rd, uint32_t funct3, uint32_t rs1, int32_t imm) {
+    return (static_cast<uint32_t>(imm) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+
+constexpr uint32_t s_type(uint32_t funct3, uint32_t rs1, uint32_t rs2, int32_t imm) {
+    uint32_t u = static_cast<uint32_t>(imm);
+    return (((u >> 5) & 0x7F) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | ((u & 0x1F) << 7) | 0x23;
+}
+
+constexpr uint32_t b_type(uint32_t funct3, uint32_t rs1, uint32_t rs2, int32_t offset) {
+    uint32_t u = static_cast<uint32_t>(offset);
+    return (((u >> 12) & 1) << 31) | (((u >> 5) & 0x3F) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12)
+           | (((u >> 1) & 0xF) << 8) | (((u >> 11) & 1) << 7) | 0x63;
+}
+
+constexpr uint32_t add(uint32_t rd, uint32_t rs1, uint32_t rs2) { return r_type(0x33, rd, 0, rs1, rs2, 0x00); }
+constexpr uint32_t sub(uint32_t rd, uint32_t rs1, uint32_t rs2) { return r_type(0x33, rd, 0, rs1, rs2, 0x20); }
+constexpr uint32_t xor_(uint32_t rd, uint32_t rs1, uint32_t rs2) { return r_type(0x33, rd, 4, rs1, rs2, 0x00); }
+constexpr uint32_t or_(uint32_t rd, uint32_t rs1, uint32_t rs2) { return r_type(0x33, rd, 6, rs1, rs2, 0x00); }
+constexpr uint32_t and_(uint32_t rd, uint32_t rs1, uint32_t rs2) { return r_type(0x33, rd, 7, rs1, rs2, 0x00); }
+
+constexpr uint32_t mul(uint32_t rd, uint32_t rs1, uint32_t rs2) { return r_type(0x33, rd, 0, rs1, rs2, 0x01); }
+constexpr uint32_t mulh(uint32_t rd, uint32_t rs1, uint32_t rs2) { return r_type(0x33, rd, 1, rs1, rs2, 0x01); }
+constexpr uint32_t mulhu(uint32_t rd, uint32_t rs1, uint32_t rs2) { return r_type(0x33, rd, 3, rs1, rs2, 0x01); }
+constexpr uint32_t div(uint32_t rd, uint32_t rs1, uint32_t rs2) { return r_type(0x33, rd, 4, rs1, rs2, 0x01); }
+constexpr uint32_t divu(uint32_t rd, uint32_t rs1, uint32_t rs2) { return r_type(0x33, rd, 5, rs1, rs2, 0x01); }
+constexpr uint32_t rem(uint32_t rd, uint32_t rs1, uint32_t rs2) { return r_type(0x33, rd, 6, rs1, rs2, 0x01); }
+constexpr uint32_t remu(uint32_t rd, uint32_t rs1, uint32_t rs2) { return r_type(0x33, rd, 7, rs1, rs2, 0x01); }
+
+constexpr uint32_t addi(uint32_t rd, uint32_t rs1, int32_t imm) { return i_type(0x13, rd, 0, rs1, imm); }
+constexpr uint32_t xori(uint32_t rd, uint32_t rs1, int32_t imm) { return i_type(0x13, rd, 4, rs1, imm); }
+constexpr uint32_t ori(uint32_t rd, uint32_t rs1, int32_t imm) { return i_type(0x13, rd, 6, rs1, imm); }
+constexpr uint32_t andi(uint32_t rd, uint32_t rs1, int32_t imm) { return i_type(0x13, rd, 7, rs1, imm); }
+constexpr uint32_t slli(uint32_t rd, uint32_t rs1, uint32_t shamt) { return i_type(0x13, rd, 1, rs1, static_cast<int32_t>(shamt)); }
+constexpr uint32_t srli(uint32_t rd, uint32_t rs1, uint32_t shamt) { return i_type(0x13, rd, 5, rs1, static_cast<int32_t>(shamt)); }
+
+constexpr uint32_t lb(uint32_t rd, uint32_t rs1, int32_t imm) { return i_type(0x03, rd, 0, rs1, imm); }
+constexpr uint32_t lh(uint32_t rd, uint32_t rs1, int32_t imm) { return i_type(0x03, rd, 1, rs1, imm); }
+constexpr uint32_t lw(uint32_t rd, uint32_t rs1, int32_t imm) { return i_type(0x03, rd, 2, rs1, imm); }
+constexpr uint32_t lbu(uint32_t rd, uint32_t rs1, int32_t imm) { return i_type(0x03, rd, 4, rs1, imm); }
+constexpr uint32_t lhu(uint32_t rd, uint32_t rs1, int32_t imm) { return i_type(0x03, rd, 5, rs1, imm); }
+constexpr uint32_t sb(uint32_t rs2, uint32_t rs1, int32_t imm) { return s_type(0, rs1, rs2, imm); }
+constexpr uint32_t sh(uint32_t rs2, uint32_t rs1, int32_t imm) { return s_type(1, rs1, rs2, imm); }
+constexpr uint32_t sw(uint32_t rs2, uint32_t rs1, int32_t imm) { return s_type(2, rs1, rs2, imm); }
+
+constexpr uint32_t beq(uint32_t rs1, uint32_t rs2, int32_t offset) { return b_type(0, rs1, rs2, offset); }
+constexpr uint32_t bne(uint32_t rs1, uint32_t rs2, int32_t offset) { return b_type(1, rs1, rs2, offset); }
+constexpr uint32_t blt(uint32_t rs1, uint32_t rs2, int32_t offset) { return b_type(4, rs1, rs2, offset); }
+constexpr uint32_t bge(uint32_t rs1, uint32_t rs2, int32_t offset) { return b_type(5, rs1, rs2, offset); }
+constexpr uint32_t bltu(uint32_t rs1, uint32_t rs2, int32_t offset) { return b_type(6, rs1, rs2, offset); }
+
+constexpr uint32_t lui(uint32_t rd, uint32_t upper) { return (upper << 12) | (rd << 7) | 0x37; }
+
+constexpr uint32_t auipc(uint32_t rd, uint32_t upper) { return (upper << 12) | (rd << 7) | 0x17; }
+
+constexpr uint32_t jalr(uint32_t rd, uint32_t rs1, int32_t imm) { return i_type(0x67, rd, 0, rs1, imm); }
+
+constexpr uint32_t jal(uint32_t rd, int32_t offset) {
+    uint32_t u = static_cast<uint32_t>(offset);
+    return (((u >> 20) & 1) << 31) | (((u >> 1) & 0x3FF) << 21) | (((u >> 11) & 1) << 20)
+           | (((u >> 12) & 0xFF) << 12) | (rd << 7) | 0x6F;
+}
+
+constexpr uint32_t amoadd_w(uint32_t rd, uint32_t rs2, uint32_t rs1) { return r_type(0x2F, rd, 2, rs1, rs2, 0x00); }
+constexpr uint32_t csrr(uint32_t rd, uint32_t csr) { return i_type(0x73, rd, 2, zero, static_cast<int32_t>(csr)); }
+
+constexpr uint32_t halt() { return jal(zero, 0); } // jump to self ends CPU::run
+
+/**
+ * @brief Writes a program into guest memory.
+ */
+inline void load(CPU& cpu, uint32_t address, const std::vector<uint32_t>& program) {
+    cpu.write_block(address, reinterpret_cast<const uint8_t*>(program.data()), program.size() * sizeof(uint32_t));
+}
+
+} // namespace bench::rv
@@ -0,0 +1,97 @@
+// Throughput of many small guest programs: a fresh CPU per job run one after the other, the way
+// a script drives them one CPU object at a time, against the BatchRunner reusing one CPU per
+// worker, on one worker and on every host thread. Each job sums 1..k in a loop and exits with the
+// sum, which the runner checks.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_asm.hpp"
+#include "bench_utils.hpp"
+#include "core/batch/BatchRunner.hpp"
+#include "utils/plt.hpp"
+
+using namespace bench::rv;
+
+namespace {
+
+constexpr size_t JOBS = 4000;
+constexpr size_t MEMORY_SIZE = 1024 * 1024;
+constexpr uint32_t ECALL = 0x00000073;
+constexpr uint32_t A7 = 17;
+
+std::vector<BatchJob> make_jobs() {
+    std::vector<BatchJob> jobs(JOBS);
+    for (size_t i = 0; i < JOBS; ++i) {
+        int32_t k = static_cast<int32_t>(100 + i % 1000);
+        std::vector<uint32_t> program = {
+            addi(t0, zero, 0),
+            addi(t1, zero, k),
+            add(t0, t0, t1),
+            addi(t1, t1, -1),
+            bne(t1, zero, -8),
+            addi(a0, t0, 0),
+            addi(A7, zero, 93),
+            ECALL,
+        };
+        BatchJob& job = jobs[i];
+        job.image.resize(program.size() * sizeof(uint32_t));
+        std::memcpy(job.image.data(), program.data(), job.image.size());
+        job.memory_size = MEMORY_SIZE;
+        job.expected_exit_code = static_cast<uint32_t>(k * (k + 1) / 2);
+    }
+    return jobs;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void report(const std::string& name, double jobs_per_second, double baseline = 0.0) {
+    std::cout << std::left << std::setw(48) << name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(10) << jobs_per_second << " jobs/s";
+    if (baseline > 0.0) {
+        std::cout << std::setprecision(2) << std::setw(10) << jobs_per_second / baseline << "x";
+    }
+    std::cout << '\n';
+}
+
+} // namespace
+
+int main() {
+    plt::disable_debug();
+    const std::vector<BatchJob> jobs = make_jobs();
+    const ExecutionMode mode = ExecutionMode::THREADED;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t serial_passed = 0;
+    for (const BatchJob& job : jobs) {
+        CPU cpu(job.memory_size, MemoryBacking::HEAP, mode);
+        cpu.set_translation_mode(TranslationMode::SATP);
+        cpu.write_block(job.load_address, job.image.data(), job.image.size());
+        RunResult result = cpu.run(job.max_instructions);
+        serial_passed += result.reason == StopReason::EXIT && result.exit_code == *job.expected_exit_code;
+    }
+    double serial = static_cast<double>(JOBS) / seconds_since(start);
+    report("fresh CPU per job, serial", serial);
+
+    bool correct = serial_passed == JOBS;
+    unsigned host_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (size_t threads : {size_t{1}, size_t{host_threads}}) {
+        BatchRunner runner(BatchConfig{threads, mode, MemoryBacking::HEAP, true});
+        runner.run(jobs);
+        const BatchStats& stats = runner.get_stats();
+        correct = correct && stats.passed == JOBS;
+        report("batch runner, " + std::to_string(threads) + " threads", stats.jobs_per_second, serial);
+        std::cout << std::left << std::setw(48) << "" << std::right << std::setw(10)
+                  << static_cast<double>(stats.instructions) / stats.seconds / 1e6 << " MIPS, " << stats.steals
+                  << " jobs stolen\n";
+    }
+    std::cout << "every job " << (correct ? "passed" : "did NOT pass") << '\n';
+    return correct ? 0 : 1;
+}
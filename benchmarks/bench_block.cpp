@@ -0,0 +1,38 @@
+// Reading back a 1 MB result buffer: word by word through the MMU versus one bulk read_block.
+#include <cstdint>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "core/memory/MMU.hpp"
+#include "utils/bitutils.hpp"
+
+namespace {
+
+constexpr uint32_t BUFFER_SIZE = 1024 * 1024;
+constexpr uint64_t ITERATIONS = 200;
+
+} // namespace
+
+int main() {
+    PhysicalMemory memory(4 * BUFFER_SIZE);
+    PageTable page_table;
+    MMU mmu(&memory, &page_table, PrivilegeMode::MACHINE);
+    mmu.set_translation_mode(TranslationMode::SATP); // bare, machine mode
+    mmu.fill(0, 0x5A, BUFFER_SIZE);
+
+    std::vector<uint8_t> buffer(BUFFER_SIZE);
+    double words = bench::ns_per_op(ITERATIONS, [&](uint64_t) {
+        for (uint32_t address = 0; address < BUFFER_SIZE; address += 4) {
+            bitutils::store_le<uint32_t>(buffer.data() + address, mmu.read_word(address));
+        }
+        bench::do_not_optimize(buffer[0]);
+    });
+    double block = bench::ns_per_op(ITERATIONS, [&](uint64_t) {
+        mmu.read_block(0, buffer.data(), BUFFER_SIZE);
+        bench::do_not_optimize(buffer[0]);
+    });
+
+    bench::report("1 MB read, read_word loop", words);
+    bench::report("1 MB read, read_block", block, words);
+    return 0;
+}
@@ -0,0 +1,145 @@
+// Branch predictors of the timing model. For each kernel and predictor, the share of branches and
+// jumps mispredicted, the CPI and the bits of state the predictor needs: nested loops whose inner
+// loop runs 4 and 16 times, a random branch followed by a second one on the same condition, and
+// a function called from two sites. Then the host cost of predicting, ns per guest instruction
+// of the timing model with the static predictor and with TAGE.
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_asm.hpp"
+#include "bench_utils.hpp"
+#include "utils/plt.hpp"
+
+using namespace bench::rv;
+
+namespace {
+
+constexpr uint32_t LOOPS = 0x000;
+constexpr uint32_t CORRELATED = 0x100;
+constexpr uint32_t CALLS = 0x200;
+constexpr uint32_t FUNCTION = 0x240;
+constexpr uint64_t RUNS = 3;
+
+struct Kernel {
+    std::string name;
+    uint32_t entry;
+    uint32_t a0, a1;
+};
+
+struct Predictor {
+    std::string name;
+    BranchPredictorConfig config;
+};
+
+void load_kernels(CPU& cpu) {
+    // a0 = outer iterations, a1 = inner iterations
+    load(cpu, LOOPS, {
+        addi(t0, a1, 0),
+        addi(a2, a2, 1),            // 4
+        addi(t0, t0, -1),
+        bne(t0, zero, -8),
+        addi(a0, a0, -1),
+        bne(a0, zero, -20),
+        halt(),
+    });
+    // a0 = iterations, a1 = xorshift state. The second branch repeats the first one
+    load(cpu, CORRELATED, {
+        slli(t0, a1, 13),
+        xor_(a1, a1, t0),
+        srli(t0, a1, 17),
+        xor_(a1, a1, t0),
+        slli(t0, a1, 5),
+        xor_(a1, a1, t0),
+        andi(t1, a1, 1),
+        beq(t1, zero, 8),
+        addi(a2, a2, 1),
+        beq(t1, zero, 8),           // 36
+        addi(a3, a3, 1),
+        addi(a0, a0, -1),           // 44
+        bne(a0, zero, -48),
+        halt(),
+    });
+    // a0 = iterations, calls FUNCTION twice per iteration, its return alternates between two sites
+    load(cpu, CALLS, {
+        jal(ra, FUNCTION - CALLS),
+        jal(ra, FUNCTION - CALLS - 4),
+        addi(a0, a0, -1),
+        bne(a0, zero, -12),
+        halt(),
+    });
+    load(cpu, FUNCTION, {
+        addi(a2, a2, 1),
+        jalr(zero, ra, 0),
+    });
+}
+
+std::unique_ptr<CPU> make_cpu(const BranchPredictorConfig& config) {
+    auto cpu = std::make_unique<CPU>(64 * 1024);
+    cpu->set_translation_mode(TranslationMode::SATP);
+    cpu->set_timing_enabled(true);
+    cpu->set_branch_predictor_config(config);
+    load_kernels(*cpu);
+    return cpu;
+}
+
+void run(CPU& cpu, const Kernel& kernel) {
+    cpu.set_register(a0, kernel.a0);
+    cpu.set_register(a1, kernel.a1);
+    cpu.get_register_bank().set_pc(kernel.entry);
+    cpu.run(CPU::UNLIMITED);
+}
+
+std::vector<Predictor> make_predictors() {
+    std::vector<Predictor> predictors(5);
+    predictors[0].name = "static not taken";
+    predictors[1].name = "bimodal 4K, no return stack";
+    predictors[1].config.kind = BranchPredictorKind::BIMODAL;
+    predictors[1].config.ras_depth = 0;
+    predictors[2].name = "bimodal 4K";
+    predictors[2].config.kind = BranchPredictorKind::BIMODAL;
+    predictors[3].name = "gshare 4K, 12 history";
+    predictors[3].config.kind = BranchPredictorKind::GSHARE;
+    predictors[4].name = "TAGE 4K + 4x1K, 32 history";
+    predictors[4].config.kind = BranchPredictorKind::TAGE;
+    predictors[4].config.history_bits = 32;
+    return predictors;
+}
+
+} // namespace
+
+int main() {
+    plt::disable_debug();
+    const std::vector<Kernel> kernels = {
+        {"loops, 4 inner iterations", LOOPS, 20000, 4},
+        {"loops, 16 inner iterations", LOOPS, 5000, 16},
+        {"random branch, correlated branch", CORRELATED, 50000, 0x2545F491},
+        {"calls from two sites", CALLS, 50000, 0},
+    };
+    const std::vector<Predictor> predictors = make_predictors();
+
+    for (const Kernel& kernel : kernels) {
+        std::cout << kernel.name << ":\n";
+        for (const Predictor& predictor : predictors) {
+            auto cpu = make_cpu(predictor.config);
+            run(*cpu, kernel);
+            const BranchPredictorStats& stats = cpu->get_branch_predictor_stats();
+            std::cout << "  " << std::left << std::setw(32) << predictor.name << std::right << std::fixed
+                      << std::setprecision(3) << "mispredicted " << 1.0 - stats.accuracy() << ", CPI "
+                      << cpu->get_timing_stats().cpi() << ", " << std::setprecision(1)
+                      << static_cast<double>(cpu->get_branch_predictor_storage_bits()) / 8192.0 << " KB\n";
+        }
+    }
+
+    const Kernel& correlated = kernels[2];
+    auto plain = make_cpu(predictors[0].config);
+    auto tage = make_cpu(predictors[4].config);
+    double plain_ns = bench::ns_per_op(RUNS, [&](uint64_t) { run(*plain, correlated); });
+    double tage_ns = bench::ns_per_op(RUNS, [&](uint64_t) { run(*tage, correlated); });
+    double instructions = static_cast<double>(tage->get_timing_stats().instructions) / RUNS;
+    bench::report("timing, static predictor", plain_ns / instructions);
+    bench::report("timing, TAGE", tage_ns / instructions, plain_ns / instructions);
+    return 0;
+}
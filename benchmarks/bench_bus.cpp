@@ -0,0 +1,53 @@
+// Guest RAM access cost with and without devices on the physical bus, and the cost of a device access.
+#include <cstdint>
+#include <memory>
+
+#include "bench_utils.hpp"
+#include "core/devices/Timer.hpp"
+#include "core/devices/Uart.hpp"
+#include "core/memory/MMU.hpp"
+
+namespace {
+
+constexpr uint64_t ITERATIONS = 20'000'000;
+constexpr uint32_t WINDOW = 64 * 1024;
+constexpr uint32_t UART_BASE = 0x10000000;
+
+double ram_read_ns(bool with_devices) {
+    PhysicalMemory memory(16 * 1024 * 1024);
+    PageTable page_table;
+    MMU mmu(&memory, &page_table, PrivilegeMode::MACHINE);
+    mmu.set_translation_mode(TranslationMode::SATP); // bare, machine mode
+    Bus bus(&memory);
+    if (with_devices) {
+        bus.add_device(0x02000000, Timer::SIZE, std::make_shared<Timer>());
+        bus.add_device(UART_BASE, Uart::SIZE, std::make_shared<Uart>());
+        mmu.set_bus(&bus);
+    }
+    return bench::ns_per_op(ITERATIONS, [&](uint64_t i) {
+        bench::do_not_optimize(mmu.read_word(static_cast<uint32_t>((i * 4) % WINDOW)));
+    });
+}
+
+} // namespace
+
+int main() {
+    double ram_only = ram_read_ns(false);
+    double with_bus = ram_read_ns(true);
+
+    PhysicalMemory memory(1024 * 1024);
+    PageTable page_table;
+    MMU mmu(&memory, &page_table, PrivilegeMode::MACHINE);
+    mmu.set_translation_mode(TranslationMode::SATP);
+    Bus bus(&memory);
+    bus.add_device(UART_BASE, Uart::SIZE, std::make_shared<Uart>());
+    mmu.set_bus(&bus);
+    double uart_status = bench::ns_per_op(ITERATIONS / 10, [&](uint64_t) {
+        bench::do_not_optimize(mmu.read(UART_BASE + Uart::LSR));
+    });
+
+    bench::report("RAM read_word, no bus", ram_only);
+    bench::report("RAM read_word, bus with uart and timer", with_bus, ram_only);
+    bench::report("UART status register read", uart_status);
+    return 0;
+}
@@ -0,0 +1,149 @@
+// Guest throughput of byte heavy kernels: strlen, memcpy and a bitwise CRC-32, all built on
+// LBU/SB. A word sized memcpy shows the cost per byte of the sub-word accesses, its misaligned
+// variant the cost of the split slow path.
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "bench_asm.hpp"
+#include "bench_utils.hpp"
+#include "utils/plt.hpp"
+
+using namespace bench::rv;
+
+namespace {
+
+constexpr uint32_t STRLEN = 0x000;
+constexpr uint32_t MEMCPY = 0x100;
+constexpr uint32_t CRC32 = 0x200;
+constexpr uint32_t MEMCPY_WORDS = 0x300;
+constexpr uint32_t SOURCE = 0x10000;
+constexpr uint32_t DESTINATION = 0x40000;
+constexpr uint32_t LENGTH = 4096;
+constexpr uint64_t RUNS = 10;
+
+void load_kernels(CPU& cpu) {
+    // a0 = string, returns its length in a0
+    load(cpu, STRLEN, {
+        addi(a1, a0, 0),
+        lbu(t0, a1, 0),
+        addi(a1, a1, 1),
+        bne(t0, zero, -8),
+        sub(a0, a1, a0),
+        addi(a0, a0, -1),
+        halt(),
+    });
+    // a0 = destination, a1 = source, a2 = length in bytes
+    load(cpu, MEMCPY, {
+        beq(a2, zero, 28),
+        lbu(t0, a1, 0),
+        sb(t0, a0, 0),
+        addi(a0, a0, 1),
+        addi(a1, a1, 1),
+        addi(a2, a2, -1),
+        jal(zero, -24),
+        halt(),
+    });
+    // a0 = buffer, a1 = length, returns the reflected CRC-32 (polynomial 0xEDB88320) in a0
+    load(cpu, CRC32, {
+        lui(t2, 0xEDB88),
+        addi(t2, t2, 0x320),
+        addi(t0, zero, -1),
+        beq(a1, zero, 52),      // byte loop
+        lbu(t1, a0, 0),
+        xor_(t0, t0, t1),
+        addi(t3, zero, 8),
+        andi(t4, t0, 1),        // bit loop
+        srli(t0, t0, 1),
+        beq(t4, zero, 8),
+        xor_(t0, t0, t2),
+        addi(t3, t3, -1),
+        bne(t3, zero, -20),
+        addi(a0, a0, 1),
+        addi(a1, a1, -1),
+        jal(zero, -48),
+        xori(a0, t0, -1),
+        halt(),
+    });
+    // Same as MEMCPY with LW/SW, the length is a multiple of 4
+    load(cpu, MEMCPY_WORDS, {
+        beq(a2, zero, 28),
+        lw(t0, a1, 0),
+        sw(t0, a0, 0),
+        addi(a0, a0, 4),
+        addi(a1, a1, 4),
+        addi(a2, a2, -4),
+        jal(zero, -24),
+        halt(),
+    });
+}
+
+// Runs a kernel to its halt and returns a0
+uint32_t call(CPU& cpu, uint32_t entry, uint32_t arg0, uint32_t arg1 = 0, uint32_t arg2 = 0) {
+    cpu.set_register(a0, arg0);
+    cpu.set_register(a1, arg1);
+    cpu.set_register(a2, arg2);
+    cpu.get_register_bank().set_pc(entry);
+    cpu.run();
+    return cpu.get_register(a0);
+}
+
+uint32_t host_crc32(const std::vector<uint8_t>& data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+// Reports the cost per byte and the throughput of a kernel over `bytes` bytes
+void report_kernel(const std::string& name, double ns_per_run, uint32_t bytes) {
+    double ns_per_byte = ns_per_run / bytes;
+    bench::report(name, ns_per_byte);
+    std::cout << std::left << std::setw(48) << "" << std::right << std::setw(10) << 1000.0 / ns_per_byte << " MB/s\n";
+}
+
+} // namespace
+
+int main() {
+    plt::disable_debug();
+    CPU cpu(1024 * 1024);
+    // Machine mode with satp in Bare mode, the kernels see physical memory directly
+    cpu.set_translation_mode(TranslationMode::SATP);
+    load_kernels(cpu);
+
+    std::vector<uint8_t> data(LENGTH + 4);
+    for (uint32_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(1 + (i * 7) % 255); // no terminator inside the buffer
+    }
+    data[LENGTH - 1] = 0;
+    cpu.write_block(SOURCE, data.data(), data.size());
+
+    uint32_t length = 0;
+    double strlen_ns = bench::ns_per_op(RUNS, [&](uint64_t) { length = call(cpu, STRLEN, SOURCE); });
+
+    double memcpy_ns = bench::ns_per_op(RUNS, [&](uint64_t) { call(cpu, MEMCPY, DESTINATION, SOURCE, LENGTH); });
+    std::vector<uint8_t> copy(LENGTH);
+    cpu.read_block(DESTINATION, copy.data(), LENGTH);
+    bool copied = std::equal(copy.begin(), copy.end(), data.begin());
+
+    constexpr uint32_t CRC_LENGTH = LENGTH / 4; // about 50 instructions per byte
+    uint32_t crc = 0;
+    double crc_ns = bench::ns_per_op(RUNS, [&](uint64_t) { crc = call(cpu, CRC32, SOURCE, CRC_LENGTH); });
+
+    double words_ns = bench::ns_per_op(RUNS, [&](uint64_t) { call(cpu, MEMCPY_WORDS, DESTINATION, SOURCE, LENGTH); });
+    double misaligned_ns = bench::ns_per_op(RUNS, [&](uint64_t) { call(cpu, MEMCPY_WORDS, DESTINATION, SOURCE + 1, LENGTH); });
+
+    report_kernel("strlen, lbu loop", strlen_ns, LENGTH);
+    report_kernel("memcpy, lbu/sb loop", memcpy_ns, LENGTH);
+    report_kernel("crc32 bitwise, lbu", crc_ns, CRC_LENGTH);
+    report_kernel("memcpy, lw/sw loop", words_ns, LENGTH);
+    report_kernel("memcpy, lw/sw loop, misaligned source (split)", misaligned_ns, LENGTH);
+
+    bool correct = length == LENGTH - 1 && copied && crc == host_crc32(data, CRC_LENGTH);
+    std::cout << "results " << (correct ? "match" : "DO NOT match") << " the host\n";
+    return correct ? 0 : 1;
+}
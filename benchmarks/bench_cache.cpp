@@ -0,0 +1,135 @@
+// Cost and output of the cache model. Guest ns per instruction of the timing model with and
+// without the caches on a sequential sum over 128 KB, a column walk over a 256x256 word matrix
+// whose rows are padded to 1028 bytes, and an lbu/sb memcpy of 64 KB. Then the CPI and miss
+// rates of the column walk for L1D sizes from 4 KB to 64 KB and for each replacement policy.
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_asm.hpp"
+#include "bench_utils.hpp"
+#include "utils/plt.hpp"
+
+using namespace bench::rv;
+
+namespace {
+
+constexpr uint32_t SUM = 0x000;
+constexpr uint32_t COLUMNS = 0x100;
+constexpr uint32_t MEMCPY = 0x200;
+constexpr uint32_t DATA = 0x40000;
+constexpr uint32_t DESTINATION = 0xC0000;
+constexpr uint32_t LENGTH = 128 * 1024;
+constexpr uint64_t RUNS = 3;
+
+struct Kernel {
+    std::string name;
+    uint32_t entry;
+    uint32_t a0, a1, a2;
+};
+
+void load_kernels(CPU& cpu) {
+    // a0 = words, a1 = end, returns the sum in a2
+    load(cpu, SUM, {
+        lw(t0, a0, 0),
+        add(a2, a2, t0),
+        addi(a0, a0, 4),
+        bne(a0, a1, -12),
+        halt(),
+    });
+    // a0 = 256x256 word matrix with rows of 257 words, sums it column by column into a2
+    load(cpu, COLUMNS, {
+        addi(t2, zero, 256),        // columns left
+        lui(t3, 0x40),
+        addi(t3, t3, 0x400),        // 256 rows of 1028 bytes
+        add(t3, t3, a0),
+        addi(t0, a0, 0),            // 16: walk down the column
+        lw(t1, t0, 0),
+        add(a2, a2, t1),
+        addi(t0, t0, 1028),
+        bltu(t0, t3, -12),
+        addi(a0, a0, 4),
+        addi(t3, t3, 4),
+        addi(t2, t2, -1),
+        bne(t2, zero, -32),
+        halt(),
+    });
+    // a0 = destination, a1 = source, a2 = length in bytes
+    load(cpu, MEMCPY, {
+        beq(a2, zero, 28),
+        lbu(t0, a1, 0),
+        sb(t0, a0, 0),
+        addi(a0, a0, 1),
+        addi(a1, a1, 1),
+        addi(a2, a2, -1),
+        jal(zero, -24),
+        halt(),
+    });
+}
+
+std::unique_ptr<CPU> make_cpu(bool caches, const CacheHierarchyConfig& config = CacheHierarchyConfig{}) {
+    auto cpu = std::make_unique<CPU>(1024 * 1024);
+    cpu->set_translation_mode(TranslationMode::SATP);
+    cpu->set_timing_enabled(true);
+    cpu->set_cache_config(config);
+    cpu->set_cache_enabled(caches);
+    load_kernels(*cpu);
+    return cpu;
+}
+
+void run(CPU& cpu, const Kernel& kernel) {
+    cpu.set_register(a0, kernel.a0);
+    cpu.set_register(a1, kernel.a1);
+    cpu.set_register(a2, kernel.a2);
+    cpu.get_register_bank().set_pc(kernel.entry);
+    cpu.run(CPU::UNLIMITED);
+}
+
+void print_sizing(const std::string& name, const CacheHierarchyConfig& config, const Kernel& kernel) {
+    auto cpu = make_cpu(true, config);
+    run(*cpu, kernel);
+    const TimingStats& timing = cpu->get_timing_stats();
+    CacheHierarchyStats caches = cpu->get_cache_stats();
+    std::cout << "  " << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(3)
+              << "CPI " << timing.cpi() << ", L1D miss rate " << caches.l1d.miss_rate() << ", L2 miss rate "
+              << caches.l2.miss_rate() << ", memory stalls " << timing.memory_stalls << '\n';
+}
+
+} // namespace
+
+int main() {
+    plt::disable_debug();
+    const std::vector<Kernel> kernels = {
+        {"sequential sum, 128 KB", SUM, DATA, DATA + LENGTH, 0},
+        {"column walk, 1028 B stride", COLUMNS, DATA, 0, 0},
+        {"memcpy, lbu/sb loop", MEMCPY, DESTINATION, DATA, LENGTH / 2},
+    };
+
+    for (const Kernel& kernel : kernels) {
+        auto plain = make_cpu(false);
+        auto cached = make_cpu(true);
+        double plain_ns = bench::ns_per_op(RUNS, [&](uint64_t) { run(*plain, kernel); });
+        double cached_ns = bench::ns_per_op(RUNS, [&](uint64_t) { run(*cached, kernel); });
+        double instructions = static_cast<double>(cached->get_timing_stats().instructions) / RUNS;
+        bench::report(kernel.name + ", timing", plain_ns / instructions);
+        bench::report(kernel.name + ", timing + caches", cached_ns / instructions, plain_ns / instructions);
+    }
+
+    const Kernel& columns = kernels[1];
+    std::cout << "column walk, L1D size (4 ways, 64 B lines, 256 KB L2):\n";
+    for (uint32_t size = 4 * 1024; size <= 64 * 1024; size *= 2) {
+        CacheHierarchyConfig config;
+        config.l1d.size = size;
+        print_sizing(std::to_string(size / 1024) + " KB", config, columns);
+    }
+    std::cout << "column walk, 16 KB L1D replacement policy:\n";
+    for (auto [name, policy] : {std::pair{"LRU", ReplacementPolicy::LRU}, std::pair{"PLRU", ReplacementPolicy::PLRU},
+                                std::pair{"random", ReplacementPolicy::RANDOM}}) {
+        CacheHierarchyConfig config;
+        config.l1d.replacement = policy;
+        print_sizing(name, config, columns);
+    }
+    return 0;
+}
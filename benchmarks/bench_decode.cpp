@@ -0,0 +1,214 @@
+// Decode cost of one instruction over a large corpus of random valid encodings, in random order so
+// the host branch predictor cannot learn it: the opcode switch decoder the generated decode table
+// replaced against the table itself. Then the execute stage alone dispatching the compact form
+// through its handler table, and a whole pipeline step.
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "bench_asm.hpp"
+#include "bench_utils.hpp"
+#include "core/cpu/isa/CompactInstruction.hpp"
+#include "core/cpu/isa/Instruction.hpp"
+#include "core/cpu/isa/InstructionTable.hpp"
+#include "core/cpu/pipeline/execute/ExecuteStage.hpp"
+
+using namespace bench::rv;
+
+namespace {
+
+constexpr uint64_t ITERATIONS = 4'000'000;
+constexpr size_t CORPUS_SIZE = 1 << 18;
+constexpr uint64_t PIPELINE_ITERATIONS = 200'000;
+
+const std::vector<uint32_t> MIX = {
+    addi(t0, t0, 1),
+    xor_(t1, t1, t0),
+    slli(t2, t0, 2),
+    add(t3, t3, t2),
+    lw(t4, sp, -8),
+    sw(t4, sp, 12),
+    beq(t0, zero, -16),
+    lui(t5, 0x12345),
+    jal(ra, 2048),
+    srli(t6, t6, 7),
+};
+
+// Every instruction of INSTRUCTIONS equally likely, random bits in every field it does not fix
+std::vector<uint32_t> make_corpus() {
+    std::mt19937 rng(0x5EED);
+    std::uniform_int_distribution<size_t> pick(0, std::size(INSTRUCTIONS) - 1);
+    std::vector<uint32_t> corpus(CORPUS_SIZE);
+    for (uint32_t& raw : corpus) {
+        const InstructionDescription& description = INSTRUCTIONS[pick(rng)];
+        raw = (static_cast<uint32_t>(rng()) & ~description.mask) | description.match;
+    }
+    return corpus;
+}
+
+// The decoder the table replaced, one switch on the opcode, with the M and A extensions added the
+// same way so it decodes the whole corpus. Kept as the reference the table is measured against
+CompactInstruction switch_decode(uint32_t raw) {
+    using enum Operation;
+    Operation op = ILLEGAL;
+    int32_t imm = 0;
+    const uint32_t funct3 = raw >> 12 & 0x7;
+    const uint32_t funct7 = raw >> 25;
+    const int32_t immediate_i = static_cast<int32_t>(raw) >> 20;
+
+    switch (raw & 0x7F) {
+        case opcodes::OP: {
+            static constexpr Operation base[8] = {ADD, SLL, SLT, SLTU, XOR, SRL, OR, AND};
+            static constexpr Operation muldiv[8] = {MUL, MULH, MULHSU, MULHU, DIV, DIVU, REM, REMU};
+            if (funct7 == 0x00) {
+                op = base[funct3];
+            } else if (funct7 == 0x01) {
+                op = muldiv[funct3];
+            } else if (funct7 == 0x20 && funct3 == 0x0) {
+                op = SUB;
+            } else if (funct7 == 0x20 && funct3 == 0x5) {
+                op = SRA;
+            }
+            break;
+        }
+        case opcodes::OP_IMM: {
+            static constexpr Operation base[8] = {ADDI, SLLI, SLTI, SLTIU, XORI, SRLI, ORI, ANDI};
+            imm = immediate_i;
+            if (funct3 == 0x1 || funct3 == 0x5) {
+                imm &= 0x1F;
+                if (funct7 == 0x20 && funct3 == 0x5) {
+                    op = SRAI;
+                } else if (funct7 == 0x00) {
+                    op = base[funct3];
+                }
+            } else {
+                op = base[funct3];
+            }
+            break;
+        }
+        case opcodes::LOAD: {
+            static constexpr Operation widths[8] = {LB, LH, LW, ILLEGAL, LBU, LHU, ILLEGAL, ILLEGAL};
+            op = widths[funct3];
+            imm = immediate_i;
+            break;
+        }
+        case opcodes::STORE: {
+            static constexpr Operation widths[8] = {SB, SH, SW, ILLEGAL, ILLEGAL, ILLEGAL, ILLEGAL, ILLEGAL};
+            op = widths[funct3];
+            imm = (static_cast<int32_t>(raw & 0xFE000000) >> 20) | static_cast<int32_t>(raw >> 7 & 0x1F);
+            break;
+        }
+        case opcodes::BRANCH: {
+            static constexpr Operation conditions[8] = {BEQ, BNE, ILLEGAL, ILLEGAL, BLT, BGE, BLTU, BGEU};
+            op = conditions[funct3];
+            imm = (static_cast<int32_t>(raw & 0x80000000) >> 19) | static_cast<int32_t>((raw & 0x80) << 4)
+                  | static_cast<int32_t>(raw >> 20 & 0x7E0) | static_cast<int32_t>(raw >> 7 & 0x1E);
+            break;
+        }
+        case opcodes::LUI:
+        case opcodes::AUIPC:
+            op = (raw & 0x7F) == opcodes::LUI ? LUI : AUIPC;
+            imm = static_cast<int32_t>(raw & 0xFFFFF000);
+            break;
+        case opcodes::JAL:
+            op = JAL;
+            imm = (static_cast<int32_t>(raw & 0x80000000) >> 11) | static_cast<int32_t>(raw & 0xFF000)
+                  | static_cast<int32_t>(raw >> 9 & 0x800) | static_cast<int32_t>(raw >> 20 & 0x7FE);
+            break;
+        case opcodes::JALR:
+            op = funct3 == 0x0 ? JALR : ILLEGAL;
+            imm = immediate_i;
+            break;
+        case opcodes::MISC_MEM:
+            op = funct3 == 0x0 ? FENCE : funct3 == 0x1 ? FENCE_I : ILLEGAL;
+            break;
+        case opcodes::AMO:
+            // aq and rl, the low two bits of funct7, do not change the operation
+            if (funct3 == 0x2) {
+                switch (funct7 >> 2) {
+                    case 0x02: op = LR_W; break;
+                    case 0x03: op = SC_W; break;
+                    case 0x01: op = AMOSWAP_W; break;
+                    case 0x00: op = AMOADD_W; break;
+                    case 0x04: op = AMOXOR_W; break;
+                    case 0x0C: op = AMOAND_W; break;
+                    case 0x08: op = AMOOR_W; break;
+                    case 0x10: op = AMOMIN_W; break;
+                    case 0x14: op = AMOMAX_W; break;
+                    case 0x18: op = AMOMINU_W; break;
+                    case 0x1C: op = AMOMAXU_W; break;
+                    default: break;
+                }
+            }
+            break;
+        case opcodes::SYSTEM:
+            op = SYSTEM;
+            imm = static_cast<int32_t>(raw >> 20);
+            break;
+        default:
+            break;
+    }
+    return CompactInstruction{op, static_cast<uint8_t>(raw >> 7 & 0x1F), static_cast<uint8_t>(raw >> 15 & 0x1F),
+                              static_cast<uint8_t>(raw >> 20 & 0x1F), imm, raw};
+}
+
+} // namespace
+
+int main() {
+    RegisterBank register_bank;
+    ExecuteStage execute_stage(register_bank);
+
+    const std::vector<uint32_t> corpus = make_corpus();
+    for (uint32_t raw : corpus) {
+        CompactInstruction expected = switch_decode(raw);
+        CompactInstruction actual = decode_compact(raw);
+        if (actual.op != expected.op || actual.imm != expected.imm) {
+            std::cerr << "decoders disagree on 0x" << std::hex << raw << '\n';
+            return 1;
+        }
+    }
+
+    uint64_t sink = 0;
+    double switch_ns = bench::ns_per_op(ITERATIONS, [&](uint64_t i) {
+        CompactInstruction decoded = switch_decode(corpus[i % CORPUS_SIZE]);
+        sink += static_cast<uint32_t>(decoded.imm) + static_cast<uint32_t>(decoded.op) + decoded.rd;
+    });
+    double compact_ns = bench::ns_per_op(ITERATIONS, [&](uint64_t i) {
+        CompactInstruction decoded = decode_compact(corpus[i % CORPUS_SIZE]);
+        sink += static_cast<uint32_t>(decoded.imm) + static_cast<uint32_t>(decoded.op) + decoded.rd;
+    });
+    bench::do_not_optimize(sink);
+    bench::report("decode, opcode switch", switch_ns);
+    bench::report("decode, compact from the decode table", compact_ns, switch_ns);
+    std::cout << std::left << std::setw(48) << "" << std::right << std::setw(10)
+              << 1000.0 / compact_ns << " M instructions/s\n";
+
+    // Already decoded, the way the predecode cache hands instructions to the stages
+    std::vector<CompactInstruction> decoded;
+    for (uint32_t raw : MIX) {
+        decoded.push_back(decode_compact(raw));
+    }
+    register_bank.set_pc(0x1000);
+    double execute_ns = bench::ns_per_op(ITERATIONS, [&](uint64_t i) {
+        execute_stage.set_instruction(decoded[i % decoded.size()]);
+        execute_stage.process();
+        bench::do_not_optimize(execute_stage.get_result());
+    });
+    bench::report("execute stage, compact handler table", execute_ns);
+
+    // The whole pipeline on a loop run from the predecode cache
+    CPU cpu(1024 * 1024);
+    load(cpu, 0, {
+        addi(t0, t0, 1),
+        xor_(t1, t1, t0),
+        slli(t2, t0, 2),
+        add(t3, t3, t2),
+        sw(t3, zero, 0x100),
+        lw(t4, zero, 0x100),
+        jal(zero, -24),
+    });
+    double pipeline_ns = bench::ns_per_op(PIPELINE_ITERATIONS * 7, [&](uint64_t) { cpu.step(); });
+    bench::report("pipeline step, predecoded loop", pipeline_ns);
+    return 0;
+}
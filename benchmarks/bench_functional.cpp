@@ -0,0 +1,160 @@
+// Guest MIPS of the functional engine (ExecutionMode::FUNCTIONAL) compared with the pipeline:
+// the five word bubble sort of the CPU tests, the same sort on a larger array, an ALU loop and
+// a bitwise CRC-32. Both modes must leave the same registers and memory.
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_asm.hpp"
+#include "bench_utils.hpp"
+#include "utils/plt.hpp"
+
+using namespace bench::rv;
+
+namespace {
+
+constexpr uint32_t BUBBLE_SORT = 0x000;
+constexpr uint32_t ALU_LOOP = 0x100;
+constexpr uint32_t CRC32 = 0x200;
+constexpr uint32_t DATA = 0x10000;
+constexpr uint32_t LENGTH = 4096; // bytes of data, restored before every run
+
+struct Kernel {
+    std::string name;
+    uint32_t entry;
+    uint32_t a0, a1;
+    uint64_t runs;
+};
+
+void load_kernels(CPU& cpu) {
+    // a0 = array of signed words, a1 = count, sorts in place
+    load(cpu, BUBBLE_SORT, {
+        addi(a1, a1, -1),
+        bge(zero, a1, 48),
+        addi(t0, a0, 0),
+        addi(t1, a1, 0),
+        lw(t2, t0, 0),
+        lw(t3, t0, 4),
+        bge(t3, t2, 12),
+        sw(t3, t0, 0),
+        sw(t2, t0, 4),
+        addi(t0, t0, 4),
+        addi(t1, t1, -1),
+        bne(t1, zero, -28),
+        jal(zero, -48),
+        halt(),
+    });
+    // a0 = iterations
+    load(cpu, ALU_LOOP, {
+        addi(t0, t0, 1),
+        xor_(t1, t1, t0),
+        slli(t2, t0, 2),
+        add(t3, t3, t2),
+        addi(a0, a0, -1),
+        bne(a0, zero, -20),
+        halt(),
+    });
+    // a0 = buffer, a1 = length, returns the reflected CRC-32 in a0
+    load(cpu, CRC32, {
+        lui(t2, 0xEDB88),
+        addi(t2, t2, 0x320),
+        addi(t0, zero, -1),
+        beq(a1, zero, 52),
+        lbu(t1, a0, 0),
+        xor_(t0, t0, t1),
+        addi(t3, zero, 8),
+        andi(t4, t0, 1),
+        srli(t0, t0, 1),
+        beq(t4, zero, 8),
+        xor_(t0, t0, t2),
+        addi(t3, t3, -1),
+        bne(t3, zero, -20),
+        addi(a0, a0, 1),
+        addi(a1, a1, -1),
+        jal(zero, -48),
+        xori(a0, t0, -1),
+        halt(),
+    });
+}
+
+std::vector<uint32_t> make_data() {
+    // The array of the CPU bubble sort test first, then pseudo random words
+    std::vector<uint32_t> data = {5, 3, 4, 1, 2};
+    uint32_t state = 0x12345678;
+    while (data.size() < LENGTH / sizeof(uint32_t)) {
+        state = state * 1664525 + 1013904223;
+        data.push_back(state);
+    }
+    return data;
+}
+
+std::unique_ptr<CPU> make_cpu(ExecutionMode mode) {
+    auto cpu = std::make_unique<CPU>(1024 * 1024, MemoryBacking::HEAP, mode);
+    cpu->set_translation_mode(TranslationMode::SATP);
+    load_kernels(*cpu);
+    return cpu;
+}
+
+void start(CPU& cpu, const Kernel& kernel, const std::vector<uint32_t>& data) {
+    cpu.write_block(DATA, reinterpret_cast<const uint8_t*>(data.data()), LENGTH);
+    cpu.set_register(a0, kernel.a0);
+    cpu.set_register(a1, kernel.a1);
+    cpu.get_register_bank().set_pc(kernel.entry);
+}
+
+// Instructions retired by one call of the kernel, the final jump to self excluded
+uint64_t count_instructions(const Kernel& kernel, const std::vector<uint32_t>& data) {
+    auto cpu = make_cpu(ExecutionMode::PIPELINE);
+    start(*cpu, kernel, data);
+    return cpu->step(CPU::UNLIMITED).instructions;
+}
+
+bool same_state(CPU& left, CPU& right) {
+    for (uint8_t reg = 0; reg < 32; ++reg) {
+        if (left.get_register(reg) != right.get_register(reg)) {
+            return false;
+        }
+    }
+    std::vector<uint8_t> left_memory(LENGTH);
+    std::vector<uint8_t> right_memory(LENGTH);
+    left.read_block(DATA, left_memory.data(), LENGTH);
+    right.read_block(DATA, right_memory.data(), LENGTH);
+    return left.get_pc() == right.get_pc() && left_memory == right_memory;
+}
+
+} // namespace
+
+int main() {
+    plt::disable_debug();
+    const std::vector<uint32_t> data = make_data();
+    const std::vector<Kernel> kernels = {
+        {"bubble sort, 5 words", BUBBLE_SORT, DATA, 5, 20'000},
+        {"bubble sort, 512 words", BUBBLE_SORT, DATA, 512, 3},
+        {"alu loop", ALU_LOOP, 200'000, 0, 5},
+        {"crc32 bitwise", CRC32, DATA, LENGTH, 5},
+    };
+
+    bool identical = true;
+    for (const Kernel& kernel : kernels) {
+        uint64_t instructions = count_instructions(kernel, data);
+        double ns[2];
+        std::unique_ptr<CPU> cpus[2];
+        const ExecutionMode modes[2] = {ExecutionMode::PIPELINE, ExecutionMode::FUNCTIONAL};
+        for (int i = 0; i < 2; ++i) {
+            cpus[i] = make_cpu(modes[i]);
+            ns[i] = bench::ns_per_op(kernel.runs, [&](uint64_t) {
+                start(*cpus[i], kernel, data);
+                cpus[i]->run();
+            }) / static_cast<double>(instructions);
+        }
+        identical = identical && same_state(*cpus[0], *cpus[1]);
+
+        bench::report(kernel.name + ", pipeline", ns[0]);
+        bench::report(kernel.name + ", functional", ns[1], ns[0]);
+        std::cout << std::left << std::setw(48) << "" << std::right << std::setw(10) << 1000.0 / ns[0] << " -> "
+                  << 1000.0 / ns[1] << " MIPS (" << instructions << " instructions per run)\n";
+    }
+    std::cout << "final state " << (identical ? "identical" : "DIFFERS") << " between the engines\n";
+    return identical ? 0 : 1;
+}
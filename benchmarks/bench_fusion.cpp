@@ -0,0 +1,162 @@
+// Macro-op fusion in the pipeline: ns per guest instruction with fusion off and on, on kernels
+// written the way a compiler emits them for the medany code model. A loop calling a non-inlined
+// leaf function (the call is AUIPC+JALR, the function loads a global with AUIPC+LW, builds a 32
+// bit constant with LUI+ADDI and zero extends a halfword with SLLI+SRLI), a loop summing the low
+// halves of words (SLLI+SRLI), and a byte copy with no fusable pair, which shows the cost of
+// looking for one. Checks that both runs end in the same state.
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_asm.hpp"
+#include "bench_utils.hpp"
+#include "utils/plt.hpp"
+
+using namespace bench::rv;
+
+namespace {
+
+constexpr uint32_t CALL_LOOP = 0x0000;
+constexpr uint32_t MIX = 0x4000;        // far enough that the call cannot be a JAL in the same object
+constexpr uint32_t HALF_SUM = 0x8000;
+constexpr uint32_t BYTE_COPY = 0x8100;
+constexpr uint32_t SEED = 0x10000;      // the global MIX loads
+constexpr uint32_t RESULT = 0x10004;
+constexpr uint32_t DATA = 0x20000;
+constexpr uint32_t DESTINATION = 0x40000;
+constexpr uint32_t LENGTH = 8192;
+constexpr uint64_t RUNS = 20;
+
+// AUIPC and the low 12 bits of a PC-relative reference from pc to target
+uint32_t hi20(uint32_t pc, uint32_t target) {
+    return ((target - pc + 0x800) >> 12) & 0xFFFFF;
+}
+
+int32_t lo12(uint32_t pc, uint32_t target) {
+    return static_cast<int32_t>((target - pc) - (hi20(pc, target) << 12));
+}
+
+struct Kernel {
+    std::string name;
+    uint32_t entry;
+    uint32_t a0, a1;
+};
+
+void load_kernels(CPU& cpu) {
+    // a1 = iterations, calls MIX on a0 every iteration and stores the result in RESULT
+    load(cpu, CALL_LOOP, {
+        auipc(ra, hi20(CALL_LOOP + 0, MIX)),
+        jalr(ra, ra, lo12(CALL_LOOP + 0, MIX)),
+        addi(a1, a1, -1),
+        bne(a1, zero, -12),
+        auipc(t0, hi20(CALL_LOOP + 16, RESULT)),
+        sw(a0, t0, lo12(CALL_LOOP + 16, RESULT)),
+        halt(),
+    });
+    // a0 = state, returns the mixed state
+    load(cpu, MIX, {
+        auipc(t0, hi20(MIX, SEED)),
+        lw(t0, t0, lo12(MIX, SEED)),
+        lui(t1, 0x9E378),
+        addi(t1, t1, -0x647),   // 0x9E3779B9
+        xor_(a0, a0, t0),
+        add(a0, a0, t1),
+        slli(t2, a0, 16),
+        srli(t2, t2, 16),
+        slli(a0, a0, 5),
+        xor_(a0, a0, t2),
+        jalr(zero, ra, 0),
+    });
+    // a0 = words, a1 = count, returns the sum of their low halves in a2
+    load(cpu, HALF_SUM, {
+        lw(t0, a0, 0),
+        slli(t0, t0, 16),
+        srli(t0, t0, 16),
+        add(a2, a2, t0),
+        addi(a0, a0, 4),
+        addi(a1, a1, -1),
+        bne(a1, zero, -24),
+        halt(),
+    });
+    // a0 = destination, a1 = length, copies from DATA
+    load(cpu, BYTE_COPY, {
+        lui(t1, DATA >> 12),
+        lbu(t0, t1, 0),
+        sb(t0, a0, 0),
+        addi(a0, a0, 1),
+        addi(t1, t1, 1),
+        addi(a1, a1, -1),
+        bne(a1, zero, -20),
+        halt(),
+    });
+}
+
+struct Outcome {
+    double ns_per_instruction = 0.0;
+    uint64_t instructions = 0;
+    FusionStats fusion;
+    std::vector<uint32_t> state; // registers, then the result words
+};
+
+Outcome run_kernel(const Kernel& kernel, bool fusion) {
+    CPU cpu(1024 * 1024);
+    cpu.set_translation_mode(TranslationMode::SATP);
+    cpu.set_fusion_enabled(fusion);
+    load_kernels(cpu);
+    uint32_t seed = 0x2545F491;
+    cpu.write_block(SEED, reinterpret_cast<const uint8_t*>(&seed), sizeof(seed));
+    for (uint32_t i = 0; i < LENGTH; i += 4) {
+        uint32_t word = i * 2654435761u;
+        cpu.write_block(DATA + i, reinterpret_cast<const uint8_t*>(&word), sizeof(word));
+    }
+
+    Outcome outcome;
+    double ns = 0.0;
+    for (uint64_t run = 0; run < RUNS; ++run) {
+        for (uint8_t reg = 1; reg < 32; ++reg) {
+            cpu.set_register(reg, 0);
+        }
+        cpu.set_register(a0, kernel.a0);
+        cpu.set_register(a1, kernel.a1);
+        cpu.get_register_bank().set_pc(kernel.entry);
+        auto start = std::chrono::steady_clock::now();
+        RunResult result = cpu.run(CPU::UNLIMITED);
+        ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        outcome.instructions += result.instructions;
+    }
+    outcome.ns_per_instruction = ns / static_cast<double>(outcome.instructions);
+    outcome.fusion = cpu.get_fusion_stats();
+    for (uint8_t reg = 0; reg < 32; ++reg) {
+        outcome.state.push_back(cpu.get_register(reg));
+    }
+    outcome.state.push_back(cpu.read_word_from_memory(RESULT));
+    outcome.state.push_back(cpu.read_word_from_memory(DESTINATION + LENGTH - 4));
+    return outcome;
+}
+
+} // namespace
+
+int main() {
+    plt::disable_debug();
+    const std::vector<Kernel> kernels = {
+        {"call loop", CALL_LOOP, 1, 25'000},
+        {"halfword sum", HALF_SUM, DATA, LENGTH / 4},
+        {"byte copy", BYTE_COPY, DESTINATION, LENGTH},
+    };
+
+    bool identical = true;
+    for (const Kernel& kernel : kernels) {
+        Outcome unfused = run_kernel(kernel, false);
+        Outcome fused = run_kernel(kernel, true);
+        identical = identical && unfused.state == fused.state && unfused.instructions == fused.instructions;
+        bench::report(kernel.name + ", no fusion", unfused.ns_per_instruction);
+        bench::report(kernel.name + ", fusion", fused.ns_per_instruction, unfused.ns_per_instruction);
+        std::cout << "  " << fused.fusion.total() << " pairs fused, "
+                  << 200.0 * static_cast<double>(fused.fusion.total()) / static_cast<double>(fused.instructions)
+                  << "% of the instructions\n";
+    }
+    std::cout << "final state " << (identical ? "identical" : "DIFFERS") << " with and without fusion\n";
+    return identical ? 0 : 1;
+}
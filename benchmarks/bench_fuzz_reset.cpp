@@ -0,0 +1,45 @@
+// Fuzzing throughput: dirty page reset of one CPU versus constructing a fresh CPU per input.
+#include <cstdint>
+#include <iostream>
+
+#include "bench_utils.hpp"
+#include "core/fuzz/FuzzHarness.hpp"
+
+namespace {
+
+constexpr size_t MEMORY_SIZE = 64 * 1024 * 1024;
+constexpr uint32_t INPUT_ADDRESS = 0x800;
+
+// sw a1, 0x400(x0) then jump to self
+constexpr uint8_t PROGRAM[] = {0x23, 0x20, 0xB0, 0x40, 0x6F, 0x00, 0x00, 0x00};
+constexpr uint8_t INPUT[] = {'f', 'u', 'z', 'z'};
+
+void load(CPU& cpu) {
+    cpu.write_block(0, PROGRAM, sizeof(PROGRAM));
+}
+
+} // namespace
+
+int main() {
+    constexpr uint64_t RECONSTRUCT_ITERATIONS = 20;
+    double reconstruct = bench::ns_per_op(RECONSTRUCT_ITERATIONS, [](uint64_t) {
+        CPU cpu(MEMORY_SIZE);
+        load(cpu);
+        cpu.write_block(INPUT_ADDRESS, INPUT, sizeof(INPUT));
+        cpu.run();
+        bench::do_not_optimize(cpu.get_pc());
+    });
+
+    CPU cpu(MEMORY_SIZE);
+    load(cpu);
+    FuzzHarness harness(cpu, INPUT_ADDRESS, sizeof(INPUT), 1000);
+    double reset = bench::ns_per_op(200'000, [&](uint64_t) {
+        bench::do_not_optimize(harness.run(INPUT, sizeof(INPUT)).instructions);
+    });
+
+    bench::report("64 MB CPU, construct per input", reconstruct);
+    bench::report("64 MB CPU, dirty page reset per input", reset, reconstruct);
+    std::cout << "execs/sec: construct " << 1e9 / reconstruct << ", dirty reset "
+              << harness.get_stats().execs_per_second << '\n';
+    return 0;
+}
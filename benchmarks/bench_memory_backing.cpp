@@ -0,0 +1,51 @@
+// Construction cost and hot access cost of the HEAP and RESERVED physical memory backings.
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "bench_utils.hpp"
+#include "core/memory/MMU.hpp"
+
+namespace {
+
+constexpr uint64_t ITERATIONS = 20'000'000;
+constexpr uint32_t WINDOW = 64 * 1024;
+
+double construction_ms(size_t size, MemoryBacking backing) {
+    auto start = std::chrono::steady_clock::now();
+    {
+        PhysicalMemory memory(size, backing);
+        bench::do_not_optimize(memory.get_size());
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+double hot_read_ns(MemoryBacking backing) {
+    PhysicalMemory memory(16 * 1024 * 1024, backing);
+    PageTable page_table;
+    MMU mmu(&memory, &page_table, PrivilegeMode::MACHINE);
+    mmu.set_translation_mode(TranslationMode::SATP); // bare, machine mode
+    return bench::ns_per_op(ITERATIONS, [&](uint64_t i) {
+        bench::do_not_optimize(mmu.read_word(static_cast<uint32_t>((i * 4) % WINDOW)));
+    });
+}
+
+} // namespace
+
+int main() {
+    for (size_t mb : {1, 64, 512}) {
+        std::string size = std::to_string(mb) + " MB";
+        double heap = construction_ms(mb * 1024 * 1024, MemoryBacking::HEAP);
+        double reserved = construction_ms(mb * 1024 * 1024, MemoryBacking::RESERVED);
+        std::cout << "construct " << size << ": heap " << heap << " ms, reserved " << reserved << " ms\n";
+    }
+    std::cout << "construct 4096 MB: reserved "
+              << construction_ms(PhysicalMemory::ADDRESS_SPACE_SIZE, MemoryBacking::RESERVED) << " ms\n";
+
+    double heap = hot_read_ns(MemoryBacking::HEAP);
+    double reserved = hot_read_ns(MemoryBacking::RESERVED);
+    bench::report("read_word, heap backing", heap);
+    bench::report("read_word, reserved backing", reserved, heap);
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Per-access cost of the MMU load/store paths.
+// The "byte composed" cases reproduce how read_word/write_word used to be built from four
+// byte accesses, each one translated and bounds checked on its own.
+#include <cstdint>
+
+#include "bench_utils.hpp"
+#include "core/memory/MMU.hpp"
+
+namespace {
+
+constexpr uint64_t ITERATIONS = 20'000'000;
+constexpr uint32_t WINDOW = 64 * 1024;  // 16 pages, all of them stay in the TLB
+constexpr uint32_t MEMORY_SIZE = 1024 * 1024;
+
+uint32_t read_word_byte_composed(MMU& mmu, uint32_t address) {
+    uint32_t word = 0;
+    word |= static_cast<uint32_t>(mmu.read(address));
+    word |= static_cast<uint32_t>(mmu.read(address + 1)) << 8;
+    word |= static_cast<uint32_t>(mmu.read(address + 2)) << 16;
+    word |= static_cast<uint32_t>(mmu.read(address + 3)) << 24;
+    return word;
+}
+
+void write_word_byte_composed(MMU& mmu, uint32_t address, uint32_t value) {
+    mmu.write(address, static_cast<uint8_t>(value & 0xFF));
+    mmu.write(address + 1, static_cast<uint8_t>((value >> 8) & 0xFF));
+    mmu.write(address + 2, static_cast<uint8_t>((value >> 16) & 0xFF));
+    mmu.write(address + 3, static_cast<uint8_t>((value >> 24) & 0xFF));
+}
+
+} // namespace
+
+int main() {
+    PhysicalMemory physical_memory(MEMORY_SIZE);
+    PageTable page_table;
+    for (uint32_t page = 0; page < MEMORY_SIZE; page += MMU::PAGE_SIZE) {
+        page_table.add_entry(page, PageTableEntry(page | PageTableEntry::VALID_BIT | PageTableEntry::READ_BIT
+                                                       | PageTableEntry::WRITE_BIT | PageTableEntry::EXECUTE_BIT));
+    }
+    MMU mmu(&physical_memory, &page_table, PrivilegeMode::MACHINE);
+
+    auto word_address = [](uint64_t i) { return static_cast<uint32_t>((i * 4) % WINDOW); };
+
+    double byte_read = bench::ns_per_op(ITERATIONS, [&](uint64_t i) {
+        bench::do_not_optimize(read_word_byte_composed(mmu, word_address(i)));
+    });
+    double native_read = bench::ns_per_op(ITERATIONS, [&](uint64_t i) {
+        bench::do_not_optimize(mmu.read_word(word_address(i)));
+    });
+    double byte_write = bench::ns_per_op(ITERATIONS, [&](uint64_t i) {
+        write_word_byte_composed(mmu, word_address(i), static_cast<uint32_t>(i));
+    });
+    double native_write = bench::ns_per_op(ITERATIONS, [&](uint64_t i) {
+        mmu.write_word(word_address(i), static_cast<uint32_t>(i));
+    });
+    double fetch = bench::ns_per_op(ITERATIONS, [&](uint64_t i) {
+        bench::do_not_optimize(mmu.fetch_word(word_address(i)));
+    });
+    double halfword = bench::ns_per_op(ITERATIONS, [&](uint64_t i) {
+        bench::do_not_optimize(mmu.read_halfword(static_cast<uint32_t>((i * 2) % WINDOW)));
+    });
+    double doubleword = bench::ns_per_op(ITERATIONS, [&](uint64_t i) {
+        bench::do_not_optimize(mmu.read_doubleword(static_cast<uint32_t>((i * 8) % WINDOW)));
+    });
+    // Misaligned accesses miss the TLB compare on purpose and are assembled by the slow path
+    double misaligned = bench::ns_per_op(ITERATIONS, [&](uint64_t i) {
+        bench::do_not_optimize(mmu.read_word(word_address(i) % (WINDOW - 8) + 1));
+    });
+    // Every access straddles two pages and takes the split slow path
+    double crossing = bench::ns_per_op(ITERATIONS, [&](uint64_t i) {
+        uint32_t page = static_cast<uint32_t>((i * MMU::PAGE_SIZE) % (WINDOW - MMU::PAGE_SIZE));
+        bench::do_not_optimize(mmu.read_word(page + MMU::PAGE_SIZE - 2));
+    });
+
+    bench::report("read_word, 4 byte accesses (before)", byte_read);
+    bench::report("read_word, single access", native_read, byte_read);
+    bench::report("write_word, 4 byte accesses (before)", byte_write);
+    bench::report("write_word, single access", native_write, byte_write);
+    bench::report("fetch_word", fetch);
+    bench::report("read_halfword", halfword);
+    bench::report("read_doubleword", doubleword);
+    bench::report("read_word misaligned inside a page", misaligned);
+    bench::report("read_word crossing a page boundary", crossing);
+    return 0;
+}
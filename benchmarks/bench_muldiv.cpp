@@ -0,0 +1,229 @@
+// M extension against software multiply and divide: the same kernels built for rv32i, calling
+// shift-and-add and shift-and-subtract routines like libgcc's __mulsi3 and __udivsi3, and built
+// for rv32im with MUL, DIVU and REMU. A dot product of 16-bit samples, and the sum of the digits
+// of words in a base passed in a register so no compiler could turn the division into a multiply.
+// For each engine, ns per kernel call and guest instructions of both builds, which must return
+// the same result as the host.
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_asm.hpp"
+#include "bench_utils.hpp"
+#include "utils/plt.hpp"
+
+using namespace bench::rv;
+
+namespace {
+
+constexpr uint32_t DOT_I = 0x000;
+constexpr uint32_t DOT_IM = 0x080;
+constexpr uint32_t DIGITS_I = 0x100;
+constexpr uint32_t DIGITS_IM = 0x180;
+constexpr uint32_t MULSI3 = 0x200;
+constexpr uint32_t UDIVMOD = 0x280;
+constexpr uint32_t SAMPLES = 0x10000;
+constexpr uint32_t COEFFICIENTS = 0x20000;
+constexpr uint32_t WORDS = 0x30000;
+constexpr uint32_t DOT_COUNT = 4096;
+constexpr uint32_t DIGITS_COUNT = 1024;
+constexpr uint32_t BASE = 10;
+constexpr uint64_t RUNS = 3;
+
+struct Kernel {
+    std::string name;
+    uint32_t entry_i;   // rv32i build
+    uint32_t entry_im;  // rv32im build
+    uint32_t data;      // s0
+    uint32_t count;
+};
+
+void load_kernels(CPU& cpu) {
+    // s0 = samples, s1 = coefficients, a4 = count, returns the sum of the products in a2
+    load(cpu, DOT_I, {
+        lw(a0, s0, 0),
+        lw(a1, s1, 0),
+        jal(ra, MULSI3 - (DOT_I + 8)),
+        add(a2, a2, a0),
+        addi(s0, s0, 4),
+        addi(s1, s1, 4),
+        addi(a4, a4, -1),
+        bne(a4, zero, -28),
+        halt(),
+    });
+    load(cpu, DOT_IM, {
+        lw(a0, s0, 0),
+        lw(a1, s1, 0),
+        mul(a0, a0, a1),
+        add(a2, a2, a0),
+        addi(s0, s0, 4),
+        addi(s1, s1, 4),
+        addi(a4, a4, -1),
+        bne(a4, zero, -28),
+        halt(),
+    });
+    // s0 = words, a4 = count, a5 = base, returns the sum of the digits in a2
+    load(cpu, DIGITS_I, {
+        lw(a3, s0, 0),
+        addi(a0, a3, 0),            // 4
+        addi(a1, a5, 0),
+        jal(ra, UDIVMOD - (DIGITS_I + 12)),
+        add(a2, a2, a1),
+        addi(a3, a0, 0),
+        bne(a3, zero, -20),
+        addi(s0, s0, 4),
+        addi(a4, a4, -1),
+        bne(a4, zero, -36),
+        halt(),
+    });
+    load(cpu, DIGITS_IM, {
+        lw(a3, s0, 0),
+        remu(t5, a3, a5),           // 4
+        add(a2, a2, t5),
+        divu(a3, a3, a5),
+        bne(a3, zero, -12),
+        addi(s0, s0, 4),
+        addi(a4, a4, -1),
+        bne(a4, zero, -28),
+        halt(),
+    });
+    // a0 = a0 * a1, one step per bit of a1. Clobbers a1, t0 and t1
+    load(cpu, MULSI3, {
+        addi(t0, a0, 0),
+        addi(a0, zero, 0),
+        andi(t1, a1, 1),            // 8
+        beq(t1, zero, 8),
+        add(a0, a0, t0),
+        srli(a1, a1, 1),
+        slli(t0, t0, 1),
+        bne(a1, zero, -20),
+        jalr(zero, ra, 0),
+    });
+    // a0 = a0 / a1 and a1 = a0 % a1 for a divisor below 2^31, restoring division one quotient
+    // bit at a time. Clobbers t0 to t3
+    load(cpu, UDIVMOD, {
+        addi(t0, zero, 0),
+        addi(t1, zero, 0),
+        addi(t2, zero, 32),
+        srli(t3, a0, 31),           // 12
+        slli(t1, t1, 1),
+        or_(t1, t1, t3),
+        slli(a0, a0, 1),
+        slli(t0, t0, 1),
+        bltu(t1, a1, 12),
+        sub(t1, t1, a1),
+        ori(t0, t0, 1),
+        addi(t2, t2, -1),           // 44
+        bne(t2, zero, -36),
+        addi(a0, t0, 0),
+        addi(a1, t1, 0),
+        jalr(zero, ra, 0),
+    });
+}
+
+std::vector<uint32_t> make_words(uint32_t count, uint32_t seed, uint32_t mask) {
+    std::vector<uint32_t> words(count);
+    uint32_t state = seed;
+    for (uint32_t& word : words) {
+        state = state * 1664525 + 1013904223;
+        word = state & mask;
+    }
+    return words;
+}
+
+struct Data {
+    std::vector<uint32_t> samples;
+    std::vector<uint32_t> coefficients;
+    std::vector<uint32_t> words;
+};
+
+void write_words(CPU& cpu, uint32_t address, const std::vector<uint32_t>& words) {
+    cpu.write_block(address, reinterpret_cast<const uint8_t*>(words.data()), words.size() * sizeof(uint32_t));
+}
+
+std::unique_ptr<CPU> make_cpu(ExecutionMode mode, const Data& data) {
+    auto cpu = std::make_unique<CPU>(1024 * 1024, MemoryBacking::HEAP, mode);
+    cpu->set_translation_mode(TranslationMode::SATP);
+    load_kernels(*cpu);
+    write_words(*cpu, SAMPLES, data.samples);
+    write_words(*cpu, COEFFICIENTS, data.coefficients);
+    write_words(*cpu, WORDS, data.words);
+    return cpu;
+}
+
+void start(CPU& cpu, const Kernel& kernel, uint32_t entry) {
+    cpu.set_register(s0, kernel.data);
+    cpu.set_register(s1, COEFFICIENTS);
+    cpu.set_register(a2, 0);
+    cpu.set_register(a4, kernel.count);
+    cpu.set_register(a5, BASE);
+    cpu.get_register_bank().set_pc(entry);
+}
+
+// Returns a2, the result of the kernel
+uint32_t run(CPU& cpu, const Kernel& kernel, uint32_t entry) {
+    start(cpu, kernel, entry);
+    cpu.run(CPU::UNLIMITED);
+    return cpu.get_register(a2);
+}
+
+// Instructions retired by one call of the kernel, the final jump to self excluded
+uint64_t count_instructions(CPU& cpu, const Kernel& kernel, uint32_t entry) {
+    start(cpu, kernel, entry);
+    return cpu.step(CPU::UNLIMITED).instructions;
+}
+
+} // namespace
+
+int main() {
+    plt::disable_debug();
+    // Samples and coefficients of 16 bits, full words for the digits
+    const Data data = {
+        make_words(DOT_COUNT, 0x12345678, 0xFFFF),
+        make_words(DOT_COUNT, 0x9E3779B9, 0xFFFF),
+        make_words(DIGITS_COUNT, 0x2545F491, 0xFFFFFFFF),
+    };
+    uint32_t dot = 0;
+    for (uint32_t i = 0; i < DOT_COUNT; ++i) {
+        dot += data.samples[i] * data.coefficients[i];
+    }
+    uint32_t digits = 0;
+    for (uint32_t word : data.words) {
+        for (uint32_t value = word; value != 0; value /= BASE) {
+            digits += value % BASE;
+        }
+    }
+
+    const std::vector<Kernel> kernels = {
+        {"dot product, 4096 samples", DOT_I, DOT_IM, SAMPLES, DOT_COUNT},
+        {"digit sum, 1024 words", DIGITS_I, DIGITS_IM, WORDS, DIGITS_COUNT},
+    };
+    const std::vector<uint32_t> expected = {dot, digits};
+    const ExecutionMode modes[4] = {ExecutionMode::PIPELINE, ExecutionMode::FUNCTIONAL, ExecutionMode::THREADED,
+                                    ExecutionMode::JIT};
+    const char* mode_names[4] = {"pipeline", "functional", "threaded", "jit"};
+
+    bool correct = true;
+    for (size_t k = 0; k < kernels.size(); ++k) {
+        const Kernel& kernel = kernels[k];
+        auto counter = make_cpu(ExecutionMode::PIPELINE, data);
+        uint64_t instructions_i = count_instructions(*counter, kernel, kernel.entry_i);
+        uint64_t instructions_im = count_instructions(*counter, kernel, kernel.entry_im);
+        std::cout << kernel.name << ": " << instructions_i << " rv32i instructions, " << instructions_im
+                  << " rv32im instructions\n";
+        for (int m = 0; m < 4; ++m) {
+            auto cpu = make_cpu(modes[m], data);
+            uint32_t result_i = 0;
+            uint32_t result_im = 0;
+            double ns_i = bench::ns_per_op(RUNS, [&](uint64_t) { result_i = run(*cpu, kernel, kernel.entry_i); });
+            double ns_im = bench::ns_per_op(RUNS, [&](uint64_t) { result_im = run(*cpu, kernel, kernel.entry_im); });
+            correct = correct && result_i == expected[k] && result_im == expected[k];
+            bench::report(std::string("  rv32i soft, ") + mode_names[m], ns_i);
+            bench::report(std::string("  rv32im, ") + mode_names[m], ns_im, ns_i);
+        }
+    }
+    std::cout << "results " << (correct ? "match" : "DIFFER FROM") << " the host\n";
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,47 @@
+// Cost per instruction of a tight loop run from the predecode cache, compared with the same
+// loop when a FENCE.I every iteration forces every instruction to be fetched and decoded again.
+#include <cstdint>
+#include <iostream>
+
+#include "bench_asm.hpp"
+#include "bench_utils.hpp"
+
+using namespace bench::rv;
+
+namespace {
+
+constexpr uint64_t ITERATIONS = 200'000;
+constexpr uint32_t FENCE_I = 0x0000100F;
+constexpr uint32_t NOP = 0x00000013; // addi x0, x0, 0
+
+// 6 instruction loop body, the last slot is a nop or a FENCE.I
+double ns_per_instruction(uint32_t last_instruction, PredecodeStats& stats) {
+    CPU cpu(1024 * 1024);
+    load(cpu, 0, {
+        addi(t0, t0, 1),
+        xor_(t1, t1, t0),
+        slli(t2, t0, 2),
+        add(t3, t3, t2),
+        last_instruction,
+        jal(zero, -20),
+    });
+    cpu.reset_predecode_stats();
+    double ns = bench::ns_per_op(ITERATIONS * 6, [&](uint64_t) { cpu.step(); });
+    stats = cpu.get_predecode_stats();
+    return ns;
+}
+
+} // namespace
+
+int main() {
+    PredecodeStats decoded;
+    PredecodeStats cached;
+    double decode_every_time = ns_per_instruction(FENCE_I, decoded);
+    double predecoded = ns_per_instruction(NOP, cached);
+
+    bench::report("loop, FENCE.I every iteration (decode)", decode_every_time);
+    bench::report("loop, predecode cache", predecoded, decode_every_time);
+    std::cout << "hit rate: " << decoded.hit_rate() * 100.0 << "% with FENCE.I, "
+              << cached.hit_rate() * 100.0 << "% without\n";
+    return 0;
+}
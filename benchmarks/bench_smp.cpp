@@ -0,0 +1,94 @@
+// Aggregate guest MIPS of a Machine running 1, 2, 4 and 8 harts in PARALLEL mode, each on its own
+// data page so nothing is shared but the final amoadd into a common counter, and the same work
+// in DETERMINISTIC mode on one host thread. Efficiency is the aggregate MIPS over the hart count
+// times the MIPS of one hart, it can only approach 1 with as many host cores as harts.
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_asm.hpp"
+#include "bench_utils.hpp"
+#include "core/machine/Machine.hpp"
+#include "utils/plt.hpp"
+
+using namespace bench::rv;
+
+namespace {
+
+constexpr uint32_t MHARTID = 0xF14;
+constexpr uint32_t DATA = 0x10000;    // hart i works on the page at DATA + i * 4K
+constexpr uint32_t COUNTER = 0x20000; // every hart adds its final count here
+constexpr uint32_t ITERATIONS = 2'000'000;
+
+// a0 = iterations, increments a word of the hart's page that many times
+const std::vector<uint32_t> PROGRAM = {
+    csrr(t0, MHARTID),
+    slli(t0, t0, 12),
+    lui(t1, DATA >> 12),
+    add(t0, t0, t1),
+    lw(t2, t0, 0),          // 16: loop
+    addi(t2, t2, 1),
+    sw(t2, t0, 0),
+    xor_(t3, t3, t2),
+    addi(a0, a0, -1),
+    bne(a0, zero, -20),
+    lui(t4, COUNTER >> 12),
+    amoadd_w(zero, t2, t4),
+    halt(),
+};
+
+struct Measure {
+    double mips = 0.0;
+    bool correct = false;
+};
+
+Measure measure(size_t harts, SchedulingMode scheduling) {
+    Machine machine(harts, 1024 * 1024, MemoryBacking::HEAP, ExecutionMode::THREADED);
+    machine.set_config(MachineConfig{scheduling, 10'000});
+    load(machine.get_hart(0), 0, PROGRAM);
+    for (size_t hart = 0; hart < harts; ++hart) {
+        machine.get_hart(hart).set_register(a0, ITERATIONS);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<RunResult> results = machine.run();
+    auto end = std::chrono::steady_clock::now();
+
+    uint64_t instructions = 0;
+    bool halted = true;
+    for (const RunResult& result : results) {
+        instructions += result.instructions;
+        halted = halted && result.reason == StopReason::HALTED;
+    }
+    double seconds = std::chrono::duration<double>(end - start).count();
+    uint32_t counter = machine.get_hart(0).read_word_from_memory(COUNTER);
+    return Measure{static_cast<double>(instructions) / seconds / 1e6, halted && counter == harts * ITERATIONS};
+}
+
+} // namespace
+
+int main() {
+    plt::disable_debug();
+    std::cout << "host threads: " << std::thread::hardware_concurrency() << '\n';
+
+    bool correct = true;
+    double single = 0.0;
+    for (size_t harts : {1, 2, 4, 8}) {
+        Measure parallel = measure(harts, SchedulingMode::PARALLEL);
+        Measure deterministic = measure(harts, SchedulingMode::DETERMINISTIC);
+        if (harts == 1) {
+            single = parallel.mips;
+        }
+        correct = correct && parallel.correct && deterministic.correct;
+        std::cout << std::left << std::setw(10) << (std::to_string(harts) + " harts") << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(10) << parallel.mips << " MIPS parallel"
+                  << std::setprecision(2) << std::setw(8) << parallel.mips / (single * static_cast<double>(harts))
+                  << " efficiency" << std::setprecision(1) << std::setw(10) << deterministic.mips
+                  << " MIPS deterministic\n";
+    }
+    std::cout << "shared counter " << (correct ? "correct" : "WRONG") << " in every run\n";
+    return correct ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+// Guest MIPS of the threaded block engine and of its JIT tier compared with the pipeline on the
+// same kernels: an ALU loop, a byte memcpy and a bitwise CRC-32. Every mode must leave the same
+// registers and memory.
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_asm.hpp"
+#include "bench_utils.hpp"
+#include "utils/plt.hpp"
+
+using namespace bench::rv;
+
+namespace {
+
+constexpr uint32_t ALU_LOOP = 0x000;
+constexpr uint32_t MEMCPY = 0x100;
+constexpr uint32_t CRC32 = 0x200;
+constexpr uint32_t SOURCE = 0x10000;
+constexpr uint32_t DESTINATION = 0x40000;
+constexpr uint32_t LENGTH = 4096;
+constexpr uint64_t RUNS = 5;
+
+struct Kernel {
+    std::string name;
+    uint32_t entry;
+    uint32_t a0, a1, a2;
+};
+
+void load_kernels(CPU& cpu) {
+    // a0 = iterations
+    load(cpu, ALU_LOOP, {
+        addi(t0, t0, 1),
+        xor_(t1, t1, t0),
+        slli(t2, t0, 2),
+        add(t3, t3, t2),
+        addi(a0, a0, -1),
+        bne(a0, zero, -20),
+        halt(),
+    });
+    // a0 = destination, a1 = source, a2 = length in bytes
+    load(cpu, MEMCPY, {
+        beq(a2, zero, 28),
+        lbu(t0, a1, 0),
+        sb(t0, a0, 0),
+        addi(a0, a0, 1),
+        addi(a1, a1, 1),
+        addi(a2, a2, -1),
+        jal(zero, -24),
+        halt(),
+    });
+    // a0 = buffer, a1 = length, returns the reflected CRC-32 in a0
+    load(cpu, CRC32, {
+        lui(t2, 0xEDB88),
+        addi(t2, t2, 0x320),
+        addi(t0, zero, -1),
+        beq(a1, zero, 52),
+        lbu(t1, a0, 0),
+        xor_(t0, t0, t1),
+        addi(t3, zero, 8),
+        andi(t4, t0, 1),
+        srli(t0, t0, 1),
+        beq(t4, zero, 8),
+        xor_(t0, t0, t2),
+        addi(t3, t3, -1),
+        bne(t3, zero, -20),
+        addi(a0, a0, 1),
+        addi(a1, a1, -1),
+        jal(zero, -48),
+        xori(a0, t0, -1),
+        halt(),
+    });
+}
+
+std::unique_ptr<CPU> make_cpu(ExecutionMode mode) {
+    auto cpu = std::make_unique<CPU>(1024 * 1024);
+    cpu->set_translation_mode(TranslationMode::SATP);
+    cpu->set_execution_mode(mode);
+    load_kernels(*cpu);
+    std::vector<uint8_t> data(LENGTH);
+    for (uint32_t i = 0; i < LENGTH; ++i) {
+        data[i] = static_cast<uint8_t>(i * 13 + 7);
+    }
+    cpu->write_block(SOURCE, data.data(), data.size());
+    return cpu;
+}
+
+void start(CPU& cpu, const Kernel& kernel) {
+    cpu.set_register(a0, kernel.a0);
+    cpu.set_register(a1, kernel.a1);
+    cpu.set_register(a2, kernel.a2);
+    cpu.get_register_bank().set_pc(kernel.entry);
+}
+
+// Instructions retired by one call of the kernel, the final jump to self excluded
+uint64_t count_instructions(const Kernel& kernel) {
+    auto cpu = make_cpu(ExecutionMode::PIPELINE);
+    start(*cpu, kernel);
+    return cpu->step(CPU::UNLIMITED).instructions;
+}
+
+bool same_state(CPU& left, CPU& right) {
+    for (uint8_t reg = 0; reg < 32; ++reg) {
+        if (left.get_register(reg) != right.get_register(reg)) {
+            return false;
+        }
+    }
+    std::vector<uint8_t> left_memory(LENGTH);
+    std::vector<uint8_t> right_memory(LENGTH);
+    left.read_block(DESTINATION, left_memory.data(), LENGTH);
+    right.read_block(DESTINATION, right_memory.data(), LENGTH);
+    return left.get_pc() == right.get_pc() && left_memory == right_memory;
+}
+
+} // namespace
+
+int main() {
+    plt::disable_debug();
+    const std::vector<Kernel> kernels = {
+        {"alu loop", ALU_LOOP, 200'000, 0, 0},
+        {"memcpy, lbu/sb loop", MEMCPY, DESTINATION, SOURCE, LENGTH},
+        {"crc32 bitwise", CRC32, SOURCE, LENGTH / 4, 0},
+    };
+
+    bool identical = true;
+    for (const Kernel& kernel : kernels) {
+        uint64_t instructions = count_instructions(kernel);
+        double ns[3];
+        std::unique_ptr<CPU> cpus[3];
+        const ExecutionMode modes[3] = {ExecutionMode::PIPELINE, ExecutionMode::THREADED, ExecutionMode::JIT};
+        for (int i = 0; i < 3; ++i) {
+            cpus[i] = make_cpu(modes[i]);
+            ns[i] = bench::ns_per_op(RUNS, [&](uint64_t) {
+                start(*cpus[i], kernel);
+                cpus[i]->run();
+            }) / static_cast<double>(instructions);
+        }
+        identical = identical && same_state(*cpus[0], *cpus[1]) && same_state(*cpus[0], *cpus[2]);
+
+        bench::report(kernel.name + ", pipeline", ns[0]);
+        bench::report(kernel.name + ", threaded", ns[1], ns[0]);
+        bench::report(kernel.name + ", jit", ns[2], ns[0]);
+        std::cout << std::left << std::setw(48) << "" << std::right << std::setw(10) << 1000.0 / ns[0] << " -> "
+                  << 1000.0 / ns[1] << " -> " << 1000.0 / ns[2] << " MIPS\n";
+    }
+    std::cout << "final state " << (identical ? "identical" : "DIFFERS") << " between the engines\n";
+    return identical ? 0 : 1;
+}
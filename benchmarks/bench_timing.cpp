@@ -0,0 +1,153 @@
+// Cost of the cycle-approximate timing model: guest MIPS of the pipeline with timing off and on,
+// and simulated cycles per host second, on a bubble sort, a memcpy and a bitwise CRC-32. Also
+// prints the CPI and stalls of each kernel with full forwarding and with none.
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_asm.hpp"
+#include "bench_utils.hpp"
+#include "utils/plt.hpp"
+
+using namespace bench::rv;
+
+namespace {
+
+constexpr uint32_t BUBBLE_SORT = 0x000;
+constexpr uint32_t MEMCPY = 0x100;
+constexpr uint32_t CRC32 = 0x200;
+constexpr uint32_t DATA = 0x10000;
+constexpr uint32_t DESTINATION = 0x40000;
+constexpr uint32_t LENGTH = 4096;
+constexpr uint64_t RUNS = 3;
+
+struct Kernel {
+    std::string name;
+    uint32_t entry;
+    uint32_t a0, a1, a2;
+};
+
+void load_kernels(CPU& cpu) {
+    // a0 = array of signed words, a1 = count, sorts in place
+    load(cpu, BUBBLE_SORT, {
+        addi(a1, a1, -1),
+        bge(zero, a1, 48),
+        addi(t0, a0, 0),
+        addi(t1, a1, 0),
+        lw(t2, t0, 0),
+        lw(t3, t0, 4),
+        bge(t3, t2, 12),
+        sw(t3, t0, 0),
+        sw(t2, t0, 4),
+        addi(t0, t0, 4),
+        addi(t1, t1, -1),
+        bne(t1, zero, -28),
+        jal(zero, -48),
+        halt(),
+    });
+    // a0 = destination, a1 = source, a2 = length in bytes
+    load(cpu, MEMCPY, {
+        beq(a2, zero, 28),
+        lbu(t0, a1, 0),
+        sb(t0, a0, 0),
+        addi(a0, a0, 1),
+        addi(a1, a1, 1),
+        addi(a2, a2, -1),
+        jal(zero, -24),
+        halt(),
+    });
+    // a0 = buffer, a1 = length, returns the reflected CRC-32 in a0
+    load(cpu, CRC32, {
+        lui(t2, 0xEDB88),
+        addi(t2, t2, 0x320),
+        addi(t0, zero, -1),
+        beq(a1, zero, 52),
+        lbu(t1, a0, 0),
+        xor_(t0, t0, t1),
+        addi(t3, zero, 8),
+        andi(t4, t0, 1),
+        srli(t0, t0, 1),
+        beq(t4, zero, 8),
+        xor_(t0, t0, t2),
+        addi(t3, t3, -1),
+        bne(t3, zero, -20),
+        addi(a0, a0, 1),
+        addi(a1, a1, -1),
+        jal(zero, -48),
+        xori(a0, t0, -1),
+        halt(),
+    });
+}
+
+std::vector<uint32_t> make_data() {
+    std::vector<uint32_t> data;
+    uint32_t state = 0x12345678;
+    while (data.size() < LENGTH / sizeof(uint32_t)) {
+        state = state * 1664525 + 1013904223;
+        data.push_back(state);
+    }
+    return data;
+}
+
+std::unique_ptr<CPU> make_cpu(bool timing, const TimingConfig& config = TimingConfig{}) {
+    auto cpu = std::make_unique<CPU>(1024 * 1024);
+    cpu->set_translation_mode(TranslationMode::SATP);
+    cpu->set_timing_enabled(timing);
+    cpu->set_timing_config(config);
+    load_kernels(*cpu);
+    return cpu;
+}
+
+void run(CPU& cpu, const Kernel& kernel, const std::vector<uint32_t>& data) {
+    cpu.write_block(DATA, reinterpret_cast<const uint8_t*>(data.data()), LENGTH);
+    cpu.set_register(a0, kernel.a0);
+    cpu.set_register(a1, kernel.a1);
+    cpu.set_register(a2, kernel.a2);
+    cpu.get_register_bank().set_pc(kernel.entry);
+    cpu.run();
+}
+
+void print_stats(const std::string& name, const TimingStats& stats) {
+    std::cout << "  " << std::left << std::setw(22) << name << std::right << std::fixed << std::setprecision(3)
+              << "CPI " << stats.cpi() << ", stalls: load-use " << stats.load_use_stalls << ", data " << stats.data_stalls
+              << ", control " << stats.control_stalls << ", flush " << stats.flush_stalls << '\n';
+}
+
+} // namespace
+
+int main() {
+    plt::disable_debug();
+    const std::vector<uint32_t> data = make_data();
+    const std::vector<Kernel> kernels = {
+        {"bubble sort, 256 words", BUBBLE_SORT, DATA, 256, 0},
+        {"memcpy, lbu/sb loop", MEMCPY, DESTINATION, DATA, LENGTH},
+        {"crc32 bitwise", CRC32, DATA, LENGTH / 4, 0},
+    };
+
+    for (const Kernel& kernel : kernels) {
+        auto plain = make_cpu(false);
+        auto timed = make_cpu(true);
+        double plain_ns = bench::ns_per_op(RUNS, [&](uint64_t) { run(*plain, kernel, data); });
+        timed->reset_timing_stats();
+        double timed_ns = bench::ns_per_op(RUNS, [&](uint64_t) { run(*timed, kernel, data); });
+        const TimingStats& stats = timed->get_timing_stats();
+        double instructions = static_cast<double>(stats.instructions) / RUNS;
+
+        bench::report(kernel.name + ", timing off", plain_ns / instructions);
+        bench::report(kernel.name + ", timing on", timed_ns / instructions, plain_ns / instructions);
+        std::cout << std::left << std::setw(48) << "" << std::right << std::setw(10)
+                  << static_cast<double>(stats.cycles) / RUNS / timed_ns * 1000.0 << " M simulated cycles/s\n";
+
+        TimingConfig no_forwarding;
+        no_forwarding.forward_ex = false;
+        no_forwarding.forward_mem = false;
+        auto slow = make_cpu(true, no_forwarding);
+        run(*slow, kernel, data);
+        timed->reset_timing_stats();
+        run(*timed, kernel, data);
+        print_stats("full forwarding", timed->get_timing_stats());
+        print_stats("no forwarding", slow->get_timing_stats());
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Cost of a guest trap: the old C++ exception unwind versus trap entry to mtvec and mret in the pipeline.
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "bench_utils.hpp"
+#include "core/cpu/CPU.hpp"
+
+namespace {
+
+constexpr uint64_t ITERATIONS = 200'000;
+constexpr uint32_t HANDLER = 0x100;
+constexpr uint32_t UNMAPPED = 0x5000;
+
+uint32_t i_type(uint32_t opcode, uint32_t rd, uint32_t funct3, uint32_t rs1, int32_t imm) {
+    return (static_cast<uint32_t>(imm) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode;
+}
+
+uint32_t jal_back(int32_t offset) {
+    uint32_t imm = static_cast<uint32_t>(offset);
+    return (((imm >> 20) & 1) << 31) | (((imm >> 1) & 0x3FF) << 21) | (((imm >> 11) & 1) << 20)
+           | (((imm >> 12) & 0xFF) << 12) | 0x6F;
+}
+
+void load(CPU& cpu, uint32_t address, std::initializer_list<uint32_t> program) {
+    std::vector<uint32_t> words(program);
+    cpu.write_block(address, reinterpret_cast<const uint8_t*>(words.data()), words.size() * sizeof(uint32_t));
+}
+
+// mtvec = HANDLER, the handler skips the trapping instruction and returns with mret
+void install_handler(CPU& cpu) {
+    load(cpu, HANDLER, {
+        i_type(0x73, 7, 2, 0, 0x341),  // csrr t2, mepc
+        i_type(0x13, 7, 0, 7, 4),      // addi t2, t2, 4
+        i_type(0x73, 0, 1, 7, 0x341),  // csrw mepc, t2
+        0x30200073,                    // mret
+    });
+    cpu.get_csrs().mtvec = HANDLER;
+}
+
+// Steps the CPU and returns the cost of one loop iteration
+double ns_per_iteration(CPU& cpu, uint64_t steps_per_iteration) {
+    return bench::ns_per_op(ITERATIONS, [&](uint64_t) {
+        for (uint64_t i = 0; i < steps_per_iteration; ++i) {
+            cpu.step();
+        }
+    });
+}
+
+} // namespace
+
+int main() {
+    // Before: every fault was a PageFaultException thrown from the MMU and caught by the CPU
+    PhysicalMemory memory(1024 * 1024);
+    PageTable page_table;
+    MMU mmu(&memory, &page_table, PrivilegeMode::MACHINE);
+    double thrown = bench::ns_per_op(ITERATIONS, [&](uint64_t) {
+        try {
+            bench::do_not_optimize(mmu.read_word(UNMAPPED));
+        } catch (const PageFaultException&) {
+        }
+    });
+
+    // Trap free loop, the reference cost of two instructions
+    CPU plain(1024 * 1024);
+    load(plain, 0, {i_type(0x13, 6, 0, 6, 1), jal_back(-4)});
+    double loop = ns_per_iteration(plain, 2);
+
+    // ecall, 4 handler instructions, jump back: 6 instructions with one trap round trip
+    CPU ecall(1024 * 1024);
+    install_handler(ecall);
+    load(ecall, 0, {0x00000073, jal_back(-4)});
+    double ecall_round_trip = ns_per_iteration(ecall, 6);
+
+    // Store page fault instead of ecall, the MMU reports it as a status
+    CPU fault(1024 * 1024);
+    install_handler(fault);
+    load(fault, 0, {
+        0x000052B7,                       // lui t0, 0x5 (unmapped page)
+        (0u << 25) | (5u << 15) | (2u << 12) | 0x23, // sw x0, 0(t0)
+        jal_back(-4),
+    });
+    fault.step();
+    double fault_round_trip = ns_per_iteration(fault, 6);
+
+    bench::report("page fault as C++ exception (throw + catch)", thrown);
+    bench::report("trap free loop, 2 instructions", loop);
+    bench::report("ecall round trip, 6 instructions", ecall_round_trip, thrown);
+    bench::report("store page fault round trip, 6 instructions", fault_round_trip, thrown);
+    std::cout << "traps taken: " << ecall.get_trap_count() + fault.get_trap_count() << '\n';
+    return 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace bench {
+
+/**
+ * @brief Keeps the compiler from optimizing away a value computed by the benchmark body.
+ */
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief Runs the body the given number of times and returns the average cost of one call.
+ * @param iterations Number of calls to the body, the body receives the iteration index.
+ * @return Nanoseconds per call.
+ */
+template <typename Body>
+double ns_per_op(uint64_t iterations, Body&& body) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        body(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(iterations);
+}
+
+/**
+ * @brief Prints one result line: name, cost per operation and optionally the speedup over a baseline.
+ */
+inline void report(const std::string& name, double ns, double baseline_ns = 0.0) {
+    std::cout << std::left << std::setw(48) << name
+              << std::right << std::fixed << std::setprecision(2) << std::setw(10) << ns << " ns/op";
+    if (baseline_ns > 0.0) {
+        std::cout << std::setw(10) << baseline_ns / ns << "x";
+    }
+    std::cout << '\n';
+}
+
+} // namespace bench
@@ -1,10 +1,14 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h> 
+#include <algorithm>
+#include <cctype>
+#include <string>
 
 
 #include "core/cpu/CPU.hpp"
 #include "core/cpu/register_bank/RegisterBank.hpp"
 #include "core/cpu/isa/Instruction.hpp" 
+#include "core/cpu/isa/CompactInstruction.hpp"
 #include "core/cpu/pipeline/Pipeline.hpp"
 #include "core/cpu/pipeline/fetch/FetchStage.hpp"
 #include "core/cpu/pipeline/decode/DecodeStage.hpp"
@@ -16,6 +20,13 @@
 #include "core/memory/PageTableEntry.hpp"
 #include "core/memory/MMU.hpp"
 #include "core/cpu/state/PrivilegeMode.hpp"
+#include "core/cpu/state/CSRFile.hpp"
+#include "core/cpu/state/Trap.hpp"
+#include "core/batch/BatchRunner.hpp"
+#include "core/fuzz/FuzzHarness.hpp"
+#include "core/machine/Machine.hpp"
+#include "core/devices/Timer.hpp"
+#include "core/devices/Uart.hpp"
 
 using DecodedInstructionInvalid   = DecodedInstruction<InstructionFormat::INIVALID_TYPE>;
 using DecodedInstructionRType     = DecodedInstruction<InstructionFormat::R_TYPE>;
@@ -24,9 +35,61 @@ using DecodedInstructionSType     = DecodedInstruction<InstructionFormat::S_TYPE
 using DecodedInstructionBType     = DecodedInstruction<InstructionFormat::B_TYPE>;
 using DecodedInstructionUType     = DecodedInstruction<InstructionFormat::U_TYPE>;
 using DecodedInstructionJType     = DecodedInstruction<InstructionFormat::J_TYPE>;
+using DecodedInstructionSystem    = DecodedInstruction<InstructionFormat::SYSTEM>;
 
 namespace py = pybind11;
 
+namespace {
+
+// Contiguous bytes of any object implementing the buffer protocol (bytes, bytearray, NumPy arrays...)
+class ByteView {
+private:
+    Py_buffer view;
+
+public:
+    explicit ByteView(const py::object& object) {
+        if (PyObject_GetBuffer(object.ptr(), &view, PyBUF_C_CONTIGUOUS) != 0) {
+            throw py::error_already_set();
+        }
+    }
+    ~ByteView() { PyBuffer_Release(&view); }
+    ByteView(const ByteView&) = delete;
+    ByteView& operator=(const ByteView&) = delete;
+
+    const uint8_t* data() const { return static_cast<const uint8_t*>(view.buf); }
+    size_t size() const { return static_cast<size_t>(view.len); }
+};
+
+// Reads a block of memory straight into a new bytes object
+template <typename Reader>
+py::bytes read_bytes(size_t size, Reader&& reader) {
+    py::bytes result(nullptr, size);
+    reader(reinterpret_cast<uint8_t*>(PyBytes_AS_STRING(result.ptr())), size);
+    return result;
+}
+
+// Lets Python classes implement devices
+class PyDevice : public Device {
+public:
+    using Device::Device;
+    uint8_t read8(uint32_t offset) override { PYBIND11_OVERRIDE_PURE(uint8_t, Device, read8, offset); }
+    uint16_t read16(uint32_t offset) override { PYBIND11_OVERRIDE_PURE(uint16_t, Device, read16, offset); }
+    uint32_t read32(uint32_t offset) override { PYBIND11_OVERRIDE_PURE(uint32_t, Device, read32, offset); }
+    void write8(uint32_t offset, uint8_t value) override {
+        PYBIND11_OVERRIDE_PURE(void, Device, write8, offset, value);
+    }
+    void write16(uint32_t offset, uint16_t value) override {
+        PYBIND11_OVERRIDE_PURE(void, Device, write16, offset, value);
+    }
+    void write32(uint32_t offset, uint32_t value) override {
+        PYBIND11_OVERRIDE_PURE(void, Device, write32, offset, value);
+    }
+    void tick(uint64_t cycles) override { PYBIND11_OVERRIDE(void, Device, tick, cycles); }
+    std::string get_name() const override { PYBIND11_OVERRIDE_PURE(std::string, Device, get_name); }
+};
+
+} // namespace
+
 
 namespace detail {
 
@@ -78,6 +141,7 @@ PYBIND11_MODULE(virtuv_bindings, m) {
     // Register exception translators
     py::register_exception<PageFaultException>(m, "PageFaultException");
     py::register_exception<AccessViolationException>(m, "AccessViolationException");
+    py::register_exception<UnhandledTrapException>(m, "UnhandledTrapException");
 
     // Bind PrivilegeMode enum
     py::enum_<PrivilegeMode>(m, "PrivilegeMode")
@@ -86,11 +150,361 @@ PYBIND11_MODULE(virtuv_bindings, m) {
         .value("MACHINE", PrivilegeMode::MACHINE)
         .export_values();
 
+    // Bind AccessType enum
+    py::enum_<AccessType>(m, "AccessType")
+        .value("READ", AccessType::READ)
+        .value("WRITE", AccessType::WRITE)
+        .value("EXECUTE", AccessType::EXECUTE)
+        .export_values();
+
+    // Bind MemoryStatus enum
+    py::enum_<MemoryStatus>(m, "MemoryStatus")
+        .value("OK", MemoryStatus::OK)
+        .value("PAGE_FAULT", MemoryStatus::PAGE_FAULT)
+        .value("ACCESS_FAULT", MemoryStatus::ACCESS_FAULT)
+        .value("MISALIGNED", MemoryStatus::MISALIGNED)
+        .export_values();
+
+    // Bind MisalignedAccess enum
+    py::enum_<MisalignedAccess>(m, "MisalignedAccess")
+        .value("SPLIT", MisalignedAccess::SPLIT)
+        .value("TRAP", MisalignedAccess::TRAP)
+        .export_values();
+
+    // Bind the trap state
+    py::enum_<TrapCause>(m, "TrapCause")
+        .value("INSTRUCTION_ADDRESS_MISALIGNED", TrapCause::INSTRUCTION_ADDRESS_MISALIGNED)
+        .value("INSTRUCTION_ACCESS_FAULT", TrapCause::INSTRUCTION_ACCESS_FAULT)
+        .value("ILLEGAL_INSTRUCTION", TrapCause::ILLEGAL_INSTRUCTION)
+        .value("BREAKPOINT", TrapCause::BREAKPOINT)
+        .value("LOAD_ADDRESS_MISALIGNED", TrapCause::LOAD_ADDRESS_MISALIGNED)
+        .value("LOAD_ACCESS_FAULT", TrapCause::LOAD_ACCESS_FAULT)
+        .value("STORE_ADDRESS_MISALIGNED", TrapCause::STORE_ADDRESS_MISALIGNED)
+        .value("STORE_ACCESS_FAULT", TrapCause::STORE_ACCESS_FAULT)
+        .value("ECALL_FROM_USER", TrapCause::ECALL_FROM_USER)
+        .value("ECALL_FROM_SUPERVISOR", TrapCause::ECALL_FROM_SUPERVISOR)
+        .value("ECALL_FROM_MACHINE", TrapCause::ECALL_FROM_MACHINE)
+        .value("INSTRUCTION_PAGE_FAULT", TrapCause::INSTRUCTION_PAGE_FAULT)
+        .value("LOAD_PAGE_FAULT", TrapCause::LOAD_PAGE_FAULT)
+        .value("STORE_PAGE_FAULT", TrapCause::STORE_PAGE_FAULT)
+        .export_values();
+
+    py::class_<Trap>(m, "Trap")
+        .def(py::init<>())
+        .def_readonly("raised", &Trap::raised)
+        .def_readonly("cause", &Trap::cause)
+        .def_readonly("value", &Trap::value, "Value written to mtval");
+
+    py::class_<CSRFile>(m, "CSRFile")
+        .def(py::init<>())
+        .def_readwrite("mstatus", &CSRFile::mstatus)
+        .def_readwrite("mie", &CSRFile::mie)
+        .def_readwrite("mtvec", &CSRFile::mtvec, "Trap handler base, 0 means no handler is installed")
+        .def_readwrite("mscratch", &CSRFile::mscratch)
+        .def_readwrite("mepc", &CSRFile::mepc)
+        .def_readwrite("mcause", &CSRFile::mcause)
+        .def_readwrite("mtval", &CSRFile::mtval)
+        .def_readwrite("mip", &CSRFile::mip)
+        .def_readwrite("mhartid", &CSRFile::mhartid, "Id of the hart, read-only to the guest");
+
+    py::enum_<CycleStatus>(m, "CycleStatus")
+        .value("RETIRED", CycleStatus::RETIRED)
+        .value("TRAPPED", CycleStatus::TRAPPED)
+        .value("UNHANDLED_TRAP", CycleStatus::UNHANDLED_TRAP)
+        .value("HALTED", CycleStatus::HALTED)
+        .export_values();
+
+    // Bind the outcome of budgeted runs
+    py::enum_<StopReason>(m, "StopReason")
+        .value("HALTED", StopReason::HALTED)
+        .value("BUDGET", StopReason::BUDGET)
+        .value("BREAKPOINT", StopReason::BREAKPOINT)
+        .value("TRAP", StopReason::TRAP)
+        .value("EXIT", StopReason::EXIT)
+        .value("STOPPED", StopReason::STOPPED)
+        .export_values();
+
+    py::class_<RunResult>(m, "RunResult")
+        .def(py::init<>())
+        .def_readonly("reason", &RunResult::reason, "Why the run stopped")
+        .def_readonly("instructions", &RunResult::instructions, "Instructions retired or trapped into a handler")
+        .def_readonly("pc", &RunResult::pc, "PC when the run stopped")
+        .def_readonly("exit_code", &RunResult::exit_code, "a0 of the exit system call, for EXIT")
+        .def("__repr__", [](const RunResult& result) {
+            return "<RunResult " + std::string(py::str(py::cast(result.reason))) + " instructions="
+                   + std::to_string(result.instructions) + " pc=" + std::to_string(result.pc) + ">";
+        });
+
+    // Bind TranslationMode enum
+    py::enum_<TranslationMode>(m, "TranslationMode")
+        .value("HOST_MANAGED", TranslationMode::HOST_MANAGED)
+        .value("SATP", TranslationMode::SATP)
+        .export_values();
+
+    // Bind TLB counters
+    py::class_<TLBStats>(m, "TLBStats")
+        .def(py::init<>())
+        .def_readonly("hits", &TLBStats::hits, "Accesses served from the TLB")
+        .def_readonly("misses", &TLBStats::misses, "Accesses that walked the page table")
+        .def_readonly("flushes", &TLBStats::flushes, "Number of full TLB invalidations");
+
+    // Bind PredecodeStats
+    py::class_<PredecodeStats>(m, "PredecodeStats")
+        .def(py::init<>())
+        .def_readonly("hits", &PredecodeStats::hits, "Instructions executed from the predecode cache")
+        .def_readonly("misses", &PredecodeStats::misses, "Instructions fetched and decoded")
+        .def_readonly("invalidations", &PredecodeStats::invalidations,
+                      "Cached instructions dropped by writes to their bytes")
+        .def_readonly("flushes", &PredecodeStats::flushes, "Whole cache flushes")
+        .def_property_readonly("hit_rate", &PredecodeStats::hit_rate,
+                               "hits / (hits + misses), 0 before the first lookup");
+
+    // Bind FusionStats
+    py::class_<FusionStats>(m, "FusionStats")
+        .def(py::init<>())
+        .def_readonly("lui_addi", &FusionStats::lui_addi, "LUI+ADDI pairs, 32 bit constants")
+        .def_readonly("auipc_jalr", &FusionStats::auipc_jalr, "AUIPC+JALR pairs, far calls and jumps")
+        .def_readonly("auipc_lw", &FusionStats::auipc_lw, "AUIPC+LW pairs, PC-relative loads")
+        .def_readonly("slli_srli", &FusionStats::slli_srli, "SLLI+SRLI pairs, zero extensions and bit fields")
+        .def_property_readonly("total", &FusionStats::total, "Pairs fused, each one two retired instructions");
+
+    // Bind ExecutionMode enum
+    py::enum_<ExecutionMode>(m, "ExecutionMode")
+        .value("PIPELINE", ExecutionMode::PIPELINE)
+        .value("THREADED", ExecutionMode::THREADED)
+        .value("JIT", ExecutionMode::JIT)
+        .value("FUNCTIONAL", ExecutionMode::FUNCTIONAL)
+        .export_values();
+
+    // Bind ThreadedStats
+    py::class_<ThreadedStats>(m, "ThreadedStats")
+        .def(py::init<>())
+        .def_readonly("blocks_translated", &ThreadedStats::blocks_translated, "Blocks built from guest code")
+        .def_readonly("blocks_executed", &ThreadedStats::blocks_executed, "Block entries")
+        .def_readonly("instructions", &ThreadedStats::instructions, "Instructions retired inside blocks")
+        .def_readonly("fallbacks", &ThreadedStats::fallbacks, "Instructions executed by the pipeline instead")
+        .def_readonly("invalidations", &ThreadedStats::invalidations, "Blocks dropped by writes to their bytes")
+        .def_readonly("flushes", &ThreadedStats::flushes, "Whole block cache flushes")
+        .def_readonly("blocks_compiled", &ThreadedStats::blocks_compiled, "Blocks compiled to host code by the JIT")
+        .def_readonly("evictions", &ThreadedStats::evictions, "JIT code arena resets because it was full");
+
+    // Bind FunctionalStats
+    py::class_<FunctionalStats>(m, "FunctionalStats")
+        .def(py::init<>())
+        .def_readonly("instructions", &FunctionalStats::instructions, "Instructions retired by the functional engine")
+        .def_readonly("fallbacks", &FunctionalStats::fallbacks, "Instructions executed by the pipeline instead");
+
+    // Bind JitConfig
+    py::class_<JitConfig>(m, "JitConfig")
+        .def(py::init<>())
+        .def_readwrite("threshold", &JitConfig::threshold, "Threaded executions before a block is compiled")
+        .def_readwrite("arena_size", &JitConfig::arena_size, "Bytes of executable memory for compiled code")
+        .def_readwrite("perf_map", &JitConfig::perf_map, "Name compiled blocks in /tmp/perf-<pid>.map");
+
+    // Bind TimingConfig
+    py::class_<TimingConfig>(m, "TimingConfig")
+        .def(py::init<>())
+        .def_readwrite("forward_ex", &TimingConfig::forward_ex, "Forward ALU results from the EX/MEM latch")
+        .def_readwrite("forward_mem", &TimingConfig::forward_mem, "Forward results and loads from the MEM/WB latch")
+        .def_readwrite("branch_penalty", &TimingConfig::branch_penalty, "Bubbles after a taken branch or a JALR")
+        .def_readwrite("jump_penalty", &TimingConfig::jump_penalty, "Bubbles after a JAL")
+        .def_readwrite("flush_penalty", &TimingConfig::flush_penalty, "Bubbles after a trap, MRET or FENCE.I");
+
+    // Bind TimingStats
+    py::class_<TimingStats>(m, "TimingStats")
+        .def(py::init<>())
+        .def_readonly("cycles", &TimingStats::cycles, "Cycles from the first fetch to the last write back")
+        .def_readonly("instructions", &TimingStats::instructions, "Instructions retired")
+        .def_readonly("traps", &TimingStats::traps, "Instructions that trapped")
+        .def_readonly("load_use_stalls", &TimingStats::load_use_stalls, "Bubbles waiting for a load result")
+        .def_readonly("data_stalls", &TimingStats::data_stalls,
+                      "Bubbles waiting for a result the forwarding paths miss")
+        .def_readonly("control_stalls", &TimingStats::control_stalls, "Bubbles after taken branches and jumps")
+        .def_readonly("flush_stalls", &TimingStats::flush_stalls, "Bubbles after traps, MRET and FENCE.I")
+        .def_readonly("fetch_stalls", &TimingStats::fetch_stalls, "Cycles fetch waited for the instruction cache")
+        .def_readonly("memory_stalls", &TimingStats::memory_stalls, "Cycles the pipeline waited for the data cache")
+        .def_property_readonly("cpi", &TimingStats::cpi, "Cycles per retired instruction");
+
+    // Bind the cache model
+    py::enum_<ReplacementPolicy>(m, "ReplacementPolicy")
+        .value("LRU", ReplacementPolicy::LRU)
+        .value("PLRU", ReplacementPolicy::PLRU)
+        .value("RANDOM", ReplacementPolicy::RANDOM)
+        .export_values();
+
+    py::enum_<WritePolicy>(m, "WritePolicy")
+        .value("WRITE_BACK", WritePolicy::WRITE_BACK)
+        .value("WRITE_THROUGH", WritePolicy::WRITE_THROUGH)
+        .export_values();
+
+    py::class_<CacheConfig>(m, "CacheConfig")
+        .def(py::init<>())
+        .def_readwrite("size", &CacheConfig::size, "Bytes of data, a power of two")
+        .def_readwrite("ways", &CacheConfig::ways, "Lines per set, a power of two up to 32")
+        .def_readwrite("line_size", &CacheConfig::line_size, "Bytes per line, a power of two of at least 4")
+        .def_readwrite("replacement", &CacheConfig::replacement)
+        .def_readwrite("write_policy", &CacheConfig::write_policy)
+        .def_readwrite("write_allocate", &CacheConfig::write_allocate, "Whether a write miss fills the line")
+        .def_readwrite("latency", &CacheConfig::latency, "Cycles a hit adds to the access");
+
+    py::class_<CacheHierarchyConfig>(m, "CacheHierarchyConfig")
+        .def(py::init<>())
+        .def_readwrite("l1i", &CacheHierarchyConfig::l1i)
+        .def_readwrite("l1d", &CacheHierarchyConfig::l1d)
+        .def_readwrite("l2", &CacheHierarchyConfig::l2)
+        .def_readwrite("memory_latency", &CacheHierarchyConfig::memory_latency, "Cycles an L2 miss adds");
+
+    py::class_<CacheStats>(m, "CacheStats")
+        .def(py::init<>())
+        .def_readonly("accesses", &CacheStats::accesses)
+        .def_readonly("hits", &CacheStats::hits)
+        .def_readonly("misses", &CacheStats::misses)
+        .def_readonly("evictions", &CacheStats::evictions, "Valid lines replaced by a fill")
+        .def_readonly("writebacks", &CacheStats::writebacks, "Evicted lines that were dirty")
+        .def_property_readonly("miss_rate", &CacheStats::miss_rate, "misses / accesses, 0 before the first access");
+
+    py::class_<CacheHierarchyStats>(m, "CacheHierarchyStats")
+        .def(py::init<>())
+        .def_readonly("l1i", &CacheHierarchyStats::l1i)
+        .def_readonly("l1d", &CacheHierarchyStats::l1d)
+        .def_readonly("l2", &CacheHierarchyStats::l2)
+        .def_readonly("memory_reads", &CacheHierarchyStats::memory_reads, "Lines filled from memory")
+        .def_readonly("memory_writes", &CacheHierarchyStats::memory_writes, "Lines and writes that reached memory");
+
+    // Bind the branch predictors
+    py::enum_<BranchPredictorKind>(m, "BranchPredictorKind")
+        .value("STATIC", BranchPredictorKind::STATIC)
+        .value("BIMODAL", BranchPredictorKind::BIMODAL)
+        .value("GSHARE", BranchPredictorKind::GSHARE)
+        .value("TAGE", BranchPredictorKind::TAGE)
+        .export_values();
+
+    py::class_<BranchPredictorConfig>(m, "BranchPredictorConfig")
+        .def(py::init<>())
+        .def_readwrite("kind", &BranchPredictorConfig::kind, "Direction predictor of conditional branches")
+        .def_readwrite("table_bits", &BranchPredictorConfig::table_bits,
+                       "log2 counters of the bimodal, gshare and TAGE base tables")
+        .def_readwrite("history_bits", &BranchPredictorConfig::history_bits,
+                       "Global history of gshare, longest history of TAGE")
+        .def_readwrite("tage_tables", &BranchPredictorConfig::tage_tables, "Tagged tables of TAGE")
+        .def_readwrite("tage_table_bits", &BranchPredictorConfig::tage_table_bits, "log2 entries per tagged table")
+        .def_readwrite("tage_tag_bits", &BranchPredictorConfig::tage_tag_bits, "Bits per TAGE tag")
+        .def_readwrite("btb_bits", &BranchPredictorConfig::btb_bits, "log2 entries of the branch target buffer")
+        .def_readwrite("ras_depth", &BranchPredictorConfig::ras_depth, "Entries of the return address stack");
+
+    py::class_<BranchPredictorStats>(m, "BranchPredictorStats")
+        .def(py::init<>())
+        .def_readonly("conditional", &BranchPredictorStats::conditional, "Conditional branches")
+        .def_readonly("conditional_mispredicts", &BranchPredictorStats::conditional_mispredicts)
+        .def_readonly("jumps", &BranchPredictorStats::jumps, "JAL")
+        .def_readonly("jump_mispredicts", &BranchPredictorStats::jump_mispredicts)
+        .def_readonly("indirect", &BranchPredictorStats::indirect, "JALR other than returns")
+        .def_readonly("indirect_mispredicts", &BranchPredictorStats::indirect_mispredicts)
+        .def_readonly("returns", &BranchPredictorStats::returns, "JALR popping the return address stack")
+        .def_readonly("return_mispredicts", &BranchPredictorStats::return_mispredicts)
+        .def_property_readonly("predictions", &BranchPredictorStats::predictions, "Branches and jumps predicted")
+        .def_property_readonly("mispredicts", &BranchPredictorStats::mispredicts, "Branches and jumps mispredicted")
+        .def_property_readonly("accuracy", &BranchPredictorStats::accuracy,
+                               "Share predicted right, 0 before the first branch");
+
+    py::class_<BranchSiteStats>(m, "BranchSiteStats")
+        .def(py::init<>())
+        .def_readonly("pc", &BranchSiteStats::pc)
+        .def_readonly("executions", &BranchSiteStats::executions)
+        .def_readonly("taken", &BranchSiteStats::taken)
+        .def_readonly("mispredicts", &BranchSiteStats::mispredicts);
+
+    // Bind MemoryBacking enum
+    py::enum_<MemoryBacking>(m, "MemoryBacking")
+        .value("HEAP", MemoryBacking::HEAP)
+        .value("RESERVED", MemoryBacking::RESERVED)
+        .export_values();
+
     // Bind PhysicalMemory class
-    py::class_<PhysicalMemory>(m, "PhysicalMemory")
+    // The buffer is a read-only view of the whole memory, e.g. numpy.frombuffer(memory, dtype=numpy.uint32)
+    py::class_<PhysicalMemory>(m, "PhysicalMemory", py::buffer_protocol())
+        .def_buffer([](PhysicalMemory& memory) {
+            return py::buffer_info(const_cast<uint8_t*>(memory.data()), sizeof(uint8_t),
+                                   py::format_descriptor<uint8_t>::format(), 1,
+                                   {static_cast<py::ssize_t>(memory.get_size())}, {py::ssize_t{1}}, true);
+        })
         .def(py::init<size_t>(), py::arg("size"))
+        .def(py::init<size_t, MemoryBacking, bool>(), py::arg("size"), py::arg("backing"),
+             py::arg("huge_pages") = false)
+        .def("get_backing", &PhysicalMemory::get_backing, "Get how the memory is backed")
         .def("read", &PhysicalMemory::read, "Read a byte from physical memory")
-        .def("write", &PhysicalMemory::write, "Write a byte to physical memory");
+        .def("write", &PhysicalMemory::write, "Write a byte to physical memory")
+        .def("read_halfword", &PhysicalMemory::read_halfword, "Read a 16-bit halfword from physical memory",
+             py::arg("address"))
+        .def("read_word", &PhysicalMemory::read_word, "Read a 32-bit word from physical memory", py::arg("address"))
+        .def("read_doubleword", &PhysicalMemory::read_doubleword, "Read a 64-bit doubleword from physical memory",
+             py::arg("address"))
+        .def("write_halfword", &PhysicalMemory::write_halfword, "Write a 16-bit halfword to physical memory",
+             py::arg("address"), py::arg("value"))
+        .def("write_word", &PhysicalMemory::write_word, "Write a 32-bit word to physical memory", py::arg("address"),
+             py::arg("value"))
+        .def("write_doubleword", &PhysicalMemory::write_doubleword, "Write a 64-bit doubleword to physical memory",
+             py::arg("address"), py::arg("value"))
+        .def("get_size", &PhysicalMemory::get_size, "Get the size of physical memory in bytes")
+        .def("zero_fill", &PhysicalMemory::zero_fill, "Set a range of physical memory to zero", py::arg("address"),
+             py::arg("size"))
+        .def("write_block", [](PhysicalMemory& memory, uint32_t address, const py::object& data) {
+            ByteView bytes(data);
+            memory.write_block(address, bytes.data(), bytes.size());
+        }, "Write a buffer to physical memory", py::arg("address"), py::arg("data"))
+        .def("is_dirty", &PhysicalMemory::is_dirty, "Check if a page was written since the last snapshot or restore",
+             py::arg("address"))
+        .def("count_dirty_pages", &PhysicalMemory::count_dirty_pages,
+             "Count the pages written since the last snapshot or restore")
+        .def("clear_dirty_pages", &PhysicalMemory::clear_dirty_pages, "Forget every dirty page");
+
+    // Bind the physical bus and the devices
+    py::enum_<RegionKind>(m, "RegionKind")
+        .value("RAM", RegionKind::RAM)
+        .value("ROM", RegionKind::ROM)
+        .value("MMIO", RegionKind::MMIO)
+        .export_values();
+
+    py::class_<Device, PyDevice, std::shared_ptr<Device>>(m, "Device")
+        .def(py::init<>())
+        .def("read8", &Device::read8, py::arg("offset"))
+        .def("read16", &Device::read16, py::arg("offset"))
+        .def("read32", &Device::read32, py::arg("offset"))
+        .def("write8", &Device::write8, py::arg("offset"), py::arg("value"))
+        .def("write16", &Device::write16, py::arg("offset"), py::arg("value"))
+        .def("write32", &Device::write32, py::arg("offset"), py::arg("value"))
+        .def("tick", &Device::tick, py::arg("cycles"))
+        .def("get_name", &Device::get_name);
+
+    py::class_<Uart, Device, std::shared_ptr<Uart>>(m, "Uart")
+        .def(py::init<bool>(), py::arg("echo") = false)
+        .def_readonly_static("SIZE", &Uart::SIZE)
+        .def("get_output", &Uart::get_output, "Get the bytes transmitted by the guest")
+        .def("clear_output", &Uart::clear_output)
+        .def("push_input", &Uart::push_input, "Queue bytes for the guest to receive", py::arg("data"));
+
+    py::class_<Timer, Device, std::shared_ptr<Timer>>(m, "Timer")
+        .def(py::init<>())
+        .def_readonly_static("SIZE", &Timer::SIZE)
+        .def_readonly_static("MTIMECMP", &Timer::MTIMECMP)
+        .def_readonly_static("MTIME", &Timer::MTIME)
+        .def("get_mtime", &Timer::get_mtime)
+        .def("set_mtime", &Timer::set_mtime, py::arg("value"))
+        .def("get_mtimecmp", &Timer::get_mtimecmp)
+        .def("set_mtimecmp", &Timer::set_mtimecmp, py::arg("value"))
+        .def("timer_interrupt_pending", &Timer::timer_interrupt_pending)
+        .def("software_interrupt_pending", &Timer::software_interrupt_pending);
+
+    py::class_<Bus>(m, "Bus")
+        .def(py::init<PhysicalMemory*>(), py::arg("ram"), py::keep_alive<1, 2>())
+        .def("add_device", &Bus::add_device, "Map a device on the bus", py::arg("base"), py::arg("size"),
+             py::arg("device"))
+        .def("add_rom", [](Bus& bus, uint32_t base, const py::object& data, const std::string& name) {
+            ByteView bytes(data);
+            bus.add_rom(base, bytes.data(), bytes.size(), name);
+        }, "Map a copy of a buffer as read-only memory", py::arg("base"), py::arg("data"), py::arg("name") = "rom")
+        .def("get_kind", &Bus::get_kind, "Get what answers at a physical address", py::arg("address"))
+        .def("tick", &Bus::tick, "Advance the clock of every device", py::arg("cycles"));
 
     // Bind PageTableEntry class
     py::class_<PageTableEntry>(m, "PageTableEntry")
@@ -112,49 +526,367 @@ PYBIND11_MODULE(virtuv_bindings, m) {
         .def(py::init<PhysicalMemory*, PageTable*, PrivilegeMode>(), py::arg("physical_memory"), py::arg("page_table"), py::arg("privilege_mode"))
         .def("read", &MMU::read, "Read a byte from virtual memory", py::arg("virtual_address"))
         .def("write", &MMU::write, "Write a byte to virtual memory", py::arg("virtual_address"), py::arg("value"))
+        .def("read_halfword", &MMU::read_halfword, "Read a 16-bit halfword from virtual memory",
+             py::arg("virtual_address"))
+        .def("write_halfword", &MMU::write_halfword, "Write a 16-bit halfword to virtual memory",
+             py::arg("virtual_address"), py::arg("value"))
         .def("read_word", &MMU::read_word, "Read a 32-bit word from virtual memory", py::arg("virtual_address"))
         .def("write_word", &MMU::write_word, "Write a 32-bit word to virtual memory", py::arg("virtual_address"), py::arg("value"))
+        .def("read_doubleword", &MMU::read_doubleword, "Read a 64-bit doubleword from virtual memory",
+             py::arg("virtual_address"))
+        .def("write_doubleword", &MMU::write_doubleword, "Write a 64-bit doubleword to virtual memory",
+             py::arg("virtual_address"), py::arg("value"))
+        .def("read_block", [](MMU& mmu, uint32_t virtual_address, size_t size) {
+            return read_bytes(size, [&](uint8_t* data, size_t length) {
+                mmu.read_block(virtual_address, data, length);
+            });
+        }, "Read a range of virtual memory as bytes", py::arg("virtual_address"), py::arg("size"))
+        .def("write_block", [](MMU& mmu, uint32_t virtual_address, const py::object& data) {
+            ByteView bytes(data);
+            mmu.write_block(virtual_address, bytes.data(), bytes.size());
+        }, "Write a buffer to virtual memory", py::arg("virtual_address"), py::arg("data"))
+        .def("fill", &MMU::fill, "Set a range of virtual memory to a byte value", py::arg("virtual_address"),
+             py::arg("value"), py::arg("size"))
+        .def("fetch_word", &MMU::fetch_word, "Fetch a 32-bit instruction word from virtual memory",
+             py::arg("virtual_address"))
         .def("set_privilege_mode", &MMU::set_privilege_mode, "Set the current privilege mode", py::arg("mode"))
-        .def("translate_address", &MMU::translate_address, "Translate a virtual address to a physical address", py::arg("virtual_address"), py::arg("is_write"));
+        .def("set_bus", &MMU::set_bus, "Route physical accesses through a bus", py::arg("bus"), py::keep_alive<1, 2>())
+        .def("translate_address", py::overload_cast<uint32_t, bool>(&MMU::translate_address),
+             "Translate a virtual address to a physical address", py::arg("virtual_address"), py::arg("is_write"))
+        .def("translate_address", py::overload_cast<uint32_t, AccessType>(&MMU::translate_address),
+             "Translate a virtual address for a given access type", py::arg("virtual_address"), py::arg("access_type"))
+        .def("set_translation_mode", &MMU::set_translation_mode, "Select host managed or satp based translation",
+             py::arg("mode"))
+        .def("get_translation_mode", &MMU::get_translation_mode, "Get the current translation mode")
+        .def("set_satp", &MMU::set_satp, "Write the satp register", py::arg("value"))
+        .def("get_satp", &MMU::get_satp, "Read the satp register")
+        .def("set_misaligned_access", &MMU::set_misaligned_access,
+             "Split misaligned accesses in software or refuse them", py::arg("policy"))
+        .def("get_misaligned_access", &MMU::get_misaligned_access, "Get how misaligned accesses are handled")
+        .def("flush_tlb", &MMU::flush_tlb, "Invalidate every TLB entry")
+        .def("flush_tlb_page", &MMU::flush_tlb_page, "Invalidate the TLB entries of one page",
+             py::arg("virtual_address"))
+        .def("get_tlb_stats", &MMU::get_tlb_stats, "Get the TLB hit/miss counters", py::return_value_policy::copy)
+        .def("reset_tlb_stats", &MMU::reset_tlb_stats, "Reset the TLB hit/miss counters");
 
     
     // Bind RegisterBank
-    py::class_<RegisterBank>(m, "RegisterBank")
+    // The buffer is a read-only view of x0..x31 as 32-bit unsigned integers
+    py::class_<RegisterBank>(m, "RegisterBank", py::buffer_protocol())
+        .def_buffer([](RegisterBank& bank) {
+            return py::buffer_info(const_cast<uint32_t*>(bank.data()), sizeof(uint32_t),
+                                   py::format_descriptor<uint32_t>::format(), 1, {py::ssize_t{32}},
+                                   {static_cast<py::ssize_t>(sizeof(uint32_t))}, true);
+        })
         .def(py::init<>())
         .def("read", &RegisterBank::read, "Read a register", py::arg("reg"))
         .def("write", &RegisterBank::write, "Write a register", py::arg("reg"), py::arg("value"))
         .def("get_pc", &RegisterBank::get_pc, "Get the current program counter")
         .def("set_pc", &RegisterBank::set_pc, "Set the program counter", py::arg("value"));
 
+    // Bind CPU snapshots, opaque handles shared between the CPUs restored from them
+    py::class_<CPUSnapshot, std::shared_ptr<CPUSnapshot>>(m, "CPUSnapshot")
+        .def_property_readonly("memory_size", [](const CPUSnapshot& snapshot) { return snapshot.memory->get_size(); })
+        .def_property_readonly("pc", [](const CPUSnapshot& snapshot) { return snapshot.register_bank.get_pc(); });
+
     // Bind CPU
     py::class_<CPU>(m, "CPU")
-        .def(py::init<size_t>(), py::arg("memory_size"))
-        .def("load_program", &CPU::load_program, "Load a binary program into memory", py::arg("filepath"))
-        .def("run", &CPU::run, "Run the CPU")
+        .def(py::init<size_t, MemoryBacking, ExecutionMode>(), py::arg("memory_size"),
+             py::arg("backing") = MemoryBacking::HEAP, py::arg("mode") = ExecutionMode::PIPELINE)
+        .def(py::init<const CPUSnapshot&>(), py::arg("snapshot"))
+        .def_readonly_static("UNLIMITED", &CPU::UNLIMITED, "Instruction budget of a run with no limit")
+        .def("snapshot", &CPU::snapshot, "Capture the CPU state, memory is shared copy-on-write")
+        .def("restore", &CPU::restore, "Rewind the CPU to a snapshot", py::arg("snapshot"))
+        .def("restore_dirty", &CPU::restore_dirty, "Rewind the CPU to its last snapshot copying only the dirty pages",
+             py::arg("snapshot"))
+        .def("fork", &CPU::fork, "Create an independent copy of the CPU")
+        .def("load_program", &CPU::load_program, "Load a binary or ELF program into memory", py::arg("filepath"))
+        .def("load_elf", &CPU::load_elf, "Load an ELF32 executable and jump to its entry point", py::arg("filepath"))
+        .def("lookup_symbol", &CPU::lookup_symbol, "Get the address of a symbol, None if it is unknown",
+             py::arg("name"))
+        .def("find_symbol", [](const CPU& cpu, uint32_t address) -> std::optional<std::string> {
+            const Symbol* symbol = cpu.get_symbols().find_containing(address);
+            if (symbol == nullptr) {
+                return std::nullopt;
+            }
+            return symbol->name;
+        }, "Get the name of the symbol covering an address, None if there is none", py::arg("address"))
+        .def("run", py::overload_cast<>(&CPU::run),
+             "Run the CPU until the program ends, raises on a trap without handler")
+        .def("run", py::overload_cast<uint64_t>(&CPU::run), "Run at most max_instructions and return a RunResult",
+             py::arg("max_instructions"))
+        .def("run_until", &CPU::run_until, "Run until the PC reaches an address, return a RunResult", py::arg("pc"),
+             py::arg("max_instructions") = CPU::UNLIMITED)
+        .def("step", py::overload_cast<>(&CPU::step), "Execute a single instruction")
+        .def("step", py::overload_cast<uint64_t>(&CPU::step),
+             "Execute n instructions through the pipeline and return a RunResult", py::arg("n"))
+        .def("request_stop", &CPU::request_stop, "Make the current or next budgeted run return STOPPED")
+        .def("get_execution_mode", &CPU::get_execution_mode, "Get the engine used by run")
+        .def("set_execution_mode", &CPU::set_execution_mode,
+             "Run through the pipeline, the threaded block engine, the JIT or the functional engine", py::arg("mode"))
+        .def("get_threaded_stats", &CPU::get_threaded_stats, "Get the threaded engine counters",
+             py::return_value_policy::copy)
+        .def("reset_threaded_stats", &CPU::reset_threaded_stats, "Reset the threaded engine counters")
+        .def("get_functional_stats", &CPU::get_functional_stats, "Get the functional engine counters",
+             py::return_value_policy::copy)
+        .def("reset_functional_stats", &CPU::reset_functional_stats, "Reset the functional engine counters")
+        .def("set_timing_enabled", &CPU::set_timing_enabled,
+             "Account cycles with the 5-stage timing model, run() then uses the pipeline", py::arg("enabled"))
+        .def("is_timing_enabled", &CPU::is_timing_enabled, "Whether the timing model is on")
+        .def("get_timing_config", &CPU::get_timing_config, "Get the forwarding paths and penalties of the timing model",
+             py::return_value_policy::copy)
+        .def("set_timing_config", &CPU::set_timing_config,
+             "Change the forwarding paths and penalties of the timing model", py::arg("config"))
+        .def("get_timing_stats", &CPU::get_timing_stats, "Get cycles, instructions and stalls of the timing model",
+             py::return_value_policy::copy)
+        .def("reset_timing_stats", &CPU::reset_timing_stats, "Reset the timing model to an empty pipeline")
+        .def("set_cache_enabled", &CPU::set_cache_enabled, "Model the L1 and L2 caches while the timing model is on",
+             py::arg("enabled"))
+        .def("is_cache_enabled", &CPU::is_cache_enabled, "Whether the cache model is on")
+        .def("get_cache_config", &CPU::get_cache_config, "Get the geometry, policies and latencies of the caches",
+             py::return_value_policy::copy)
+        .def("set_cache_config", &CPU::set_cache_config, "Change the caches, they start cold", py::arg("config"))
+        .def("get_cache_stats", &CPU::get_cache_stats, "Get hits, misses, evictions and write backs per level")
+        .def("reset_cache_stats", &CPU::reset_cache_stats, "Reset the cache counters, the cached lines stay")
+        .def("set_branch_predictor_config", &CPU::set_branch_predictor_config,
+             "Change the branch predictor of the timing model, it starts untrained", py::arg("config"))
+        .def("get_branch_predictor_config", &CPU::get_branch_predictor_config,
+             "Get the branch predictor and its table sizes", py::return_value_policy::copy)
+        .def("get_branch_predictor_stats", &CPU::get_branch_predictor_stats,
+             "Get predictions and mispredictions per kind of branch", py::return_value_policy::copy)
+        .def("get_branch_site_stats", &CPU::get_branch_site_stats,
+             "Get the counters of every branch PC, most mispredicted first")
+        .def("reset_branch_predictor_stats", &CPU::reset_branch_predictor_stats,
+             "Reset the branch predictor counters, what was learnt stays")
+        .def("get_branch_predictor_storage_bits", &CPU::get_branch_predictor_storage_bits,
+             "Bits of state the predictor would need in hardware")
+        .def("set_fusion_enabled", &CPU::set_fusion_enabled, "Turn macro-op fusion of the pipeline on or off",
+             py::arg("enabled"))
+        .def("is_fusion_enabled", &CPU::is_fusion_enabled, "Whether the pipeline fuses instruction pairs")
+        .def("get_fusion_stats", &CPU::get_fusion_stats, "Get the number of pairs fused per idiom",
+             py::return_value_policy::copy)
+        .def("reset_fusion_stats", &CPU::reset_fusion_stats, "Reset the fusion counters")
+        .def("get_jit_config", &CPU::get_jit_config, "Get the settings of the JIT mode", py::return_value_policy::copy)
+        .def("set_jit_config", &CPU::set_jit_config, "Change the settings of the JIT mode, drops the compiled code",
+             py::arg("config"))
         .def("get_register", &CPU::get_register, "Read a given general purpose value")
-        .def("read_word_from_memory", &CPU::read_word_from_memory, "Read a word given an address from memory");
+        .def("set_register", &CPU::set_register, "Write a given general purpose register", py::arg("reg"),
+             py::arg("value"))
+        .def("get_pc", &CPU::get_pc, "Get the program counter")
+        .def("read_word_from_memory", &CPU::read_word_from_memory, "Read a word given an address from memory")
+        .def("read_block", [](CPU& cpu, uint32_t address, size_t size) {
+            return read_bytes(size, [&](uint8_t* data, size_t length) { cpu.read_block(address, data, length); });
+        }, "Read a range of virtual memory as bytes", py::arg("address"), py::arg("size"))
+        .def("write_block", [](CPU& cpu, uint32_t address, const py::object& data) {
+            ByteView bytes(data);
+            cpu.write_block(address, bytes.data(), bytes.size());
+        }, "Write a buffer to virtual memory", py::arg("address"), py::arg("data"))
+        .def("fill", &CPU::fill, "Set a range of virtual memory to a byte value", py::arg("address"), py::arg("value"),
+             py::arg("size"))
+        .def("attach_device", &CPU::attach_device, "Map a device on the physical bus", py::arg("base"), py::arg("size"),
+             py::arg("device"))
+        .def("attach_rom", [](CPU& cpu, uint32_t base, const py::object& data, const std::string& name) {
+            ByteView bytes(data);
+            cpu.attach_rom(base, bytes.data(), bytes.size(), name);
+        }, "Map a copy of a buffer as read-only memory", py::arg("base"), py::arg("data"), py::arg("name") = "rom")
+        .def("get_physical_memory", &CPU::get_physical_memory,
+             "Get the physical memory, it supports the buffer protocol", py::return_value_policy::reference_internal)
+        .def("get_register_bank", &CPU::get_register_bank, "Get the register bank, it supports the buffer protocol",
+             py::return_value_policy::reference_internal)
+        .def("get_csrs", &CPU::get_csrs, "Get the machine mode trap registers",
+             py::return_value_policy::reference_internal)
+        .def("get_privilege_mode", &CPU::get_privilege_mode, "Get the current privilege mode")
+        .def("set_privilege_mode", &CPU::set_privilege_mode, "Switch privilege mode, flushes the TLB", py::arg("mode"))
+        .def("get_translation_mode", &CPU::get_translation_mode, "Get where the MMU takes its translations from")
+        .def("set_translation_mode", &CPU::set_translation_mode, "Select host managed or satp based translation",
+             py::arg("mode"))
+        .def("get_misaligned_access", &CPU::get_misaligned_access, "Get how misaligned loads and stores are handled")
+        .def("set_misaligned_access", &CPU::set_misaligned_access, "Split misaligned loads and stores or trap on them",
+             py::arg("policy"))
+        .def("get_last_trap", &CPU::get_last_trap, "Get the last trap raised by the guest",
+             py::return_value_policy::copy)
+        .def("get_trap_count", &CPU::get_trap_count, "Count the traps raised by the guest")
+        .def("get_tlb_stats", &CPU::get_tlb_stats, "Get the MMU TLB hit/miss counters", py::return_value_policy::copy)
+        .def("get_predecode_stats", &CPU::get_predecode_stats,
+             "Get the predecode cache counters, including the hit rate", py::return_value_policy::copy)
+        .def("reset_predecode_stats", &CPU::reset_predecode_stats, "Reset the predecode cache counters")
+        .def("flush_predecode_cache", &CPU::flush_predecode_cache,
+             "Drop every decoded instruction and translated block, needed after writing code through a memory view")
+        .def("count_dirty_pages", &CPU::count_dirty_pages,
+             "Count the pages written since the last snapshot or restore");
+
+    // Bind the fuzz harness
+    py::enum_<FuzzOutcome>(m, "FuzzOutcome")
+        .value("HALTED", FuzzOutcome::HALTED)
+        .value("BUDGET_EXHAUSTED", FuzzOutcome::BUDGET_EXHAUSTED)
+        .value("CRASHED", FuzzOutcome::CRASHED)
+        .export_values();
+
+    py::class_<FuzzResult>(m, "FuzzResult")
+        .def_readonly("outcome", &FuzzResult::outcome)
+        .def_readonly("instructions", &FuzzResult::instructions)
+        .def_readonly("pc", &FuzzResult::pc)
+        .def_readonly("dirty_pages", &FuzzResult::dirty_pages)
+        .def_readonly("message", &FuzzResult::message);
+
+    py::class_<FuzzStats>(m, "FuzzStats")
+        .def_readonly("executions", &FuzzStats::executions)
+        .def_readonly("instructions", &FuzzStats::instructions)
+        .def_readonly("dirty_pages_restored", &FuzzStats::dirty_pages_restored)
+        .def_readonly("seconds", &FuzzStats::seconds)
+        .def_readonly("execs_per_second", &FuzzStats::execs_per_second);
+
+    py::class_<FuzzHarness>(m, "FuzzHarness")
+        .def(py::init<CPU&, uint32_t, size_t, uint64_t>(), py::keep_alive<1, 2>(),
+             py::arg("cpu"), py::arg("input_address"), py::arg("max_input_size"), py::arg("instruction_budget"))
+        .def("run", [](FuzzHarness& harness, const py::object& data) {
+            ByteView bytes(data);
+            return harness.run(bytes.data(), bytes.size());
+        }, "Run one input and reset the CPU to the base state", py::arg("data"))
+        .def("get_stats", &FuzzHarness::get_stats, "Get the counters over every input", py::return_value_policy::copy)
+        .def("reset_stats", &FuzzHarness::reset_stats, "Reset the counters")
+        .def("get_instruction_budget", &FuzzHarness::get_instruction_budget)
+        .def("set_instruction_budget", &FuzzHarness::set_instruction_budget, py::arg("budget"));
+
+    // Bind harts sharing one memory
+    py::enum_<SchedulingMode>(m, "SchedulingMode")
+        .value("PARALLEL", SchedulingMode::PARALLEL)
+        .value("DETERMINISTIC", SchedulingMode::DETERMINISTIC)
+        .export_values();
+
+    py::class_<MachineConfig>(m, "MachineConfig")
+        .def(py::init<>())
+        .def_readwrite("scheduling", &MachineConfig::scheduling)
+        .def_readwrite("quantum", &MachineConfig::quantum, "Instructions of a turn in DETERMINISTIC mode");
+
+    // Bind machine snapshots, opaque handles like the CPU snapshots
+    py::class_<MachineSnapshot, std::shared_ptr<MachineSnapshot>>(m, "MachineSnapshot")
+        .def_property_readonly("hart_count", [](const MachineSnapshot& snapshot) { return snapshot.harts.size(); });
+
+    py::class_<Machine>(m, "Machine")
+        .def(py::init<size_t, size_t, MemoryBacking, ExecutionMode>(), py::arg("hart_count"), py::arg("memory_size"),
+             py::arg("backing") = MemoryBacking::HEAP, py::arg("mode") = ExecutionMode::PIPELINE)
+        .def("get_hart_count", &Machine::get_hart_count)
+        .def("get_hart", &Machine::get_hart, "Get a hart, it lives as long as the machine",
+             py::return_value_policy::reference_internal, py::arg("hart_id"))
+        .def("get_physical_memory", &Machine::get_physical_memory, "Get the memory shared by the harts",
+             py::return_value_policy::reference_internal)
+        .def("get_config", &Machine::get_config, py::return_value_policy::copy)
+        .def("set_config", &Machine::set_config, py::arg("config"))
+        .def("load_program", &Machine::load_program, "Load a program through hart 0 and start every hart at its entry",
+             py::arg("filepath"))
+        // The harts run on their own threads, Python devices take the GIL back when called
+        .def("run", &Machine::run, "Run every hart until it stops, one result per hart",
+             py::arg("max_instructions") = CPU::UNLIMITED, py::call_guard<py::gil_scoped_release>())
+        .def("request_stop", &Machine::request_stop, "Make every hart of the current or next run stop")
+        .def("snapshot", &Machine::snapshot, "Capture every hart and the shared memory")
+        .def("restore", &Machine::restore, "Rewind every hart and the shared memory to a snapshot", py::arg("snapshot"))
+        .def("restore_dirty", &Machine::restore_dirty,
+             "Rewind to the snapshot last taken or restored, copying back only the written pages",
+             py::arg("snapshot"));
+
+    // Bind the batch runner, images and expected bytes are any buffer
+    py::class_<MemoryCheck>(m, "MemoryCheck")
+        .def(py::init([](uint32_t address, const py::object& data) {
+            ByteView bytes(data);
+            return MemoryCheck{address, std::vector<uint8_t>(bytes.data(), bytes.data() + bytes.size())};
+        }), py::arg("address"), py::arg("data"))
+        .def_readwrite("address", &MemoryCheck::address)
+        .def_property("data",
+            [](const MemoryCheck& check) {
+                return py::bytes(reinterpret_cast<const char*>(check.data.data()), check.data.size());
+            },
+            [](MemoryCheck& check, const py::object& data) {
+                ByteView bytes(data);
+                check.data.assign(bytes.data(), bytes.data() + bytes.size());
+            });
+
+    py::class_<BatchJob>(m, "BatchJob")
+        .def(py::init<>())
+        .def_property("image",
+            [](const BatchJob& job) {
+                return py::bytes(reinterpret_cast<const char*>(job.image.data()), job.image.size());
+            },
+            [](BatchJob& job, const py::object& data) {
+                ByteView bytes(data);
+                job.image.assign(bytes.data(), bytes.data() + bytes.size());
+            }, "Program image, copied to load_address before the run")
+        .def_readwrite("load_address", &BatchJob::load_address)
+        .def_readwrite("entry", &BatchJob::entry, "PC the run starts from")
+        .def_readwrite("memory_size", &BatchJob::memory_size)
+        .def_readwrite("max_instructions", &BatchJob::max_instructions)
+        .def_readwrite("expected_reason", &BatchJob::expected_reason, "None: the job must halt or exit")
+        .def_readwrite("expected_exit_code", &BatchJob::expected_exit_code)
+        .def_readwrite("expected_registers", &BatchJob::expected_registers, "List of (register, value)")
+        .def_readwrite("expected_memory", &BatchJob::expected_memory, "List of MemoryCheck");
+
+    py::class_<BatchResult>(m, "BatchResult")
+        .def_readonly("run", &BatchResult::run)
+        .def_readonly("passed", &BatchResult::passed)
+        .def_readonly("failure", &BatchResult::failure, "First check that failed or the error that ended the job");
+
+    py::class_<BatchConfig>(m, "BatchConfig")
+        .def(py::init<>())
+        .def_readwrite("threads", &BatchConfig::threads, "Worker threads, 0 for one per host thread")
+        .def_readwrite("mode", &BatchConfig::mode)
+        .def_readwrite("backing", &BatchConfig::backing)
+        .def_readwrite("pin_threads", &BatchConfig::pin_threads);
+
+    py::class_<BatchStats>(m, "BatchStats")
+        .def_readonly("jobs", &BatchStats::jobs)
+        .def_readonly("passed", &BatchStats::passed)
+        .def_readonly("failed", &BatchStats::failed)
+        .def_readonly("instructions", &BatchStats::instructions)
+        .def_readonly("steals", &BatchStats::steals)
+        .def_readonly("threads", &BatchStats::threads)
+        .def_readonly("seconds", &BatchStats::seconds)
+        .def_readonly("jobs_per_second", &BatchStats::jobs_per_second);
+
+    py::class_<BatchRunner>(m, "BatchRunner")
+        .def(py::init<const BatchConfig&>(), py::arg("config") = BatchConfig{})
+        .def("get_config", &BatchRunner::get_config, py::return_value_policy::copy)
+        .def("set_config", &BatchRunner::set_config, py::arg("config"))
+        // The jobs are converted before the GIL is released, the workers never touch Python
+        .def("run", &BatchRunner::run, "Run every job on the worker threads, one result per job",
+             py::arg("jobs"), py::call_guard<py::gil_scoped_release>())
+        .def("get_stats", &BatchRunner::get_stats, "Get the counters of the last run", py::return_value_policy::copy);
 
     // Bind pipeline
     py::class_<Pipeline>(m, "Pipeline")
-        .def(py::init<RegisterBank&, MMU&>(), py::arg("register_bank"), py::arg("mmu"))
-        .def("run_cycle", &Pipeline::run_cycle, "Run one cycle of the pipeline");
+        .def(py::init<RegisterBank&, MMU&>(), py::arg("register_bank"), py::arg("mmu"),
+             py::keep_alive<1, 2>(), py::keep_alive<1, 3>())
+        .def("run_cycle", &Pipeline::run_cycle, "Run one cycle of the pipeline, a fused pair when allowed",
+             py::arg("allow_fusion") = false)
+        .def("fused_last_cycle", &Pipeline::fused_last_cycle, "Whether the last cycle ran a fused pair")
+        .def("get_csrs", py::overload_cast<>(&Pipeline::get_csrs), "Get the machine mode trap registers",
+             py::return_value_policy::reference_internal)
+        .def("get_last_trap", &Pipeline::get_last_trap, "Get the last trap raised", py::return_value_policy::copy)
+        .def("get_trap_count", &Pipeline::get_trap_count, "Count the traps raised")
+        .def("flush_predecode_cache", &Pipeline::flush_predecode_cache, "Drop every decoded instruction")
+        .def("get_predecode_stats", &Pipeline::get_predecode_stats, "Get the predecode cache counters",
+             py::return_value_policy::copy)
+        .def("reset_predecode_stats", &Pipeline::reset_predecode_stats, "Reset the predecode cache counters");
 
     // Bind FetchStage
     py::class_<FetchStage>(m, "FetchStage")
         .def(py::init<MMU&, RegisterBank&>(), py::arg("mmu"), py::arg("register_bank"))
         .def("process", &FetchStage::process, "Process the fetch stage")
-        .def("get_fetched_instruction", &FetchStage::get_fetched_instruction, "Return the fetched instruction");
+        .def("get_fetched_instruction", &FetchStage::get_fetched_instruction, "Return the fetched instruction")
+        .def("get_trap", &FetchStage::get_trap, "Return the fetch fault, if any", py::return_value_policy::copy);
 
     // Bind DecodeStage
     py::class_<DecodeStage>(m, "DecodeStage")
         .def(py::init<RegisterBank&>(), py::arg("register_bank"))
         .def("set_fetched_instruction", &DecodeStage::set_fetched_instruction, "Set the fetched instruction", py::arg("instruction"))
         .def("process", &DecodeStage::process, "Process the decode stage")
+        .def("get_instruction", &DecodeStage::get_instruction, "Return the decoded instruction",
+             py::return_value_policy::copy)
         .def("get_decoded_instruction", &DecodeStage::get_decoded_instruction, "Return the decoded instruction variant");
 
     // Bind ExecuteStage
     py::class_<ExecuteStage>(m, "ExecuteStage")
         .def(py::init<RegisterBank&>(), py::arg("register_bank"))
+        .def("set_instruction", &ExecuteStage::set_instruction, "Set the decoded instruction", py::arg("instruction"))
         .def("set_decoded_instruction",
          [](ExecuteStage &self, pybind11::object decoded_obj) {
              auto var = try_cast_variant<DecodedInstructionInvalid,
@@ -163,7 +895,8 @@ PYBIND11_MODULE(virtuv_bindings, m) {
                                          DecodedInstructionSType,
                                          DecodedInstructionBType,
                                          DecodedInstructionUType,
-                                         DecodedInstructionJType>(decoded_obj);
+                                         DecodedInstructionJType,
+                                         DecodedInstructionSystem>(decoded_obj);
              self.set_decoded_instruction(std::move(var));
          },
          py::arg("decoded_instruction"), "Set the decoded instruction")
@@ -174,6 +907,8 @@ PYBIND11_MODULE(virtuv_bindings, m) {
     py::class_<MemoryAccessStage>(m, "MemoryAccessStage")
         .def(py::init<MMU&, RegisterBank&>(), py::arg("mmu"), py::arg("register_bank"))
         .def("set_execution_result", &MemoryAccessStage::set_execution_result, "Set the execution result", py::arg("exec_result"))
+        .def("set_instruction", &MemoryAccessStage::set_instruction, "Set the decoded instruction",
+             py::arg("instruction"))
         .def("set_decoded_instruction",
          [](ExecuteStage &self, pybind11::object decoded_obj) {
              auto var = try_cast_variant<DecodedInstructionInvalid,
@@ -182,7 +917,8 @@ PYBIND11_MODULE(virtuv_bindings, m) {
                                          DecodedInstructionSType,
                                          DecodedInstructionBType,
                                          DecodedInstructionUType,
-                                         DecodedInstructionJType>(decoded_obj);
+                                         DecodedInstructionJType,
+                                         DecodedInstructionSystem>(decoded_obj);
              self.set_decoded_instruction(std::move(var));
          },
          py::arg("decoded_instruction"), "Set the decoded instruction")
@@ -194,6 +930,7 @@ PYBIND11_MODULE(virtuv_bindings, m) {
         .def(py::init<RegisterBank&>(), py::arg("register_bank"))
         .def("set_execution_result", &WriteBackStage::set_execution_result, "Set the execution result", py::arg("exec_result"))
         .def("set_memory_access_result", &WriteBackStage::set_memory_access_result, "Set the memory access result", py::arg("mem_result"))
+        .def("set_instruction", &WriteBackStage::set_instruction, "Set the decoded instruction", py::arg("instruction"))
         .def("set_decoded_instruction",
          [](ExecuteStage &self, pybind11::object decoded_obj) {
              auto var = try_cast_variant<DecodedInstructionInvalid,
@@ -202,7 +939,8 @@ PYBIND11_MODULE(virtuv_bindings, m) {
                                          DecodedInstructionSType,
                                          DecodedInstructionBType,
                                          DecodedInstructionUType,
-                                         DecodedInstructionJType>(decoded_obj);
+                                         DecodedInstructionJType,
+                                         DecodedInstructionSystem>(decoded_obj);
              self.set_decoded_instruction(std::move(var));
          },
          py::arg("decoded_instruction"), "Set the decoded instruction")
@@ -211,12 +949,17 @@ PYBIND11_MODULE(virtuv_bindings, m) {
     // Bind interstage communication objects
     py::class_<ExecutionResult>(m, "ExecutionResult")
         .def(py::init<>())
-        .def_readwrite("alu_result", &ExecutionResult::alu_result, "ALU result computed during execution");
+        .def_readwrite("alu_result", &ExecutionResult::alu_result, "ALU result computed during execution")
+        .def_readwrite("branch_taken", &ExecutionResult::branch_taken, "The instruction jumps")
+        .def_readwrite("branch_target", &ExecutionResult::branch_target,
+                       "Address of the next instruction when branch_taken")
+        .def_readonly("trap", &ExecutionResult::trap, "Trap raised during execution");
     
     py::class_<MemoryAccessResult>(m, "MemoryAccessResult")
         .def(py::init<>())
         .def_readwrite("load_data", &MemoryAccessResult::load_data, "Loaded data from memory (if any)")
-        .def_readwrite("store_success", &MemoryAccessResult::store_success, "Indicates if a store was successful");
+        .def_readwrite("store_success", &MemoryAccessResult::store_success, "Indicates if a store was successful")
+        .def_readonly("trap", &MemoryAccessResult::trap, "Load or store fault");
 
     // Bind the InstructionFormat enum.
     py::enum_<InstructionFormat>(m, "InstructionFormat")
@@ -227,8 +970,34 @@ PYBIND11_MODULE(virtuv_bindings, m) {
     .value("B_TYPE", InstructionFormat::B_TYPE)
     .value("U_TYPE", InstructionFormat::U_TYPE)
     .value("J_TYPE", InstructionFormat::J_TYPE)
+    .value("SYSTEM", InstructionFormat::SYSTEM)
     .export_values();
 
+    // Bind the decoded form the pipeline executes
+    py::enum_<Operation> operation(m, "Operation");
+    for (size_t i = 0; i < static_cast<size_t>(Operation::COUNT); ++i) {
+        std::string name = operation_name(static_cast<Operation>(i));
+        std::transform(name.begin(), name.end(), name.begin(), [](char c) {
+            return c == '.' ? '_' : static_cast<char>(std::toupper(c));
+        });
+        operation.value(name.c_str(), static_cast<Operation>(i));
+    }
+
+    py::class_<CompactInstruction>(m, "CompactInstruction")
+        .def(py::init(&decode_compact), py::arg("raw"))
+        .def_readonly("op", &CompactInstruction::op, "Operation, ILLEGAL for encodings the pipeline rejects")
+        .def_readonly("rd", &CompactInstruction::rd)
+        .def_readonly("rs1", &CompactInstruction::rs1)
+        .def_readonly("rs2", &CompactInstruction::rs2)
+        .def_readonly("imm", &CompactInstruction::imm,
+                      "Sign extended immediate, the shift amount of immediate shifts, the CSR of SYSTEM")
+        .def_readonly("raw", &CompactInstruction::raw)
+        .def("__repr__", [](const CompactInstruction& inst) {
+            return std::string("<CompactInstruction ") + operation_name(inst.op) + " rd=" + std::to_string(inst.rd)
+                   + " rs1=" + std::to_string(inst.rs1) + " rs2=" + std::to_string(inst.rs2)
+                   + " imm=" + std::to_string(inst.imm) + ">";
+        });
+
     // Bind each specialization of DecodedInstruction.  (bit fields are not addressabl because of memory alignment, lambdas are needed to modify individually)
 
     // Invalid type (for initialization or error)
@@ -396,4 +1165,24 @@ PYBIND11_MODULE(virtuv_bindings, m) {
             [](DecodedInstruction<InstructionFormat::J_TYPE>& inst, uint32_t val) { inst.imm20 = val; })
         .def("get_immediate", &DecodedInstruction<InstructionFormat::J_TYPE>::get_immediate)
         .def("get_opcode", &DecodedInstruction<InstructionFormat::J_TYPE>::get_opcode);
+
+    // SYSTEM instructions
+    py::class_<DecodedInstruction<InstructionFormat::SYSTEM>>(m, "DecodedInstructionSystem")
+        .def(py::init<uint32_t>())
+        .def_property("opcode",
+            [](const DecodedInstruction<InstructionFormat::SYSTEM>& inst) { return inst.opcode; },
+            [](DecodedInstruction<InstructionFormat::SYSTEM>& inst, uint32_t val) { inst.opcode = val; })
+        .def_property("rd",
+            [](const DecodedInstruction<InstructionFormat::SYSTEM>& inst) { return inst.rd; },
+            [](DecodedInstruction<InstructionFormat::SYSTEM>& inst, uint32_t val) { inst.rd = val; })
+        .def_property("funct3",
+            [](const DecodedInstruction<InstructionFormat::SYSTEM>& inst) { return inst.funct3; },
+            [](DecodedInstruction<InstructionFormat::SYSTEM>& inst, uint32_t val) { inst.funct3 = val; })
+        .def_property("rs1",
+            [](const DecodedInstruction<InstructionFormat::SYSTEM>& inst) { return inst.rs1; },
+            [](DecodedInstruction<InstructionFormat::SYSTEM>& inst, uint32_t val) { inst.rs1 = val; })
+        .def_property("csr",
+            [](const DecodedInstruction<InstructionFormat::SYSTEM>& inst) { return inst.csr; },
+            [](DecodedInstruction<InstructionFormat::SYSTEM>& inst, uint32_t val) { inst.csr = val; })
+        .def("get_opcode", &DecodedInstruction<InstructionFormat::SYSTEM>::get_opcode);
 }
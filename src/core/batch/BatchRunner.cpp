@@ -0,0 +1,211 @@
+#include "BatchRunner.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// Jobs [next, end) dealt to a worker. The owner and the workers stealing from it all take jobs
+// with the same fetch_add, a job is taken once without any lock. Aligned so two cursors never
+// share a cache line
+struct alignas(64) JobRange {
+    std::atomic<size_t> next{0};
+    size_t end = 0;
+};
+
+struct alignas(64) WorkerCounters {
+    uint64_t jobs = 0;
+    uint64_t passed = 0;
+    uint64_t instructions = 0;
+    uint64_t steals = 0;
+};
+
+// Best effort, a worker that cannot be pinned still runs
+void pin_to_cpu(size_t worker) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+        return;
+    }
+    size_t wanted = worker % static_cast<size_t>(CPU_COUNT(&allowed));
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &allowed) && wanted-- == 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            return;
+        }
+    }
+#else
+    (void)worker;
+#endif
+}
+
+// The CPU of a worker, rewound to its empty state before each job
+class WorkerCPU {
+private:
+    const BatchConfig& config;
+    std::unique_ptr<CPU> cpu;
+    std::shared_ptr<CPUSnapshot> empty;
+    size_t memory_size = 0;
+
+public:
+    explicit WorkerCPU(const BatchConfig& config) : config(config) {}
+
+    CPU& prepare(size_t size) {
+        if (cpu && size == memory_size) {
+            cpu->restore_dirty(*empty);
+            return *cpu;
+        }
+        // Machine mode with satp translation, bare at reset: the job sees its memory at its physical addresses
+        cpu = std::make_unique<CPU>(size, config.backing, config.mode);
+        cpu->set_translation_mode(TranslationMode::SATP);
+        empty = cpu->snapshot();
+        memory_size = size;
+        return *cpu;
+    }
+
+    void discard() {
+        cpu.reset();
+    }
+};
+
+const char* reason_name(StopReason reason) {
+    switch (reason) {
+        case StopReason::HALTED: return "HALTED";
+        case StopReason::BUDGET: return "BUDGET";
+        case StopReason::BREAKPOINT: return "BREAKPOINT";
+        case StopReason::TRAP: return "TRAP";
+        case StopReason::EXIT: return "EXIT";
+        default: return "STOPPED";
+    }
+}
+
+std::string check(CPU& cpu, const BatchJob& job, const RunResult& run) {
+    std::ostringstream failure;
+    if (job.expected_reason ? run.reason != *job.expected_reason
+                            : run.reason != StopReason::HALTED && run.reason != StopReason::EXIT) {
+        failure << "stopped with " << reason_name(run.reason) << " at pc 0x" << std::hex << run.pc;
+        if (run.reason == StopReason::TRAP) {
+            const Trap& trap = cpu.get_last_trap();
+            failure << ": " << trap::cause_name(trap.cause) << " (mtval 0x" << trap.value << ")";
+        }
+        return failure.str();
+    }
+    if (job.expected_exit_code && run.exit_code != *job.expected_exit_code) {
+        failure << "exit code " << run.exit_code << ", expected " << *job.expected_exit_code;
+        return failure.str();
+    }
+    for (const auto& [reg, value] : job.expected_registers) {
+        if (cpu.get_register(reg) != value) {
+            failure << "x" << static_cast<int>(reg) << " = 0x" << std::hex << cpu.get_register(reg)
+                    << ", expected 0x" << value;
+            return failure.str();
+        }
+    }
+    std::vector<uint8_t> actual;
+    for (const MemoryCheck& expected : job.expected_memory) {
+        actual.resize(expected.data.size());
+        cpu.read_block(expected.address, actual.data(), actual.size());
+        if (actual != expected.data) {
+            failure << "memory at 0x" << std::hex << expected.address << " differs";
+            return failure.str();
+        }
+    }
+    return {};
+}
+
+} // namespace
+
+BatchRunner::BatchRunner(const BatchConfig& config) : config(config) {}
+
+const BatchConfig& BatchRunner::get_config() const {
+    return config;
+}
+
+void BatchRunner::set_config(const BatchConfig& new_config) {
+    config = new_config;
+}
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<BatchJob>& jobs) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BatchResult> results(jobs.size());
+    size_t threads = config.threads != 0 ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max<size_t>(1, std::min(threads, jobs.size()));
+
+    std::vector<JobRange> ranges(threads);
+    for (size_t worker = 0; worker < threads; ++worker) {
+        ranges[worker].next.store(jobs.size() * worker / threads, std::memory_order_relaxed);
+        ranges[worker].end = jobs.size() * (worker + 1) / threads;
+    }
+    std::vector<WorkerCounters> counters(threads);
+
+    auto work = [&](size_t self) {
+        if (config.pin_threads) {
+            pin_to_cpu(self);
+        }
+        WorkerCPU worker_cpu(config);
+        WorkerCounters& own = counters[self];
+        // Its own range first, then the others in turn
+        for (size_t offset = 0; offset < threads; ++offset) {
+            JobRange& range = ranges[(self + offset) % threads];
+            for (size_t index = range.next.fetch_add(1, std::memory_order_relaxed); index < range.end;
+                 index = range.next.fetch_add(1, std::memory_order_relaxed)) {
+                const BatchJob& job = jobs[index];
+                BatchResult& result = results[index];
+                try {
+                    CPU& cpu = worker_cpu.prepare(job.memory_size);
+                    cpu.write_block(job.load_address, job.image.data(), job.image.size());
+                    cpu.get_register_bank().set_pc(job.entry);
+                    result.run = cpu.run(job.max_instructions);
+                    result.failure = check(cpu, job, result.run);
+                } catch (const std::exception& e) {
+                    result.failure = e.what();
+                    worker_cpu.discard();
+                }
+                result.passed = result.failure.empty();
+                ++own.jobs;
+                own.passed += result.passed;
+                own.instructions += result.run.instructions;
+                own.steals += offset != 0;
+            }
+        }
+    };
+
+    // The calling thread only waits, pinning must not change its affinity
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (size_t worker = 0; worker < threads; ++worker) {
+        pool.emplace_back(work, worker);
+    }
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+
+    stats = BatchStats{};
+    stats.threads = threads;
+    for (const WorkerCounters& worker : counters) {
+        stats.jobs += worker.jobs;
+        stats.passed += worker.passed;
+        stats.instructions += worker.instructions;
+        stats.steals += worker.steals;
+    }
+    stats.failed = stats.jobs - stats.passed;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.jobs_per_second = stats.seconds > 0.0 ? static_cast<double>(stats.jobs) / stats.seconds : 0.0;
+    return results;
+}
+
+const BatchStats& BatchRunner::get_stats() const {
+    return stats;
+}
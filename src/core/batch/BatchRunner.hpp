@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/cpu/CPU.hpp"
+
+/**
+ * @brief Bytes a job expects in guest memory once it stopped.
+ */
+struct MemoryCheck {
+    uint32_t address = 0;
+    std::vector<uint8_t> data;
+};
+
+/**
+ * @brief One guest program of a batch and the checks its outcome must pass.
+ */
+struct BatchJob {
+    std::vector<uint8_t> image;                  /**< Copied to load_address before the run */
+    uint32_t load_address = 0;
+    uint32_t entry = 0;                          /**< PC the run starts from */
+    size_t memory_size = 1024 * 1024;
+    uint64_t max_instructions = CPU::UNLIMITED;
+    std::optional<StopReason> expected_reason;   /**< When not set the job must halt or exit */
+    std::optional<uint32_t> expected_exit_code;  /**< a0 of the exit system call */
+    std::vector<std::pair<uint8_t, uint32_t>> expected_registers; /**< (register, value) pairs */
+    std::vector<MemoryCheck> expected_memory;
+};
+
+/**
+ * @brief How one job ended.
+ */
+struct BatchResult {
+    RunResult run;
+    bool passed = false;
+    std::string failure; /**< First check that failed or the error that ended the job, empty when passed */
+};
+
+/**
+ * @brief Settings of a BatchRunner.
+ */
+struct BatchConfig {
+    size_t threads = 0;                               /**< Worker threads, 0 for one per host thread */
+    ExecutionMode mode = ExecutionMode::PIPELINE;     /**< Execution mode of every job */
+    MemoryBacking backing = MemoryBacking::HEAP;
+    bool pin_threads = false;                         /**< Pin worker i to the i-th CPU the process may run on */
+};
+
+/**
+ * @brief Counters of the last BatchRunner::run.
+ */
+struct BatchStats {
+    uint64_t jobs = 0;
+    uint64_t passed = 0;
+    uint64_t failed = 0;
+    uint64_t instructions = 0;
+    uint64_t steals = 0;         /**< Jobs run by another worker than the one they were given to */
+    size_t threads = 0;
+    double seconds = 0.0;        /**< Wall time of the whole batch */
+    double jobs_per_second = 0.0;
+};
+
+/**
+ * @brief Runs many independent guest programs on a pool of worker threads.
+ *
+ * Each worker keeps one CPU and rewinds it to its empty state between jobs with
+ * CPU::restore_dirty, so a job costs the pages it wrote rather than a CPU construction. The
+ * CPU is rebuilt when a job asks for another memory size or ended with an exception. The CPU is
+ * built on its worker thread, after the pinning, so with first touch allocation its memory is
+ * on the NUMA node of the worker.
+ *
+ * The jobs are dealt out as one contiguous range per worker. A worker that finishes its range
+ * takes jobs from the ranges of the others. Every job writes its own result slot and every
+ * worker its own counters, the hot path takes no lock.
+ */
+class BatchRunner {
+private:
+    BatchConfig config;
+    BatchStats stats;
+
+public:
+    explicit BatchRunner(const BatchConfig& config = BatchConfig{});
+
+    const BatchConfig& get_config() const;
+    void set_config(const BatchConfig& config);
+
+    /**
+     * @brief Runs every job and waits for all of them.
+     *
+     * Errors of a job, e.g. an image that does not fit its memory, fail that job only.
+     * @param jobs The jobs, they are not modified.
+     * @return One result per job, in the order of the jobs.
+     */
+    std::vector<BatchResult> run(const std::vector<BatchJob>& jobs);
+
+    /**
+     * @brief Gets the counters of the last run.
+     */
+    const BatchStats& get_stats() const;
+};
@@ -1,25 +1,68 @@
 #include "CPU.hpp"
 #include <fstream>
+#include <sstream>
+#include <stdexcept>
 #include <iostream>
 #include <vector>
+#include "core/loader/ElfLoader.hpp"
 #include "utils/plt.hpp"
 
-CPU::CPU(size_t memory_size)
-    : register_bank(),                           
-      physical_memory(memory_size),                
+CPU::CPU(size_t memory_size, MemoryBacking backing, ExecutionMode mode)
+    : CPU(std::make_shared<PhysicalMemory>(memory_size, backing), 0, mode)
+{
+}
+
+CPU::CPU(std::shared_ptr<PhysicalMemory> memory, uint32_t hart_id, ExecutionMode mode)
+    : shared_memory(std::move(memory)),
+      physical_memory(*shared_memory),
+      bus(&physical_memory),
       page_table(),                                
       mmu(&physical_memory, &page_table, PrivilegeMode::MACHINE), 
-      pipeline(register_bank, mmu),              
-      privilege_mode(PrivilegeMode::MACHINE)      
+      register_bank(),                           
+      pipeline(register_bank, mmu),
+      threaded_engine(register_bank, mmu, bus, pipeline),
+      functional_engine(register_bank, mmu, bus, pipeline),
+      execution_mode(ExecutionMode::PIPELINE),
+      symbols(std::make_shared<const SymbolTable>()),
+      stop_requested(false)
 {
     uint32_t virtual_address = 0x0000;
     uint32_t page_number = virtual_address & 0xFFFFF000;
     uint32_t entry_value = (page_number & 0xFFFFF000)
                            | PageTableEntry::VALID_BIT | PageTableEntry::READ_BIT | PageTableEntry::WRITE_BIT | PageTableEntry::EXECUTE_BIT | PageTableEntry::USER_ACCESSIBLE_BIT;
     page_table.add_entry(page_number, PageTableEntry(entry_value));
+    mmu.set_bus(&bus);
+    pipeline.get_csrs().mhartid = hart_id;
+    set_execution_mode(mode);
+}
+
+CPU::CPU(const CPUSnapshot& snapshot)
+    : CPU(snapshot.memory->get_size(), snapshot.memory_backing)
+{
+    for (const BusRegion& region : snapshot.bus_regions) {
+        if (region.kind == RegionKind::MMIO) {
+            throw std::invalid_argument("Cannot build a CPU from a snapshot with device " + region.name + " attached, devices cannot be copied");
+        }
+        attach_rom(region.base, region.storage.get(), region.size, region.name);
+    }
+    set_misaligned_access(snapshot.misaligned_access);
+    set_fusion_enabled(snapshot.fusion_enabled);
+    set_timing_config(snapshot.timing_config);
+    set_timing_enabled(snapshot.timing_enabled);
+    set_cache_config(snapshot.cache_config);
+    set_cache_enabled(snapshot.cache_enabled);
+    set_branch_predictor_config(snapshot.branch_predictor_config);
+    set_jit_config(snapshot.jit_config);
+    set_execution_mode(snapshot.execution_mode);
+    symbols = snapshot.symbols;
+    restore(snapshot);
 }
 
 int CPU::load_program(const std::string &filepath) {
+    if (ElfLoader::is_elf(filepath)) {
+        return load_elf(filepath);
+    }
+
     std::ifstream file(filepath, std::ios::binary | std::ios::ate);
     if (!file.is_open()) {
         PLT_ERROR("Error: Unable to open program file: " + filepath);
@@ -37,14 +80,12 @@ int CPU::load_program(const std::string &filepath) {
     }
     file.close();
 
-    //For the moment copy the program to memory starting from address 0
-    for (std::streamsize i = 0; i < size; ++i) {
-        try {
-            mmu.write(static_cast<uint32_t>(i), static_cast<uint8_t>(buffer[i]));
-        } catch (const std::exception& e) {
-            PLT_ERROR("Error writing to physical memory at address " + std::to_string(i) + ": " + e.what());
-            return -1;
-        }
+    //For the moment copy the program to memory starting from address 0, one translation per page
+    try {
+        mmu.write_block(0, reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+    } catch (const std::exception& e) {
+        PLT_ERROR("Error writing program to memory: " + std::string(e.what()));
+        return -1;
     }
     //set initial pc where the program starts
     register_bank.set_pc(0);
@@ -53,24 +94,290 @@ int CPU::load_program(const std::string &filepath) {
     return 0;
 }
 
+int CPU::load_elf(const std::string &filepath) {
+    ElfImage image;
+    try {
+        image = ElfLoader::load(filepath, physical_memory);
+    } catch (const std::exception& e) {
+        PLT_ERROR("Error loading ELF program " + filepath + ": " + e.what());
+        return -1;
+    }
+
+    // Map every page of every segment with the permissions of the segment
+    for (const ElfSegment& segment : image.segments) {
+        uint32_t flags = PageTableEntry::VALID_BIT | PageTableEntry::USER_ACCESSIBLE_BIT
+                         | (segment.readable ? PageTableEntry::READ_BIT : 0)
+                         | (segment.writable ? PageTableEntry::WRITE_BIT : 0)
+                         | (segment.executable ? PageTableEntry::EXECUTE_BIT : 0);
+        uint32_t first_page = segment.virtual_address & MMU::PAGE_MASK;
+        uint32_t last_page = (segment.virtual_address + segment.memory_size - 1) & MMU::PAGE_MASK;
+        uint32_t physical_page = segment.physical_address & MMU::PAGE_MASK;
+        for (uint32_t page = first_page; ; page += MMU::PAGE_SIZE, physical_page += MMU::PAGE_SIZE) {
+            page_table.add_entry(page, PageTableEntry(physical_page | flags));
+            if (page == last_page) {
+                break;
+            }
+        }
+    }
+
+    symbols = std::make_shared<const SymbolTable>(std::move(image.symbols));
+    register_bank.set_pc(image.entry);
+    // The loader wrote physical memory directly, the MMU did not see the writes
+    flush_code_caches();
+
+    std::ostringstream message;
+    message << "ELF program loaded successfully (" << image.segments.size() << " segments, entry 0x"
+            << std::hex << image.entry << ").";
+    PLT_INFO(message.str());
+    return 0;
+}
+
 void CPU::run() {
     try {
-        while (true) {
-            PLT_DEBUG("INSTRUCTION");
-            pipeline.run_cycle();
+        RunResult result = run(UNLIMITED);
+        if (result.reason == StopReason::TRAP || result.reason == StopReason::EXIT) {
+            check_cycle(CycleStatus::UNHANDLED_TRAP);
+        }
+        if (result.reason == StopReason::HALTED) {
+            PLT_INFO("CPU ended program, exiting simulation");
         }
-    } catch (const EndOfProgramException& e){
-        PLT_INFO("CPU ended program, exiting simulation");
     } catch (const std::exception& e) {
         PLT_ERROR("CPU Exception: " + std::string(e.what()));
-        throw e;
+        throw;
+    }
+}
+
+void CPU::step() {
+    CycleStatus status = pipeline.run_cycle();
+    // Devices advance with retired instructions, a halt or an unhandled trap retires nothing
+    uint64_t executed = (completed_instruction(status) ? 1 : 0) + (pipeline.fused_last_cycle() ? 1 : 0);
+    if (executed != 0) {
+        bus.tick(executed);
+    }
+    check_cycle(status);
+}
+
+RunResult CPU::run(uint64_t max_instructions) {
+    // The timing model only sees the instructions of the pipeline
+    return execute(max_instructions, NO_STOP_PC, !pipeline.is_timing_enabled());
+}
+
+RunResult CPU::run_until(uint32_t pc, uint64_t max_instructions) {
+    return execute(max_instructions, pc, !pipeline.is_timing_enabled());
+}
+
+RunResult CPU::step(uint64_t n) {
+    return execute(n, NO_STOP_PC, false);
+}
+
+void CPU::request_stop() {
+    stop_requested.store(true, std::memory_order_relaxed);
+}
+
+RunResult CPU::execute(uint64_t max_instructions, uint64_t stop_pc, bool use_engines) {
+    use_engines = use_engines && execution_mode != ExecutionMode::PIPELINE;
+    RunResult result;
+    while (true) {
+        uint32_t pc = register_bank.get_pc();
+        // Checked between batches, the engines never look at it
+        if (stop_requested.load(std::memory_order_relaxed)) {
+            stop_requested.store(false, std::memory_order_relaxed);
+            result.reason = StopReason::STOPPED;
+            break;
+        }
+        if (result.instructions == max_instructions) {
+            result.reason = StopReason::BUDGET;
+            break;
+        }
+        // The instruction at the breakpoint runs when the call starts there
+        if (pc == stop_pc && result.instructions != 0) {
+            result.reason = StopReason::BREAKPOINT;
+            break;
+        }
+
+        uint64_t executed = 0;
+        uint64_t budget = max_instructions - result.instructions;
+        CycleStatus status;
+        if (use_engines && pc != stop_pc) {
+            // The engines tick the devices themselves
+            status = execution_mode == ExecutionMode::FUNCTIONAL
+                         ? functional_engine.run_instructions(budget, stop_pc, executed)
+                         : threaded_engine.run_blocks(budget, stop_pc, executed);
+        } else {
+            // A fused pair must not run past the budget or over the breakpoint
+            status = pipeline.run_cycle(budget >= 2 && stop_pc != static_cast<uint64_t>(pc) + 4);
+            executed = (completed_instruction(status) ? 1 : 0) + (pipeline.fused_last_cycle() ? 1 : 0);
+            if (executed != 0) {
+                bus.tick(executed);
+            }
+        }
+        result.instructions += executed;
+
+        if (status == CycleStatus::HALTED) {
+            result.reason = StopReason::HALTED;
+            break;
+        }
+        if (status == CycleStatus::UNHANDLED_TRAP) {
+            const Trap& trap = pipeline.get_last_trap();
+            bool is_ecall = trap.cause == TrapCause::ECALL_FROM_USER || trap.cause == TrapCause::ECALL_FROM_SUPERVISOR
+                            || trap.cause == TrapCause::ECALL_FROM_MACHINE;
+            if (is_ecall && register_bank.read(17) == EXIT_SYSCALL) {
+                result.reason = StopReason::EXIT;
+                result.exit_code = register_bank.read(10);
+            } else {
+                result.reason = StopReason::TRAP;
+            }
+            break;
+        }
     }
+    result.pc = register_bank.get_pc();
+    return result;
+}
+
+ExecutionMode CPU::get_execution_mode() const {
+    return execution_mode;
+}
+
+void CPU::set_execution_mode(ExecutionMode mode) {
+    execution_mode = mode;
+    threaded_engine.set_jit_enabled(mode == ExecutionMode::JIT);
+}
+
+const ThreadedStats& CPU::get_threaded_stats() const {
+    return threaded_engine.get_stats();
+}
+
+void CPU::reset_threaded_stats() {
+    threaded_engine.reset_stats();
+}
+
+const FunctionalStats& CPU::get_functional_stats() const {
+    return functional_engine.get_stats();
+}
+
+void CPU::reset_functional_stats() {
+    functional_engine.reset_stats();
+}
+
+void CPU::set_timing_enabled(bool enabled) {
+    pipeline.set_timing_enabled(enabled);
+}
+
+bool CPU::is_timing_enabled() const {
+    return pipeline.is_timing_enabled();
+}
+
+const TimingConfig& CPU::get_timing_config() const {
+    return pipeline.get_timing().get_config();
+}
+
+void CPU::set_timing_config(const TimingConfig& config) {
+    pipeline.get_timing().set_config(config);
+}
+
+const TimingStats& CPU::get_timing_stats() const {
+    return pipeline.get_timing().get_stats();
+}
+
+void CPU::reset_timing_stats() {
+    pipeline.get_timing().reset();
+}
+
+void CPU::set_cache_enabled(bool enabled) {
+    pipeline.set_cache_enabled(enabled);
+}
+
+bool CPU::is_cache_enabled() const {
+    return pipeline.is_cache_enabled();
+}
+
+const CacheHierarchyConfig& CPU::get_cache_config() const {
+    return pipeline.get_caches().get_config();
+}
+
+void CPU::set_cache_config(const CacheHierarchyConfig& config) {
+    pipeline.get_caches().set_config(config);
+}
+
+CacheHierarchyStats CPU::get_cache_stats() const {
+    return pipeline.get_caches().get_stats();
+}
+
+void CPU::reset_cache_stats() {
+    pipeline.get_caches().reset_stats();
+}
+
+void CPU::set_branch_predictor_config(const BranchPredictorConfig& config) {
+    pipeline.get_branch_predictor().set_config(config);
+}
+
+const BranchPredictorConfig& CPU::get_branch_predictor_config() const {
+    return pipeline.get_branch_predictor().get_config();
+}
+
+const BranchPredictorStats& CPU::get_branch_predictor_stats() const {
+    return pipeline.get_branch_predictor().get_stats();
+}
+
+std::vector<BranchSiteStats> CPU::get_branch_site_stats() const {
+    return pipeline.get_branch_predictor().get_site_stats();
+}
+
+void CPU::reset_branch_predictor_stats() {
+    pipeline.get_branch_predictor().reset_stats();
+}
+
+uint64_t CPU::get_branch_predictor_storage_bits() const {
+    return pipeline.get_branch_predictor().storage_bits();
+}
+
+void CPU::set_fusion_enabled(bool enabled) {
+    pipeline.set_fusion_enabled(enabled);
+}
+
+bool CPU::is_fusion_enabled() const {
+    return pipeline.is_fusion_enabled();
+}
+
+const FusionStats& CPU::get_fusion_stats() const {
+    return pipeline.get_fusion_stats();
+}
+
+void CPU::reset_fusion_stats() {
+    pipeline.reset_fusion_stats();
+}
+
+const JitConfig& CPU::get_jit_config() const {
+    return threaded_engine.get_jit_config();
+}
+
+void CPU::set_jit_config(const JitConfig& config) {
+    threaded_engine.set_jit_config(config);
+}
+
+void CPU::check_cycle(CycleStatus status) const {
+    if (status != CycleStatus::UNHANDLED_TRAP) {
+        return;
+    }
+    const Trap& trap = pipeline.get_last_trap();
+    std::ostringstream message;
+    message << "Unhandled trap: " << trap::cause_name(trap.cause) << " at pc 0x" << std::hex << register_bank.get_pc()
+            << " (mtval 0x" << trap.value << "), no handler installed in mtvec";
+    throw UnhandledTrapException(message.str(), trap, register_bank.get_pc());
 }
 
 uint32_t CPU::get_register(uint8_t reg){
     return register_bank.read(reg);
 }
 
+void CPU::set_register(uint8_t reg, uint32_t value) {
+    register_bank.write(reg, value);
+}
+
+uint32_t CPU::get_pc() const {
+    return register_bank.get_pc();
+}
+
 uint32_t CPU::read_word_from_memory(uint32_t address){
     try {
         return mmu.read_word(address);
@@ -78,4 +385,190 @@ uint32_t CPU::read_word_from_memory(uint32_t address){
         PLT_ERROR("Error reading from physical memory at address " + std::to_string(address) + ": " + e.what());
         return -1;
     }
-}
\ No newline at end of file
+}
+
+void CPU::read_block(uint32_t address, uint8_t* data, size_t size) {
+    mmu.read_block(address, data, size);
+}
+
+void CPU::write_block(uint32_t address, const uint8_t* data, size_t size) {
+    mmu.write_block(address, data, size);
+}
+
+void CPU::fill(uint32_t address, uint8_t value, size_t size) {
+    mmu.fill(address, value, size);
+}
+
+PhysicalMemory& CPU::get_physical_memory() {
+    return physical_memory;
+}
+
+const Bus& CPU::get_bus() const {
+    return bus;
+}
+
+void CPU::attach_device(uint32_t base, size_t size, std::shared_ptr<Device> device) {
+    bus.add_device(base, size, std::move(device));
+    // RAM pages now shadowed by the device may be cached
+    mmu.flush_tlb();
+}
+
+void CPU::attach_rom(uint32_t base, const uint8_t* data, size_t size, const std::string& name) {
+    bus.add_rom(base, data, size, name);
+    mmu.flush_tlb();
+}
+
+RegisterBank& CPU::get_register_bank() {
+    return register_bank;
+}
+
+CSRFile& CPU::get_csrs() {
+    return pipeline.get_csrs();
+}
+
+PrivilegeMode CPU::get_privilege_mode() const {
+    return mmu.get_privilege_mode();
+}
+
+void CPU::set_privilege_mode(PrivilegeMode mode) {
+    mmu.set_privilege_mode(mode);
+}
+
+TranslationMode CPU::get_translation_mode() const {
+    return mmu.get_translation_mode();
+}
+
+void CPU::set_translation_mode(TranslationMode mode) {
+    mmu.set_translation_mode(mode);
+}
+
+const PredecodeStats& CPU::get_predecode_stats() const {
+    return pipeline.get_predecode_stats();
+}
+
+void CPU::reset_predecode_stats() {
+    pipeline.reset_predecode_stats();
+}
+
+void CPU::flush_predecode_cache() {
+    flush_code_caches();
+}
+
+void CPU::flush_code_caches() {
+    pipeline.flush_predecode_cache();
+    threaded_engine.flush();
+    // Nothing is cached anymore, writes to former code pages can take the TLB hit path again
+    mmu.clear_code_pages();
+}
+
+MisalignedAccess CPU::get_misaligned_access() const {
+    return mmu.get_misaligned_access();
+}
+
+void CPU::set_misaligned_access(MisalignedAccess policy) {
+    mmu.set_misaligned_access(policy);
+}
+
+const Trap& CPU::get_last_trap() const {
+    return pipeline.get_last_trap();
+}
+
+uint64_t CPU::get_trap_count() const {
+    return pipeline.get_trap_count();
+}
+
+const TLBStats& CPU::get_tlb_stats() const {
+    return mmu.get_tlb_stats();
+}
+
+size_t CPU::count_dirty_pages() const {
+    return physical_memory.count_dirty_pages();
+}
+
+const SymbolTable& CPU::get_symbols() const {
+    return *symbols;
+}
+
+std::optional<uint32_t> CPU::lookup_symbol(const std::string& name) const {
+    const Symbol* symbol = symbols->find(name);
+    if (symbol == nullptr) {
+        return std::nullopt;
+    }
+    return symbol->address;
+}
+
+std::shared_ptr<CPUSnapshot> CPU::snapshot() {
+    return std::make_shared<CPUSnapshot>(capture_state(physical_memory.snapshot()));
+}
+
+void CPU::restore(const CPUSnapshot& snapshot) {
+    physical_memory.restore(*snapshot.memory);
+    restore_state(snapshot);
+    flush_code_caches();
+}
+
+size_t CPU::restore_dirty(const CPUSnapshot& snapshot) {
+    invalidate_written_code();
+    size_t restored = physical_memory.restore_dirty_pages(*snapshot.memory);
+    restore_state(snapshot);
+    return restored;
+}
+
+CPUSnapshot CPU::capture_state(std::shared_ptr<const MemorySnapshot> memory) {
+    CPUSnapshot snapshot;
+    snapshot.register_bank = register_bank;
+    snapshot.csrs = pipeline.get_csrs();
+    snapshot.page_table = page_table;
+    snapshot.privilege_mode = mmu.get_privilege_mode();
+    snapshot.translation_mode = mmu.get_translation_mode();
+    snapshot.satp = mmu.get_satp();
+    snapshot.memory_backing = physical_memory.get_backing();
+    snapshot.memory = std::move(memory);
+
+    snapshot.execution_mode = execution_mode;
+    snapshot.misaligned_access = mmu.get_misaligned_access();
+    snapshot.fusion_enabled = pipeline.is_fusion_enabled();
+    snapshot.timing_enabled = pipeline.is_timing_enabled();
+    snapshot.timing_config = get_timing_config();
+    snapshot.cache_enabled = pipeline.is_cache_enabled();
+    snapshot.cache_config = get_cache_config();
+    snapshot.branch_predictor_config = get_branch_predictor_config();
+    snapshot.jit_config = get_jit_config();
+    snapshot.bus_regions = bus.get_regions();
+    snapshot.symbols = symbols;
+
+    // Dirty tracking restarted, write translations must be installed again to mark their pages
+    mmu.flush_tlb();
+    return snapshot;
+}
+
+void CPU::restore_state(const CPUSnapshot& snapshot) {
+    register_bank = snapshot.register_bank;
+    restore_csrs(snapshot.csrs);
+    page_table = snapshot.page_table;
+
+    // Each setter flushes the TLB, so no stale host pointer or permission survives the restore
+    mmu.set_translation_mode(snapshot.translation_mode);
+    mmu.set_satp(snapshot.satp);
+    mmu.set_privilege_mode(snapshot.privilege_mode);
+}
+
+void CPU::invalidate_written_code() {
+    // Only the pages copied back can change under the decoded instructions, ask before the
+    // restore clears the dirty bits
+    pipeline.invalidate_written_code(physical_memory);
+    threaded_engine.invalidate_written_code(physical_memory);
+}
+
+void CPU::restore_csrs(const CSRFile& csrs) {
+    // A snapshot of another hart must not change who this hart is
+    uint32_t hart_id = pipeline.get_csrs().mhartid;
+    pipeline.get_csrs() = csrs;
+    pipeline.get_csrs().mhartid = hart_id;
+    // The reservation was on memory that has just been replaced
+    pipeline.clear_reservation();
+}
+
+std::unique_ptr<CPU> CPU::fork() {
+    return std::make_unique<CPU>(*snapshot());
+}
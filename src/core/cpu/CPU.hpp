@@ -1,25 +1,284 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
+#include "core/cpu/functional/FunctionalEngine.hpp"
 #include "core/cpu/pipeline/Pipeline.hpp"
 #include "core/cpu/register_bank/RegisterBank.hpp"
+#include "core/cpu/state/CPUSnapshot.hpp"
+#include "core/cpu/state/ExecutionMode.hpp"
+#include "core/cpu/threaded/ThreadedEngine.hpp"
+#include "core/loader/SymbolTable.hpp"
 #include "core/memory/MMU.hpp"
 
+/**
+ * @brief Why a budgeted run returned.
+ */
+enum class StopReason {
+    HALTED = 0,     /**< The program jumped to itself, the PC is at the jump */
+    BUDGET = 1,     /**< The instruction budget is spent */
+    BREAKPOINT = 2, /**< The PC reached the address given to run_until(), nothing there was executed */
+    TRAP = 3,       /**< The guest trapped while mtvec is 0, see get_last_trap() */
+    EXIT = 4,       /**< The guest made the exit system call (ECALL with a7 = 93) while mtvec is 0 */
+    STOPPED = 5     /**< request_stop() was called */
+};
+
+/**
+ * @brief Outcome of CPU::run(max_instructions), CPU::run_until() and CPU::step(n).
+ */
+struct RunResult {
+    StopReason reason = StopReason::BUDGET;
+    uint64_t instructions = 0; /**< Instructions retired or trapped into a handler during the call */
+    uint32_t pc = 0;           /**< PC when the run stopped */
+    uint32_t exit_code = 0;    /**< a0 of the exit system call, only set for EXIT */
+};
+
 class CPU {
+public:
+    static constexpr uint64_t UNLIMITED = UINT64_MAX; /**< Instruction budget of a run with no limit */
+
 private:
-    RegisterBank register_bank;     // Manages registers
-    Pipeline pipeline;              // Manages instruction processing
-    MMU mmu;                        /**< Memory Management Unit */
-    PhysicalMemory physical_memory;
+    // Declaration order is construction order: memory and page table before the MMU that points to them
+    std::shared_ptr<PhysicalMemory> shared_memory; // owned with the other harts of a Machine, if any
+    PhysicalMemory& physical_memory;
+    Bus bus;                        /**< ROM and devices in front of the physical memory */
     PageTable page_table;
-    PrivilegeMode privilege_mode;   /**< Current privilege mode of the CPU */
+    MMU mmu;                        /**< Memory Management Unit */
+    RegisterBank register_bank;     // Manages registers
+    Pipeline pipeline;              // Manages instruction processing, owns the CSRs
+    ThreadedEngine threaded_engine; // Block engine, leaves SYSTEM instructions and traps to the pipeline
+    FunctionalEngine functional_engine; // Single step interpreter, leaves the same to the pipeline
+    ExecutionMode execution_mode;
+    std::shared_ptr<const SymbolTable> symbols; /**< Symbols of the last ELF program loaded, shared with snapshots */
+
+    std::atomic<bool> stop_requested;   // set by request_stop(), consumed by the run that sees it
+
+    static constexpr uint64_t NO_STOP_PC = UINT64_MAX; // never equal to a 32-bit PC
+    static constexpr uint32_t EXIT_SYSCALL = 93;        // Linux exit: number in a7, status in a0
+
+    void check_cycle(CycleStatus status) const; // throws UnhandledTrapException for a trap without handler
+    // Loop behind run(), run_until() and step(n)
+    RunResult execute(uint64_t max_instructions, uint64_t stop_pc, bool use_engines);
+    void flush_code_caches();                   // drops decoded instructions and blocks, and their code marks
+    void restore_csrs(const CSRFile& csrs);     // CSRs of a snapshot, the hart id stays
+
+    // Used by snapshot/restore and by Machine, which captures the shared memory once for every hart
+    friend class Machine;
+    // Everything but the memory, both flush the TLB
+    CPUSnapshot capture_state(std::shared_ptr<const MemorySnapshot> memory);
+    void restore_state(const CPUSnapshot& snapshot);
+    void invalidate_written_code();                    // drops the decoded instructions of the dirty pages
 
 public:
-    CPU(size_t memory_size);
+    CPU(size_t memory_size, MemoryBacking backing = MemoryBacking::HEAP, ExecutionMode mode = ExecutionMode::PIPELINE);
+    // Same settings and ROMs as the CPU of the snapshot, throws std::invalid_argument if it had devices
+    explicit CPU(const CPUSnapshot& snapshot);
+    /**
+     * @brief Builds a hart on a memory other harts may share, see Machine.
+     *
+     * The memory is shared, the bus devices, page table, TLB and code caches are the hart's own.
+     * @param memory The physical memory.
+     * @param hart_id Value of the mhartid CSR.
+     * @param mode The execution mode.
+     */
+    CPU(std::shared_ptr<PhysicalMemory> memory, uint32_t hart_id, ExecutionMode mode = ExecutionMode::PIPELINE);
+
+    int load_program(const std::string &filepath); // Load a binary program, ELF files go through load_elf
+
+    /**
+     * @brief Loads an ELF32 executable and points the PC at its entry.
+     *
+     * Segments are placed at their physical addresses and their pages are mapped in the page
+     * table with the segment permissions, user accessible. The symbol table is kept for lookups.
+     * @param filepath Path of the executable.
+     * @return 0 on success, -1 if the file cannot be loaded.
+     */
+    int load_elf(const std::string &filepath);
+    /**
+     * @brief Runs until the program ends with a jump to itself.
+     *
+     * Guest traps are handled inside the pipeline by jumping to mtvec. The execution mode
+     * selects the engine, all of them produce the same state.
+     * @throws UnhandledTrapException if the guest traps while mtvec is 0.
+     */
+    void run();
+    // Execute a single instruction through the pipeline, same traps as run()
+    void step();
+
+    /**
+     * @brief Runs at most max_instructions instructions and reports why it stopped.
+     *
+     * Nothing is thrown for the guest: the jump to self, a trap while mtvec is 0 and the exit
+     * system call come back as a StopReason. The budget is exact in every execution mode, the
+     * engines only start a batch of blocks that fits in what is left of it. Instructions that
+     * trap into a handler count, the jump to self that ends the program does not.
+     * @param max_instructions Instruction budget, UNLIMITED for none.
+     */
+    RunResult run(uint64_t max_instructions);
+
+    /**
+     * @brief Like run(max_instructions), also stopping before the instruction at pc.
+     *
+     * When the PC is already there, that instruction is executed first so a loop can be run
+     * one iteration at a time.
+     */
+    RunResult run_until(uint32_t pc, uint64_t max_instructions = UNLIMITED);
+
+    /**
+     * @brief Executes n instructions through the pipeline, stopping early like run(max_instructions).
+     */
+    RunResult step(uint64_t n);
 
-    int load_program(const std::string &filepath); // Load a binary program
-    void run();                                     // Run the CPU
+    /**
+     * @brief Makes the current or next run return STOPPED. Safe to call from another thread.
+     *
+     * The flag is checked between batches of blocks, a run returns within a few thousand instructions.
+     */
+    void request_stop();
+    ExecutionMode get_execution_mode() const;       // engine used by run()
+    void set_execution_mode(ExecutionMode mode);    // PIPELINE unless given to the constructor
+    const ThreadedStats& get_threaded_stats() const; // blocks translated and executed by the threaded engine
+    void reset_threaded_stats();                    // resets the threaded engine counters
+    const FunctionalStats& get_functional_stats() const; // instructions executed by the functional engine
+    void reset_functional_stats();                  // resets the functional engine counters
+    /**
+     * @brief Turns the cycle-approximate timing model of the pipeline on or off.
+     *
+     * While it is on, run() goes through the pipeline whatever the execution mode, and every
+     * instruction is also accounted as it would flow through an overlapped 5-stage core.
+     * Turning it on starts counting from an empty pipeline.
+     */
+    void set_timing_enabled(bool enabled);
+    bool is_timing_enabled() const;
+    const TimingConfig& get_timing_config() const;  // forwarding paths and redirect penalties
+    void set_timing_config(const TimingConfig& config); // applies to the instructions that follow
+    const TimingStats& get_timing_stats() const;    // cycles, instructions and stalls per cause
+    void reset_timing_stats();                      // starts again from an empty pipeline
+    /**
+     * @brief Turns the cache model on or off, off by default.
+     *
+     * The L1 instruction and data caches and the shared L2 only see accesses while the timing
+     * model is on, their latencies add to its cycle count. Turning it on starts from cold caches.
+     */
+    void set_cache_enabled(bool enabled);
+    bool is_cache_enabled() const;
+    const CacheHierarchyConfig& get_cache_config() const; // geometry, policies and latencies of every level
+    // Starts from cold caches, throws std::invalid_argument on a bad geometry
+    void set_cache_config(const CacheHierarchyConfig& config);
+    CacheHierarchyStats get_cache_stats() const;     // hits, misses, evictions and write backs per level
+    void reset_cache_stats();                       // resets the cache counters, the cached lines stay
+    /**
+     * @brief Selects the branch predictor the timing model fetches with.
+     *
+     * STATIC by default: every taken branch and jump costs its redirect penalty. A bimodal, gshare
+     * or TAGE direction predictor comes with a branch target buffer and a return address stack,
+     * only mispredicted branches and jumps cost the penalty. Predictions are made while the timing
+     * model is on. Changing the predictor starts it untrained, throws std::invalid_argument on
+     * a table size out of range.
+     */
+    void set_branch_predictor_config(const BranchPredictorConfig& config);
+    const BranchPredictorConfig& get_branch_predictor_config() const;
+    const BranchPredictorStats& get_branch_predictor_stats() const; // predictions and mispredictions per kind of branch
+    std::vector<BranchSiteStats> get_branch_site_stats() const;    // per branch PC, most mispredicted first
+    void reset_branch_predictor_stats();            // resets the counters, what was learnt stays
+    uint64_t get_branch_predictor_storage_bits() const; // state a hardware version of the predictor would hold
+    /**
+     * @brief Turns macro-op fusion of the pipeline on or off, on by default.
+     *
+     * Budgeted runs and breakpoints stay exact, a pair is only fused when both of its
+     * instructions fit the budget and the breakpoint is not on the second one. step() runs one
+     * instruction and never fuses. The engines of the other modes are not affected.
+     */
+    void set_fusion_enabled(bool enabled);
+    bool is_fusion_enabled() const;
+    const FusionStats& get_fusion_stats() const;    // pairs fused per idiom
+    void reset_fusion_stats();                      // resets the fusion counters
+    const JitConfig& get_jit_config() const;        // settings of the JIT mode
+    void set_jit_config(const JitConfig& config);   // drops the compiled code
     uint32_t get_register(uint8_t reg);             // returns register value  
+    void set_register(uint8_t reg, uint32_t value); // writes register value
+    uint32_t get_pc() const;                        // returns the program counter
     uint32_t read_word_from_memory(uint32_t address); // reads value of memory at address
+    void read_block(uint32_t address, uint8_t* data, size_t size);        // copies virtual memory to a buffer
+    void write_block(uint32_t address, const uint8_t* data, size_t size); // writes a buffer to virtual memory
+    void fill(uint32_t address, uint8_t value, size_t size);              // sets a range of virtual memory
+    PhysicalMemory& get_physical_memory();                                // backing memory, for zero-copy views
+    const Bus& get_bus() const;                                           // regions attached to the bus
+
+    /**
+     * @brief Maps a device on the physical bus and flushes the TLB, devices may shadow RAM.
+     * @param base First physical address of the device.
+     * @param size Number of addresses the device answers to.
+     * @param device The device, shared with the caller.
+     * @throws std::invalid_argument if the range overlaps another device or ROM.
+     */
+    void attach_device(uint32_t base, size_t size, std::shared_ptr<Device> device);
+
+    /**
+     * @brief Maps a copy of a buffer as read-only memory on the physical bus and flushes the TLB.
+     * @throws std::invalid_argument if the range overlaps another device or ROM.
+     */
+    void attach_rom(uint32_t base, const uint8_t* data, size_t size, const std::string& name = "rom");
+    RegisterBank& get_register_bank();
+    CSRFile& get_csrs();                              // machine mode trap registers
+    PrivilegeMode get_privilege_mode() const;         // current privilege mode of the hart
+    void set_privilege_mode(PrivilegeMode mode);      // switches mode and flushes the TLB
+    TranslationMode get_translation_mode() const;     // where the MMU takes its translations from
+    void set_translation_mode(TranslationMode mode);  // SATP leaves machine mode untranslated, flushes the TLB
+    MisalignedAccess get_misaligned_access() const;   // how misaligned loads and stores are handled
+    void set_misaligned_access(MisalignedAccess policy); // split them in software or trap, SPLIT by default
+    const Trap& get_last_trap() const;                // last trap raised by the guest
+    uint64_t get_trap_count() const;                  // traps raised by the guest so far
+    const TLBStats& get_tlb_stats() const;            // returns the MMU TLB counters
+    const PredecodeStats& get_predecode_stats() const; // hits and misses of the decoded instruction cache
+    void reset_predecode_stats();                     // resets the decoded instruction cache counters
+    // Drops decoded instructions and blocks, needed after changing code through get_physical_memory()
+    void flush_predecode_cache();
+    size_t count_dirty_pages() const;                 // pages written since the last snapshot or restore
+    const SymbolTable& get_symbols() const;           // symbols of the last ELF program loaded
+    std::optional<uint32_t> lookup_symbol(const std::string& name) const; // address of a symbol
+
+    /**
+     * @brief Captures registers, CSRs, page table, privilege/translation state and memory.
+     *
+     * Capturing copies the non-zero pages of the memory once, every restore or fork from the
+     * returned snapshot shares them copy-on-write. Starts dirty page tracking from scratch.
+     * The other harts of a Machine are not covered, use Machine::snapshot for them.
+     * @return The snapshot, it can be restored any number of times.
+     */
+    std::shared_ptr<CPUSnapshot> snapshot();
+
+    /**
+     * @brief Rewinds the CPU to a snapshot, flushing every cached translation.
+     *
+     * With RESERVED memory backing only the pages written afterwards are ever copied.
+     * @param snapshot A snapshot taken from a CPU with the same memory size.
+     */
+    void restore(const CPUSnapshot& snapshot);
+
+    /**
+     * @brief Rewinds the CPU to a snapshot copying back only the pages written since then.
+     *
+     * Only valid when this CPU was the last one to take or restore the snapshot, which is
+     * the case in a snapshot/run/reset loop. Costs O(dirty pages).
+     * @param snapshot The snapshot this CPU last took or restored.
+     * @return Number of pages copied back.
+     */
+    size_t restore_dirty(const CPUSnapshot& snapshot);
+
+    /**
+     * @brief Creates an independent copy of the CPU.
+     *
+     * Equivalent to snapshotting this CPU and building a new one from the snapshot. To branch
+     * many times from the same state take one snapshot and build CPUs from it instead. The copy
+     * has the same execution mode, settings and ROMs.
+     * @return The new CPU.
+     * @throws std::invalid_argument if a device is attached, devices cannot be copied.
+     */
+    std::unique_ptr<CPU> fork();
 };
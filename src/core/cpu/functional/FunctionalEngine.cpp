@@ -0,0 +1,233 @@
+#include "FunctionalEngine.hpp"
+#include <atomic>
+#include "core/cpu/isa/MultiplyDivide.hpp"
+
+FunctionalEngine::FunctionalEngine(RegisterBank& register_bank, MMU& mmu, Bus& bus, Pipeline& pipeline)
+    : register_bank(register_bank), mmu(mmu), bus(bus), pipeline(pipeline)
+{
+}
+
+CycleStatus FunctionalEngine::run_instructions(uint64_t budget, uint64_t stop_pc, uint64_t& executed) {
+    uint32_t* x = register_bank.data();
+    const bool tick_devices = bus.has_regions();
+    uint32_t pc = register_bank.get_pc();
+    const uint64_t limit = budget < MAX_INSTRUCTIONS ? budget : MAX_INSTRUCTIONS;
+
+    uint64_t count = 0;
+    for (; count < limit && pc != stop_pc; ++count) {
+        uint32_t raw = 0;
+        uint32_t next_pc = pc + 4;
+        if (mmu.try_fetch_word(pc, raw) != MemoryStatus::OK || !execute(raw, pc, x, next_pc)) {
+            // Nothing changed, the pipeline executes the instruction and takes its trap if any
+            register_bank.set_pc(pc);
+            stats.instructions += count;
+            executed = count;
+            return step(executed);
+        }
+        pc = next_pc;
+        if (tick_devices) {
+            bus.tick(1);
+        }
+    }
+    register_bank.set_pc(pc);
+    stats.instructions += count;
+    executed = count;
+    return CycleStatus::RETIRED;
+}
+
+CycleStatus FunctionalEngine::step(uint64_t& executed) {
+    ++stats.fallbacks;
+    CycleStatus status = pipeline.run_cycle();
+    // The host stops before ticking when a trap has no handler or the program ended
+    if (completed_instruction(status)) {
+        bus.tick(1);
+        ++executed;
+    }
+    return status;
+}
+
+bool FunctionalEngine::execute(uint32_t raw, uint32_t pc, uint32_t* x, uint32_t& next_pc) {
+    // Only the encodings the pipeline executes without trapping are handled, an instruction is
+    // either committed whole or left untouched for the pipeline
+    uint32_t rd = raw >> 7 & 0x1F;
+    uint32_t value;
+
+    switch (raw & 0x7F) {
+        case opcodes::OP: {
+            DecodedInstruction<InstructionFormat::R_TYPE> inst(raw);
+            uint32_t a = x[inst.rs1];
+            uint32_t b = x[inst.rs2];
+            if (inst.funct7 == 0x00) {
+                switch (inst.funct3) {
+                    case 0x0: value = a + b; break;
+                    case 0x1: value = a << (b & 0x1F); break;
+                    case 0x2: value = static_cast<int32_t>(a) < static_cast<int32_t>(b) ? 1 : 0; break;
+                    case 0x3: value = a < b ? 1 : 0; break;
+                    case 0x4: value = a ^ b; break;
+                    case 0x5: value = a >> (b & 0x1F); break;
+                    case 0x6: value = a | b; break;
+                    default:  value = a & b; break;
+                }
+            } else if (inst.funct7 == 0x20 && inst.funct3 == 0x0) {
+                value = a - b;
+            } else if (inst.funct7 == 0x20 && inst.funct3 == 0x5) {
+                value = static_cast<uint32_t>(static_cast<int32_t>(a) >> (b & 0x1F));
+            } else if (inst.funct7 == 0x01) {
+                value = m_extension::execute(inst.funct3, a, b);
+            } else {
+                return false;
+            }
+            break;
+        }
+        case opcodes::OP_IMM: {
+            DecodedInstruction<InstructionFormat::I_TYPE> inst(raw);
+            uint32_t a = x[inst.rs1];
+            uint32_t imm = static_cast<uint32_t>(inst.get_immediate());
+            uint32_t shift_type = imm >> 5 & 0x7F;
+            switch (inst.funct3) {
+                case 0x0: value = a + imm; break;
+                case 0x2: value = static_cast<int32_t>(a) < static_cast<int32_t>(imm) ? 1 : 0; break;
+                case 0x3: value = a < imm ? 1 : 0; break;
+                case 0x4: value = a ^ imm; break;
+                case 0x6: value = a | imm; break;
+                case 0x7: value = a & imm; break;
+                case 0x1:
+                    if (shift_type != 0x00) {
+                        return false;
+                    }
+                    value = a << (imm & 0x1F);
+                    break;
+                default: // 0x5
+                    if (shift_type == 0x00) {
+                        value = a >> (imm & 0x1F);
+                    } else if (shift_type == 0x20) {
+                        value = static_cast<uint32_t>(static_cast<int32_t>(a) >> (imm & 0x1F));
+                    } else {
+                        return false;
+                    }
+                    break;
+            }
+            break;
+        }
+        case opcodes::LUI:
+        case opcodes::AUIPC: {
+            DecodedInstruction<InstructionFormat::U_TYPE> inst(raw);
+            value = static_cast<uint32_t>(inst.get_immediate()) + ((raw & 0x7F) == opcodes::AUIPC ? pc : 0);
+            break;
+        }
+        case opcodes::LOAD: {
+            // Loads into x0 still access memory, they may fault
+            DecodedInstruction<InstructionFormat::I_TYPE> inst(raw);
+            uint32_t address = x[inst.rs1] + static_cast<uint32_t>(inst.get_immediate());
+            MemoryStatus status;
+            switch (inst.funct3) {
+                case 0x0: {
+                    uint8_t byte;
+                    status = mmu.try_read(address, byte);
+                    value = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int8_t>(byte)));
+                    break;
+                }
+                case 0x1: {
+                    uint16_t halfword;
+                    status = mmu.try_read_halfword(address, halfword);
+                    value = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int16_t>(halfword)));
+                    break;
+                }
+                case 0x2:
+                    status = mmu.try_read_word(address, value);
+                    break;
+                case 0x4: {
+                    uint8_t byte;
+                    status = mmu.try_read(address, byte);
+                    value = byte;
+                    break;
+                }
+                case 0x5: {
+                    uint16_t halfword;
+                    status = mmu.try_read_halfword(address, halfword);
+                    value = halfword;
+                    break;
+                }
+                default:
+                    return false;
+            }
+            if (status != MemoryStatus::OK) {
+                return false;
+            }
+            break;
+        }
+        case opcodes::STORE: {
+            DecodedInstruction<InstructionFormat::S_TYPE> inst(raw);
+            uint32_t address = x[inst.rs1] + static_cast<uint32_t>(inst.get_immediate());
+            MemoryStatus status;
+            switch (inst.funct3) {
+                case 0x0: status = mmu.try_write(address, static_cast<uint8_t>(x[inst.rs2])); break;
+                case 0x1: status = mmu.try_write_halfword(address, static_cast<uint16_t>(x[inst.rs2])); break;
+                case 0x2: status = mmu.try_write_word(address, x[inst.rs2]); break;
+                default:  return false;
+            }
+            return status == MemoryStatus::OK;
+        }
+        case opcodes::BRANCH: {
+            DecodedInstruction<InstructionFormat::B_TYPE> inst(raw);
+            uint32_t a = x[inst.rs1];
+            uint32_t b = x[inst.rs2];
+            bool taken;
+            switch (inst.funct3) {
+                case 0x0: taken = a == b; break;
+                case 0x1: taken = a != b; break;
+                case 0x4: taken = static_cast<int32_t>(a) < static_cast<int32_t>(b); break;
+                case 0x5: taken = static_cast<int32_t>(a) >= static_cast<int32_t>(b); break;
+                case 0x6: taken = a < b; break;
+                case 0x7: taken = a >= b; break;
+                default:  return false;
+            }
+            if (taken) {
+                uint32_t target = pc + static_cast<uint32_t>(inst.get_immediate());
+                if (target & 0x3) {
+                    return false;
+                }
+                next_pc = target;
+            }
+            return true;
+        }
+        case opcodes::JAL: {
+            // A jump to itself ends the program, the pipeline reports it
+            DecodedInstruction<InstructionFormat::J_TYPE> inst(raw);
+            uint32_t target = pc + static_cast<uint32_t>(inst.get_immediate());
+            if (target == pc || (target & 0x3) != 0) {
+                return false;
+            }
+            value = pc + 4;
+            next_pc = target;
+            break;
+        }
+        case opcodes::JALR: {
+            // The target is read before the link, rd may be rs1
+            DecodedInstruction<InstructionFormat::I_TYPE> inst(raw);
+            uint32_t target = (x[inst.rs1] + static_cast<uint32_t>(inst.get_immediate())) & ~1u;
+            if (inst.funct3 != 0x0 || (target & 0x3) != 0) {
+                return false;
+            }
+            value = pc + 4;
+            next_pc = target;
+            break;
+        }
+        case opcodes::MISC_MEM:
+            // FENCE is a full host fence, it orders memory against the other harts. FENCE.I and
+            // encodings with rd set go to the pipeline
+            if (rd != 0 || (raw >> 12 & 0x7) != 0x0) {
+                return false;
+            }
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return true;
+        default:
+            // SYSTEM and unknown opcodes
+            return false;
+    }
+
+    // Write back, x0 stays zero
+    x[rd] = value;
+    x[0] = 0;
+    return true;
+}
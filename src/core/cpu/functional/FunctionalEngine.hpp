@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include "core/cpu/pipeline/Pipeline.hpp"
+#include "core/cpu/register_bank/RegisterBank.hpp"
+#include "core/memory/Bus.hpp"
+#include "core/memory/MMU.hpp"
+
+// Counters of the functional engine
+struct FunctionalStats {
+    uint64_t instructions = 0; // instructions retired by the engine itself
+    uint64_t fallbacks = 0;    // instructions executed by the pipeline instead
+};
+
+// Instruction set simulator: fetches, decodes, executes and commits each instruction in a single
+// function, straight from the raw encoding to the register bank and the MMU, with no stage
+// objects or results in between. Nothing is cached, every instruction is fetched again through
+// the execute TLB, so code written by the guest needs no invalidation here.
+//
+// Like the threaded engine it leaves everything uncommon to the pipeline, one instruction at a
+// time: SYSTEM instructions, FENCE.I, illegal encodings, jumps to self (end of program) and
+// control transfers to misaligned targets. A fetch, load or store that faults changes nothing and
+// the pipeline executes the instruction again to take the trap.
+//
+// Devices are ticked once per retired instruction like CPU::run does, after the instruction
+class FunctionalEngine {
+private:
+    static constexpr uint32_t MAX_INSTRUCTIONS = 4096; // per run_instructions() call
+
+    RegisterBank& register_bank;
+    MMU& mmu;
+    Bus& bus;
+    Pipeline& pipeline;
+    FunctionalStats stats;
+
+    bool execute(uint32_t raw, uint32_t pc, uint32_t* x, uint32_t& next_pc); // false leaves the instruction to the pipeline
+    CycleStatus step(uint64_t& executed); // one instruction through the pipeline
+
+public:
+    FunctionalEngine(RegisterBank& register_bank, MMU& mmu, Bus& bus, Pipeline& pipeline);
+
+    // Runs instructions from the PC until one has to go through the pipeline, which then executes
+    // it, until the PC reaches stop_pc or until a batch of at most budget instructions is done.
+    // executed counts the instructions retired or trapped. Returns the status of the pipeline for
+    // the instruction it executed, RETIRED otherwise. A stop_pc above 32 bits never matches
+    CycleStatus run_instructions(uint64_t budget, uint64_t stop_pc, uint64_t& executed);
+
+    const FunctionalStats& get_stats() const { return stats; }
+    void reset_stats() { stats = FunctionalStats{}; }
+};
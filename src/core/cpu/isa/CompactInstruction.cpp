@@ -0,0 +1,142 @@
+#include "CompactInstruction.hpp"
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include "InstructionTable.hpp"
+
+namespace {
+
+using decode_table::Entry;
+using decode_table::FUNCT7_CLASSES;
+using decode_table::KEYS;
+
+static_assert(std::size(INSTRUCTIONS) <= 64, "funct7 signatures hold one bit per instruction");
+
+// Instructions whose funct7 bits accept a funct7 value, the ones that do not look at funct7 left out
+constexpr uint64_t funct7_signature(uint32_t funct7) {
+    uint64_t signature = 0;
+    for (size_t i = 0; i < std::size(INSTRUCTIONS); ++i) {
+        uint32_t mask = INSTRUCTIONS[i].mask >> 25;
+        if (mask != 0 && (funct7 & mask) == (INSTRUCTIONS[i].match >> 25 & mask)) {
+            signature |= uint64_t{1} << i;
+        }
+    }
+    return signature;
+}
+
+// funct7 values with the same signature decode the same way whatever the opcode and funct3, they
+// share a class. Each class keeps its first value to stand for the others
+struct Funct7Classes {
+    std::array<uint8_t, 128> class_of{};
+    std::array<uint32_t, FUNCT7_CLASSES> representative{};
+    size_t count = 0;
+};
+
+constexpr Funct7Classes build_funct7_classes() {
+    Funct7Classes classes;
+    std::array<uint64_t, FUNCT7_CLASSES> signatures{};
+    for (uint32_t funct7 = 0; funct7 < 128; ++funct7) {
+        uint64_t signature = funct7_signature(funct7);
+        size_t found = 0;
+        while (found < classes.count && signatures[found] != signature) {
+            ++found;
+        }
+        if (found == classes.count) {
+            if (classes.count == FUNCT7_CLASSES) {
+                classes.count = FUNCT7_CLASSES + 1; // too many, reported below
+                return classes;
+            }
+            signatures[found] = signature;
+            classes.representative[found] = funct7;
+            ++classes.count;
+        }
+        classes.class_of[funct7] = static_cast<uint8_t>(found);
+    }
+    return classes;
+}
+
+constexpr Funct7Classes CLASSES = build_funct7_classes();
+static_assert(CLASSES.count <= FUNCT7_CLASSES, "INSTRUCTIONS tell apart more funct7 values than the key holds");
+
+// A word with the opcode, funct3 and funct7 of a key and zeros everywhere else
+constexpr uint32_t representative(size_t key) {
+    return static_cast<uint32_t>(key & 0x7F) | static_cast<uint32_t>(key >> 7 & 0x7) << 12
+           | CLASSES.representative[key >> 10] << 25;
+}
+
+// Key of a funct7 class, funct3 and opcode
+constexpr size_t make_key(size_t funct7_class, uint32_t funct3, uint32_t opcode) {
+    return funct7_class << 10 | funct3 << 7 | opcode;
+}
+
+// Calls visit(key) for every key a description matches. Only the keys of its opcode are looked
+// at, which keeps the compile time evaluation well inside the compiler limits
+template <typename Visit>
+constexpr void for_each_matching_key(const InstructionDescription& description, Visit visit) {
+    uint32_t opcode = description.match & 0x7F;
+    for (size_t funct7_class = 0; funct7_class < CLASSES.count; ++funct7_class) {
+        for (uint32_t funct3 = 0; funct3 < 8; ++funct3) {
+            size_t key = make_key(funct7_class, funct3, opcode);
+            if ((representative(key) & description.mask) == description.match) {
+                visit(key);
+            }
+        }
+    }
+}
+
+// Each description has to test its opcode, be decidable from the key alone and match one key at
+// most once
+constexpr bool descriptions_fit_the_key() {
+    std::array<uint8_t, KEYS> matches{};
+    for (const InstructionDescription& description : INSTRUCTIONS) {
+        if ((description.mask & 0x7F) != 0x7F || (description.mask & ~instruction_masks::FUNCT7) != 0
+            || (description.match & ~description.mask) != 0) {
+            return false;
+        }
+        bool overlap = false;
+        for_each_matching_key(description, [&](size_t key) { overlap |= matches[key]++ != 0; });
+        if (overlap) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(descriptions_fit_the_key(), "INSTRUCTIONS entries overlap or test bits outside opcode/funct3/funct7");
+
+constexpr std::array<Entry, KEYS> build_entries() {
+    // Keys no description matches stay ILLEGAL, so do the keys of the unused classes
+    std::array<Entry, KEYS> table{};
+    for (const InstructionDescription& description : INSTRUCTIONS) {
+        for_each_matching_key(description, [&](size_t key) { table[key] = Entry{description.op, description.immediate}; });
+    }
+    return table;
+}
+
+constexpr std::array<const char*, static_cast<size_t>(Operation::COUNT)> NAMES = [] {
+    std::array<const char*, static_cast<size_t>(Operation::COUNT)> names{};
+    names[static_cast<size_t>(Operation::ILLEGAL)] = "illegal";
+    for (const InstructionDescription& description : INSTRUCTIONS) {
+        names[static_cast<size_t>(description.op)] = description.name;
+    }
+    return names;
+}();
+
+constexpr bool every_operation_is_described() {
+    for (const char* name : NAMES) {
+        if (name == nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(every_operation_is_described(), "an Operation has no entry in INSTRUCTIONS");
+
+} // namespace
+
+// Built by the compiler, constinit makes sure no table is filled at startup
+constinit const std::array<uint8_t, 128> decode_table::FUNCT7_CLASS = CLASSES.class_of;
+constinit const std::array<Entry, KEYS> decode_table::ENTRIES = build_entries();
+
+const char* operation_name(Operation op) {
+    return op < Operation::COUNT ? NAMES[static_cast<size_t>(op)] : "illegal";
+}
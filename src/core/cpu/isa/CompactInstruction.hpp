@@ -0,0 +1,84 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "Immediate.hpp"
+
+// One value per instruction of the base integer ISA and the M and A extensions. Encodings the pipeline
+// rejects decode to ILLEGAL. All SYSTEM instructions share one operation, the pipeline completes
+// them from the raw encoding since they touch privileged state
+enum class Operation : uint8_t {
+    ILLEGAL,
+    LUI, AUIPC, JAL, JALR,
+    BEQ, BNE, BLT, BGE, BLTU, BGEU,
+    LB, LH, LW, LBU, LHU,
+    SB, SH, SW,
+    ADDI, SLTI, SLTIU, XORI, ORI, ANDI, SLLI, SRLI, SRAI,
+    ADD, SUB, SLL, SLT, SLTU, XOR, SRL, SRA, OR, AND,
+    MUL, MULH, MULHSU, MULHU, DIV, DIVU, REM, REMU,
+    FENCE, FENCE_I,
+    LR_W, SC_W, AMOSWAP_W, AMOADD_W, AMOXOR_W, AMOAND_W, AMOOR_W, AMOMIN_W, AMOMAX_W, AMOMINU_W, AMOMAXU_W,
+    SYSTEM,
+    COUNT
+};
+
+// Decoded instruction as the pipeline executes it: the operation, the register indices and the
+// immediate already sign extended (the shift amount for the immediate shifts, the CSR address
+// for SYSTEM). Trivially copyable and small enough to be kept by the predecode cache and copied
+// between stages for free. The raw encoding is kept for traps and SYSTEM
+struct CompactInstruction {
+    Operation op = Operation::ILLEGAL;
+    uint8_t rd = 0;
+    uint8_t rs1 = 0;
+    uint8_t rs2 = 0;
+    int32_t imm = 0;
+    uint32_t raw = 0;
+};
+
+static_assert(std::is_trivially_copyable_v<CompactInstruction>);
+static_assert(sizeof(CompactInstruction) == 12);
+
+// Decode lookup table generated at compile time from INSTRUCTIONS (InstructionTable.hpp). An
+// instruction is looked up by its opcode, funct3 and a 4 bit class of funct7: the funct7 values
+// that no instruction tells apart share a class, e.g. every aq/rl combination of an AMO and
+// every value no instruction uses
+namespace decode_table {
+constexpr size_t FUNCT7_CLASSES = 16;
+constexpr size_t KEYS = 128 * 8 * FUNCT7_CLASSES;
+
+struct Entry {
+    Operation op = Operation::ILLEGAL;
+    ImmediateFormat immediate = ImmediateFormat::NONE;
+};
+
+extern const std::array<uint8_t, 128> FUNCT7_CLASS;
+extern const std::array<Entry, KEYS> ENTRIES;
+
+inline size_t key(uint32_t raw) {
+    return (raw & 0x7F) | (raw >> 5 & 0x380) | static_cast<size_t>(FUNCT7_CLASS[raw >> 25]) << 10;
+}
+} // namespace decode_table
+
+// Decodes a raw instruction word: one table lookup and the immediate extractors, no branches.
+// Inline so the fields land straight in the caller's instruction
+inline CompactInstruction decode_compact(uint32_t raw) {
+    const decode_table::Entry entry = decode_table::ENTRIES[decode_table::key(raw)];
+    return CompactInstruction{entry.op, static_cast<uint8_t>(raw >> 7 & 0x1F), static_cast<uint8_t>(raw >> 15 & 0x1F),
+                              static_cast<uint8_t>(raw >> 20 & 0x1F), extract_immediate(entry.immediate, raw), raw};
+}
+
+// Whether the write back stage stores the ALU result in rd: jumps (the link), LUI, AUIPC, the
+// ALU operations and FENCE (whose result is 0). Loads write the loaded value instead
+constexpr bool writes_alu_result(Operation op) {
+    return (op >= Operation::LUI && op <= Operation::JALR) || (op >= Operation::ADDI && op <= Operation::FENCE_I);
+}
+
+// LR, SC and the AMOs: the memory access stage reads and writes memory in one atomic step and
+// the value read is written back like a load
+constexpr bool is_atomic(Operation op) {
+    return op >= Operation::LR_W && op <= Operation::AMOMAXU_W;
+}
+
+// Mnemonic of an operation, e.g. "addi"
+const char* operation_name(Operation op);
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+
+// Where the immediate of an instruction comes from
+enum class ImmediateFormat : uint8_t {
+    NONE,   // R-type, FENCE
+    I,      // [31:20]
+    S,      // [31:25] and [11:7]
+    B,      // [31], [7], [30:25] and [11:8], imm[0] is zero
+    U,      // [31:12] already shifted into place
+    J,      // [31], [19:12], [20] and [30:21], imm[0] is zero
+    SHAMT,  // [24:20] of the immediate shifts
+    CSR,    // [31:20] zero extended
+    COUNT
+};
+
+// Extracts the immediate of a format from a raw instruction, sign extended with an arithmetic
+// shift of the sign bit. Each format is a handful of shifts and masks
+template <ImmediateFormat Format>
+constexpr int32_t extract_immediate(uint32_t raw);
+
+template <>
+constexpr int32_t extract_immediate<ImmediateFormat::NONE>(uint32_t) {
+    return 0;
+}
+
+template <>
+constexpr int32_t extract_immediate<ImmediateFormat::I>(uint32_t raw) {
+    return static_cast<int32_t>(raw) >> 20;
+}
+
+template <>
+constexpr int32_t extract_immediate<ImmediateFormat::S>(uint32_t raw) {
+    return (static_cast<int32_t>(raw & 0xFE000000) >> 20) | static_cast<int32_t>(raw >> 7 & 0x1F);
+}
+
+template <>
+constexpr int32_t extract_immediate<ImmediateFormat::B>(uint32_t raw) {
+    return (static_cast<int32_t>(raw & 0x80000000) >> 19) | static_cast<int32_t>((raw & 0x80) << 4)
+           | static_cast<int32_t>(raw >> 20 & 0x7E0) | static_cast<int32_t>(raw >> 7 & 0x1E);
+}
+
+template <>
+constexpr int32_t extract_immediate<ImmediateFormat::U>(uint32_t raw) {
+    return static_cast<int32_t>(raw & 0xFFFFF000);
+}
+
+template <>
+constexpr int32_t extract_immediate<ImmediateFormat::J>(uint32_t raw) {
+    return (static_cast<int32_t>(raw & 0x80000000) >> 11) | static_cast<int32_t>(raw & 0xFF000)
+           | static_cast<int32_t>(raw >> 9 & 0x800) | static_cast<int32_t>(raw >> 20 & 0x7FE);
+}
+
+template <>
+constexpr int32_t extract_immediate<ImmediateFormat::SHAMT>(uint32_t raw) {
+    return static_cast<int32_t>(raw >> 20 & 0x1F);
+}
+
+template <>
+constexpr int32_t extract_immediate<ImmediateFormat::CSR>(uint32_t raw) {
+    return static_cast<int32_t>(raw >> 20);
+}
+
+// Immediate of a format only known at run time. Every format is extracted and the ones that do
+// not apply are masked off, a few more ALU operations than a switch but nothing to mispredict
+constexpr int32_t extract_immediate(ImmediateFormat format, uint32_t raw) {
+    auto only = [format](ImmediateFormat candidate, int32_t immediate) {
+        return immediate & -static_cast<int32_t>(format == candidate);
+    };
+    return only(ImmediateFormat::I, extract_immediate<ImmediateFormat::I>(raw))
+           | only(ImmediateFormat::S, extract_immediate<ImmediateFormat::S>(raw))
+           | only(ImmediateFormat::B, extract_immediate<ImmediateFormat::B>(raw))
+           | only(ImmediateFormat::U, extract_immediate<ImmediateFormat::U>(raw))
+           | only(ImmediateFormat::J, extract_immediate<ImmediateFormat::J>(raw))
+           | only(ImmediateFormat::SHAMT, extract_immediate<ImmediateFormat::SHAMT>(raw))
+           | only(ImmediateFormat::CSR, extract_immediate<ImmediateFormat::CSR>(raw));
+}
+
+// addi x0, x0, -1 / sw x0, -4(x0) / beq x0, x0, -4 / jal x0, -4
+static_assert(extract_immediate<ImmediateFormat::I>(0xFFF00013) == -1);
+static_assert(extract_immediate<ImmediateFormat::S>(0xFE002E23) == -4);
+static_assert(extract_immediate<ImmediateFormat::B>(0xFE000EE3) == -4);
+static_assert(extract_immediate<ImmediateFormat::J>(0xFFDFF06F) == -4);
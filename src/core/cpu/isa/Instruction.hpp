@@ -1,9 +1,8 @@
 #pragma once
 #include <cstdint>
-#include <initializer_list>
-#include <utility>
+#include <stdexcept>
 #include <variant>
-#include "utils/bitutils.hpp"
+#include "Immediate.hpp"
 
 //Values are the opcodes for the matching instructions
 enum class InstructionFormat {
@@ -13,23 +12,26 @@ enum class InstructionFormat {
     B_TYPE          = 0x63,
     U_TYPE          = 0x37,
     J_TYPE          = 0x6F,
+    SYSTEM          = 0x73, // ECALL, EBREAK, MRET and the Zicsr instructions, I-type layout
     INIVALID_TYPE   = 0xFF
 };
 
-// Combines bit ranges from the instruction into a single immediate value
-template <typename Instruction>
-constexpr int32_t get_combined_immediate(const Instruction& instr,
-                                         std::initializer_list<std::pair<int, int>> bit_ranges) {
-    int32_t immediate = 0;
-    // Iterate over each source range (start to end)
-    for (const auto& [start, end] : bit_ranges) {
-        for (int bit = start; bit >= end; --bit) { // Include all bits in the range
-            int32_t dst_bit = bit - end;          // Align destination bits to zero
-            immediate |= ((instr.raw >> bit) & 1) << dst_bit;
-        }
-    }
-    return immediate;
-}
+// Opcodes of the base integer ISA. Several opcodes share the layout of one format, e.g. loads,
+// JALR and FENCE decode as I_TYPE and AUIPC decodes as U_TYPE
+namespace opcodes {
+constexpr uint32_t LOAD     = 0x03;
+constexpr uint32_t MISC_MEM = 0x0F; // FENCE
+constexpr uint32_t OP_IMM   = 0x13;
+constexpr uint32_t AUIPC    = 0x17;
+constexpr uint32_t STORE    = 0x23;
+constexpr uint32_t AMO      = 0x2F; // A extension
+constexpr uint32_t OP       = 0x33;
+constexpr uint32_t LUI      = 0x37;
+constexpr uint32_t BRANCH   = 0x63;
+constexpr uint32_t JALR     = 0x67;
+constexpr uint32_t JAL      = 0x6F;
+constexpr uint32_t SYSTEM   = 0x73;
+} // namespace opcodes
 
 // Base class for decoded instructions
 class DecodedInstructionBase {
@@ -114,9 +116,7 @@ public:
 
     int32_t get_immediate() const {
         // I-Type immediate is a contiguous range [31:20]
-        return bitutils::sign_extend(get_combined_immediate(*this, {
-            {31, 20} // Immediate field
-        }), 12);
+        return extract_immediate<ImmediateFormat::I>(raw);
     }
 
     uint32_t get_opcode() const override {
@@ -145,10 +145,7 @@ public:
 
     int32_t get_immediate() const {
         // S-Type immediate spans two ranges: [31:25] and [11:7]
-        return bitutils::sign_extend(get_combined_immediate(*this, {
-            {31, 25}, // Upper immediate [11:5]
-            {11, 7}   // Lower immediate [4:0]
-        }), 12);
+        return extract_immediate<ImmediateFormat::S>(raw);
     }
 
     uint32_t get_opcode() const override {
@@ -178,13 +175,8 @@ public:
     explicit DecodedInstruction(uint32_t instruction) : raw(instruction) {}
 
     int32_t get_immediate() const {
-        // B-Type immediate spans four ranges: [31], [30:25], [11:8], and [7]
-        return bitutils::sign_extend(get_combined_immediate(*this, {
-            {31, 31}, // imm[12]
-            {30, 25}, // imm[10:5]
-            {11, 8},  // imm[4:1]
-            {7, 7}    // imm[11]
-        }), 13);
+        // B-Type immediate spans four ranges: [31], [7], [30:25] and [11:8], imm[0] is always zero
+        return extract_immediate<ImmediateFormat::B>(raw);
     }
 
     uint32_t get_opcode() const override {
@@ -209,10 +201,8 @@ public:
     explicit DecodedInstruction(uint32_t instruction) : raw(instruction) {}
 
     int32_t get_immediate() const {
-        // U-Type immediate is a contiguous range [31:12]
-        return get_combined_immediate(*this, {
-            {31, 12} // Immediate field
-        }) << 12; // Shift left by 12 bits
+        // U-Type immediate is a contiguous range [31:12], already in the upper bits
+        return extract_immediate<ImmediateFormat::U>(raw);
     }
 
     uint32_t get_opcode() const override {
@@ -240,14 +230,36 @@ public:
     explicit DecodedInstruction(uint32_t instruction) : raw(instruction) {}
 
     int32_t get_immediate() const {
-        // J-Type immediate spans four ranges: [31], [30:21], [20], and [19:12]
-        return bitutils::sign_extend(get_combined_immediate(*this, {
-            {31, 31}, // imm[20]
-            {30, 21}, // imm[10:1]
-            {20, 20}, // imm[11]
-            {19, 12}  // imm[19:12]
-        }), 21);
+        // J-Type immediate spans four ranges: [31], [19:12], [20] and [30:21], imm[0] is always zero
+        return extract_immediate<ImmediateFormat::J>(raw);
+    }
+
+    uint32_t get_opcode() const override {
+        return opcode;
     }
+};
+
+// Specialization for SYSTEM instructions (I-type layout, the immediate is an unsigned CSR address or funct12)
+template <>
+class DecodedInstruction<InstructionFormat::SYSTEM> : DecodedInstructionBase{
+public:
+    static constexpr InstructionFormat format = InstructionFormat::SYSTEM;
+    static constexpr uint32_t ECALL = 0x00000073;
+    static constexpr uint32_t EBREAK = 0x00100073;
+    static constexpr uint32_t MRET = 0x30200073;
+    static constexpr uint32_t WFI = 0x10500073;
+    union {
+        uint32_t raw; // Full 32-bit raw instruction
+        struct {
+            uint32_t opcode : 7;  // Bits [6:0]
+            uint32_t rd : 5;      // Bits [11:7]
+            uint32_t funct3 : 3;  // Bits [14:12], 0 for the privileged instructions
+            uint32_t rs1 : 5;     // Bits [19:15], zimm for the immediate CSR forms
+            uint32_t csr : 12;    // Bits [31:20]
+        };
+    };
+
+    explicit DecodedInstruction(uint32_t instruction) : raw(instruction) {}
 
     uint32_t get_opcode() const override {
         return opcode;
@@ -262,5 +274,6 @@ using DecodedInstructionVariant = std::variant<
     DecodedInstruction<InstructionFormat::S_TYPE>,
     DecodedInstruction<InstructionFormat::B_TYPE>,
     DecodedInstruction<InstructionFormat::U_TYPE>,
-    DecodedInstruction<InstructionFormat::J_TYPE>
+    DecodedInstruction<InstructionFormat::J_TYPE>,
+    DecodedInstruction<InstructionFormat::SYSTEM>
 >;
\ No newline at end of file
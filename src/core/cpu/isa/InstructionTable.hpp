@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include "CompactInstruction.hpp"
+#include "Immediate.hpp"
+
+// One supported instruction: it matches every raw word with (raw & mask) == match. The decoder
+// is generated from this table at compile time, adding an instruction is one entry here plus its
+// operation and handler
+struct InstructionDescription {
+    const char* name;
+    uint32_t mask;
+    uint32_t match;
+    ImmediateFormat immediate;
+    Operation op;
+};
+
+namespace instruction_masks {
+constexpr uint32_t OPCODE = 0x0000007F;
+constexpr uint32_t FUNCT3 = 0x0000707F;
+constexpr uint32_t FUNCT7 = 0xFE00707F;
+constexpr uint32_t FUNCT5 = 0xF800707F; // AMOs, aq and rl are ignored
+} // namespace instruction_masks
+
+constexpr InstructionDescription INSTRUCTIONS[] = {
+    {"lui",     instruction_masks::OPCODE, 0x00000037, ImmediateFormat::U,     Operation::LUI},
+    {"auipc",   instruction_masks::OPCODE, 0x00000017, ImmediateFormat::U,     Operation::AUIPC},
+    {"jal",     instruction_masks::OPCODE, 0x0000006F, ImmediateFormat::J,     Operation::JAL},
+    {"jalr",    instruction_masks::FUNCT3, 0x00000067, ImmediateFormat::I,     Operation::JALR},
+
+    {"beq",     instruction_masks::FUNCT3, 0x00000063, ImmediateFormat::B,     Operation::BEQ},
+    {"bne",     instruction_masks::FUNCT3, 0x00001063, ImmediateFormat::B,     Operation::BNE},
+    {"blt",     instruction_masks::FUNCT3, 0x00004063, ImmediateFormat::B,     Operation::BLT},
+    {"bge",     instruction_masks::FUNCT3, 0x00005063, ImmediateFormat::B,     Operation::BGE},
+    {"bltu",    instruction_masks::FUNCT3, 0x00006063, ImmediateFormat::B,     Operation::BLTU},
+    {"bgeu",    instruction_masks::FUNCT3, 0x00007063, ImmediateFormat::B,     Operation::BGEU},
+
+    {"lb",      instruction_masks::FUNCT3, 0x00000003, ImmediateFormat::I,     Operation::LB},
+    {"lh",      instruction_masks::FUNCT3, 0x00001003, ImmediateFormat::I,     Operation::LH},
+    {"lw",      instruction_masks::FUNCT3, 0x00002003, ImmediateFormat::I,     Operation::LW},
+    {"lbu",     instruction_masks::FUNCT3, 0x00004003, ImmediateFormat::I,     Operation::LBU},
+    {"lhu",     instruction_masks::FUNCT3, 0x00005003, ImmediateFormat::I,     Operation::LHU},
+    {"sb",      instruction_masks::FUNCT3, 0x00000023, ImmediateFormat::S,     Operation::SB},
+    {"sh",      instruction_masks::FUNCT3, 0x00001023, ImmediateFormat::S,     Operation::SH},
+    {"sw",      instruction_masks::FUNCT3, 0x00002023, ImmediateFormat::S,     Operation::SW},
+
+    {"addi",    instruction_masks::FUNCT3, 0x00000013, ImmediateFormat::I,     Operation::ADDI},
+    {"slti",    instruction_masks::FUNCT3, 0x00002013, ImmediateFormat::I,     Operation::SLTI},
+    {"sltiu",   instruction_masks::FUNCT3, 0x00003013, ImmediateFormat::I,     Operation::SLTIU},
+    {"xori",    instruction_masks::FUNCT3, 0x00004013, ImmediateFormat::I,     Operation::XORI},
+    {"ori",     instruction_masks::FUNCT3, 0x00006013, ImmediateFormat::I,     Operation::ORI},
+    {"andi",    instruction_masks::FUNCT3, 0x00007013, ImmediateFormat::I,     Operation::ANDI},
+    {"slli",    instruction_masks::FUNCT7, 0x00001013, ImmediateFormat::SHAMT, Operation::SLLI},
+    {"srli",    instruction_masks::FUNCT7, 0x00005013, ImmediateFormat::SHAMT, Operation::SRLI},
+    {"srai",    instruction_masks::FUNCT7, 0x40005013, ImmediateFormat::SHAMT, Operation::SRAI},
+
+    {"add",     instruction_masks::FUNCT7, 0x00000033, ImmediateFormat::NONE,  Operation::ADD},
+    {"sub",     instruction_masks::FUNCT7, 0x40000033, ImmediateFormat::NONE,  Operation::SUB},
+    {"sll",     instruction_masks::FUNCT7, 0x00001033, ImmediateFormat::NONE,  Operation::SLL},
+    {"slt",     instruction_masks::FUNCT7, 0x00002033, ImmediateFormat::NONE,  Operation::SLT},
+    {"sltu",    instruction_masks::FUNCT7, 0x00003033, ImmediateFormat::NONE,  Operation::SLTU},
+    {"xor",     instruction_masks::FUNCT7, 0x00004033, ImmediateFormat::NONE,  Operation::XOR},
+    {"srl",     instruction_masks::FUNCT7, 0x00005033, ImmediateFormat::NONE,  Operation::SRL},
+    {"sra",     instruction_masks::FUNCT7, 0x40005033, ImmediateFormat::NONE,  Operation::SRA},
+    {"or",      instruction_masks::FUNCT7, 0x00006033, ImmediateFormat::NONE,  Operation::OR},
+    {"and",     instruction_masks::FUNCT7, 0x00007033, ImmediateFormat::NONE,  Operation::AND},
+
+    // M extension. Division never traps, by zero and INT_MIN / -1 have defined results
+    {"mul",     instruction_masks::FUNCT7, 0x02000033, ImmediateFormat::NONE,  Operation::MUL},
+    {"mulh",    instruction_masks::FUNCT7, 0x02001033, ImmediateFormat::NONE,  Operation::MULH},
+    {"mulhsu",  instruction_masks::FUNCT7, 0x02002033, ImmediateFormat::NONE,  Operation::MULHSU},
+    {"mulhu",   instruction_masks::FUNCT7, 0x02003033, ImmediateFormat::NONE,  Operation::MULHU},
+    {"div",     instruction_masks::FUNCT7, 0x02004033, ImmediateFormat::NONE,  Operation::DIV},
+    {"divu",    instruction_masks::FUNCT7, 0x02005033, ImmediateFormat::NONE,  Operation::DIVU},
+    {"rem",     instruction_masks::FUNCT7, 0x02006033, ImmediateFormat::NONE,  Operation::REM},
+    {"remu",    instruction_masks::FUNCT7, 0x02007033, ImmediateFormat::NONE,  Operation::REMU},
+
+    // FENCE orders memory between harts, FENCE.I makes earlier stores visible to fetch
+    {"fence",   instruction_masks::FUNCT3, 0x0000000F, ImmediateFormat::NONE,  Operation::FENCE},
+    {"fence.i", instruction_masks::FUNCT3, 0x0000100F, ImmediateFormat::NONE,  Operation::FENCE_I},
+
+    // A extension, word sized. The rs2 field of LR is not checked
+    {"lr.w",      instruction_masks::FUNCT5, 0x1000202F, ImmediateFormat::NONE, Operation::LR_W},
+    {"sc.w",      instruction_masks::FUNCT5, 0x1800202F, ImmediateFormat::NONE, Operation::SC_W},
+    {"amoswap.w", instruction_masks::FUNCT5, 0x0800202F, ImmediateFormat::NONE, Operation::AMOSWAP_W},
+    {"amoadd.w",  instruction_masks::FUNCT5, 0x0000202F, ImmediateFormat::NONE, Operation::AMOADD_W},
+    {"amoxor.w",  instruction_masks::FUNCT5, 0x2000202F, ImmediateFormat::NONE, Operation::AMOXOR_W},
+    {"amoand.w",  instruction_masks::FUNCT5, 0x6000202F, ImmediateFormat::NONE, Operation::AMOAND_W},
+    {"amoor.w",   instruction_masks::FUNCT5, 0x4000202F, ImmediateFormat::NONE, Operation::AMOOR_W},
+    {"amomin.w",  instruction_masks::FUNCT5, 0x8000202F, ImmediateFormat::NONE, Operation::AMOMIN_W},
+    {"amomax.w",  instruction_masks::FUNCT5, 0xA000202F, ImmediateFormat::NONE, Operation::AMOMAX_W},
+    {"amominu.w", instruction_masks::FUNCT5, 0xC000202F, ImmediateFormat::NONE, Operation::AMOMINU_W},
+    {"amomaxu.w", instruction_masks::FUNCT5, 0xE000202F, ImmediateFormat::NONE, Operation::AMOMAXU_W},
+
+    // Every SYSTEM encoding, the pipeline sorts out the privileged and CSR instructions
+    {"system",  instruction_masks::OPCODE, 0x00000073, ImmediateFormat::CSR,   Operation::SYSTEM},
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+
+// Results of the M extension instructions, shared by the pipeline and the threaded and functional
+// engines. Each is a single host multiply or divide. The high products are the upper half of the
+// 64 bit product of the operands extended as signed or unsigned (MULHSU: rs1 signed, rs2
+// unsigned). Division never traps: by zero the quotient is all ones and the remainder the
+// dividend, and INT_MIN / -1 overflows to INT_MIN with a remainder of 0
+namespace m_extension {
+
+constexpr uint32_t INT_MIN_BITS = 0x80000000;
+
+constexpr uint32_t mul(uint32_t a, uint32_t b) {
+    return a * b;
+}
+
+constexpr uint32_t mulh(uint32_t a, uint32_t b) {
+    int64_t product = int64_t{static_cast<int32_t>(a)} * int64_t{static_cast<int32_t>(b)};
+    return static_cast<uint32_t>(static_cast<uint64_t>(product) >> 32);
+}
+
+constexpr uint32_t mulhsu(uint32_t a, uint32_t b) {
+    int64_t product = int64_t{static_cast<int32_t>(a)} * int64_t{b};
+    return static_cast<uint32_t>(static_cast<uint64_t>(product) >> 32);
+}
+
+constexpr uint32_t mulhu(uint32_t a, uint32_t b) {
+    return static_cast<uint32_t>(uint64_t{a} * uint64_t{b} >> 32);
+}
+
+constexpr uint32_t div(uint32_t a, uint32_t b) {
+    if (b == 0) {
+        return 0xFFFFFFFF;
+    }
+    if (a == INT_MIN_BITS && b == 0xFFFFFFFF) {
+        return a;
+    }
+    return static_cast<uint32_t>(static_cast<int32_t>(a) / static_cast<int32_t>(b));
+}
+
+constexpr uint32_t divu(uint32_t a, uint32_t b) {
+    return b != 0 ? a / b : 0xFFFFFFFF;
+}
+
+constexpr uint32_t rem(uint32_t a, uint32_t b) {
+    if (b == 0) {
+        return a;
+    }
+    if (a == INT_MIN_BITS && b == 0xFFFFFFFF) {
+        return 0;
+    }
+    return static_cast<uint32_t>(static_cast<int32_t>(a) % static_cast<int32_t>(b));
+}
+
+constexpr uint32_t remu(uint32_t a, uint32_t b) {
+    return b != 0 ? a % b : a;
+}
+
+// The instruction of OP with funct7 0x01 and this funct3
+constexpr uint32_t execute(uint32_t funct3, uint32_t a, uint32_t b) {
+    switch (funct3 & 0x7) {
+        case 0x0: return mul(a, b);
+        case 0x1: return mulh(a, b);
+        case 0x2: return mulhsu(a, b);
+        case 0x3: return mulhu(a, b);
+        case 0x4: return div(a, b);
+        case 0x5: return divu(a, b);
+        case 0x6: return rem(a, b);
+        default:  return remu(a, b);
+    }
+}
+
+static_assert(div(INT_MIN_BITS, 0xFFFFFFFF) == INT_MIN_BITS && rem(INT_MIN_BITS, 0xFFFFFFFF) == 0);
+static_assert(div(7, 0) == 0xFFFFFFFF && rem(7, 0) == 7 && divu(7, 0) == 0xFFFFFFFF && remu(7, 0) == 7);
+static_assert(div(static_cast<uint32_t>(-7), 2) == static_cast<uint32_t>(-3) && rem(static_cast<uint32_t>(-7), 2) == static_cast<uint32_t>(-1));
+static_assert(mulh(0xFFFFFFFF, 0xFFFFFFFF) == 0 && mulhu(0xFFFFFFFF, 0xFFFFFFFF) == 0xFFFFFFFE);
+static_assert(mulhsu(0xFFFFFFFF, 0xFFFFFFFF) == 0xFFFFFFFF);
+
+} // namespace m_extension
@@ -0,0 +1,47 @@
+#include "CodeArena.hpp"
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <sys/mman.h>
+
+#include "utils/plt.hpp"
+
+CodeArena::CodeArena(size_t capacity)
+    : memory(nullptr), capacity(capacity), used(0), reserved(0), failed(false) {}
+
+CodeArena::~CodeArena() {
+    if (memory != nullptr) {
+        munmap(memory, capacity);
+    }
+}
+
+bool CodeArena::ensure_mapped() {
+    if (memory != nullptr || failed) {
+        return memory != nullptr;
+    }
+    void* mapping = mmap(nullptr, capacity, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        PLT_WARN("CodeArena - Unable to map executable memory, the JIT stays off: " + std::string(std::strerror(errno)));
+        failed = true;
+        return false;
+    }
+    memory = static_cast<uint8_t*>(mapping);
+    return true;
+}
+
+void CodeArena::commit(size_t size) {
+    used += size;
+}
+
+void CodeArena::reserve_current() {
+    reserved = used;
+}
+
+void CodeArena::reset() {
+    used = reserved;
+}
+
+bool CodeArena::contains(const void* address) const {
+    const uint8_t* byte = static_cast<const uint8_t*>(address);
+    return memory != nullptr && byte >= memory && byte < memory + used;
+}
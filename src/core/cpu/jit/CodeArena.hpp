@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Executable memory for compiled blocks. Code is bump allocated and only ever released all at
+// once by reset(), which is the eviction policy of the JIT: when the arena is full every compiled
+// block is dropped and the hot ones are compiled again as they come back.
+//
+// The mapping is readable, writable and executable so chaining can patch the jump slots of
+// compiled code in place. It is created on first use, hosts that refuse executable memory leave
+// the arena unavailable and the JIT off.
+class CodeArena {
+private:
+    uint8_t* memory;
+    size_t capacity;
+    size_t used;
+    size_t reserved; // bytes kept by reset(), the entry and exit code
+    bool failed;
+
+public:
+    explicit CodeArena(size_t capacity);
+    ~CodeArena();
+    CodeArena(const CodeArena&) = delete;
+    CodeArena& operator=(const CodeArena&) = delete;
+
+    // Maps the memory if needed, returns false if the host refuses it
+    bool ensure_mapped();
+
+    uint8_t* cursor() const { return memory + used; }
+    size_t remaining() const { return capacity - used; }
+
+    // Marks `size` bytes from the cursor as used
+    void commit(size_t size);
+
+    // Keeps everything allocated so far across resets
+    void reserve_current();
+
+    // Drops every allocation made after reserve_current
+    void reset();
+
+    bool contains(const void* address) const;
+    bool is_empty() const { return used == reserved; } // nothing allocated since reserve_current
+    size_t get_capacity() const { return capacity; }
+    size_t get_used() const { return used; }
+};
@@ -0,0 +1,738 @@
+#include "JitCompiler.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <type_traits>
+#include <vector>
+
+#include "X86Emitter.hpp"
+
+namespace {
+
+using Kind = ThreadedOpKind;
+
+// Fixed roles of host registers inside compiled code. rax, rcx and rdx are scratch
+constexpr X86Reg CONTEXT = X86Reg::R14;
+constexpr X86Reg REGISTERS = X86Reg::R15;
+
+// Homes of cached guest registers, most used first. The first four survive call-outs, the others
+// are stored to the register bank around them
+constexpr std::array<X86Reg, 10> HOMES = {
+    X86Reg::RBX, X86Reg::RBP, X86Reg::R12, X86Reg::R13,
+    X86Reg::RSI, X86Reg::RDI, X86Reg::R8, X86Reg::R9, X86Reg::R10, X86Reg::R11
+};
+constexpr size_t CALLEE_SAVED_HOMES = 4;
+
+static_assert(sizeof(MMU::TLBEntry) == 16, "the TLB index is scaled with a shift by 4");
+
+int32_t field(size_t offset) {
+    return static_cast<int32_t>(offset);
+}
+
+int32_t register_slot(uint32_t reg) {
+    return static_cast<int32_t>(4 * reg);
+}
+
+// Call-outs of the memory ops, the ones the inline TLB lookup cannot serve
+
+void sync_devices(JitContext* context, uint32_t index) {
+    // Same ticks as SYNC_DEVICES in ThreadedEngine::execute
+    if (context->tick_devices) {
+        uint64_t now = context->retired + index;
+        if (now != context->ticked) {
+            context->bus->tick(now - context->ticked);
+            context->ticked = now;
+        }
+    }
+}
+
+MemoryStatus read(MMU& mmu, uint32_t address, uint8_t& value) { return mmu.try_read(address, value); }
+MemoryStatus read(MMU& mmu, uint32_t address, uint16_t& value) { return mmu.try_read_halfword(address, value); }
+MemoryStatus read(MMU& mmu, uint32_t address, uint32_t& value) { return mmu.try_read_word(address, value); }
+MemoryStatus write(MMU& mmu, uint32_t address, uint8_t value) { return mmu.try_write(address, value); }
+MemoryStatus write(MMU& mmu, uint32_t address, uint16_t value) { return mmu.try_write_halfword(address, value); }
+MemoryStatus write(MMU& mmu, uint32_t address, uint32_t value) { return mmu.try_write_word(address, value); }
+
+// Returns 0 and leaves the extended value in the context, or 1 if the access faults
+template <typename T, bool SIGNED>
+uint32_t load_call(JitContext* context, uint32_t address, uint32_t index) {
+    sync_devices(context, index);
+    T value = 0;
+    if (read(*context->mmu, address, value) != MemoryStatus::OK) {
+        return 1;
+    }
+    if constexpr (SIGNED) {
+        context->value = static_cast<uint32_t>(static_cast<int32_t>(static_cast<std::make_signed_t<T>>(value)));
+    } else {
+        context->value = value;
+    }
+    return 0;
+}
+
+// Returns 0, 1 if the access faults, 2 if it dropped compiled or translated code
+template <typename T>
+uint32_t store_call(JitContext* context, uint32_t address, uint32_t value, uint32_t index) {
+    sync_devices(context, index);
+    if (write(*context->mmu, address, static_cast<T>(value)) != MemoryStatus::OK) {
+        return 1;
+    }
+    return context->cache->code_written() ? 2 : 0;
+}
+
+// Emits one block. Layout: entry, body, miss paths, fault exits, unlinked chain exits, the
+// shared jump to the epilogue, then the 8 byte jump slots
+class BlockEmitter {
+private:
+    struct Chain {
+        X86Emitter::Label slot;
+        X86Emitter::Label unlinked;
+        uint32_t target;
+    };
+
+    X86Emitter& as;
+    const ThreadedBlock& block;
+    const MMU::TLBEntry* read_tlb;
+    const MMU::TLBEntry* write_tlb;
+    const void* epilogue;
+
+    std::array<int, 32> home;   // index in HOMES, -1 when the register lives in the register bank
+    std::vector<uint32_t> cached;
+    uint32_t written;           // bit per guest register written by the block
+    X86Emitter::Label leave;
+    std::map<uint32_t, X86Emitter::Label> faults; // by op index
+    std::vector<Chain> chains;
+    std::vector<std::function<void()>> cold;      // miss paths, emitted after the body
+
+    bool is_cached(uint32_t reg) const { return reg != 0 && home[reg] >= 0; }
+    X86Reg host(uint32_t reg) const { return HOMES[static_cast<size_t>(home[reg])]; }
+
+    void allocate();
+    void writeback();
+    void spill();   // caller saved homes to the register bank, before a call-out
+    void reload();
+
+    X86Reg source(uint32_t reg, X86Reg scratch);
+    void to_rax(uint32_t reg);
+    void operate(X86Alu op, X86Reg dst, uint32_t reg); // dst = dst op x[reg]
+    void write(uint32_t reg, X86Reg value);
+    void write_constant(uint32_t reg, uint32_t value);
+
+    X86Emitter::Label fault(uint32_t index);
+    void exit_to(uint32_t target, uint32_t retired, BlockExit exit, bool chain);
+    void call_out(const void* function);
+
+    void emit_alu(const ThreadedOp& op);
+    void emit_alu_immediate(const ThreadedOp& op);
+    void emit_multiply_divide(const ThreadedOp& op);
+    void emit_load(const ThreadedOp& op, uint32_t index);
+    void emit_store(const ThreadedOp& op, uint32_t index);
+    void emit_lookup(const MMU::TLBEntry* tlb, uint32_t size, X86Emitter::Label miss);
+    void emit_op(const ThreadedOp& op, uint32_t index);
+
+public:
+    BlockEmitter(X86Emitter& as, const ThreadedBlock& block, const MMU::TLBEntry* read_tlb,
+                 const MMU::TLBEntry* write_tlb, const void* epilogue)
+        : as(as), block(block), read_tlb(read_tlb), write_tlb(write_tlb), epilogue(epilogue), written(0),
+          leave(as.new_label()) {
+        home.fill(-1);
+    }
+
+    void emit();
+};
+
+void BlockEmitter::allocate() {
+    std::array<uint32_t, 32> uses{};
+    for (const ThreadedOp& op : block.ops) {
+        ++uses[op.rd];
+        ++uses[op.rs1];
+        ++uses[op.rs2];
+        written |= 1u << op.rd;
+    }
+    written &= ~1u;
+
+    // Registers used once are cheaper to access in memory than to load and write back
+    std::vector<uint32_t> candidates;
+    for (uint32_t reg = 1; reg < 32; ++reg) {
+        if (uses[reg] >= 2) {
+            candidates.push_back(reg);
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) { return uses[a] > uses[b]; });
+    for (uint32_t reg : candidates) {
+        if (cached.size() == HOMES.size()) {
+            break;
+        }
+        home[reg] = static_cast<int>(cached.size());
+        cached.push_back(reg);
+    }
+}
+
+void BlockEmitter::writeback() {
+    for (uint32_t reg : cached) {
+        if (written & (1u << reg)) {
+            as.store(REGISTERS, register_slot(reg), host(reg));
+        }
+    }
+}
+
+void BlockEmitter::spill() {
+    for (uint32_t reg : cached) {
+        if (static_cast<size_t>(home[reg]) >= CALLEE_SAVED_HOMES) {
+            as.store(REGISTERS, register_slot(reg), host(reg));
+        }
+    }
+}
+
+void BlockEmitter::reload() {
+    for (uint32_t reg : cached) {
+        if (static_cast<size_t>(home[reg]) >= CALLEE_SAVED_HOMES) {
+            as.load(host(reg), REGISTERS, register_slot(reg));
+        }
+    }
+}
+
+X86Reg BlockEmitter::source(uint32_t reg, X86Reg scratch) {
+    if (reg == 0) {
+        as.mov(scratch, 0u);
+        return scratch;
+    }
+    if (is_cached(reg)) {
+        return host(reg);
+    }
+    as.load(scratch, REGISTERS, register_slot(reg));
+    return scratch;
+}
+
+void BlockEmitter::to_rax(uint32_t reg) {
+    X86Reg value = source(reg, X86Reg::RAX);
+    if (value != X86Reg::RAX) {
+        as.mov(X86Reg::RAX, value);
+    }
+}
+
+void BlockEmitter::operate(X86Alu op, X86Reg dst, uint32_t reg) {
+    if (reg == 0) {
+        as.alu(op, dst, 0u);
+    } else if (is_cached(reg)) {
+        as.alu(op, dst, host(reg));
+    } else {
+        as.alu(op, dst, REGISTERS, register_slot(reg));
+    }
+}
+
+void BlockEmitter::write(uint32_t reg, X86Reg value) {
+    if (reg == 0) {
+        return;
+    }
+    if (is_cached(reg)) {
+        if (host(reg) != value) {
+            as.mov(host(reg), value);
+        }
+    } else {
+        as.store(REGISTERS, register_slot(reg), value);
+    }
+}
+
+void BlockEmitter::write_constant(uint32_t reg, uint32_t value) {
+    if (reg == 0) {
+        return;
+    }
+    if (is_cached(reg)) {
+        as.mov(host(reg), value);
+    } else {
+        as.store_imm(REGISTERS, register_slot(reg), value);
+    }
+}
+
+X86Emitter::Label BlockEmitter::fault(uint32_t index) {
+    auto it = faults.find(index);
+    if (it == faults.end()) {
+        it = faults.emplace(index, as.new_label()).first;
+    }
+    return it->second;
+}
+
+void BlockEmitter::exit_to(uint32_t target, uint32_t retired, BlockExit exit, bool chain) {
+    writeback();
+    if (retired != 0) {
+        as.alu_mem64(X86Alu::ADD, CONTEXT, field(offsetof(JitContext, retired)), static_cast<int32_t>(retired));
+    }
+    // Only targets of the same virtual page are chained, the engine validated its translation
+    if (exit == BlockExit::NEXT && chain && ((target ^ block.pc) & MMU::PAGE_MASK) == 0) {
+        Chain link{as.new_label(), as.new_label(), target};
+        as.alu_mem64(X86Alu::SUB, CONTEXT, field(offsetof(JitContext, budget)), 1);
+        as.jcc(X86Cond::LE, link.unlinked);
+        as.jmp_indirect(link.slot);
+        chains.push_back(link);
+        return;
+    }
+    as.store_imm(CONTEXT, field(offsetof(JitContext, next_pc)), target);
+    if (exit != BlockExit::NEXT) {
+        as.store_imm(CONTEXT, field(offsetof(JitContext, exit)), static_cast<uint32_t>(exit));
+    }
+    as.jmp(leave);
+}
+
+void BlockEmitter::call_out(const void* function) {
+    as.mov64(X86Reg::RDI, CONTEXT);
+    as.mov64(X86Reg::RAX, reinterpret_cast<uint64_t>(function));
+    as.call(X86Reg::RAX);
+}
+
+void BlockEmitter::emit_alu(const ThreadedOp& op) {
+    X86Alu alu;
+    switch (op.kind) {
+        case Kind::ADD: alu = X86Alu::ADD; break;
+        case Kind::SUB: alu = X86Alu::SUB; break;
+        case Kind::XOR: alu = X86Alu::XOR; break;
+        case Kind::OR:  alu = X86Alu::OR; break;
+        case Kind::AND: alu = X86Alu::AND; break;
+        case Kind::SLT:
+        case Kind::SLTU:
+            to_rax(op.rs1);
+            operate(X86Alu::CMP, X86Reg::RAX, op.rs2);
+            as.setcc(op.kind == Kind::SLT ? X86Cond::L : X86Cond::B, X86Reg::RAX);
+            as.movzx8(X86Reg::RAX, X86Reg::RAX);
+            write(op.rd, X86Reg::RAX);
+            return;
+        default: { // SLL, SRL, SRA
+            X86Shift shift = op.kind == Kind::SLL ? X86Shift::SHL : op.kind == Kind::SRL ? X86Shift::SHR : X86Shift::SAR;
+            X86Reg amount = source(op.rs2, X86Reg::RCX);
+            if (amount != X86Reg::RCX) {
+                as.mov(X86Reg::RCX, amount);
+            }
+            if (is_cached(op.rd) && op.rd == op.rs1) {
+                as.shift_cl(shift, host(op.rd));
+                return;
+            }
+            to_rax(op.rs1);
+            as.shift_cl(shift, X86Reg::RAX);
+            write(op.rd, X86Reg::RAX);
+            return;
+        }
+    }
+    // In place when the destination is a cached source, x86 only has two operand forms
+    if (is_cached(op.rd) && op.rd == op.rs1 && op.rs2 != op.rd) {
+        operate(alu, host(op.rd), op.rs2);
+        return;
+    }
+    to_rax(op.rs1);
+    operate(alu, X86Reg::RAX, op.rs2);
+    write(op.rd, X86Reg::RAX);
+}
+
+void BlockEmitter::emit_multiply_divide(const ThreadedOp& op) {
+    switch (op.kind) {
+        case Kind::MUL:
+            // The low half of the product is the same signed or unsigned
+            if (is_cached(op.rd) && op.rd == op.rs1 && op.rs2 != op.rd) {
+                as.imul(host(op.rd), source(op.rs2, X86Reg::RCX));
+                return;
+            }
+            to_rax(op.rs1);
+            as.imul(X86Reg::RAX, source(op.rs2, X86Reg::RCX));
+            write(op.rd, X86Reg::RAX);
+            return;
+        case Kind::MULH:
+        case Kind::MULHSU:
+        case Kind::MULHU: {
+            // The operands extended to 64 bits, their product fits and its upper half is the result.
+            // A 32-bit mov zero extends
+            X86Reg a = source(op.rs1, X86Reg::RAX);
+            if (op.kind == Kind::MULHU) {
+                as.mov(X86Reg::RAX, a);
+            } else {
+                as.movsxd(X86Reg::RAX, a);
+            }
+            X86Reg b = source(op.rs2, X86Reg::RCX);
+            if (op.kind == Kind::MULH) {
+                as.movsxd(X86Reg::RCX, b);
+            } else {
+                as.mov(X86Reg::RCX, b);
+            }
+            as.imul64(X86Reg::RAX, X86Reg::RCX);
+            as.shift64(X86Shift::SHR, X86Reg::RAX, 32);
+            write(op.rd, X86Reg::RAX);
+            return;
+        }
+        default: // DIV, DIVU, REM, REMU
+            break;
+    }
+    // Division by zero, and INT_MIN / -1 which raises #DE on x86, take the cold path. Homes are
+    // never rax or rdx, the divisor survives the division
+    bool sign = op.kind == Kind::DIV || op.kind == Kind::REM;
+    bool remainder = op.kind == Kind::REM || op.kind == Kind::REMU;
+    X86Emitter::Label special = as.new_label();
+    X86Emitter::Label resume = as.new_label();
+    to_rax(op.rs1);
+    X86Reg divisor = source(op.rs2, X86Reg::RCX);
+    as.alu(X86Alu::CMP, divisor, 0u);
+    as.jcc(X86Cond::E, special);
+    if (sign) {
+        as.alu(X86Alu::CMP, divisor, 0xFFFFFFFFu);
+        as.jcc(X86Cond::E, special);
+        as.cdq();
+    } else {
+        as.alu(X86Alu::XOR, X86Reg::RDX, X86Reg::RDX);
+    }
+    as.div(divisor, sign);
+    if (remainder) {
+        as.mov(X86Reg::RAX, X86Reg::RDX);
+    }
+    as.bind(resume);
+    write(op.rd, X86Reg::RAX);
+
+    cold.push_back([this, special, resume, divisor, sign, remainder]() {
+        as.bind(special);
+        if (sign) {
+            // By -1 the quotient is the negated dividend, INT_MIN stays INT_MIN, and the remainder 0
+            X86Emitter::Label zero = as.new_label();
+            as.alu(X86Alu::CMP, divisor, 0u);
+            as.jcc(X86Cond::E, zero);
+            if (remainder) {
+                as.alu(X86Alu::XOR, X86Reg::RAX, X86Reg::RAX);
+            } else {
+                as.imul(X86Reg::RAX, divisor);
+            }
+            as.jmp(resume);
+            as.bind(zero);
+        }
+        // By zero the quotient is all ones, the remainder the dividend already in eax
+        if (!remainder) {
+            as.mov(X86Reg::RAX, 0xFFFFFFFFu);
+        }
+        as.jmp(resume);
+    });
+}
+
+void BlockEmitter::emit_alu_immediate(const ThreadedOp& op) {
+    switch (op.kind) {
+        case Kind::SLTI:
+        case Kind::SLTIU:
+            to_rax(op.rs1);
+            as.alu(X86Alu::CMP, X86Reg::RAX, op.imm);
+            as.setcc(op.kind == Kind::SLTI ? X86Cond::L : X86Cond::B, X86Reg::RAX);
+            as.movzx8(X86Reg::RAX, X86Reg::RAX);
+            write(op.rd, X86Reg::RAX);
+            return;
+        case Kind::SLLI:
+        case Kind::SRLI:
+        case Kind::SRAI: {
+            X86Shift shift = op.kind == Kind::SLLI ? X86Shift::SHL : op.kind == Kind::SRLI ? X86Shift::SHR : X86Shift::SAR;
+            if (is_cached(op.rd) && op.rd == op.rs1) {
+                as.shift(shift, host(op.rd), static_cast<uint8_t>(op.imm));
+                return;
+            }
+            to_rax(op.rs1);
+            as.shift(shift, X86Reg::RAX, static_cast<uint8_t>(op.imm));
+            write(op.rd, X86Reg::RAX);
+            return;
+        }
+        default:
+            break;
+    }
+    X86Alu alu = op.kind == Kind::ADDI ? X86Alu::ADD : op.kind == Kind::XORI ? X86Alu::XOR
+               : op.kind == Kind::ORI ? X86Alu::OR : X86Alu::AND;
+    if (op.rs1 == 0) {
+        // li and mv style constants
+        write_constant(op.rd, alu == X86Alu::AND ? 0 : op.imm);
+        return;
+    }
+    if (is_cached(op.rd) && op.rd == op.rs1) {
+        as.alu(alu, host(op.rd), op.imm);
+        return;
+    }
+    to_rax(op.rs1);
+    as.alu(alu, X86Reg::RAX, op.imm);
+    write(op.rd, X86Reg::RAX);
+}
+
+void BlockEmitter::emit_lookup(const MMU::TLBEntry* tlb, uint32_t size, X86Emitter::Label miss) {
+    // rax holds the address. Same hit test as MMU::load and MMU::store, the alignment bits in the
+    // compare send misaligned addresses to the call-out. Leaves the addend in rdx
+    as.mov(X86Reg::RCX, X86Reg::RAX);
+    as.shift(X86Shift::SHR, X86Reg::RCX, MMU::PAGE_SHIFT);
+    as.alu(X86Alu::AND, X86Reg::RCX, MMU::TLB_ENTRIES - 1);
+    as.shift(X86Shift::SHL, X86Reg::RCX, 4);
+    as.mov64(X86Reg::RDX, reinterpret_cast<uint64_t>(tlb));
+    as.alu64(X86Alu::ADD, X86Reg::RDX, X86Reg::RCX);
+    as.mov(X86Reg::RCX, X86Reg::RAX);
+    as.alu(X86Alu::AND, X86Reg::RCX, MMU::PAGE_MASK | (size - 1));
+    as.alu(X86Alu::CMP, X86Reg::RCX, X86Reg::RDX, field(offsetof(MMU::TLBEntry, tag)));
+    as.jcc(X86Cond::NE, miss);
+    as.load64(X86Reg::RDX, X86Reg::RDX, field(offsetof(MMU::TLBEntry, addend)));
+}
+
+void BlockEmitter::emit_load(const ThreadedOp& op, uint32_t index) {
+    X86Emitter::Label miss = as.new_label();
+    X86Emitter::Label resume = as.new_label();
+    uint32_t size = (op.kind == Kind::LW) ? 4 : (op.kind == Kind::LH || op.kind == Kind::LHU) ? 2 : 1;
+    const void* function = op.kind == Kind::LB  ? reinterpret_cast<const void*>(&load_call<uint8_t, true>)
+                         : op.kind == Kind::LH  ? reinterpret_cast<const void*>(&load_call<uint16_t, true>)
+                         : op.kind == Kind::LW  ? reinterpret_cast<const void*>(&load_call<uint32_t, false>)
+                         : op.kind == Kind::LBU ? reinterpret_cast<const void*>(&load_call<uint8_t, false>)
+                                                : reinterpret_cast<const void*>(&load_call<uint16_t, false>);
+
+    to_rax(op.rs1);
+    if (op.imm != 0) {
+        as.alu(X86Alu::ADD, X86Reg::RAX, op.imm);
+    }
+    emit_lookup(read_tlb, size, miss);
+    // Loads into x0 still access memory, the value is dropped
+    X86Reg value = is_cached(op.rd) ? host(op.rd) : X86Reg::RCX;
+    switch (op.kind) {
+        case Kind::LB:  as.load8(value, X86Reg::RDX, X86Reg::RAX, true); break;
+        case Kind::LBU: as.load8(value, X86Reg::RDX, X86Reg::RAX, false); break;
+        case Kind::LH:  as.load16(value, X86Reg::RDX, X86Reg::RAX, true); break;
+        case Kind::LHU: as.load16(value, X86Reg::RDX, X86Reg::RAX, false); break;
+        default:        as.load32(value, X86Reg::RDX, X86Reg::RAX); break;
+    }
+    if (op.rd != 0 && !is_cached(op.rd)) {
+        as.store(REGISTERS, register_slot(op.rd), X86Reg::RCX);
+    }
+    as.bind(resume);
+
+    cold.push_back([this, op, index, miss, resume, function, value]() {
+        as.bind(miss);
+        spill();
+        as.mov(X86Reg::RSI, X86Reg::RAX);
+        as.mov(X86Reg::RDX, index);
+        call_out(function);
+        reload();
+        as.test(X86Reg::RAX, 0xFFFFFFFF);
+        as.jcc(X86Cond::NE, fault(index));
+        if (op.rd != 0) {
+            as.load(value, CONTEXT, field(offsetof(JitContext, value)));
+            if (!is_cached(op.rd)) {
+                as.store(REGISTERS, register_slot(op.rd), X86Reg::RCX);
+            }
+        }
+        as.jmp(resume);
+    });
+}
+
+void BlockEmitter::emit_store(const ThreadedOp& op, uint32_t index) {
+    X86Emitter::Label miss = as.new_label();
+    X86Emitter::Label resume = as.new_label();
+    uint32_t size = op.kind == Kind::SW ? 4 : op.kind == Kind::SH ? 2 : 1;
+    const void* function = op.kind == Kind::SB ? reinterpret_cast<const void*>(&store_call<uint8_t>)
+                         : op.kind == Kind::SH ? reinterpret_cast<const void*>(&store_call<uint16_t>)
+                                               : reinterpret_cast<const void*>(&store_call<uint32_t>);
+
+    to_rax(op.rs1);
+    if (op.imm != 0) {
+        as.alu(X86Alu::ADD, X86Reg::RAX, op.imm);
+    }
+    // Code pages never get a write translation, stores to them always take the call-out
+    emit_lookup(write_tlb, size, miss);
+    X86Reg value = source(op.rs2, X86Reg::RCX);
+    switch (op.kind) {
+        case Kind::SB: as.store8(X86Reg::RDX, X86Reg::RAX, value); break;
+        case Kind::SH: as.store16(X86Reg::RDX, X86Reg::RAX, value); break;
+        default:       as.store32(X86Reg::RDX, X86Reg::RAX, value); break;
+    }
+    as.bind(resume);
+
+    cold.push_back([this, op, index, miss, resume, function]() {
+        as.bind(miss);
+        spill();
+        // Every guest register is now in a callee saved home or in the register bank
+        if (is_cached(op.rs2) && static_cast<size_t>(home[op.rs2]) < CALLEE_SAVED_HOMES) {
+            as.mov(X86Reg::RDX, host(op.rs2));
+        } else if (op.rs2 == 0) {
+            as.mov(X86Reg::RDX, 0u);
+        } else {
+            as.load(X86Reg::RDX, REGISTERS, register_slot(op.rs2));
+        }
+        as.mov(X86Reg::RSI, X86Reg::RAX);
+        as.mov(X86Reg::RCX, index);
+        call_out(function);
+        reload();
+        as.alu(X86Alu::CMP, X86Reg::RAX, 0u);
+        as.jcc(X86Cond::E, resume);
+        as.alu(X86Alu::CMP, X86Reg::RAX, 1u);
+        as.jcc(X86Cond::E, fault(index));
+        // The store dropped code, maybe this block: leave right after it
+        exit_to(block.pc + 4 * (index + 1), index + 1, BlockExit::NEXT, false);
+    });
+}
+
+void BlockEmitter::emit_op(const ThreadedOp& op, uint32_t index) {
+    switch (op.kind) {
+        case Kind::NOP:
+            return;
+        case Kind::FENCE:
+            as.mfence();
+            return;
+        case Kind::LI:
+            write_constant(op.rd, op.imm);
+            return;
+        case Kind::ADD: case Kind::SUB: case Kind::SLL: case Kind::SLT: case Kind::SLTU:
+        case Kind::XOR: case Kind::SRL: case Kind::SRA: case Kind::OR: case Kind::AND:
+            emit_alu(op);
+            return;
+        case Kind::MUL: case Kind::MULH: case Kind::MULHSU: case Kind::MULHU:
+        case Kind::DIV: case Kind::DIVU: case Kind::REM: case Kind::REMU:
+            emit_multiply_divide(op);
+            return;
+        case Kind::ADDI: case Kind::SLTI: case Kind::SLTIU: case Kind::XORI: case Kind::ORI:
+        case Kind::ANDI: case Kind::SLLI: case Kind::SRLI: case Kind::SRAI:
+            emit_alu_immediate(op);
+            return;
+        case Kind::LB: case Kind::LH: case Kind::LW: case Kind::LBU: case Kind::LHU:
+            emit_load(op, index);
+            return;
+        case Kind::SB: case Kind::SH: case Kind::SW:
+            emit_store(op, index);
+            return;
+        case Kind::BEQ: case Kind::BNE: case Kind::BLT: case Kind::BGE: case Kind::BLTU: case Kind::BGEU: {
+            static constexpr X86Cond conditions[] = {X86Cond::E, X86Cond::NE, X86Cond::L, X86Cond::GE, X86Cond::B, X86Cond::AE};
+            X86Emitter::Label taken = as.new_label();
+            operate(X86Alu::CMP, source(op.rs1, X86Reg::RAX), op.rs2);
+            as.jcc(conditions[static_cast<size_t>(op.kind) - static_cast<size_t>(Kind::BEQ)], taken);
+            exit_to(op.aux, index + 1, BlockExit::NEXT, true);
+            as.bind(taken);
+            exit_to(op.imm, index + 1, BlockExit::NEXT, true);
+            return;
+        }
+        case Kind::JAL:
+            write_constant(op.rd, op.aux);
+            exit_to(op.imm, index + 1, BlockExit::NEXT, true);
+            return;
+        case Kind::JALR:
+            // The target is computed before the link, rd may be rs1
+            to_rax(op.rs1);
+            if (op.imm != 0) {
+                as.alu(X86Alu::ADD, X86Reg::RAX, op.imm);
+            }
+            as.alu(X86Alu::AND, X86Reg::RAX, ~1u);
+            as.test(X86Reg::RAX, 0x2);
+            as.jcc(X86Cond::NE, fault(index));
+            write_constant(op.rd, op.aux);
+            writeback();
+            as.alu_mem64(X86Alu::ADD, CONTEXT, field(offsetof(JitContext, retired)), static_cast<int32_t>(index + 1));
+            as.store(CONTEXT, field(offsetof(JitContext, next_pc)), X86Reg::RAX);
+            as.jmp(leave);
+            return;
+        case Kind::FENCE_I:
+            exit_to(op.aux, index + 1, BlockExit::FENCE_I, false);
+            return;
+        case Kind::FALLTHROUGH:
+            exit_to(op.aux, index, BlockExit::NEXT, true);
+            return;
+        default: // FALLBACK
+            as.jmp(fault(index));
+            return;
+    }
+}
+
+void BlockEmitter::emit() {
+    allocate();
+
+    as.alu_mem64(X86Alu::ADD, CONTEXT, field(offsetof(JitContext, blocks)), 1);
+    for (uint32_t reg : cached) {
+        as.load(host(reg), REGISTERS, register_slot(reg));
+    }
+    for (uint32_t index = 0; index < block.ops.size(); ++index) {
+        emit_op(block.ops[index], index);
+    }
+    for (const auto& path : cold) {
+        path();
+    }
+    // The instruction did not run, the pipeline executes it
+    for (const auto& [index, label] : faults) {
+        as.bind(label);
+        exit_to(block.pc + 4 * index, index, BlockExit::STEP, false);
+    }
+    // Exits whose slot is not linked yet, or out of budget: the engine links them on the way out
+    for (const Chain& link : chains) {
+        as.bind(link.unlinked);
+        as.store_imm(CONTEXT, field(offsetof(JitContext, next_pc)), link.target);
+        as.lea(X86Reg::RAX, link.slot);
+        as.store64(CONTEXT, field(offsetof(JitContext, link_slot)), X86Reg::RAX);
+        as.jmp(leave);
+    }
+    as.bind(leave);
+    as.jmp(epilogue);
+
+    as.align(8);
+    for (const Chain& link : chains) {
+        as.bind(link.slot);
+        as.data64(reinterpret_cast<uint64_t>(as.address_of(link.unlinked)));
+    }
+}
+
+} // namespace
+
+JitCompiler::JitCompiler(MMU& mmu, const JitConfig& config)
+    : mmu(mmu), config(config), arena(config.arena_size), entry(nullptr), epilogue(nullptr) {}
+
+bool JitCompiler::prepare() {
+    if (entry != nullptr) {
+        return true;
+    }
+#if !defined(__x86_64__)
+    // The code generator only knows x86-64, blocks stay threaded on other hosts
+    return false;
+#endif
+    if (!arena.ensure_mapped()) {
+        return false;
+    }
+    // entry(context, registers, code), System V: rdi, rsi, rdx. The extra push keeps the stack
+    // 16 byte aligned for the call-outs
+    X86Emitter as(arena.cursor(), arena.remaining());
+    for (X86Reg reg : {X86Reg::RBX, X86Reg::RBP, X86Reg::R12, X86Reg::R13, X86Reg::R14, X86Reg::R15, X86Reg::RAX}) {
+        as.push(reg);
+    }
+    as.mov64(CONTEXT, X86Reg::RDI);
+    as.mov64(REGISTERS, X86Reg::RSI);
+    as.jmp(X86Reg::RDX);
+    X86Emitter::Label exit = as.new_label();
+    as.bind(exit);
+    for (X86Reg reg : {X86Reg::RCX, X86Reg::R15, X86Reg::R14, X86Reg::R13, X86Reg::R12, X86Reg::RBP, X86Reg::RBX}) {
+        as.pop(reg);
+    }
+    as.ret();
+    if (!as.finish()) {
+        return false;
+    }
+    if (config.perf_map) {
+        perf_map.record(as.get_start(), as.size(), "virtuv_jit_entry");
+    }
+    entry = reinterpret_cast<Entry>(as.get_start());
+    epilogue = as.address_of(exit);
+    arena.commit(as.size());
+    arena.reserve_current();
+    return true;
+}
+
+JitCompiler::Result JitCompiler::compile(ThreadedBlock& block) {
+    if (!prepare()) {
+        return Result::UNAVAILABLE;
+    }
+    X86Emitter as(arena.cursor(), arena.remaining());
+    as.align(16);
+    uint8_t* start = as.get_cursor();
+    BlockEmitter(as, block, mmu.get_tlb(AccessType::READ), mmu.get_tlb(AccessType::WRITE), epilogue).emit();
+    if (!as.finish()) {
+        // A block that does not fit an empty arena never will
+        return arena.is_empty() ? Result::UNAVAILABLE : Result::ARENA_FULL;
+    }
+    arena.commit(as.size());
+    block.compiled = start;
+    if (config.perf_map) {
+        perf_map.record_block(start, static_cast<size_t>(as.get_cursor() - start), block.pc);
+    }
+    return Result::COMPILED;
+}
+
+void JitCompiler::reset() {
+    arena.reset();
+}
+
+void JitCompiler::link(const void** slot, ThreadedBlock& target) {
+    target.incoming.push_back(ThreadedBlock::ChainLink{slot, *slot});
+    *slot = target.compiled;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "core/cpu/threaded/BlockCache.hpp"
+#include "core/cpu/threaded/ThreadedBlock.hpp"
+#include "core/memory/Bus.hpp"
+#include "core/memory/MMU.hpp"
+#include "CodeArena.hpp"
+#include "PerfMap.hpp"
+
+// Settings of the JIT tier of the threaded engine
+struct JitConfig {
+    uint32_t threshold = 16;                 // threaded executions before a block is compiled
+    size_t arena_size = 16 * 1024 * 1024;    // bytes of executable memory, all dropped when full
+    bool perf_map = false;                   // name compiled blocks in /tmp/perf-<pid>.map
+};
+
+// State shared between the engine and compiled code, which keeps its address in r14. Compiled
+// blocks chained to each other keep adding to the counters until one of them leaves
+struct JitContext {
+    uint32_t next_pc = 0;          // where the guest continues
+    BlockExit exit = BlockExit::NEXT;
+    uint64_t retired = 0;          // instructions retired since enter()
+    uint64_t ticked = 0;           // of those, instructions already ticked on the bus
+    uint64_t blocks = 0;           // blocks entered since enter()
+    int64_t budget = 0;            // chained jumps left before returning to the engine
+    const void** link_slot = nullptr; // jump slot of the exit taken, when it can be chained
+    uint32_t value = 0;            // result of the load call-outs
+    MMU* mmu = nullptr;
+    Bus* bus = nullptr;
+    BlockCache* cache = nullptr;
+    bool tick_devices = false;
+};
+
+// Second tier of the threaded engine: compiles hot blocks to x86-64.
+//
+// A compiled block keeps the guest registers it uses most in host registers, loaded on entry
+// and written back to the register bank on every exit. Loads and stores look the MMU TLB up
+// inline and access host memory directly on a hit. Misses, devices and code pages call out to
+// the MMU try_* accessors, which also deliver the device ticks the threaded engine would have
+// delivered by then. An access that faults leaves the block before the instruction and the
+// pipeline executes it again to take the trap, like the threaded engine does.
+//
+// Exits to a known PC of the same page go through a jump slot. The slot first points at code that
+// returns to the engine, which then links it straight to the compiled target; targets record the
+// slots jumping to them so dropping a block points them back at their exit.
+//
+// Every op of the threaded engine is compiled, including FALLBACK which leaves for the pipeline,
+// so the instructions the threaded engine leaves to the pipeline are left to it here too.
+class JitCompiler {
+public:
+    enum class Result {
+        COMPILED,
+        ARENA_FULL,  // reset() and try again
+        UNAVAILABLE  // no executable memory, or the block does not fit an empty arena
+    };
+
+private:
+    using Entry = void (*)(JitContext* context, uint32_t* registers, const void* code);
+
+    MMU& mmu;
+    JitConfig config;
+    CodeArena arena;
+    PerfMap perf_map;
+    Entry entry;          // saves the host registers and jumps to a block
+    const void* epilogue; // restores them and returns from entry
+
+    bool prepare(); // maps the arena and emits entry and epilogue once
+
+public:
+    JitCompiler(MMU& mmu, const JitConfig& config);
+    JitCompiler(const JitCompiler&) = delete;
+    JitCompiler& operator=(const JitCompiler&) = delete;
+
+    const JitConfig& get_config() const { return config; }
+
+    // Compiles a block and sets its compiled entry
+    Result compile(ThreadedBlock& block);
+
+    // Drops every compiled block, the caller forgets their entries. Only called between two blocks
+    void reset();
+
+    // Runs compiled code from block until it leaves, the context tells where and why
+    void enter(const ThreadedBlock& block, JitContext& context, uint32_t* registers) const {
+        entry(&context, registers, block.compiled);
+    }
+
+    // Makes the slot of an exit jump straight to a compiled block
+    static void link(const void** slot, ThreadedBlock& target);
+};
@@ -0,0 +1,37 @@
+#include "PerfMap.hpp"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+#include "utils/plt.hpp"
+
+PerfMap::PerfMap() : file(nullptr), failed(false) {}
+
+PerfMap::~PerfMap() {
+    if (file != nullptr) {
+        std::fclose(file);
+    }
+}
+
+void PerfMap::record(const void* start, size_t size, const std::string& name) {
+    if (file == nullptr && !failed) {
+        std::string path = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+        file = std::fopen(path.c_str(), "a");
+        if (file == nullptr) {
+            PLT_WARN("PerfMap - Unable to open " + path + ": " + std::string(std::strerror(errno)));
+            failed = true;
+        }
+    }
+    if (file == nullptr) {
+        return;
+    }
+    std::fprintf(file, "%lx %zx %s\n", static_cast<unsigned long>(reinterpret_cast<uintptr_t>(start)), size, name.c_str());
+    // perf may read the file while the guest still runs
+    std::fflush(file);
+}
+
+void PerfMap::record_block(const void* start, size_t size, uint32_t guest_pc) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "virtuv_jit_0x%08x", guest_pc);
+    record(start, size, name);
+}
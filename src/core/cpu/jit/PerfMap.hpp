@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// Writes /tmp/perf-<pid>.map, the file perf reads to name code it finds no symbols for. Each
+// compiled block gets a line with its host address, its size and the guest PC it starts at.
+// The file is opened on the first record and never truncated, perf keeps the last name of an
+// address reused after an eviction.
+class PerfMap {
+private:
+    std::FILE* file;
+    bool failed;
+
+public:
+    PerfMap();
+    ~PerfMap();
+    PerfMap(const PerfMap&) = delete;
+    PerfMap& operator=(const PerfMap&) = delete;
+
+    void record(const void* start, size_t size, const std::string& name);
+    void record_block(const void* start, size_t size, uint32_t guest_pc);
+};
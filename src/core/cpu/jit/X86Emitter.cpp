@@ -0,0 +1,426 @@
+#include "X86Emitter.hpp"
+#include <cstring>
+#include <limits>
+
+namespace {
+
+uint8_t code(X86Reg reg) {
+    return static_cast<uint8_t>(reg);
+}
+
+bool fits_int8(int64_t value) {
+    return value >= -128 && value <= 127;
+}
+
+} // namespace
+
+X86Emitter::X86Emitter(uint8_t* buffer, size_t size)
+    : start(buffer), cursor(buffer), end(buffer + size), overflow(false) {}
+
+void X86Emitter::byte(uint8_t value) {
+    if (cursor >= end) {
+        overflow = true;
+        return;
+    }
+    *cursor++ = value;
+}
+
+void X86Emitter::dword(uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        byte(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+void X86Emitter::qword(uint64_t value) {
+    dword(static_cast<uint32_t>(value));
+    dword(static_cast<uint32_t>(value >> 32));
+}
+
+void X86Emitter::rex(bool wide, uint8_t reg, uint8_t index, uint8_t base, bool force) {
+    uint8_t prefix = 0x40 | (wide ? 0x08 : 0) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+    if (prefix != 0x40 || force) {
+        byte(prefix);
+    }
+}
+
+void X86Emitter::modrm_reg(uint8_t reg, uint8_t rm) {
+    byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+void X86Emitter::modrm_mem(uint8_t reg, X86Reg base, int32_t disp) {
+    uint8_t rm = code(base) & 7;
+    // rbp and r13 have no form without displacement, rsp and r12 need a SIB byte
+    uint8_t mod = (disp == 0 && rm != 5) ? 0x00 : fits_int8(disp) ? 0x40 : 0x80;
+    byte(mod | ((reg & 7) << 3) | rm);
+    if (rm == 4) {
+        byte(0x24);
+    }
+    if (mod == 0x40) {
+        byte(static_cast<uint8_t>(disp));
+    } else if (mod == 0x80) {
+        dword(static_cast<uint32_t>(disp));
+    }
+}
+
+void X86Emitter::modrm_sib(uint8_t reg, X86Reg base, X86Reg index) {
+    uint8_t rm = code(base) & 7;
+    uint8_t mod = rm == 5 ? 0x40 : 0x00;
+    byte(mod | ((reg & 7) << 3) | 4);
+    byte(((code(index) & 7) << 3) | rm);
+    if (mod == 0x40) {
+        byte(0);
+    }
+}
+
+void X86Emitter::rel32(Label label) {
+    fixups.push_back(Fixup{size(), label});
+    dword(0);
+}
+
+X86Emitter::Label X86Emitter::new_label() {
+    labels.push_back(-1);
+    return labels.size() - 1;
+}
+
+void X86Emitter::bind(Label label) {
+    labels[label] = static_cast<ptrdiff_t>(size());
+}
+
+uint8_t* X86Emitter::address_of(Label label) const {
+    return start + labels[label];
+}
+
+bool X86Emitter::finish() {
+    if (overflow) {
+        return false;
+    }
+    for (const Fixup& fixup : fixups) {
+        if (labels[fixup.label] < 0) {
+            return false;
+        }
+        int32_t displacement = static_cast<int32_t>(labels[fixup.label] - static_cast<ptrdiff_t>(fixup.position + 4));
+        std::memcpy(start + fixup.position, &displacement, sizeof(displacement));
+    }
+    fixups.clear();
+    return true;
+}
+
+void X86Emitter::align(size_t alignment) {
+    while (reinterpret_cast<uintptr_t>(cursor) % alignment != 0 && !overflow) {
+        byte(0xCC);
+    }
+}
+
+void X86Emitter::data64(uint64_t value) {
+    qword(value);
+}
+
+void X86Emitter::mov(X86Reg dst, X86Reg src) {
+    rex(false, code(src), 0, code(dst));
+    byte(0x89);
+    modrm_reg(code(src), code(dst));
+}
+
+void X86Emitter::mov(X86Reg dst, uint32_t imm) {
+    rex(false, 0, 0, code(dst));
+    byte(0xB8 + (code(dst) & 7));
+    dword(imm);
+}
+
+void X86Emitter::mov64(X86Reg dst, uint64_t imm) {
+    rex(true, 0, 0, code(dst));
+    byte(0xB8 + (code(dst) & 7));
+    qword(imm);
+}
+
+void X86Emitter::mov64(X86Reg dst, X86Reg src) {
+    rex(true, code(src), 0, code(dst));
+    byte(0x89);
+    modrm_reg(code(src), code(dst));
+}
+
+void X86Emitter::load(X86Reg dst, X86Reg base, int32_t disp) {
+    rex(false, code(dst), 0, code(base));
+    byte(0x8B);
+    modrm_mem(code(dst), base, disp);
+}
+
+void X86Emitter::load64(X86Reg dst, X86Reg base, int32_t disp) {
+    rex(true, code(dst), 0, code(base));
+    byte(0x8B);
+    modrm_mem(code(dst), base, disp);
+}
+
+void X86Emitter::store(X86Reg base, int32_t disp, X86Reg src) {
+    rex(false, code(src), 0, code(base));
+    byte(0x89);
+    modrm_mem(code(src), base, disp);
+}
+
+void X86Emitter::store64(X86Reg base, int32_t disp, X86Reg src) {
+    rex(true, code(src), 0, code(base));
+    byte(0x89);
+    modrm_mem(code(src), base, disp);
+}
+
+void X86Emitter::store_imm(X86Reg base, int32_t disp, uint32_t imm) {
+    rex(false, 0, 0, code(base));
+    byte(0xC7);
+    modrm_mem(0, base, disp);
+    dword(imm);
+}
+
+void X86Emitter::lea(X86Reg dst, Label label) {
+    rex(true, code(dst), 0, 0);
+    byte(0x8D);
+    byte(((code(dst) & 7) << 3) | 0x05); // mod 00, rm 101: [rip + disp32]
+    rel32(label);
+}
+
+void X86Emitter::alu(X86Alu op, X86Reg dst, X86Reg src) {
+    rex(false, code(src), 0, code(dst));
+    byte(static_cast<uint8_t>(op) * 8 + 0x01);
+    modrm_reg(code(src), code(dst));
+}
+
+void X86Emitter::alu(X86Alu op, X86Reg dst, X86Reg base, int32_t disp) {
+    rex(false, code(dst), 0, code(base));
+    byte(static_cast<uint8_t>(op) * 8 + 0x03);
+    modrm_mem(code(dst), base, disp);
+}
+
+void X86Emitter::alu(X86Alu op, X86Reg dst, uint32_t imm) {
+    int32_t value = static_cast<int32_t>(imm);
+    rex(false, 0, 0, code(dst));
+    byte(fits_int8(value) ? 0x83 : 0x81);
+    modrm_reg(static_cast<uint8_t>(op), code(dst));
+    if (fits_int8(value)) {
+        byte(static_cast<uint8_t>(value));
+    } else {
+        dword(imm);
+    }
+}
+
+void X86Emitter::alu64(X86Alu op, X86Reg dst, X86Reg src) {
+    rex(true, code(src), 0, code(dst));
+    byte(static_cast<uint8_t>(op) * 8 + 0x01);
+    modrm_reg(code(src), code(dst));
+}
+
+void X86Emitter::alu_mem64(X86Alu op, X86Reg base, int32_t disp, int32_t imm) {
+    rex(true, 0, 0, code(base));
+    byte(fits_int8(imm) ? 0x83 : 0x81);
+    modrm_mem(static_cast<uint8_t>(op), base, disp);
+    if (fits_int8(imm)) {
+        byte(static_cast<uint8_t>(imm));
+    } else {
+        dword(static_cast<uint32_t>(imm));
+    }
+}
+
+void X86Emitter::alu_mem(X86Alu op, X86Reg base, int32_t disp, int32_t imm) {
+    rex(false, 0, 0, code(base));
+    byte(fits_int8(imm) ? 0x83 : 0x81);
+    modrm_mem(static_cast<uint8_t>(op), base, disp);
+    if (fits_int8(imm)) {
+        byte(static_cast<uint8_t>(imm));
+    } else {
+        dword(static_cast<uint32_t>(imm));
+    }
+}
+
+void X86Emitter::shift(X86Shift op, X86Reg dst, uint8_t amount) {
+    rex(false, 0, 0, code(dst));
+    byte(0xC1);
+    modrm_reg(static_cast<uint8_t>(op), code(dst));
+    byte(amount);
+}
+
+void X86Emitter::shift64(X86Shift op, X86Reg dst, uint8_t amount) {
+    rex(true, 0, 0, code(dst));
+    byte(0xC1);
+    modrm_reg(static_cast<uint8_t>(op), code(dst));
+    byte(amount);
+}
+
+void X86Emitter::shift_cl(X86Shift op, X86Reg dst) {
+    rex(false, 0, 0, code(dst));
+    byte(0xD3);
+    modrm_reg(static_cast<uint8_t>(op), code(dst));
+}
+
+void X86Emitter::imul(X86Reg dst, X86Reg src) {
+    rex(false, code(dst), 0, code(src));
+    byte(0x0F);
+    byte(0xAF);
+    modrm_reg(code(dst), code(src));
+}
+
+void X86Emitter::imul64(X86Reg dst, X86Reg src) {
+    rex(true, code(dst), 0, code(src));
+    byte(0x0F);
+    byte(0xAF);
+    modrm_reg(code(dst), code(src));
+}
+
+void X86Emitter::cdq() {
+    byte(0x99);
+}
+
+void X86Emitter::div(X86Reg divisor, bool sign) {
+    rex(false, 0, 0, code(divisor));
+    byte(0xF7);
+    modrm_reg(sign ? 7 : 6, code(divisor));
+}
+
+void X86Emitter::test(X86Reg reg, uint32_t imm) {
+    rex(false, 0, 0, code(reg));
+    byte(0xF7);
+    modrm_reg(0, code(reg));
+    dword(imm);
+}
+
+void X86Emitter::test64(X86Reg a, X86Reg b) {
+    rex(true, code(b), 0, code(a));
+    byte(0x85);
+    modrm_reg(code(b), code(a));
+}
+
+void X86Emitter::setcc(X86Cond cond, X86Reg dst) {
+    byte(0x0F);
+    byte(0x90 | static_cast<uint8_t>(cond));
+    modrm_reg(0, code(dst));
+}
+
+void X86Emitter::movzx8(X86Reg dst, X86Reg src) {
+    rex(false, code(dst), 0, code(src));
+    byte(0x0F);
+    byte(0xB6);
+    modrm_reg(code(dst), code(src));
+}
+
+void X86Emitter::movsx8(X86Reg dst, X86Reg src) {
+    rex(false, code(dst), 0, code(src));
+    byte(0x0F);
+    byte(0xBE);
+    modrm_reg(code(dst), code(src));
+}
+
+void X86Emitter::movzx16(X86Reg dst, X86Reg src) {
+    rex(false, code(dst), 0, code(src));
+    byte(0x0F);
+    byte(0xB7);
+    modrm_reg(code(dst), code(src));
+}
+
+void X86Emitter::movsx16(X86Reg dst, X86Reg src) {
+    rex(false, code(dst), 0, code(src));
+    byte(0x0F);
+    byte(0xBF);
+    modrm_reg(code(dst), code(src));
+}
+
+void X86Emitter::movsxd(X86Reg dst, X86Reg src) {
+    rex(true, code(dst), 0, code(src));
+    byte(0x63);
+    modrm_reg(code(dst), code(src));
+}
+
+void X86Emitter::load8(X86Reg dst, X86Reg base, X86Reg index, bool sign) {
+    rex(false, code(dst), code(index), code(base));
+    byte(0x0F);
+    byte(sign ? 0xBE : 0xB6);
+    modrm_sib(code(dst), base, index);
+}
+
+void X86Emitter::load16(X86Reg dst, X86Reg base, X86Reg index, bool sign) {
+    rex(false, code(dst), code(index), code(base));
+    byte(0x0F);
+    byte(sign ? 0xBF : 0xB7);
+    modrm_sib(code(dst), base, index);
+}
+
+void X86Emitter::load32(X86Reg dst, X86Reg base, X86Reg index) {
+    rex(false, code(dst), code(index), code(base));
+    byte(0x8B);
+    modrm_sib(code(dst), base, index);
+}
+
+void X86Emitter::store8(X86Reg base, X86Reg index, X86Reg src) {
+    // Without a REX prefix registers 4 to 7 would be AH, CH, DH and BH
+    rex(false, code(src), code(index), code(base), code(src) >= 4);
+    byte(0x88);
+    modrm_sib(code(src), base, index);
+}
+
+void X86Emitter::store16(X86Reg base, X86Reg index, X86Reg src) {
+    byte(0x66);
+    rex(false, code(src), code(index), code(base));
+    byte(0x89);
+    modrm_sib(code(src), base, index);
+}
+
+void X86Emitter::store32(X86Reg base, X86Reg index, X86Reg src) {
+    rex(false, code(src), code(index), code(base));
+    byte(0x89);
+    modrm_sib(code(src), base, index);
+}
+
+void X86Emitter::push(X86Reg reg) {
+    rex(false, 0, 0, code(reg));
+    byte(0x50 + (code(reg) & 7));
+}
+
+void X86Emitter::pop(X86Reg reg) {
+    rex(false, 0, 0, code(reg));
+    byte(0x58 + (code(reg) & 7));
+}
+
+void X86Emitter::ret() {
+    byte(0xC3);
+}
+
+void X86Emitter::mfence() {
+    byte(0x0F);
+    byte(0xAE);
+    byte(0xF0);
+}
+
+void X86Emitter::call(X86Reg target) {
+    rex(false, 0, 0, code(target));
+    byte(0xFF);
+    modrm_reg(2, code(target));
+}
+
+void X86Emitter::jmp(X86Reg target) {
+    rex(false, 0, 0, code(target));
+    byte(0xFF);
+    modrm_reg(4, code(target));
+}
+
+void X86Emitter::jmp(Label label) {
+    byte(0xE9);
+    rel32(label);
+}
+
+void X86Emitter::jmp(const void* target) {
+    byte(0xE9);
+    int64_t displacement = static_cast<const uint8_t*>(target) - (cursor + 4);
+    if (displacement < std::numeric_limits<int32_t>::min() || displacement > std::numeric_limits<int32_t>::max()) {
+        overflow = true;
+        return;
+    }
+    dword(static_cast<uint32_t>(static_cast<int32_t>(displacement)));
+}
+
+void X86Emitter::jmp_indirect(Label slot) {
+    byte(0xFF);
+    byte(0x25); // mod 00, /4, rm 101: [rip + disp32]
+    rel32(slot);
+}
+
+void X86Emitter::jcc(X86Cond cond, Label label) {
+    byte(0x0F);
+    byte(0x80 | static_cast<uint8_t>(cond));
+    rel32(label);
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// x86-64 general purpose registers, numbered like their encoding
+enum class X86Reg : uint8_t {
+    RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+    R8 = 8, R9 = 9, R10 = 10, R11 = 11, R12 = 12, R13 = 13, R14 = 14, R15 = 15
+};
+
+// Condition codes of Jcc and SETcc
+enum class X86Cond : uint8_t {
+    B = 0x2, AE = 0x3, E = 0x4, NE = 0x5, BE = 0x6, A = 0x7, S = 0x8, NS = 0x9, L = 0xC, GE = 0xD, LE = 0xE, G = 0xF
+};
+
+// Two operand integer operations sharing the 0x01/0x03/0x81 encoding family, the value is the /digit
+enum class X86Alu : uint8_t {
+    ADD = 0, OR = 1, AND = 4, SUB = 5, XOR = 6, CMP = 7
+};
+
+enum class X86Shift : uint8_t {
+    SHL = 4, SHR = 5, SAR = 7
+};
+
+// Minimal x86-64 assembler writing straight into a buffer, only what the JIT needs. Operations
+// are 32-bit unless their name ends in 64. Memory operands are [base + disp]; loads and stores
+// of guest memory use [base + index]. Labels are resolved by finish().
+//
+// Writing past the end of the buffer sets overflowed() and drops the bytes, the caller throws
+// the code away and tries again with more room.
+class X86Emitter {
+public:
+    using Label = size_t;
+
+private:
+    struct Fixup {
+        size_t position; // of the rel32 field
+        Label label;
+    };
+
+    uint8_t* start;
+    uint8_t* cursor;
+    uint8_t* end;
+    bool overflow;
+    std::vector<ptrdiff_t> labels; // offset from start, -1 while unbound
+    std::vector<Fixup> fixups;
+
+    void byte(uint8_t value);
+    void dword(uint32_t value);
+    void qword(uint64_t value);
+    void rex(bool wide, uint8_t reg, uint8_t index, uint8_t base, bool force = false);
+    void modrm_reg(uint8_t reg, uint8_t rm);                // register direct
+    void modrm_mem(uint8_t reg, X86Reg base, int32_t disp); // [base + disp]
+    void modrm_sib(uint8_t reg, X86Reg base, X86Reg index); // [base + index]
+    void rel32(Label label);
+
+public:
+    X86Emitter(uint8_t* buffer, size_t size);
+
+    uint8_t* get_start() const { return start; }
+    uint8_t* get_cursor() const { return cursor; }
+    size_t size() const { return static_cast<size_t>(cursor - start); }
+    bool overflowed() const { return overflow; }
+
+    Label new_label();
+    void bind(Label label);
+    uint8_t* address_of(Label label) const; // valid once bound
+    // Patches every jump to a label, returns false if a label was never bound or the buffer overflowed
+    bool finish();
+
+    void align(size_t alignment);   // pads with int3
+    void data64(uint64_t value);    // raw 8 bytes, e.g. a jump slot
+
+    void mov(X86Reg dst, X86Reg src);
+    void mov(X86Reg dst, uint32_t imm);
+    void mov64(X86Reg dst, uint64_t imm);
+    void mov64(X86Reg dst, X86Reg src);
+    void load(X86Reg dst, X86Reg base, int32_t disp);           // mov r32, [base + disp]
+    void load64(X86Reg dst, X86Reg base, int32_t disp);         // mov r64, [base + disp]
+    void store(X86Reg base, int32_t disp, X86Reg src);          // mov [base + disp], r32
+    void store64(X86Reg base, int32_t disp, X86Reg src);        // mov [base + disp], r64
+    void store_imm(X86Reg base, int32_t disp, uint32_t imm);    // mov dword [base + disp], imm32
+    void lea(X86Reg dst, Label label);                          // lea r64, [rip + label]
+
+    void alu(X86Alu op, X86Reg dst, X86Reg src);
+    void alu(X86Alu op, X86Reg dst, X86Reg base, int32_t disp); // op r32, [base + disp]
+    void alu(X86Alu op, X86Reg dst, uint32_t imm);
+    void alu64(X86Alu op, X86Reg dst, X86Reg src);
+    void alu_mem64(X86Alu op, X86Reg base, int32_t disp, int32_t imm); // op qword [base + disp], imm32
+    void alu_mem(X86Alu op, X86Reg base, int32_t disp, int32_t imm);   // op dword [base + disp], imm32
+    void shift(X86Shift op, X86Reg dst, uint8_t amount);
+    void shift64(X86Shift op, X86Reg dst, uint8_t amount);
+    void shift_cl(X86Shift op, X86Reg dst);
+    void imul(X86Reg dst, X86Reg src);
+    void imul64(X86Reg dst, X86Reg src);
+    void cdq();                                 // sign extends eax into edx
+    void div(X86Reg divisor, bool sign);        // edx:eax / r32, quotient in eax, remainder in edx
+    void test(X86Reg reg, uint32_t imm);
+    void test64(X86Reg a, X86Reg b);
+    void setcc(X86Cond cond, X86Reg dst);      // dst = cond ? 1 : 0, dst must be RAX to RBX
+    void movzx8(X86Reg dst, X86Reg src);        // zero extends the low byte, src must be RAX to RBX
+    void movsx8(X86Reg dst, X86Reg src);
+    void movzx16(X86Reg dst, X86Reg src);
+    void movsx16(X86Reg dst, X86Reg src);
+    void movsxd(X86Reg dst, X86Reg src);        // sign extends a 32-bit register to 64 bits
+
+    // Guest memory accesses [base + index]
+    void load8(X86Reg dst, X86Reg base, X86Reg index, bool sign);
+    void load16(X86Reg dst, X86Reg base, X86Reg index, bool sign);
+    void load32(X86Reg dst, X86Reg base, X86Reg index);
+    void store8(X86Reg base, X86Reg index, X86Reg src);
+    void store16(X86Reg base, X86Reg index, X86Reg src);
+    void store32(X86Reg base, X86Reg index, X86Reg src);
+
+    void push(X86Reg reg);
+    void pop(X86Reg reg);
+    void ret();
+    void mfence();
+    void call(X86Reg target);
+    void jmp(X86Reg target);
+    void jmp(Label label);
+    void jmp(const void* target);            // rel32, the target must be within 2GB
+    void jmp_indirect(Label slot);            // jmp [rip + slot]
+    void jcc(X86Cond cond, Label label);
+};
@@ -3,39 +3,450 @@
 Pipeline::Pipeline(RegisterBank& register_bank, MMU& mmu)
     : register_bank(register_bank),
       mmu(mmu),
+      trap_count(0),
+      timing_enabled(false),
+      cache_enabled(false),
+      caches_active(false),
+      fetch_latency(0),
+      memory_latency(0),
+      current_raw(0),
+      fusion_enabled(true),
+      fused(false),
+      fused_first_raw(0),
       fetch_stage(mmu, register_bank),
       decode_stage(register_bank),
       execute_stage(register_bank),
       mem_acces_stage(mmu, register_bank),
       write_back_stage(register_bank)
 {
+    mmu.add_code_write_listener(&predecode_cache);
 }
 
-void Pipeline::run_cycle() {
-    // --- Fetch Stage ---
-    fetch_stage.process();
-    uint32_t instruction = fetch_stage.get_fetched_instruction();
+Pipeline::~Pipeline() {
+    mmu.remove_code_write_listener(&predecode_cache);
+}
+
+CycleStatus Pipeline::run_cycle(bool allow_fusion) {
+    fused = false;
+    allow_fusion = allow_fusion && fusion_enabled;
+    if (!timing_enabled) {
+        return execute_instruction(allow_fusion);
+    }
+    uint32_t pc = register_bank.get_pc();
+    current_raw = 0;
+    fetch_latency = 0;
+    memory_latency = 0;
+    CycleStatus status = execute_instruction(allow_fusion && !caches_active);
+    // The model sees a fused pair as the two instructions it is
+    if (fused) {
+        timing.record(fused_first_raw, pc, pc + 4, pc + 4, false);
+        pc += 4;
+    }
+    // An unhandled trap or a halt leaves the hart where it was, the host decides what happens next
+    if (completed_instruction(status)) {
+        uint32_t next_pc = register_bank.get_pc();
+        bool trapped = status == CycleStatus::TRAPPED;
+        // Predicted at fetch and trained once resolved, a trap redirects whatever was predicted
+        uint32_t predicted_pc = trapped ? pc + 4 : branch_predictor.resolve(current_raw, pc, next_pc);
+        timing.record(current_raw, pc, next_pc, predicted_pc, trapped, fetch_latency, memory_latency);
+    }
+    return status;
+}
+
+CycleStatus Pipeline::execute_instruction(bool allow_fusion) {
+    uint32_t pc = register_bank.get_pc();
+
+    // --- Fetch and Decode, skipped when the instruction is in the predecode cache ---
+    uint32_t physical_pc = 0;
+    bool cacheable = mmu.translate_fetch(pc, physical_pc);
+    const CompactInstruction* cached = cacheable ? predecode_cache.lookup(physical_pc) : nullptr;
+    if (caches_active && cacheable) {
+        fetch_latency = caches.fetch(physical_pc);
+    }
+    if (cached == nullptr) {
+        fetch_stage.process();
+        if (fetch_stage.get_trap().raised) {
+            return take_trap(pc, fetch_stage.get_trap());
+        }
+        decode_stage.set_fetched_instruction(fetch_stage.get_fetched_instruction());
+        decode_stage.process();
+        cached = &decode_stage.get_instruction();
+        if (cached->op == Operation::ILLEGAL) {
+            current_raw = cached->raw;
+            return take_trap(pc, Trap{true, TrapCause::ILLEGAL_INSTRUCTION, cached->raw});
+        }
+        // Writes to the page have to reach the cache from now on
+        if (cacheable && predecode_cache.insert(physical_pc, *cached)) {
+            mmu.mark_code_page(physical_pc);
+        }
+    }
+    // A store overwriting this very instruction empties its cache slot, the stages after it work
+    // on this copy
+    const CompactInstruction inst = *cached;
+    current_raw = inst.raw;
 
-    // --- Decode Stage ---
-    decode_stage.set_fetched_instruction(instruction);
-    decode_stage.process();
-    // Retrieve the decoded instruction variant for the next stages.
-    auto decoded_inst = decode_stage.get_decoded_instruction();
+    // --- Fusion, the next instruction is only looked at when it is cached on the same page ---
+    if (allow_fusion && cacheable && may_start_fused_pair(inst.op) && ((pc + 4) & ~MMU::PAGE_MASK) != 0) {
+        const CompactInstruction* next = predecode_cache.peek(physical_pc + 4);
+        FusedPair pair = next != nullptr ? match_fused_pair(inst, *next) : FusedPair::NONE;
+        CycleStatus status;
+        if (pair != FusedPair::NONE && execute_fused_pair(pc, pair, inst, *next, status)) {
+            predecode_cache.record_hit();
+            return status;
+        }
+    }
 
     // --- Execute Stage ---
-    execute_stage.set_decoded_instruction(decoded_inst);
+    execute_stage.set_instruction(inst);
     execute_stage.process();
-    auto exec_result = execute_stage.get_result();
+    const auto& exec_result = execute_stage.get_result();
+    if (exec_result.trap.raised) {
+        return take_trap(pc, exec_result.trap);
+    }
+    if (exec_result.halt) {
+        return CycleStatus::HALTED;
+    }
+    if (inst.op == Operation::SYSTEM) {
+        return complete_system(pc, DecodedInstruction<InstructionFormat::SYSTEM>(inst.raw), exec_result.alu_result);
+    }
 
     // --- Memory Access Stage ---
     mem_acces_stage.set_execution_result(exec_result);
-    mem_acces_stage.set_decoded_instruction(decoded_inst);
+    mem_acces_stage.set_instruction(inst);
     mem_acces_stage.process();
-    auto mem_result = mem_acces_stage.get_result();
+    const auto& mem_result = mem_acces_stage.get_result();
+    if (mem_result.trap.raised) {
+        return take_trap(pc, mem_result.trap);
+    }
+    if (caches_active) {
+        access_data_cache(inst.op, exec_result.alu_result);
+    }
 
     // --- Write Back Stage ---
     write_back_stage.set_execution_result(exec_result);
     write_back_stage.set_memory_access_result(mem_result);
-    write_back_stage.set_decoded_instruction(decoded_inst);
+    write_back_stage.set_instruction(inst);
     write_back_stage.process();
+
+    if (exec_result.fence_i) {
+        flush_predecode_cache();
+    }
+
+    // The instruction retired, move to the next one
+    register_bank.set_pc(exec_result.branch_taken ? exec_result.branch_target : pc + 4);
+    return CycleStatus::RETIRED;
+}
+
+bool Pipeline::execute_fused_pair(uint32_t pc, FusedPair pair, const CompactInstruction& first,
+                                  const CompactInstruction& second, CycleStatus& status) {
+    uint32_t first_imm = static_cast<uint32_t>(first.imm);
+    uint32_t second_imm = static_cast<uint32_t>(second.imm);
+    uint32_t next_pc = pc + 8;
+    switch (pair) {
+        case FusedPair::LUI_ADDI:
+            register_bank.write(first.rd, first_imm + second_imm);
+            ++fusion_stats.lui_addi;
+            break;
+        case FusedPair::AUIPC_JALR: {
+            next_pc = (pc + first_imm + second_imm) & ~1u;
+            // The JALR traps on it, left to the unfused path
+            if (next_pc & 0x3) {
+                return false;
+            }
+            register_bank.write(first.rd, pc + first_imm);
+            if (second.rd != 0) {
+                register_bank.write(second.rd, pc + 8);
+            }
+            ++fusion_stats.auipc_jalr;
+            break;
+        }
+        case FusedPair::AUIPC_LW: {
+            // Devices are ticked once per retired instruction by the caller, a fused load would
+            // read a device one tick before the AUIPC is accounted. Loads of RAM and ROM only,
+            // devices and faults are left to the unfused path
+            uint32_t address = pc + first_imm + second_imm;
+            uint32_t physical_address = 0;
+            if (!mmu.translate_cacheable(address, AccessType::READ, physical_address)) {
+                return false;
+            }
+            register_bank.write(first.rd, pc + first_imm);
+            uint32_t value = 0;
+            MemoryStatus memory_status = mmu.try_read_word(address, value);
+            fused = true;
+            fused_first_raw = first.raw;
+            current_raw = second.raw;
+            if (memory_status != MemoryStatus::OK) {
+                // The AUIPC retired, the LW traps where it is
+                register_bank.set_pc(pc + 4);
+                status = take_trap(pc + 4, trap::from_memory_status(memory_status, AccessType::READ, address));
+                return true;
+            }
+            if (second.rd != 0) {
+                register_bank.write(second.rd, value);
+            }
+            ++fusion_stats.auipc_lw;
+            break;
+        }
+        case FusedPair::SLLI_SRLI:
+            register_bank.write(first.rd, register_bank.read(first.rs1) << first_imm >> second_imm);
+            ++fusion_stats.slli_srli;
+            break;
+        default:
+            return false;
+    }
+    fused = true;
+    fused_first_raw = first.raw;
+    current_raw = second.raw;
+    register_bank.set_pc(next_pc);
+    status = CycleStatus::RETIRED;
+    return true;
+}
+
+CycleStatus Pipeline::take_trap(uint32_t pc, const Trap& trap) {
+    last_trap = trap;
+    ++trap_count;
+    if (csrs.mtvec == 0) {
+        // Nobody to deliver the trap to, the state is left as it was so the host can inspect it
+        return CycleStatus::UNHANDLED_TRAP;
+    }
+
+    csrs.mepc = pc;
+    csrs.mcause = static_cast<uint32_t>(trap.cause);
+    csrs.mtval = trap.value;
+
+    // Save the interrupt enable and the previous privilege mode, then enter machine mode
+    uint32_t previous_mode = static_cast<uint32_t>(mmu.get_privilege_mode());
+    uint32_t mpie = (csrs.mstatus & CSRFile::MSTATUS_MIE) ? CSRFile::MSTATUS_MPIE : 0;
+    csrs.mstatus = (csrs.mstatus & ~(CSRFile::MSTATUS_MIE | CSRFile::MSTATUS_MPIE | CSRFile::MSTATUS_MPP))
+                   | mpie | (previous_mode << CSRFile::MSTATUS_MPP_SHIFT);
+    set_privilege_mode(PrivilegeMode::MACHINE);
+
+    // Synchronous exceptions always go to the base address, vectored mode only offsets interrupts
+    register_bank.set_pc(csrs.mtvec & ~0x3u);
+    return CycleStatus::TRAPPED;
+}
+
+CycleStatus Pipeline::complete_system(uint32_t pc, const DecodedInstruction<InstructionFormat::SYSTEM>& inst, uint32_t operand) {
+    using System = DecodedInstruction<InstructionFormat::SYSTEM>;
+    PrivilegeMode mode = mmu.get_privilege_mode();
+
+    if (inst.funct3 == 0x0) {
+        switch (inst.raw) {
+            case System::ECALL: {
+                TrapCause cause = mode == PrivilegeMode::USER       ? TrapCause::ECALL_FROM_USER
+                                : mode == PrivilegeMode::SUPERVISOR ? TrapCause::ECALL_FROM_SUPERVISOR
+                                                                    : TrapCause::ECALL_FROM_MACHINE;
+                return take_trap(pc, Trap{true, cause, 0});
+            }
+            case System::EBREAK:
+                return take_trap(pc, Trap{true, TrapCause::BREAKPOINT, pc});
+            case System::MRET: {
+                if (mode != PrivilegeMode::MACHINE) {
+                    break;
+                }
+                // Restore the interrupt enable and the privilege mode saved on trap entry
+                uint32_t previous_mode = (csrs.mstatus & CSRFile::MSTATUS_MPP) >> CSRFile::MSTATUS_MPP_SHIFT;
+                uint32_t mie = (csrs.mstatus & CSRFile::MSTATUS_MPIE) ? CSRFile::MSTATUS_MIE : 0;
+                csrs.mstatus = (csrs.mstatus & ~(CSRFile::MSTATUS_MIE | CSRFile::MSTATUS_MPP)) | mie | CSRFile::MSTATUS_MPIE;
+                set_privilege_mode(static_cast<PrivilegeMode>(previous_mode));
+                register_bank.set_pc(csrs.mepc);
+                return CycleStatus::RETIRED;
+            }
+            case System::WFI:
+                // No interrupts are modelled, waiting would never end
+                register_bank.set_pc(pc + 4);
+                return CycleStatus::RETIRED;
+            default:
+                // SFENCE.VMA, rs1 selects a single page when it is not x0
+                if ((inst.raw & 0xFE007FFF) == 0x12000073 && mode != PrivilegeMode::USER) {
+                    if (inst.rs1 != 0) {
+                        mmu.flush_tlb_page(register_bank.read(inst.rs1));
+                    } else {
+                        mmu.flush_tlb();
+                    }
+                    register_bank.set_pc(pc + 4);
+                    return CycleStatus::RETIRED;
+                }
+                break;
+        }
+        return take_trap(pc, Trap{true, TrapCause::ILLEGAL_INSTRUCTION, inst.raw});
+    }
+
+    // Zicsr: RW always writes and only reads when rd is not x0, RS/RC always read and only
+    // write when the operand register (or immediate) is not zero
+    uint32_t op = inst.funct3 & 0x3;
+    if (op == 0) {
+        return take_trap(pc, Trap{true, TrapCause::ILLEGAL_INSTRUCTION, inst.raw});
+    }
+    bool do_read = op != 1 || inst.rd != 0;
+    bool do_write = op == 1 || inst.rs1 != 0;
+    uint16_t address = static_cast<uint16_t>(inst.csr);
+
+    uint32_t old_value = 0;
+    if (do_read && !read_csr(address, mode, old_value)) {
+        return take_trap(pc, Trap{true, TrapCause::ILLEGAL_INSTRUCTION, inst.raw});
+    }
+    if (do_write) {
+        uint32_t new_value = op == 1 ? operand
+                           : op == 2 ? old_value | operand
+                                     : old_value & ~operand;
+        if (!write_csr(address, mode, new_value)) {
+            return take_trap(pc, Trap{true, TrapCause::ILLEGAL_INSTRUCTION, inst.raw});
+        }
+    }
+    if (inst.rd != 0) {
+        register_bank.write(inst.rd, old_value);
+    }
+    register_bank.set_pc(pc + 4);
+    return CycleStatus::RETIRED;
+}
+
+// satp belongs to the MMU, which flushes its TLB when it is written. The other CSRs are in csrs
+bool Pipeline::read_csr(uint16_t address, PrivilegeMode mode, uint32_t& value) const {
+    if (address != CSRFile::SATP) {
+        return csrs.read(address, mode, value);
+    }
+    if (!CSRFile::is_accessible(address, mode, false)) {
+        return false;
+    }
+    value = mmu.get_satp();
+    return true;
+}
+
+bool Pipeline::write_csr(uint16_t address, PrivilegeMode mode, uint32_t value) {
+    if (address != CSRFile::SATP) {
+        return csrs.write(address, mode, value);
+    }
+    if (!CSRFile::is_accessible(address, mode, true)) {
+        return false;
+    }
+    mmu.set_satp(value & CSRFile::SATP_WRITABLE);
+    return true;
+}
+
+void Pipeline::access_data_cache(Operation op, uint32_t address) {
+    // Atomics read and write the line, SC and the AMOs count as writes
+    bool read = (op >= Operation::LB && op <= Operation::LHU) || op == Operation::LR_W;
+    bool write = (op >= Operation::SB && op <= Operation::SW) || (is_atomic(op) && op != Operation::LR_W);
+    uint32_t physical_address = 0;
+    if ((read || write) && mmu.translate_cacheable(address, write ? AccessType::WRITE : AccessType::READ, physical_address)) {
+        memory_latency = write ? caches.write(physical_address) : caches.read(physical_address);
+    }
+}
+
+void Pipeline::set_privilege_mode(PrivilegeMode mode) {
+    // Changing mode flushes the TLB, traps taken and returned within machine mode keep it warm
+    if (mmu.get_privilege_mode() != mode) {
+        mmu.set_privilege_mode(mode);
+    }
+}
+
+bool Pipeline::fused_last_cycle() const {
+    return fused;
+}
+
+CSRFile& Pipeline::get_csrs() {
+    return csrs;
+}
+
+const CSRFile& Pipeline::get_csrs() const {
+    return csrs;
+}
+
+const Trap& Pipeline::get_last_trap() const {
+    return last_trap;
+}
+
+uint64_t Pipeline::get_trap_count() const {
+    return trap_count;
+}
+
+void Pipeline::clear_reservation() {
+    mem_acces_stage.clear_reservation();
+}
+
+void Pipeline::flush_predecode_cache() {
+    // Code marks stay, other decoded code caches may still rely on them
+    predecode_cache.flush();
+}
+
+void Pipeline::invalidate_written_code(const PhysicalMemory& memory) {
+    for (uint32_t page : predecode_cache.get_pages()) {
+        if (memory.is_dirty(page)) {
+            predecode_cache.invalidate_page(page);
+        }
+    }
+}
+
+const PredecodeStats& Pipeline::get_predecode_stats() const {
+    return predecode_cache.get_stats();
+}
+
+void Pipeline::reset_predecode_stats() {
+    predecode_cache.reset_stats();
+}
+
+void Pipeline::set_fusion_enabled(bool enabled) {
+    fusion_enabled = enabled;
+}
+
+bool Pipeline::is_fusion_enabled() const {
+    return fusion_enabled;
+}
+
+const FusionStats& Pipeline::get_fusion_stats() const {
+    return fusion_stats;
+}
+
+void Pipeline::reset_fusion_stats() {
+    fusion_stats = FusionStats{};
+}
+
+void Pipeline::set_timing_enabled(bool enabled) {
+    if (enabled && !timing_enabled) {
+        timing.reset();
+    }
+    timing_enabled = enabled;
+    caches_active = timing_enabled && cache_enabled;
+}
+
+bool Pipeline::is_timing_enabled() const {
+    return timing_enabled;
+}
+
+TimingModel& Pipeline::get_timing() {
+    return timing;
+}
+
+const TimingModel& Pipeline::get_timing() const {
+    return timing;
+}
+
+void Pipeline::set_cache_enabled(bool enabled) {
+    if (enabled && !cache_enabled) {
+        caches.invalidate();
+        caches.reset_stats();
+    }
+    cache_enabled = enabled;
+    caches_active = timing_enabled && cache_enabled;
+}
+
+bool Pipeline::is_cache_enabled() const {
+    return cache_enabled;
+}
+
+CacheHierarchy& Pipeline::get_caches() {
+    return caches;
+}
+
+const CacheHierarchy& Pipeline::get_caches() const {
+    return caches;
+}
+
+BranchPredictionUnit& Pipeline::get_branch_predictor() {
+    return branch_predictor;
+}
+
+const BranchPredictionUnit& Pipeline::get_branch_predictor() const {
+    return branch_predictor;
 }
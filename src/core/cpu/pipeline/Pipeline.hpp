@@ -1,24 +1,128 @@
 #pragma once
+#include <cstdint>
 #include "core/cpu/register_bank/RegisterBank.hpp"
+#include "core/cpu/state/CSRFile.hpp"
+#include "core/cpu/state/Trap.hpp"
 #include "core/memory/MMU.hpp"
 #include "decode/DecodeStage.hpp"
+#include "decode/MacroFusion.hpp"
+#include "decode/PredecodeCache.hpp"
+#include "fetch/BranchPredictionUnit.hpp"
 #include "fetch/FetchStage.hpp"
 #include "execute/ExecuteStage.hpp"
 #include "memory_access/MemoryAccessStage.hpp"
 #include "write_back/WriteBackStage.hpp"
+#include "timing/CacheHierarchy.hpp"
+#include "timing/TimingModel.hpp"
 
+// Outcome of one pipeline cycle
+enum class CycleStatus {
+    RETIRED = 0,        // the instruction completed and the PC moved to the next one
+    TRAPPED = 1,        // the instruction trapped, the PC is at the trap handler
+    UNHANDLED_TRAP = 2, // the instruction trapped with no handler installed (mtvec is 0), nothing changed
+    HALTED = 3          // the instruction jumps to itself, the program ended and nothing changed
+};
+
+// The instruction was executed: it either retired or trapped into the handler
+inline bool completed_instruction(CycleStatus status) {
+    return status == CycleStatus::RETIRED || status == CycleStatus::TRAPPED;
+}
+
+// Runs one instruction at a time through the stages. Faults come back from the stages as Trap
+// values and are taken here without unwinding: mepc/mcause/mtval are written, the hart moves to
+// machine mode and jumps to mtvec. MRET returns to mepc in the mode saved in mstatus.MPP
+//
+// Decoded instructions are kept in a predecode cache keyed by physical address. When the PC
+// translates through the execute TLB and its instruction is cached, fetch and decode are skipped.
+// Stores to cached code drop the instructions they overwrite, FENCE.I drops everything
+//
+// When the caller allows it, an instruction starting one of the idioms of MacroFusion.hpp whose
+// successor on the same page is cached and completes it runs together with it in one cycle.
+// Either both retire or, when the load of AUIPC+LW faults, the AUIPC retires and the trap is
+// taken at the LW, as if they had run one at a time. AUIPC+LW is only fused for loads of RAM and
+// ROM, a device read has to see the tick of the AUIPC first. A branch into the second
+// instruction finds it on its own, fusion only starts at the first one
+//
+// With timing on, every instruction that goes through is also handed to the TimingModel, which
+// works out the cycles it would take on an overlapped 5-stage core. With the cache model on as
+// well, the physical address of each fetch and of each load or store of RAM goes through the
+// CacheHierarchy, whose latency the TimingModel adds to IF and MEM. Pairs are not fused then, the
+// caches see every access in program order. The next PC fetch would have gone to comes from the
+// BranchPredictionUnit, trained on each branch and jump as it resolves
 class Pipeline {
 private:
     RegisterBank& register_bank;
     MMU& mmu;
+    CSRFile csrs;
+    Trap last_trap;
+    uint64_t trap_count;
+    PredecodeCache predecode_cache;
+    TimingModel timing;
+    bool timing_enabled;
+    CacheHierarchy caches;
+    bool cache_enabled;
+    bool caches_active;       // timing and cache model both on
+    BranchPredictionUnit branch_predictor;
+    uint32_t fetch_latency;   // latencies of the instruction in flight, for the timing model
+    uint32_t memory_latency;
+    uint32_t current_raw; // encoding of the instruction in flight, kept for the timing model
+    bool fusion_enabled;
+    bool fused;               // the last cycle retired the first instruction of a fused pair
+    uint32_t fused_first_raw; // its encoding, current_raw is the second one
+    FusionStats fusion_stats;
 
     FetchStage fetch_stage;
     DecodeStage decode_stage;
     ExecuteStage execute_stage;
     MemoryAccessStage mem_acces_stage;
     WriteBackStage write_back_stage;
+
+    CycleStatus execute_instruction(bool allow_fusion);
+    bool execute_fused_pair(uint32_t pc, FusedPair pair, const CompactInstruction& first,
+                            const CompactInstruction& second, CycleStatus& status);
+    CycleStatus take_trap(uint32_t pc, const Trap& trap);
+    CycleStatus complete_system(uint32_t pc, const DecodedInstruction<InstructionFormat::SYSTEM>& inst, uint32_t operand);
+    bool read_csr(uint16_t address, PrivilegeMode mode, uint32_t& value) const;
+    bool write_csr(uint16_t address, PrivilegeMode mode, uint32_t value);
+    void set_privilege_mode(PrivilegeMode mode);
+    void access_data_cache(Operation op, uint32_t address);
 public:
     Pipeline(RegisterBank& register_bank, MMU& mmu);
+    ~Pipeline();
+    Pipeline(const Pipeline&) = delete;            // the MMU points at the predecode cache
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    // With allow_fusion the cycle may run a fused pair, the caller must then be fine with two
+    // instructions completing and the PC never stopping between them
+    CycleStatus run_cycle(bool allow_fusion = false);
+    bool fused_last_cycle() const;       // the first instruction of a pair retired before the status
+
+    CSRFile& get_csrs();
+    const CSRFile& get_csrs() const;
+    const Trap& get_last_trap() const;   // last trap raised, handled or not
+    uint64_t get_trap_count() const;     // traps raised since construction
+    void clear_reservation();            // the next SC.W fails
+
+    void flush_predecode_cache();                                  // drops every decoded instruction
+    void invalidate_written_code(const PhysicalMemory& memory);    // drops the cached pages memory reports dirty
+    const PredecodeStats& get_predecode_stats() const;
+    void reset_predecode_stats();
+
+    void set_fusion_enabled(bool enabled);                         // on by default, run_cycle still needs allow_fusion
+    bool is_fusion_enabled() const;
+    const FusionStats& get_fusion_stats() const;
+    void reset_fusion_stats();
+
+    void set_timing_enabled(bool enabled);                         // off by default, turning it on starts from an empty pipeline
+    bool is_timing_enabled() const;
+    TimingModel& get_timing();
+    const TimingModel& get_timing() const;
+
+    void set_cache_enabled(bool enabled);                          // off by default, only used with timing on, turning it on starts from cold caches
+    bool is_cache_enabled() const;
+    CacheHierarchy& get_caches();
+    const CacheHierarchy& get_caches() const;
 
-    void run_cycle();
+    BranchPredictionUnit& get_branch_predictor();                  // only used with timing on, STATIC (not taken) by default
+    const BranchPredictionUnit& get_branch_predictor() const;
 };
@@ -1,46 +1,59 @@
 #include "DecodeStage.hpp"
-#include <stdexcept>
 #include <cstdint>
 
 // Constructor
 DecodeStage::DecodeStage(RegisterBank& register_bank)
-    : fetched_instruction(0), register_bank(register_bank), decoded_instruction(DecodedInstruction<InstructionFormat::INIVALID_TYPE>(0)){}
+    : fetched_instruction(0), register_bank(register_bank){}
 
 // Process the fetched instruction and decode it
 void DecodeStage::process() {
+    instruction = decode_compact(fetched_instruction);
+}
+
+// Get the decoded instruction (This is the output)
+const CompactInstruction& DecodeStage::get_instruction() const {
+    return instruction;
+}
+
+DecodedInstructionVariant DecodeStage::get_decoded_instruction() const {
     // Extract the opcode from the fetched instruction
     uint32_t opcode = DecodedInstructionBase(fetched_instruction).get_opcode();
 
-    InstructionFormat format = static_cast<InstructionFormat>(opcode);
     // Decode the instruction based on the opcode
     using enum InstructionFormat;
 
-    switch (format) {
-        case R_TYPE:
+    DecodedInstructionVariant decoded_instruction = DecodedInstruction<INIVALID_TYPE>(fetched_instruction);
+    switch (opcode) {
+        case opcodes::OP:
+        case opcodes::AMO:
             decoded_instruction = DecodedInstruction<R_TYPE>(fetched_instruction);
             break;
-        case I_TYPE:
+        case opcodes::OP_IMM:
+        case opcodes::LOAD:
+        case opcodes::JALR:
+        case opcodes::MISC_MEM:
             decoded_instruction = DecodedInstruction<I_TYPE>(fetched_instruction);
             break;
-        case S_TYPE:
+        case opcodes::STORE:
             decoded_instruction = DecodedInstruction<S_TYPE>(fetched_instruction);
             break;
-        case B_TYPE:
+        case opcodes::BRANCH:
             decoded_instruction = DecodedInstruction<B_TYPE>(fetched_instruction);
             break;
-        case U_TYPE:
+        case opcodes::LUI:
+        case opcodes::AUIPC:
             decoded_instruction = DecodedInstruction<U_TYPE>(fetched_instruction);
             break;
-        case J_TYPE:
+        case opcodes::JAL:
             decoded_instruction = DecodedInstruction<J_TYPE>(fetched_instruction);
             break;
+        case opcodes::SYSTEM:
+            decoded_instruction = DecodedInstruction<SYSTEM>(fetched_instruction);
+            break;
         default:
-            throw std::invalid_argument("Unsupported instruction format");
+            // Unknown opcodes decode to the invalid format
+            break;
     }
-}
-
-// Get the decoded instruction (This is the output)
-const DecodedInstructionVariant& DecodeStage::get_decoded_instruction() const {
     return decoded_instruction;
 }
 
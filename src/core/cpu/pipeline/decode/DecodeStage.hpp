@@ -3,20 +3,24 @@
 #include <variant>
 #include "core/cpu/pipeline/PipelineStage.hpp"
 #include "core/cpu/register_bank/RegisterBank.hpp"
+#include "core/cpu/isa/CompactInstruction.hpp"
 #include "core/cpu/isa/Instruction.hpp"
 
 class DecodeStage : public PipelineStage {
 private:
     uint32_t fetched_instruction;                   // Instruction fetched in FetchStage
     RegisterBank& register_bank;                    // Reference to the register bank
-    DecodedInstructionVariant decoded_instruction;  // Decoded instruction
+    CompactInstruction instruction;                 // Decoded instruction
 
 public:
     DecodeStage(RegisterBank& register_bank);
 
     void process() override;
 
-    const DecodedInstructionVariant& get_decoded_instruction() const;
+    const CompactInstruction& get_instruction() const;
+
+    // The fetched instruction in the per-format form, built on request for inspection
+    DecodedInstructionVariant get_decoded_instruction() const;
 
     void set_fetched_instruction(uint32_t fetched_instruction);
 };
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include "core/cpu/isa/CompactInstruction.hpp"
+
+// Pairs of adjacent instructions the pipeline executes as one operation. Each is a fixed idiom
+// compilers emit, the second instruction consumes the register the first one writes:
+//   LUI rd, hi   + ADDI rd, rd, lo   a 32 bit constant
+//   AUIPC rd, hi + JALR rd2, lo(rd)  a call or jump further than JAL reaches
+//   AUIPC rd, hi + LW rd2, lo(rd)    a load of a PC-relative global
+//   SLLI rd, rs, a + SRLI rd, rd, b  a zero extension or a bit field extraction
+enum class FusedPair : uint8_t {
+    NONE,
+    LUI_ADDI,
+    AUIPC_JALR,
+    AUIPC_LW,
+    SLLI_SRLI
+};
+
+// Counters of the fused pairs, each pair is two retired instructions
+struct FusionStats {
+    uint64_t lui_addi = 0;
+    uint64_t auipc_jalr = 0;
+    uint64_t auipc_lw = 0;
+    uint64_t slli_srli = 0;
+
+    uint64_t total() const {
+        return lui_addi + auipc_jalr + auipc_lw + slli_srli;
+    }
+};
+
+// Whether the first instruction can start a pair, checked before the next slot is looked at
+constexpr bool may_start_fused_pair(Operation op) {
+    return op == Operation::LUI || op == Operation::AUIPC || op == Operation::SLLI;
+}
+
+// The pair two adjacent decoded instructions form, NONE when they do not fuse. A first
+// instruction writing x0 never fuses, its result is not what the second one reads
+inline FusedPair match_fused_pair(const CompactInstruction& first, const CompactInstruction& second) {
+    if (first.rd == 0 || second.rs1 != first.rd) {
+        return FusedPair::NONE;
+    }
+    switch (first.op) {
+        case Operation::LUI:
+            return second.op == Operation::ADDI && second.rd == first.rd ? FusedPair::LUI_ADDI : FusedPair::NONE;
+        case Operation::AUIPC:
+            return second.op == Operation::JALR ? FusedPair::AUIPC_JALR
+                 : second.op == Operation::LW   ? FusedPair::AUIPC_LW
+                                                : FusedPair::NONE;
+        case Operation::SLLI:
+            return second.op == Operation::SRLI && second.rd == first.rd ? FusedPair::SLLI_SRLI : FusedPair::NONE;
+        default:
+            return FusedPair::NONE;
+    }
+}
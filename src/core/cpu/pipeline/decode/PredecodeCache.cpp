@@ -0,0 +1,116 @@
+#include "PredecodeCache.hpp"
+
+namespace {
+
+constexpr uint32_t INVALID_PAGE = 0xFFFFFFFF; // page numbers are 20 bits wide
+
+} // namespace
+
+PredecodeCache::PredecodeCache()
+    : last_page_number(INVALID_PAGE), last_page(nullptr) {}
+
+PredecodeCache::Page* PredecodeCache::find_page(uint32_t page_number) {
+    if (page_number == last_page_number) {
+        return last_page;
+    }
+    auto it = pages.find(page_number);
+    if (it == pages.end()) {
+        return nullptr;
+    }
+    last_page_number = page_number;
+    last_page = it->second.get();
+    return last_page;
+}
+
+const CompactInstruction* PredecodeCache::lookup(uint32_t physical_address) {
+    Page* page = find_page(physical_address >> MMU::PAGE_SHIFT);
+    uint32_t index = (physical_address & ~MMU::PAGE_MASK) >> 2;
+    if (page != nullptr && page->valid[index]) {
+        ++stats.hits;
+        return &page->slots[index];
+    }
+    ++stats.misses;
+    return nullptr;
+}
+
+const CompactInstruction* PredecodeCache::peek(uint32_t physical_address) {
+    Page* page = find_page(physical_address >> MMU::PAGE_SHIFT);
+    uint32_t index = (physical_address & ~MMU::PAGE_MASK) >> 2;
+    return page != nullptr && page->valid[index] ? &page->slots[index] : nullptr;
+}
+
+void PredecodeCache::record_hit() {
+    ++stats.hits;
+}
+
+bool PredecodeCache::insert(uint32_t physical_address, const CompactInstruction& instruction) {
+    uint32_t page_number = physical_address >> MMU::PAGE_SHIFT;
+    Page* page = find_page(page_number);
+    if (page == nullptr) {
+        auto& owned = pages[page_number];
+        owned = std::make_unique<Page>();
+        page = owned.get();
+        last_page_number = page_number;
+        last_page = page;
+    }
+    bool first_instruction = page->valid.none();
+    uint32_t index = (physical_address & ~MMU::PAGE_MASK) >> 2;
+    page->slots[index] = instruction;
+    page->valid[index] = true;
+    return first_instruction;
+}
+
+void PredecodeCache::invalidate(uint32_t physical_address, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    // Every word slot overlapping [physical_address, physical_address + size)
+    uint64_t first = physical_address >> 2;
+    uint64_t last = (static_cast<uint64_t>(physical_address) + size - 1) >> 2;
+    for (uint64_t word = first; word <= last; ++word) {
+        Page* page = find_page(static_cast<uint32_t>(word / SLOTS_PER_PAGE));
+        if (page == nullptr) {
+            // Skip to the next page
+            word = (word / SLOTS_PER_PAGE + 1) * SLOTS_PER_PAGE - 1;
+            continue;
+        }
+        if (page->valid[word % SLOTS_PER_PAGE]) {
+            page->valid[word % SLOTS_PER_PAGE] = false;
+            ++stats.invalidations;
+        }
+    }
+}
+
+void PredecodeCache::invalidate_page(uint32_t physical_address) {
+    invalidate(physical_address & MMU::PAGE_MASK, MMU::PAGE_SIZE);
+}
+
+void PredecodeCache::flush() {
+    for (auto& [page_number, page] : pages) {
+        page->valid.reset();
+    }
+    ++stats.flushes;
+}
+
+std::vector<uint32_t> PredecodeCache::get_pages() const {
+    std::vector<uint32_t> addresses;
+    addresses.reserve(pages.size());
+    for (const auto& [page_number, page] : pages) {
+        if (page->valid.any()) {
+            addresses.push_back(page_number << MMU::PAGE_SHIFT);
+        }
+    }
+    return addresses;
+}
+
+void PredecodeCache::on_code_write(uint32_t physical_address, size_t size) {
+    invalidate(physical_address, size);
+}
+
+const PredecodeStats& PredecodeCache::get_stats() const {
+    return stats;
+}
+
+void PredecodeCache::reset_stats() {
+    stats = PredecodeStats{};
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "core/cpu/isa/CompactInstruction.hpp"
+#include "core/memory/MMU.hpp"
+
+// Counters of the predecode cache
+struct PredecodeStats {
+    uint64_t hits = 0;          // instructions executed from the cache
+    uint64_t misses = 0;        // instructions fetched and decoded
+    uint64_t invalidations = 0; // cached instructions dropped because their bytes were written
+    uint64_t flushes = 0;       // whole cache flushes (FENCE.I, snapshot restore, program load)
+
+    double hit_rate() const {
+        uint64_t lookups = hits + misses;
+        return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+    }
+};
+
+// Decoded instructions keyed by physical address, so every virtual alias of a page shares them
+// and a page table change does not lose them. A page holds one slot per instruction word and a
+// bit per slot telling whether it is valid. Illegal instructions are never cached, they trap anyway.
+// Flushing only clears the valid bits, pages stay allocated for the code that runs next.
+//
+// Pages are created the first time one of their instructions is decoded. The pipeline marks
+// them as code in the MMU, which then reports every write to them through on_code_write so the
+// slots whose bytes change are dropped (self modifying code).
+class PredecodeCache : public CodeWriteListener {
+public:
+    static constexpr uint32_t SLOTS_PER_PAGE = MMU::PAGE_SIZE / sizeof(uint32_t);
+
+private:
+    struct Page {
+        CompactInstruction slots[SLOTS_PER_PAGE];
+        std::bitset<SLOTS_PER_PAGE> valid;
+    };
+
+    std::unordered_map<uint32_t, std::unique_ptr<Page>> pages; // by physical page number
+    uint32_t last_page_number;                                 // lookups stay in one page most of the time
+    Page* last_page;
+    PredecodeStats stats;
+
+    Page* find_page(uint32_t page_number);
+
+public:
+    PredecodeCache();
+
+    // Returns the cached instruction at a physical address, nullptr on a miss
+    const CompactInstruction* lookup(uint32_t physical_address);
+
+    // Like lookup but counts nothing, for the pipeline looking one instruction ahead. It calls
+    // record_hit once it executes the instruction
+    const CompactInstruction* peek(uint32_t physical_address);
+    void record_hit();
+
+    // Caches a decoded instruction, returns true if its page held no cached instruction before
+    bool insert(uint32_t physical_address, const CompactInstruction& instruction);
+
+    // Drops the instructions overlapping a written range
+    void invalidate(uint32_t physical_address, size_t size);
+
+    // Drops every instruction of a page
+    void invalidate_page(uint32_t physical_address);
+
+    // Drops everything
+    void flush();
+
+    // Physical base addresses of the pages with cached instructions
+    std::vector<uint32_t> get_pages() const;
+
+    void on_code_write(uint32_t physical_address, size_t size) override;
+
+    const PredecodeStats& get_stats() const;
+    void reset_stats();
+};
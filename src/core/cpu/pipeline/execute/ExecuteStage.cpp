@@ -1,135 +1,204 @@
 #include "ExecuteStage.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <stdexcept>
 #include <variant>
+#include "core/cpu/isa/MultiplyDivide.hpp"
 #include "utils/plt.hpp"
 
+namespace {
+
+// Operands of a handler, rs1 and rs2 are read whether the operation uses them or not
+struct Operands {
+    uint32_t rs1;
+    uint32_t rs2;
+    uint32_t pc;  // control transfers are relative to the address of the instruction itself
+};
+
+using Handler = void (*)(const CompactInstruction& inst, const Operands& in, ExecutionResult& out);
+
+void raise_illegal_instruction(const CompactInstruction& inst, const Operands&, ExecutionResult& out) {
+    out.trap = Trap{true, TrapCause::ILLEGAL_INSTRUCTION, inst.raw};
+}
+
+// Takes the jump, traps if the target is misaligned
+void set_jump_target(ExecutionResult& out, uint32_t target) {
+    out.branch_taken = true;
+    out.branch_target = target;
+    // Without the C extension every instruction is 4 byte aligned
+    if (target & 0x3) {
+        out.trap = Trap{true, TrapCause::INSTRUCTION_ADDRESS_MISALIGNED, target};
+    }
+}
+
+void execute_lui(const CompactInstruction& inst, const Operands&, ExecutionResult& out) {
+    out.alu_result = static_cast<uint32_t>(inst.imm);
+}
+
+void execute_auipc(const CompactInstruction& inst, const Operands& in, ExecutionResult& out) {
+    out.alu_result = in.pc + static_cast<uint32_t>(inst.imm);
+}
+
+void execute_jal(const CompactInstruction& inst, const Operands& in, ExecutionResult& out) {
+    // JAL links the address of the next instruction
+    out.alu_result = in.pc + 4;
+    set_jump_target(out, in.pc + static_cast<uint32_t>(inst.imm));
+
+    // A jump to self never leaves, it is how programs end: flag it for the host to stop
+    out.halt = out.branch_target == in.pc;
+}
+
+void execute_jalr(const CompactInstruction& inst, const Operands& in, ExecutionResult& out) {
+    out.alu_result = in.pc + 4;
+    set_jump_target(out, (in.rs1 + static_cast<uint32_t>(inst.imm)) & ~1u);
+}
+
+template <bool (*Condition)(uint32_t, uint32_t)>
+void execute_branch(const CompactInstruction& inst, const Operands& in, ExecutionResult& out) {
+    if (Condition(in.rs1, in.rs2)) {
+        set_jump_target(out, in.pc + static_cast<uint32_t>(inst.imm));
+    }
+}
+
+bool equal(uint32_t a, uint32_t b) { return a == b; }
+bool not_equal(uint32_t a, uint32_t b) { return a != b; }
+bool less(uint32_t a, uint32_t b) { return static_cast<int32_t>(a) < static_cast<int32_t>(b); }
+bool greater_equal(uint32_t a, uint32_t b) { return static_cast<int32_t>(a) >= static_cast<int32_t>(b); }
+bool less_unsigned(uint32_t a, uint32_t b) { return a < b; }
+bool greater_equal_unsigned(uint32_t a, uint32_t b) { return a >= b; }
+
+// Loads and stores compute the address, the memory access stage reads or writes it
+void execute_address(const CompactInstruction& inst, const Operands& in, ExecutionResult& out) {
+    out.alu_result = in.rs1 + static_cast<uint32_t>(inst.imm);
+}
+
+// Register-immediate operations, the immediate of the shifts is the shift amount
+template <uint32_t (*Function)(uint32_t, uint32_t)>
+void execute_immediate(const CompactInstruction& inst, const Operands& in, ExecutionResult& out) {
+    out.alu_result = Function(in.rs1, static_cast<uint32_t>(inst.imm));
+}
+
+// Register-register operations
+template <uint32_t (*Function)(uint32_t, uint32_t)>
+void execute_register(const CompactInstruction&, const Operands& in, ExecutionResult& out) {
+    out.alu_result = Function(in.rs1, in.rs2);
+}
+
+uint32_t add(uint32_t a, uint32_t b) { return a + b; }
+uint32_t sub(uint32_t a, uint32_t b) { return a - b; }
+uint32_t sll(uint32_t a, uint32_t b) { return a << (b & 0x1F); }
+uint32_t slt(uint32_t a, uint32_t b) { return static_cast<int32_t>(a) < static_cast<int32_t>(b) ? 1 : 0; }
+uint32_t sltu(uint32_t a, uint32_t b) { return a < b ? 1 : 0; }
+uint32_t bitwise_xor(uint32_t a, uint32_t b) { return a ^ b; }
+uint32_t srl(uint32_t a, uint32_t b) { return a >> (b & 0x1F); }
+uint32_t sra(uint32_t a, uint32_t b) { return static_cast<uint32_t>(static_cast<int32_t>(a) >> (b & 0x1F)); }
+uint32_t bitwise_or(uint32_t a, uint32_t b) { return a | b; }
+uint32_t bitwise_and(uint32_t a, uint32_t b) { return a & b; }
+
+void execute_fence(const CompactInstruction&, const Operands&, ExecutionResult&) {
+    // FENCE orders memory between harts, other harts may run on other host threads
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+// LR, SC and the AMOs address memory with rs1 alone, the memory access stage does the rest
+void execute_atomic(const CompactInstruction&, const Operands& in, ExecutionResult& out) {
+    out.alu_result = in.rs1;
+}
+
+void execute_fence_i(const CompactInstruction&, const Operands&, ExecutionResult& out) {
+    // FENCE.I makes earlier stores visible to instruction fetch, the pipeline flushes its decoded instructions
+    out.fence_i = true;
+}
+
+void execute_system(const CompactInstruction& inst, const Operands& in, ExecutionResult& out) {
+    // The pipeline completes SYSTEM instructions since they touch privileged state. The operand
+    // of the CSR instructions is rs1, or the zero extended rs1 field for the immediate forms
+    out.alu_result = (inst.raw >> 12 & 0x4) ? inst.rs1 : in.rs1;
+}
+
+constexpr size_t OPERATIONS = static_cast<size_t>(Operation::COUNT);
+
+// Indexed by Operation, each entry is assigned to its operation by name
+constexpr std::array<Handler, OPERATIONS> HANDLERS = [] {
+    std::array<Handler, OPERATIONS> handlers{};
+    auto set = [&](Operation op, Handler handler) { handlers[static_cast<size_t>(op)] = handler; };
+    auto set_range = [&](Operation first, Operation last, Handler handler) {
+        for (size_t op = static_cast<size_t>(first); op <= static_cast<size_t>(last); ++op) {
+            handlers[op] = handler;
+        }
+    };
+    set(Operation::ILLEGAL, raise_illegal_instruction);
+    set(Operation::LUI, execute_lui);
+    set(Operation::AUIPC, execute_auipc);
+    set(Operation::JAL, execute_jal);
+    set(Operation::JALR, execute_jalr);
+    set(Operation::BEQ, execute_branch<equal>);
+    set(Operation::BNE, execute_branch<not_equal>);
+    set(Operation::BLT, execute_branch<less>);
+    set(Operation::BGE, execute_branch<greater_equal>);
+    set(Operation::BLTU, execute_branch<less_unsigned>);
+    set(Operation::BGEU, execute_branch<greater_equal_unsigned>);
+    set_range(Operation::LB, Operation::LHU, execute_address);
+    set_range(Operation::SB, Operation::SW, execute_address);
+    set(Operation::ADDI, execute_immediate<add>);
+    set(Operation::SLTI, execute_immediate<slt>);
+    set(Operation::SLTIU, execute_immediate<sltu>);
+    set(Operation::XORI, execute_immediate<bitwise_xor>);
+    set(Operation::ORI, execute_immediate<bitwise_or>);
+    set(Operation::ANDI, execute_immediate<bitwise_and>);
+    set(Operation::SLLI, execute_immediate<sll>);
+    set(Operation::SRLI, execute_immediate<srl>);
+    set(Operation::SRAI, execute_immediate<sra>);
+    set(Operation::ADD, execute_register<add>);
+    set(Operation::SUB, execute_register<sub>);
+    set(Operation::SLL, execute_register<sll>);
+    set(Operation::SLT, execute_register<slt>);
+    set(Operation::SLTU, execute_register<sltu>);
+    set(Operation::XOR, execute_register<bitwise_xor>);
+    set(Operation::SRL, execute_register<srl>);
+    set(Operation::SRA, execute_register<sra>);
+    set(Operation::OR, execute_register<bitwise_or>);
+    set(Operation::AND, execute_register<bitwise_and>);
+    set(Operation::MUL, execute_register<m_extension::mul>);
+    set(Operation::MULH, execute_register<m_extension::mulh>);
+    set(Operation::MULHSU, execute_register<m_extension::mulhsu>);
+    set(Operation::MULHU, execute_register<m_extension::mulhu>);
+    set(Operation::DIV, execute_register<m_extension::div>);
+    set(Operation::DIVU, execute_register<m_extension::divu>);
+    set(Operation::REM, execute_register<m_extension::rem>);
+    set(Operation::REMU, execute_register<m_extension::remu>);
+    set(Operation::FENCE, execute_fence);
+    set(Operation::FENCE_I, execute_fence_i);
+    set_range(Operation::LR_W, Operation::AMOMAXU_W, execute_atomic);
+    set(Operation::SYSTEM, execute_system);
+    return handlers;
+}();
+
+constexpr bool every_operation_has_a_handler() {
+    for (Handler handler : HANDLERS) {
+        if (handler == nullptr) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(every_operation_has_a_handler(), "an Operation has no entry in HANDLERS");
+
+} // namespace
+
 // Constructor
 ExecuteStage::ExecuteStage(RegisterBank& register_bank)
-    : register_bank(register_bank), decoded_instruction(DecodedInstruction<InstructionFormat::INIVALID_TYPE>(0)), rs1_value(0), rs2_value(0), immediate(0) {}
+    : register_bank(register_bank), has_instruction(false) {}
 
 // Process the instruction
 void ExecuteStage::process() {
-    if (!decoded_instruction.index()) { // Check if the variant is not initialized
+    if (!has_instruction) {
         throw std::runtime_error("Decoded instruction is not set for execution");
     }
-
-    std::visit(
-        [this](auto& instruction) {
-            using T = std::decay_t<decltype(instruction)>;
-
-            // Handle R-Type Instructions
-            if constexpr (T::format == InstructionFormat::R_TYPE) {
-                rs1_value = register_bank.read(instruction.rs1);
-                rs2_value = register_bank.read(instruction.rs2);
-
-                switch (instruction.funct3) {
-                    case 0x0: // ADD or SUB
-                        result.alu_result = (instruction.funct7 == 0x20)
-                                                ? rs1_value - rs2_value  // SUB
-                                                : rs1_value + rs2_value; // ADD
-                        break;
-                    default:
-                        throw std::invalid_argument("Unsupported R-Type funct3");
-                }
-            }
-
-            // Handle I-Type Instructions
-            else if constexpr (T::format == InstructionFormat::I_TYPE) {
-                rs1_value = register_bank.read(instruction.rs1);
-                immediate = instruction.get_immediate();
-
-                switch (instruction.funct3) {
-                    case 0x0: // ADDI
-                        result.alu_result = rs1_value + immediate;
-                        break;
-                    case 0x2: // SLTI: Set less than (signed)
-                        result.alu_result = (static_cast<int32_t>(rs1_value) < immediate) ? 1 : 0;
-                        break;
-                    case 0x3: // SLTIU: Set less than (unsigned)
-                        result.alu_result = (rs1_value < static_cast<uint32_t>(immediate)) ? 1 : 0;
-                        break;
-                    case 0x4: // XORI
-                        result.alu_result = rs1_value ^ immediate;
-                        break;
-                    case 0x6: // ORI
-                        result.alu_result = rs1_value | immediate;
-                        break;
-                    case 0x7: // ANDI
-                        result.alu_result = rs1_value & immediate;
-                        break;
-                    case 0x1: { // SLLI (Shift Left Logical Immediate)
-                        // For SLLI, the lower 5 bits of the immediate specify the shift amount.
-                        uint32_t shamt = immediate & 0x1F;
-                        result.alu_result = rs1_value << shamt;
-                        break;
-                    }
-                    case 0x5: { // Either SRLI (logical shift right)
-                        uint32_t shamt = immediate & 0x1F;
-                        // Determine shift type based on funct7 field (which is part of the instruction encoding)
-                        result.alu_result = rs1_value >> shamt;
-                        break;
-                    }
-                    default:
-                        throw std::invalid_argument("Unsupported I-Type funct3");
-                }
-            }
-
-            // Handle B-Type Instructions
-            else if constexpr (T::format == InstructionFormat::B_TYPE) {
-                rs1_value = register_bank.read(instruction.rs1);
-                rs2_value = register_bank.read(instruction.rs2);
-                immediate = instruction.get_immediate();
-
-                switch (instruction.funct3) {
-                    case 0x0: // BEQ
-                        result.branch_taken = (rs1_value == rs2_value);
-                        result.branch_target = result.branch_taken ? immediate : 0;
-                        break;
-                    case 0x1: // BNE
-                        result.branch_taken = (rs1_value != rs2_value);
-                        result.branch_target = result.branch_taken ? immediate : 0;
-                        break;
-                    default:
-                        throw std::invalid_argument("Unsupported B-Type funct3");
-                }
-            }
-
-            // Handle S-Type Instructions
-            else if constexpr (T::format == InstructionFormat::S_TYPE) {
-                rs1_value = register_bank.read(instruction.rs1);
-                rs2_value = register_bank.read(instruction.rs2);
-                immediate = instruction.get_immediate();
-
-                result.alu_result = rs1_value + immediate; 
-            }
-
-            // Handle U-Type Instructions
-            else if constexpr (T::format == InstructionFormat::U_TYPE) {
-                immediate = instruction.get_immediate();
-
-                result.alu_result = immediate; 
-            }
-
-            // Handle J-Type Instructions
-            else if constexpr (T::format == InstructionFormat::J_TYPE) {
-                immediate = instruction.get_immediate();
-
-                result.branch_taken = true;
-                result.branch_target = register_bank.get_pc() + immediate;
-
-                //Handle Jump to Self instruction (Infinite loop detection to determine end of program)
-                if (result.branch_target == register_bank.get_pc()) {
-                    throw EndOfProgramException();
-                }
-            }
-
-            // Unsupported instruction format
-            else {
-                throw std::invalid_argument("Unsupported instruction format for execution stage");
-            }
-        },
-        decoded_instruction
-    );
+    result = ExecutionResult{};
+    Operands operands{register_bank.read(instruction.rs1), register_bank.read(instruction.rs2), register_bank.get_pc()};
+    HANDLERS[static_cast<size_t>(instruction.op)](instruction, operands, result);
 }
 
 // Get the execution result
@@ -138,6 +207,13 @@ const ExecutionResult& ExecuteStage::get_result() const {
 }
 
 //Set input decoded instruction
-void ExecuteStage::set_decoded_instruction(const DecodedInstructionVariant& instruction) {
-    decoded_instruction = instruction;   
+void ExecuteStage::set_instruction(const CompactInstruction& decoded) {
+    instruction = decoded;
+    has_instruction = true;
+}
+
+void ExecuteStage::set_decoded_instruction(const DecodedInstructionVariant& decoded) {
+    // The invalid format only ever means that nothing was decoded
+    has_instruction = decoded.index() != 0;
+    instruction = decode_compact(std::visit([](const auto& inst) { return inst.raw; }, decoded));
 }
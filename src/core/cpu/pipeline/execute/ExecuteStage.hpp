@@ -2,40 +2,29 @@
 
 #include "core/cpu/register_bank/RegisterBank.hpp"
 #include "core/cpu/pipeline/PipelineStage.hpp"
+#include "core/cpu/isa/CompactInstruction.hpp"
 #include "core/cpu/isa/Instruction.hpp"
+#include "core/cpu/state/Trap.hpp"
 #include <cstdint>
 #include <optional>
 #include <string>
-#include <exception>
 
 // Execution result structure
 struct ExecutionResult {
-    uint32_t alu_result;     
+    uint32_t alu_result = 0;
     bool branch_taken = false;
     uint32_t branch_target = 0;
+    bool fence_i = false;       // FENCE.I, instructions decoded before it must not be reused
+    Trap trap;                  // illegal instruction or misaligned jump target, raised instead of thrown
+    bool halt = false;          // jump to self, the end of the program: nothing is written back
 };
 
-//Exception thrown when jump to self is detected such that top level can detect end of program and stop the execution gracefully
-class EndOfProgramException : public std::exception {
-    public:
-        explicit EndOfProgramException(const std::string& msg = "End of program reached")
-            : message(msg) {}
-    
-        virtual const char* what() const noexcept override {
-            return message.c_str();
-        }
-        
-    private:
-        std::string message;
-};
-
+// Executes one instruction through a table of handlers indexed by its operation
 class ExecuteStage : public PipelineStage {
 private:
     const RegisterBank& register_bank;
-    DecodedInstructionVariant decoded_instruction; // Input decoded instruction
-    uint32_t rs1_value;                             // Value from register rs1
-    uint32_t rs2_value;                             // Value from register rs2
-    int32_t immediate;                              // Immediate value
+    CompactInstruction instruction;                 // Input decoded instruction
+    bool has_instruction;
     ExecutionResult result;                         // Execution result
 
 public:
@@ -45,5 +34,6 @@ public:
 
     const ExecutionResult& get_result() const;
 
-    void set_decoded_instruction(const DecodedInstructionVariant& instruction);
+    void set_instruction(const CompactInstruction& instruction);
+    void set_decoded_instruction(const DecodedInstructionVariant& instruction); // decodes it again, for the bindings
 };
@@ -0,0 +1,24 @@
+#include "BimodalPredictor.hpp"
+#include <algorithm>
+
+BimodalPredictor::BimodalPredictor(uint32_t table_bits)
+    : counters(size_t{1} << table_bits), mask((1u << table_bits) - 1) {
+    reset();
+}
+
+bool BimodalPredictor::predict(uint32_t pc) {
+    return counters[pc >> 2 & mask] >= 2;
+}
+
+void BimodalPredictor::update(uint32_t pc, bool taken) {
+    train_counter(counters[pc >> 2 & mask], taken);
+}
+
+void BimodalPredictor::reset() {
+    // Weakly not taken, one taken outcome flips a counter
+    std::fill(counters.begin(), counters.end(), 1);
+}
+
+uint64_t BimodalPredictor::storage_bits() const {
+    return 2 * counters.size();
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "BranchPredictor.hpp"
+
+// A table of 2-bit counters indexed by the branch address
+class BimodalPredictor : public BranchPredictor {
+private:
+    std::vector<uint8_t> counters;
+    uint32_t mask;
+
+public:
+    explicit BimodalPredictor(uint32_t table_bits);
+    bool predict(uint32_t pc) override;
+    void update(uint32_t pc, bool taken) override;
+    void reset() override;
+    uint64_t storage_bits() const override;
+};
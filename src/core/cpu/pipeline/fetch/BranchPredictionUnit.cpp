@@ -0,0 +1,162 @@
+#include "BranchPredictionUnit.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include "BimodalPredictor.hpp"
+#include "GSharePredictor.hpp"
+#include "TagePredictor.hpp"
+#include "core/cpu/isa/Instruction.hpp"
+
+namespace {
+
+void check_range(const char* name, uint32_t value, uint32_t low, uint32_t high) {
+    if (value < low || value > high) {
+        throw std::invalid_argument(std::string("Branch predictor: ") + name + " must be between " +
+                                    std::to_string(low) + " and " + std::to_string(high));
+    }
+}
+
+std::unique_ptr<BranchPredictor> make_direction_predictor(const BranchPredictorConfig& config) {
+    switch (config.kind) {
+        case BranchPredictorKind::BIMODAL:
+            return std::make_unique<BimodalPredictor>(config.table_bits);
+        case BranchPredictorKind::GSHARE:
+            return std::make_unique<GSharePredictor>(config.table_bits, config.history_bits);
+        case BranchPredictorKind::TAGE:
+            return std::make_unique<TagePredictor>(config.table_bits, config.tage_tables, config.tage_table_bits,
+                                                   config.tage_tag_bits, config.history_bits);
+        default:
+            return nullptr;
+    }
+}
+
+bool is_link(uint32_t reg) {
+    return reg == 1 || reg == 5;
+}
+
+} // namespace
+
+BranchPredictionUnit::BranchPredictionUnit(const BranchPredictorConfig& config)
+    : target_mask(0), return_stack(0) {
+    set_config(config);
+}
+
+uint32_t BranchPredictionUnit::resolve(uint32_t raw, uint32_t pc, uint32_t next_pc) {
+    uint32_t opcode = raw & 0x7F;
+    if (opcode != opcodes::BRANCH && opcode != opcodes::JAL && opcode != opcodes::JALR) {
+        return pc + 4;
+    }
+    uint32_t rd = raw >> 7 & 0x1F;
+    uint32_t rs1 = raw >> 15 & 0x1F;
+    bool taken = next_pc != pc + 4;
+    bool call = opcode != opcodes::BRANCH && is_link(rd);
+    bool ret = opcode == opcodes::JALR && is_link(rs1) && (!is_link(rd) || rd != rs1);
+
+    // --- Prediction, from what was learnt before this instruction ---
+    uint32_t predicted = pc + 4;
+    if (direction) {
+        Target& entry = targets[pc >> 2 & target_mask];
+        bool hit = entry.valid && entry.pc == pc;
+        uint32_t return_address = 0;
+        if (opcode == opcodes::BRANCH) {
+            if (direction->predict(pc) && hit) {
+                predicted = entry.target;
+            }
+            direction->update(pc, taken);
+        } else if (ret && return_stack.peek(return_address)) {
+            predicted = return_address;
+        } else if (hit) {
+            predicted = entry.target;
+        }
+
+        // --- Training ---
+        if (taken && !ret) {
+            entry = Target{pc, next_pc, true};
+        }
+        if (ret) {
+            return_stack.pop();
+        }
+        if (call) {
+            return_stack.push(pc + 4);
+        }
+    }
+
+    bool mispredicted = predicted != next_pc;
+    if (opcode == opcodes::BRANCH) {
+        ++stats.conditional;
+        stats.conditional_mispredicts += mispredicted;
+    } else if (opcode == opcodes::JAL) {
+        ++stats.jumps;
+        stats.jump_mispredicts += mispredicted;
+    } else if (ret) {
+        ++stats.returns;
+        stats.return_mispredicts += mispredicted;
+    } else {
+        ++stats.indirect;
+        stats.indirect_mispredicts += mispredicted;
+    }
+    BranchSiteStats& site = sites[pc];
+    site.pc = pc;
+    ++site.executions;
+    site.taken += taken;
+    site.mispredicts += mispredicted;
+    return predicted;
+}
+
+const BranchPredictorConfig& BranchPredictionUnit::get_config() const {
+    return config;
+}
+
+void BranchPredictionUnit::set_config(const BranchPredictorConfig& value) {
+    check_range("table_bits", value.table_bits, 1, 24);
+    check_range("history_bits", value.history_bits, 1, 64);
+    check_range("tage_tables", value.tage_tables, 1, 8);
+    check_range("tage_table_bits", value.tage_table_bits, 1, 20);
+    check_range("tage_tag_bits", value.tage_tag_bits, 4, 16);
+    check_range("btb_bits", value.btb_bits, 0, 20);
+    check_range("ras_depth", value.ras_depth, 0, 1024);
+    direction = make_direction_predictor(value);
+    config = value;
+    targets.assign(size_t{1} << config.btb_bits, Target{});
+    target_mask = (1u << config.btb_bits) - 1;
+    return_stack = ReturnAddressStack(config.ras_depth);
+}
+
+const BranchPredictorStats& BranchPredictionUnit::get_stats() const {
+    return stats;
+}
+
+std::vector<BranchSiteStats> BranchPredictionUnit::get_site_stats() const {
+    std::vector<BranchSiteStats> result;
+    result.reserve(sites.size());
+    for (const auto& [pc, site] : sites) {
+        result.push_back(site);
+    }
+    std::sort(result.begin(), result.end(), [](const BranchSiteStats& a, const BranchSiteStats& b) {
+        return a.mispredicts != b.mispredicts ? a.mispredicts > b.mispredicts : a.pc < b.pc;
+    });
+    return result;
+}
+
+void BranchPredictionUnit::reset_stats() {
+    stats = BranchPredictorStats{};
+    sites.clear();
+}
+
+void BranchPredictionUnit::reset() {
+    if (direction) {
+        direction->reset();
+    }
+    std::fill(targets.begin(), targets.end(), Target{});
+    return_stack.reset();
+}
+
+uint64_t BranchPredictionUnit::storage_bits() const {
+    if (!direction) {
+        return 0;
+    }
+    // A target entry holds the word address bits the index leaves as its tag, the word-aligned
+    // target and a valid bit
+    uint64_t target_bits = targets.size() * ((30 - config.btb_bits) + 30 + 1);
+    return direction->storage_bits() + target_bits + return_stack.storage_bits();
+}
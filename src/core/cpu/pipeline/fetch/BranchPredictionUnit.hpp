@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "BranchPredictor.hpp"
+#include "ReturnAddressStack.hpp"
+
+// Direction predictor used for conditional branches
+enum class BranchPredictorKind : uint8_t {
+    STATIC = 0,   // always not taken, no target buffer or return stack: every taken branch and jump redirects
+    BIMODAL = 1,
+    GSHARE = 2,
+    TAGE = 3
+};
+
+// Table sizes are log2 of their entries
+struct BranchPredictorConfig {
+    BranchPredictorKind kind = BranchPredictorKind::STATIC;
+    uint32_t table_bits = 12;       // counters of the bimodal and gshare tables and of the TAGE base table, 1 to 24
+    uint32_t history_bits = 12;     // global history of gshare, longest history of TAGE, 1 to 64
+    uint32_t tage_tables = 4;       // tagged tables of TAGE, 1 to 8
+    uint32_t tage_table_bits = 10;  // entries per tagged table, 1 to 20
+    uint32_t tage_tag_bits = 9;     // bits per tag, 4 to 16
+    uint32_t btb_bits = 9;          // branch target buffer entries, 0 to 20
+    uint32_t ras_depth = 8;         // return address stack entries, 0 for none
+};
+
+struct BranchPredictorStats {
+    uint64_t conditional = 0;             // conditional branches
+    uint64_t conditional_mispredicts = 0;
+    uint64_t jumps = 0;                   // JAL
+    uint64_t jump_mispredicts = 0;        // their target was not in the branch target buffer
+    uint64_t indirect = 0;                // JALR other than returns
+    uint64_t indirect_mispredicts = 0;
+    uint64_t returns = 0;                 // JALR predicted from the return address stack
+    uint64_t return_mispredicts = 0;
+
+    uint64_t predictions() const { return conditional + jumps + indirect + returns; }
+    uint64_t mispredicts() const {
+        return conditional_mispredicts + jump_mispredicts + indirect_mispredicts + return_mispredicts;
+    }
+    double accuracy() const {
+        return predictions() != 0 ? 1.0 - static_cast<double>(mispredicts()) / static_cast<double>(predictions()) : 0.0;
+    }
+};
+
+// Counters of one branch or jump
+struct BranchSiteStats {
+    uint32_t pc = 0;
+    uint64_t executions = 0;
+    uint64_t taken = 0;
+    uint64_t mispredicts = 0;
+};
+
+// Next-PC prediction at fetch: a direction predictor for conditional branches, a direct-mapped
+// branch target buffer holding the target of every branch and jump last seen taken, and a return
+// address stack. Fetch only leaves the fall-through path on a target buffer hit, a branch
+// predicted taken whose target is not there still falls through.
+//
+// Calls and returns are told apart by the link registers x1 and x5, as the ISA manual suggests:
+// JAL and JALR writing a link register push the return address, a JALR reading one it does not
+// write pops it, and the pop is predicted as the target
+class BranchPredictionUnit {
+private:
+    struct Target {
+        uint32_t pc = 0;
+        uint32_t target = 0;
+        bool valid = false;
+    };
+
+    BranchPredictorConfig config;
+    std::unique_ptr<BranchPredictor> direction;  // null for STATIC
+    std::vector<Target> targets;
+    uint32_t target_mask;
+    ReturnAddressStack return_stack;
+    BranchPredictorStats stats;
+    std::unordered_map<uint32_t, BranchSiteStats> sites;  // by PC
+
+public:
+    // Throws std::invalid_argument when a size is out of range
+    explicit BranchPredictionUnit(const BranchPredictorConfig& config = BranchPredictorConfig{});
+
+    // PC fetch went to after the instruction at pc, then trains on where it really went.
+    // Instructions other than branches and jumps fall through and are not counted
+    uint32_t resolve(uint32_t raw, uint32_t pc, uint32_t next_pc);
+
+    const BranchPredictorConfig& get_config() const;
+    void set_config(const BranchPredictorConfig& value);   // starts from an untrained predictor
+    const BranchPredictorStats& get_stats() const;
+    std::vector<BranchSiteStats> get_site_stats() const;   // most mispredicted first
+    void reset_stats();
+    void reset();                                          // forgets everything learnt, the counters stay
+    uint64_t storage_bits() const;                         // bits of state of the tables, target buffer and stack
+};
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+
+// Direction predictor of conditional branches, consulted at fetch. Every predict() is followed
+// by the update() of the same branch with its outcome, before the next branch is predicted, so
+// an implementation may keep what it looked up for the update
+class BranchPredictor {
+public:
+    virtual bool predict(uint32_t pc) = 0;            // true when the branch at pc is predicted taken
+    virtual void update(uint32_t pc, bool taken) = 0; // trains on the outcome and moves the history
+    virtual void reset() = 0;                         // back to the state after construction
+    virtual uint64_t storage_bits() const = 0;        // bits of state a hardware version would need
+    virtual ~BranchPredictor() = default;
+};
+
+// 2-bit saturating counters, 0 and 1 predict not taken, 2 and 3 taken
+inline void train_counter(uint8_t& counter, bool taken) {
+    if (taken) {
+        counter += counter < 3;
+    } else {
+        counter -= counter > 0;
+    }
+}
@@ -4,14 +4,17 @@ FetchStage::FetchStage(MMU& mmu, RegisterBank& register_bank)
     : mmu(mmu),  fetched_instruction(0), register_bank(register_bank) {}
 
 void FetchStage::process() {
-    // Fetch the instruction from memory at the current program counter
+    // Fetch the instruction from memory at the current program counter. The PC itself is
+    // advanced by the pipeline once the instruction retires, so a trap sees the faulting PC
     uint32_t pc = register_bank.get_pc();
-    fetched_instruction = mmu.read_word(pc);
-
-    // Increment the program counter to point to the next instruction
-    register_bank.set_pc(pc + 4);
+    MemoryStatus status = mmu.try_fetch_word(pc, fetched_instruction);
+    trap = status == MemoryStatus::OK ? Trap{} : trap::from_memory_status(status, AccessType::EXECUTE, pc);
 }
 
 uint32_t FetchStage::get_fetched_instruction() {
     return fetched_instruction;
-}
\ No newline at end of file
+}
+
+const Trap& FetchStage::get_trap() const {
+    return trap;
+}
@@ -2,6 +2,7 @@
 #include <cstdint>
 #include "core/cpu/pipeline/PipelineStage.hpp"
 #include "core/cpu/register_bank/RegisterBank.hpp"
+#include "core/cpu/state/Trap.hpp"
 #include "core/memory/MMU.hpp"
 
 class FetchStage : public PipelineStage {
@@ -9,8 +10,10 @@ private:
     MMU& mmu;
     uint32_t fetched_instruction;
     RegisterBank& register_bank;
+    Trap trap;                      // Fetch fault of the last process(), raised instead of thrown
 public:
     FetchStage(MMU& mmu, RegisterBank& register_bank);
     void process() override;
     uint32_t get_fetched_instruction();
+    const Trap& get_trap() const;
 };
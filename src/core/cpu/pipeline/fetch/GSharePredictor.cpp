@@ -0,0 +1,41 @@
+#include "GSharePredictor.hpp"
+#include <algorithm>
+
+GSharePredictor::GSharePredictor(uint32_t table_bits, uint32_t history_bits)
+    : counters(size_t{1} << table_bits),
+      mask((1u << table_bits) - 1),
+      table_bits(table_bits),
+      history(0),
+      history_mask(history_bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << history_bits) - 1),
+      history_bits(history_bits),
+      last_index(0) {
+    reset();
+}
+
+uint32_t GSharePredictor::index(uint32_t pc) const {
+    // A history longer than the index is folded onto it
+    uint64_t folded = 0;
+    for (uint64_t rest = history; rest != 0; rest >>= table_bits) {
+        folded ^= rest;
+    }
+    return (pc >> 2 ^ static_cast<uint32_t>(folded)) & mask;
+}
+
+bool GSharePredictor::predict(uint32_t pc) {
+    last_index = index(pc);
+    return counters[last_index] >= 2;
+}
+
+void GSharePredictor::update(uint32_t, bool taken) {
+    train_counter(counters[last_index], taken);
+    history = (history << 1 | taken) & history_mask;
+}
+
+void GSharePredictor::reset() {
+    std::fill(counters.begin(), counters.end(), 1);
+    history = 0;
+}
+
+uint64_t GSharePredictor::storage_bits() const {
+    return 2 * counters.size() + history_bits;
+}
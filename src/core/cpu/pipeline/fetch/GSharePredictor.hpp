@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "BranchPredictor.hpp"
+
+// A table of 2-bit counters indexed by the branch address XOR the global history, the outcomes
+// of the last history_bits conditional branches. Branches whose direction follows the ones
+// before them get a counter per path
+class GSharePredictor : public BranchPredictor {
+private:
+    std::vector<uint8_t> counters;
+    uint32_t mask;
+    uint32_t table_bits;
+    uint64_t history;
+    uint64_t history_mask;
+    uint32_t history_bits;
+    uint32_t last_index;  // counter predict() looked at
+
+    uint32_t index(uint32_t pc) const;
+
+public:
+    GSharePredictor(uint32_t table_bits, uint32_t history_bits);
+    bool predict(uint32_t pc) override;
+    void update(uint32_t pc, bool taken) override;
+    void reset() override;
+    uint64_t storage_bits() const override;
+};
@@ -0,0 +1,37 @@
+#include "ReturnAddressStack.hpp"
+
+ReturnAddressStack::ReturnAddressStack(size_t depth) : entries(depth), top(0), count(0) {}
+
+void ReturnAddressStack::push(uint32_t address) {
+    if (entries.empty()) {
+        return;
+    }
+    entries[top] = address;
+    top = (top + 1) % entries.size();
+    count += count < entries.size();
+}
+
+bool ReturnAddressStack::peek(uint32_t& address) const {
+    if (count == 0) {
+        return false;
+    }
+    address = entries[(top + entries.size() - 1) % entries.size()];
+    return true;
+}
+
+void ReturnAddressStack::pop() {
+    if (count != 0) {
+        top = (top + entries.size() - 1) % entries.size();
+        --count;
+    }
+}
+
+void ReturnAddressStack::reset() {
+    top = 0;
+    count = 0;
+}
+
+uint64_t ReturnAddressStack::storage_bits() const {
+    // Word-aligned addresses
+    return 30 * entries.size();
+}
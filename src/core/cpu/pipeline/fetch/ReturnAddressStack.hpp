@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Circular stack of return addresses pushed by calls and popped by returns. A call on a full
+// stack overwrites the oldest entry, a return on an empty one has nothing to predict
+class ReturnAddressStack {
+private:
+    std::vector<uint32_t> entries;
+    size_t top;     // slot of the next push
+    size_t count;
+
+public:
+    explicit ReturnAddressStack(size_t depth);
+    void push(uint32_t address);
+    bool peek(uint32_t& address) const;  // false when empty
+    void pop();
+    void reset();
+    uint64_t storage_bits() const;
+};
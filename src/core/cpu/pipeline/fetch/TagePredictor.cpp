@@ -0,0 +1,134 @@
+#include "TagePredictor.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr uint32_t MIN_HISTORY = 4;
+constexpr uint64_t USEFUL_RESET_PERIOD = 256 * 1024;
+
+} // namespace
+
+TagePredictor::TagePredictor(uint32_t base_bits, uint32_t table_count, uint32_t table_bits, uint32_t tag_bits,
+                             uint32_t history_bits)
+    : base(size_t{1} << base_bits),
+      base_mask((1u << base_bits) - 1),
+      tables(table_count),
+      table_bits(table_bits),
+      tag_bits(tag_bits),
+      history(0),
+      history_bits(history_bits),
+      updates(0),
+      provider(-1),
+      provider_taken(false),
+      alternate_taken(false) {
+    // Geometric series of history lengths between MIN_HISTORY and history_bits
+    uint32_t shortest = std::min(MIN_HISTORY, history_bits);
+    double ratio = table_count > 1 ? std::pow(static_cast<double>(history_bits) / shortest, 1.0 / (table_count - 1)) : 1.0;
+    for (uint32_t i = 0; i < table_count; ++i) {
+        Table& table = tables[i];
+        table.entries.resize(size_t{1} << table_bits);
+        table.history_length = table_count > 1 ? static_cast<uint32_t>(std::lround(shortest * std::pow(ratio, i)))
+                                               : history_bits;
+    }
+    reset();
+}
+
+uint32_t TagePredictor::fold(uint32_t length, uint32_t bits) const {
+    // The most recent length outcomes XORed together in chunks of bits
+    uint64_t rest = length >= 64 ? history : history & ((uint64_t{1} << length) - 1);
+    uint64_t folded = 0;
+    for (; rest != 0; rest >>= bits) {
+        folded ^= rest;
+    }
+    return static_cast<uint32_t>(folded) & ((1u << bits) - 1);
+}
+
+bool TagePredictor::predict(uint32_t pc) {
+    uint32_t address = pc >> 2;
+    uint32_t table_mask = (1u << table_bits) - 1;
+    uint32_t tag_mask = (1u << tag_bits) - 1;
+    provider = -1;
+    int alternate = -1;
+    for (size_t i = 0; i < tables.size(); ++i) {
+        Table& table = tables[i];
+        table.index = (address ^ address >> table_bits ^ fold(table.history_length, table_bits)) & table_mask;
+        table.tag = static_cast<uint16_t>((address ^ fold(table.history_length, tag_bits)
+                                           ^ fold(table.history_length, tag_bits - 1) << 1) & tag_mask);
+        if (table.entries[table.index].tag == table.tag) {
+            alternate = provider;
+            provider = static_cast<int>(i);
+        }
+    }
+    bool base_taken = base[address & base_mask] >= 2;
+    alternate_taken = alternate >= 0 ? tables[alternate].entries[tables[alternate].index].counter >= 0 : base_taken;
+    provider_taken = provider >= 0 ? tables[provider].entries[tables[provider].index].counter >= 0 : base_taken;
+    return provider_taken;
+}
+
+void TagePredictor::update(uint32_t pc, bool taken) {
+    if (provider >= 0) {
+        Entry& entry = tables[provider].entries[tables[provider].index];
+        if (provider_taken != alternate_taken) {
+            if (provider_taken == taken) {
+                entry.useful += entry.useful < 3;
+            } else {
+                entry.useful -= entry.useful > 0;
+            }
+        }
+        if (taken) {
+            entry.counter += entry.counter < 3;
+        } else {
+            entry.counter -= entry.counter > -4;
+        }
+    } else {
+        train_counter(base[pc >> 2 & base_mask], taken);
+    }
+
+    // Give the branch more history: the first free longer entry, weakly in the right direction
+    if (provider_taken != taken) {
+        bool allocated = false;
+        for (size_t i = static_cast<size_t>(provider + 1); i < tables.size() && !allocated; ++i) {
+            Entry& entry = tables[i].entries[tables[i].index];
+            if (entry.useful == 0) {
+                entry = Entry{tables[i].tag, static_cast<int8_t>(taken ? 0 : -1), 0};
+                allocated = true;
+            }
+        }
+        for (size_t i = static_cast<size_t>(provider + 1); i < tables.size() && !allocated; ++i) {
+            Entry& entry = tables[i].entries[tables[i].index];
+            entry.useful -= entry.useful > 0;
+        }
+    }
+
+    if (++updates % USEFUL_RESET_PERIOD == 0) {
+        for (Table& table : tables) {
+            for (Entry& entry : table.entries) {
+                entry.useful >>= 1;
+            }
+        }
+    }
+    history = history << 1 | taken;
+    if (history_bits < 64) {
+        history &= (uint64_t{1} << history_bits) - 1;
+    }
+}
+
+void TagePredictor::reset() {
+    std::fill(base.begin(), base.end(), 1);
+    for (Table& table : tables) {
+        std::fill(table.entries.begin(), table.entries.end(), Entry{});
+    }
+    history = 0;
+    updates = 0;
+    provider = -1;
+}
+
+uint64_t TagePredictor::storage_bits() const {
+    // Tag, 3-bit counter and 2-bit useful counter per tagged entry
+    uint64_t bits = 2 * base.size() + history_bits;
+    for (const Table& table : tables) {
+        bits += table.entries.size() * (tag_bits + 5);
+    }
+    return bits;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "BranchPredictor.hpp"
+
+// A small TAGE: a bimodal base table and tagged tables indexed by the branch address hashed
+// with geometrically longer slices of the global history, from 4 branches up to history_bits.
+// The longest table whose tag matches provides the prediction, the base table when none does.
+//
+// Each tagged entry holds a partial tag, a 3-bit signed counter and a 2-bit useful counter.
+// The useful counter of the provider moves when it disagreed with the next longest match (the
+// alternate) and was right or wrong. A misprediction allocates the branch in one longer table
+// whose entry is not useful, or ages the useful counters of those tables when there is none.
+// Every 256K updates all useful counters are halved so stale entries can be replaced
+class TagePredictor : public BranchPredictor {
+private:
+    struct Entry {
+        uint16_t tag = 0;
+        int8_t counter = 0;   // -4 .. 3, taken when >= 0
+        uint8_t useful = 0;   // 0 .. 3
+    };
+
+    struct Table {
+        std::vector<Entry> entries;
+        uint32_t history_length;
+        uint32_t index = 0;   // slot and tag of the branch predict() looked at
+        uint16_t tag = 0;
+    };
+
+    std::vector<uint8_t> base;
+    uint32_t base_mask;
+    std::vector<Table> tables;  // shortest history first
+    uint32_t table_bits;
+    uint32_t tag_bits;
+    uint64_t history;
+    uint32_t history_bits;
+    uint64_t updates;
+    int provider;               // table of the prediction, -1 for the base table
+    bool provider_taken;
+    bool alternate_taken;
+
+    uint32_t fold(uint32_t length, uint32_t bits) const;
+
+public:
+    // table_count tagged tables of 2^table_bits entries with tags of tag_bits bits
+    TagePredictor(uint32_t base_bits, uint32_t table_count, uint32_t table_bits, uint32_t tag_bits,
+                  uint32_t history_bits);
+    bool predict(uint32_t pc) override;
+    void update(uint32_t pc, bool taken) override;
+    void reset() override;
+    uint64_t storage_bits() const override;
+};
@@ -1,8 +1,30 @@
 #include "MemoryAccessStage.hpp"
-#include <stdexcept>
+#include <atomic>
+#include <bit>
+#include <variant>
+
+// Guest words are operated on in place with host atomics, no byte swapping possible
+static_assert(std::endian::native == std::endian::little, "atomics need a little endian host");
+
+namespace {
+
+uint32_t select_min_max(Operation op, uint32_t current, uint32_t operand) {
+    switch (op) {
+        case Operation::AMOMIN_W:
+            return static_cast<int32_t>(operand) < static_cast<int32_t>(current) ? operand : current;
+        case Operation::AMOMAX_W:
+            return static_cast<int32_t>(operand) > static_cast<int32_t>(current) ? operand : current;
+        case Operation::AMOMINU_W:
+            return operand < current ? operand : current;
+        default: // AMOMAXU
+            return operand > current ? operand : current;
+    }
+}
+
+} // namespace
 
 MemoryAccessStage::MemoryAccessStage(MMU& mmu, RegisterBank& register_bank)
-    : mmu(mmu), register_bank(register_bank), decoded_instruction(DecodedInstruction<InstructionFormat::INIVALID_TYPE>(0))
+    : mmu(mmu), register_bank(register_bank)
 {
     result.load_data.reset(); //reset result
     result.store_success = false;
@@ -15,28 +37,127 @@ void MemoryAccessStage::set_execution_result(const ExecutionResult& exec_result)
 void MemoryAccessStage::process() {
     result.load_data.reset(); // reset
     result.store_success = false;
+    result.trap = Trap{};
 
     uint32_t effective_address = execution_result.alu_result;
 
-    //decay the variant of the decoded instruction
-    std::visit([this, effective_address](auto& inst) {
-        using T = std::decay_t<decltype(inst)>;
+    // Loads, the operation selects the width and the extension
+    if (instruction.op >= Operation::LB && instruction.op <= Operation::LHU) {
+        uint32_t value = 0;
+        MemoryStatus status = load(instruction.op, effective_address, value);
+        if (status != MemoryStatus::OK) {
+            result.trap = trap::from_memory_status(status, AccessType::READ, effective_address);
+            return;
+        }
+        result.load_data = value;
+    }
+    // Stores, the operation selects the width
+    else if (instruction.op >= Operation::SB && instruction.op <= Operation::SW) {
+        uint32_t data_to_store = register_bank.read(instruction.rs2);
+        MemoryStatus status = store(instruction.op, effective_address, data_to_store);
+        if (status != MemoryStatus::OK) {
+            result.trap = trap::from_memory_status(status, AccessType::WRITE, effective_address);
+            return;
+        }
+        result.store_success = true;
+    }
+    // Atomics, the value read from memory is written back like a load
+    else if (is_atomic(instruction.op)) {
+        uint32_t value = 0;
+        MemoryStatus status = atomic(instruction.op, effective_address, register_bank.read(instruction.rs2), value);
+        if (status != MemoryStatus::OK) {
+            AccessType type = instruction.op == Operation::LR_W ? AccessType::READ : AccessType::WRITE;
+            result.trap = trap::from_memory_status(status, type, effective_address);
+            return;
+        }
+        result.load_data = value;
+    }
+}
 
-        // if I format it could be LOAD 
-        if constexpr (T::format == InstructionFormat::I_TYPE) {
-            if (inst.opcode == 0x03) { //TODO: implement different than word
-                result.load_data = mmu.read_word(effective_address);
-            }
+MemoryStatus MemoryAccessStage::load(Operation op, uint32_t address, uint32_t& value) {
+    // Each width goes through its own MMU accessor, a TLB hit is one host load of that width
+    MemoryStatus status;
+    switch (op) {
+        case Operation::LB: {
+            uint8_t byte = 0;
+            status = mmu.try_read(address, byte);
+            value = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int8_t>(byte)));
+            break;
+        }
+        case Operation::LH: {
+            uint16_t halfword = 0;
+            status = mmu.try_read_halfword(address, halfword);
+            value = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int16_t>(halfword)));
+            break;
         }
-        // else type S is store
-        else if constexpr (T::format == InstructionFormat::S_TYPE) { //TODO: Implement different than word
-            auto& s_inst = std::get<DecodedInstruction<InstructionFormat::S_TYPE>>(decoded_instruction);
-            uint32_t rs2 = s_inst.rs2;
-            uint32_t data_to_store = register_bank.read(rs2);
-            mmu.write_word(effective_address, data_to_store);
-            result.store_success = true;
+        case Operation::LBU: {
+            uint8_t byte = 0;
+            status = mmu.try_read(address, byte);
+            value = byte;
+            break;
         }
-    }, decoded_instruction);
+        case Operation::LHU: {
+            uint16_t halfword = 0;
+            status = mmu.try_read_halfword(address, halfword);
+            value = halfword;
+            break;
+        }
+        default: // LW
+            status = mmu.try_read_word(address, value);
+            break;
+    }
+    return status;
+}
+
+MemoryStatus MemoryAccessStage::store(Operation op, uint32_t address, uint32_t value) {
+    switch (op) {
+        case Operation::SB:
+            return mmu.try_write(address, static_cast<uint8_t>(value));
+        case Operation::SH:
+            return mmu.try_write_halfword(address, static_cast<uint16_t>(value));
+        default:  // SW
+            return mmu.try_write_word(address, value);
+    }
+}
+
+MemoryStatus MemoryAccessStage::atomic(Operation op, uint32_t address, uint32_t operand, uint32_t& value) {
+    uint32_t* word = nullptr;
+    MemoryStatus status = mmu.try_atomic_word(address, op == Operation::LR_W ? AccessType::READ : AccessType::WRITE, word);
+    if (status != MemoryStatus::OK) {
+        return status;
+    }
+    // aq and rl are not looked at, every access is sequentially consistent
+    std::atomic_ref<uint32_t> memory(*word);
+    switch (op) {
+        case Operation::LR_W:
+            value = memory.load();
+            reservation = Reservation{word, value};
+            break;
+        case Operation::SC_W: {
+            // SC writes 0 on success, and always ends the reservation
+            uint32_t expected = reservation.value;
+            bool success = reservation.word == word && memory.compare_exchange_strong(expected, operand);
+            reservation.word = nullptr;
+            value = success ? 0 : 1;
+            break;
+        }
+        case Operation::AMOSWAP_W: value = memory.exchange(operand); break;
+        case Operation::AMOADD_W:  value = memory.fetch_add(operand); break;
+        case Operation::AMOXOR_W:  value = memory.fetch_xor(operand); break;
+        case Operation::AMOAND_W:  value = memory.fetch_and(operand); break;
+        case Operation::AMOOR_W:   value = memory.fetch_or(operand); break;
+        default:
+            // No host instruction for the min and max, retried until no other hart got in between
+            value = memory.load();
+            while (!memory.compare_exchange_weak(value, select_min_max(op, value, operand))) {
+            }
+            break;
+    }
+    return MemoryStatus::OK;
+}
+
+void MemoryAccessStage::clear_reservation() {
+    reservation.word = nullptr;
 }
 
 const MemoryAccessResult& MemoryAccessStage::get_result() const {
@@ -44,6 +165,10 @@ const MemoryAccessResult& MemoryAccessStage::get_result() const {
 }
 
 //Set input decoded instruction
-void MemoryAccessStage::set_decoded_instruction(const DecodedInstructionVariant& instruction) {
-    decoded_instruction = instruction;   
+void MemoryAccessStage::set_instruction(const CompactInstruction& decoded) {
+    instruction = decoded;
+}
+
+void MemoryAccessStage::set_decoded_instruction(const DecodedInstructionVariant& decoded) {
+    instruction = decode_compact(std::visit([](const auto& inst) { return inst.raw; }, decoded));
 }
@@ -8,6 +8,16 @@
 struct MemoryAccessResult {
     std::optional<uint32_t> load_data;  // read value in case of load
     bool store_success = false;        
+    Trap trap;                          // load or store fault, raised instead of thrown
+};
+
+// LR/SC reservation of the hart: the word LR read and the value it saw. SC succeeds when the word
+// still holds that value, checked and written with one compare and swap, so the plain loads and
+// stores of the other harts never synchronize with it. A store of the same value in between goes
+// unnoticed, which the A extension allows
+struct Reservation {
+    uint32_t* word = nullptr; // host word, null when there is no reservation
+    uint32_t value = 0;
 };
 
 class MemoryAccessStage {
@@ -15,18 +25,27 @@ private:
     MMU& mmu;
     const RegisterBank& register_bank;
     ExecutionResult execution_result;
-    DecodedInstructionVariant decoded_instruction; // Input decoded instruction
+    CompactInstruction instruction; // Input decoded instruction
     MemoryAccessResult result;
+    Reservation reservation;
+
+    // Sub-word loads are sign or zero extended to 32 bits according to the operation
+    MemoryStatus load(Operation op, uint32_t address, uint32_t& value);
+    MemoryStatus store(Operation op, uint32_t address, uint32_t value);
+    // LR, SC and the AMOs with host atomics, value is what is written back to rd
+    MemoryStatus atomic(Operation op, uint32_t address, uint32_t operand, uint32_t& value);
     
 public:
     MemoryAccessStage(MMU& mmu, RegisterBank& register_bank);
 
     void set_execution_result(const ExecutionResult& exec_result);
-    void set_decoded_instruction(const DecodedInstructionVariant& instruction);
+    void set_instruction(const CompactInstruction& decoded);
+    void set_decoded_instruction(const DecodedInstructionVariant& decoded);
 
     void process();
 
     const MemoryAccessResult& get_result() const;
+    void clear_reservation(); // the next SC fails
 
 };
 
@@ -0,0 +1,174 @@
+#include "Cache.hpp"
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace {
+
+constexpr uint32_t RANDOM_SEED = 0x9E3779B9;
+
+} // namespace
+
+Cache::Cache(const CacheConfig& config)
+    : config(config), random_state(RANDOM_SEED), last_line(0), last_index(0) {
+    if (!std::has_single_bit(config.size) || !std::has_single_bit(config.ways) || !std::has_single_bit(config.line_size)
+        || config.line_size < 4 || config.ways > 32 || config.size < config.ways * config.line_size) {
+        throw std::invalid_argument("Cache: size, ways and line size must be powers of two, with at most 32 "
+                                    "ways, lines of at least 4 bytes and room for one set");
+    }
+    uint32_t sets = config.size / (config.ways * config.line_size);
+    line_mask = config.line_size - 1;
+    line_shift = static_cast<uint32_t>(std::countr_zero(config.line_size));
+    set_mask = sets - 1;
+    lines.assign(static_cast<size_t>(sets) * config.ways, 0);
+    if (config.replacement == ReplacementPolicy::LRU) {
+        ranks.resize(lines.size());
+    } else if (config.replacement == ReplacementPolicy::PLRU) {
+        trees.resize(sets);
+    }
+    invalidate();
+}
+
+uint32_t Cache::find(uint32_t set, uint32_t line) const {
+    const uint32_t* tags = &lines[static_cast<size_t>(set) * config.ways];
+    for (uint32_t way = 0; way < config.ways; ++way) {
+        if ((tags[way] & ~DIRTY) == (line | VALID)) {
+            return way;
+        }
+    }
+    return config.ways;
+}
+
+uint32_t Cache::choose_victim(uint32_t set) {
+    size_t base = static_cast<size_t>(set) * config.ways;
+    for (uint32_t way = 0; way < config.ways; ++way) {
+        if (!(lines[base + way] & VALID)) {
+            return way;
+        }
+    }
+    switch (config.replacement) {
+        case ReplacementPolicy::LRU:
+            return static_cast<uint32_t>(std::find(&ranks[base], &ranks[base] + config.ways, config.ways - 1) - &ranks[base]);
+        case ReplacementPolicy::PLRU: {
+            // Follow the bits down from the root, each points at the half used least recently
+            uint32_t node = 1;
+            while (node < config.ways) {
+                node = 2 * node + (trees[set] >> node & 1);
+            }
+            return node - config.ways;
+        }
+        default:
+            // xorshift32
+            random_state ^= random_state << 13;
+            random_state ^= random_state >> 17;
+            random_state ^= random_state << 5;
+            return random_state & (config.ways - 1);
+    }
+}
+
+void Cache::touch(uint32_t set, uint32_t way) {
+    last_index = static_cast<size_t>(set) * config.ways + way;
+    last_line = lines[last_index] & ~DIRTY;
+    if (config.replacement == ReplacementPolicy::LRU) {
+        uint8_t* rank = &ranks[static_cast<size_t>(set) * config.ways];
+        uint8_t previous = rank[way];
+        for (uint32_t other = 0; other < config.ways; ++other) {
+            rank[other] += rank[other] < previous;
+        }
+        rank[way] = 0;
+    } else if (config.replacement == ReplacementPolicy::PLRU) {
+        // Every node on the path points away from this way
+        uint32_t& tree = trees[set];
+        for (uint32_t node = way + config.ways; node > 1; node /= 2) {
+            uint32_t parent = node / 2;
+            tree = (tree & ~(1u << parent)) | static_cast<uint32_t>((node & 1) == 0) << parent;
+        }
+    }
+}
+
+CacheAccess Cache::allocate(uint32_t set, uint32_t line, bool dirty) {
+    CacheAccess access;
+    access.fill = true;
+    uint32_t way = choose_victim(set);
+    uint32_t& tag = lines[static_cast<size_t>(set) * config.ways + way];
+    if (tag & VALID) {
+        ++stats.evictions;
+        if (tag & DIRTY) {
+            ++stats.writebacks;
+            access.writeback = true;
+            access.victim = tag & ~line_mask;
+        }
+    }
+    tag = line | VALID | (dirty ? DIRTY : 0);
+    touch(set, way);
+    return access;
+}
+
+CacheAccess Cache::read(uint32_t address) {
+    uint32_t line = address & ~line_mask;
+    ++stats.accesses;
+    if ((line | VALID) == last_line) {
+        ++stats.hits;
+        return CacheAccess{true, false, false, 0};
+    }
+    uint32_t set = (address >> line_shift) & set_mask;
+    uint32_t way = find(set, line);
+    if (way != config.ways) {
+        ++stats.hits;
+        touch(set, way);
+        return CacheAccess{true, false, false, 0};
+    }
+    ++stats.misses;
+    return allocate(set, line, false);
+}
+
+CacheAccess Cache::write(uint32_t address) {
+    uint32_t line = address & ~line_mask;
+    bool write_back = config.write_policy == WritePolicy::WRITE_BACK;
+    ++stats.accesses;
+    if ((line | VALID) == last_line) {
+        ++stats.hits;
+        lines[last_index] |= write_back ? DIRTY : 0;
+        return CacheAccess{true, false, false, 0};
+    }
+    uint32_t set = (address >> line_shift) & set_mask;
+    uint32_t way = find(set, line);
+    if (way != config.ways) {
+        ++stats.hits;
+        if (write_back) {
+            lines[static_cast<size_t>(set) * config.ways + way] |= DIRTY;
+        }
+        touch(set, way);
+        return CacheAccess{true, false, false, 0};
+    }
+    ++stats.misses;
+    if (!config.write_allocate) {
+        return CacheAccess{};
+    }
+    return allocate(set, line, write_back);
+}
+
+bool Cache::contains(uint32_t address) const {
+    return find((address >> line_shift) & set_mask, address & ~line_mask) != config.ways;
+}
+
+void Cache::invalidate() {
+    std::fill(lines.begin(), lines.end(), 0);
+    last_line = 0;
+    for (size_t i = 0; i < ranks.size(); ++i) {
+        ranks[i] = static_cast<uint8_t>(i % config.ways);
+    }
+    std::fill(trees.begin(), trees.end(), 0);
+}
+
+const CacheConfig& Cache::get_config() const {
+    return config;
+}
+
+const CacheStats& Cache::get_stats() const {
+    return stats;
+}
+
+void Cache::reset_stats() {
+    stats = CacheStats{};
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How a full set picks the line it evicts
+enum class ReplacementPolicy : uint8_t {
+    LRU = 0,    // least recently used
+    PLRU = 1,   // tree pseudo-LRU, one bit per node of a binary tree over the ways
+    RANDOM = 2
+};
+
+enum class WritePolicy : uint8_t {
+    WRITE_BACK = 0,   // writes dirty the line, the next level sees it when it is evicted
+    WRITE_THROUGH = 1 // every write also goes to the next level, lines are never dirty
+};
+
+// Geometry and policies of one cache level. Sizes are powers of two
+struct CacheConfig {
+    uint32_t size = 16 * 1024;  // bytes of data
+    uint32_t ways = 4;          // lines per set, at most 32
+    uint32_t line_size = 64;    // bytes per line, at least 4
+    ReplacementPolicy replacement = ReplacementPolicy::LRU;
+    WritePolicy write_policy = WritePolicy::WRITE_BACK;
+    bool write_allocate = true; // a write miss fills the line, otherwise the write goes around the cache
+    uint32_t latency = 0;       // cycles a hit adds to the access
+};
+
+struct CacheStats {
+    uint64_t accesses = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;  // valid lines replaced by a fill
+    uint64_t writebacks = 0; // evicted lines that were dirty
+
+    double miss_rate() const {
+        return accesses != 0 ? static_cast<double>(misses) / static_cast<double>(accesses) : 0.0;
+    }
+};
+
+// Outcome of one access
+struct CacheAccess {
+    bool hit = false;
+    bool fill = false;      // the line was allocated, the next level has to supply it
+    bool writeback = false; // a dirty line was evicted for it
+    uint32_t victim = 0;    // address of that line
+};
+
+// Tags and replacement state of a set-associative cache. It holds no data: guest memory is
+// always up to date, the cache only tells which level would have served each access.
+//
+// Every line is one packed word, its line address with the valid and dirty bits in the low bits
+// the line offset leaves free, so the tags of a set sit next to each other and a lookup compares
+// a handful of words. The replacement state is one byte per line for LRU (its rank in the set,
+// 0 for the most recent, the ranks of a set are always a permutation) and one word per set for
+// PLRU (the tree bits, indexed like a heap from 1). The line accessed last is remembered: it is
+// already the most recent of its set, so the run of accesses to one line that fetch and
+// sequential data make costs one compare each
+class Cache {
+private:
+    static constexpr uint32_t VALID = 0x1;
+    static constexpr uint32_t DIRTY = 0x2;
+
+    CacheConfig config;
+    uint32_t line_mask;   // address bits of the offset in a line
+    uint32_t line_shift;
+    uint32_t set_mask;
+    std::vector<uint32_t> lines; // sets * ways packed tags
+    std::vector<uint8_t> ranks;  // LRU
+    std::vector<uint32_t> trees; // PLRU
+    uint32_t random_state;
+    uint32_t last_line;   // packed tag of the line accessed last, 0 when there is none
+    size_t last_index;    // its slot in lines
+    CacheStats stats;
+
+    // Way of the line in its set, ways when it is not cached
+    uint32_t find(uint32_t set, uint32_t line) const;
+    uint32_t choose_victim(uint32_t set);
+    void touch(uint32_t set, uint32_t way);
+    CacheAccess allocate(uint32_t set, uint32_t line, bool dirty);
+
+public:
+    // Throws std::invalid_argument when the geometry is not a power of two or does not fit
+    explicit Cache(const CacheConfig& config = CacheConfig{});
+
+    CacheAccess read(uint32_t address);
+    CacheAccess write(uint32_t address);
+    bool contains(uint32_t address) const;
+
+    void invalidate();   // drops every line, dirty ones included
+    const CacheConfig& get_config() const;
+    const CacheStats& get_stats() const;
+    void reset_stats();
+};
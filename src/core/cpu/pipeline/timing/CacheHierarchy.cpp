@@ -0,0 +1,85 @@
+#include "CacheHierarchy.hpp"
+#include <utility>
+
+CacheHierarchy::CacheHierarchy(const CacheHierarchyConfig& config)
+    : config(config), l1i(config.l1i), l1d(config.l1d), l2(config.l2), memory_reads(0), memory_writes(0) {}
+
+uint32_t CacheHierarchy::fetch(uint32_t address) {
+    return complete_l1_access(l1i, l1i.read(address), address);
+}
+
+uint32_t CacheHierarchy::read(uint32_t address) {
+    return complete_l1_access(l1d, l1d.read(address), address);
+}
+
+uint32_t CacheHierarchy::write(uint32_t address) {
+    CacheAccess access = l1d.write(address);
+    // A write that does not stay in the L1 continues to the L2
+    if (!access.fill && (!access.hit || config.l1d.write_policy == WritePolicy::WRITE_THROUGH)) {
+        write_l2(address);
+    }
+    return complete_l1_access(l1d, access, address);
+}
+
+uint32_t CacheHierarchy::complete_l1_access(const Cache& l1, const CacheAccess& access, uint32_t address) {
+    uint32_t latency = l1.get_config().latency;
+    if (access.writeback) {
+        write_l2(access.victim);
+    }
+    if (access.fill) {
+        latency += read_l2(address);
+    }
+    return latency;
+}
+
+uint32_t CacheHierarchy::read_l2(uint32_t address) {
+    CacheAccess access = l2.read(address);
+    memory_writes += access.writeback;
+    if (access.hit) {
+        return config.l2.latency;
+    }
+    ++memory_reads;
+    return config.l2.latency + config.memory_latency;
+}
+
+void CacheHierarchy::write_l2(uint32_t address) {
+    CacheAccess access = l2.write(address);
+    memory_writes += access.writeback;
+    memory_reads += access.fill;
+    memory_writes += !access.fill && (!access.hit || config.l2.write_policy == WritePolicy::WRITE_THROUGH);
+}
+
+const CacheHierarchyConfig& CacheHierarchy::get_config() const {
+    return config;
+}
+
+void CacheHierarchy::set_config(const CacheHierarchyConfig& new_config) {
+    // Built first so an invalid level leaves the hierarchy as it was
+    Cache new_l1i(new_config.l1i);
+    Cache new_l1d(new_config.l1d);
+    Cache new_l2(new_config.l2);
+    config = new_config;
+    l1i = std::move(new_l1i);
+    l1d = std::move(new_l1d);
+    l2 = std::move(new_l2);
+    memory_reads = 0;
+    memory_writes = 0;
+}
+
+CacheHierarchyStats CacheHierarchy::get_stats() const {
+    return CacheHierarchyStats{l1i.get_stats(), l1d.get_stats(), l2.get_stats(), memory_reads, memory_writes};
+}
+
+void CacheHierarchy::reset_stats() {
+    l1i.reset_stats();
+    l1d.reset_stats();
+    l2.reset_stats();
+    memory_reads = 0;
+    memory_writes = 0;
+}
+
+void CacheHierarchy::invalidate() {
+    l1i.invalidate();
+    l1d.invalidate();
+    l2.invalidate();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include "Cache.hpp"
+
+// Split L1 instruction and data caches in front of a shared L2 and main memory. Latencies are
+// the cycles an access adds to the one cycle its stage takes anyway
+struct CacheHierarchyConfig {
+    CacheConfig l1i;
+    CacheConfig l1d;
+    CacheConfig l2{256 * 1024, 8, 64, ReplacementPolicy::LRU, WritePolicy::WRITE_BACK, true, 10};
+    uint32_t memory_latency = 100;
+};
+
+struct CacheHierarchyStats {
+    CacheStats l1i;
+    CacheStats l1d;
+    CacheStats l2;
+    uint64_t memory_reads = 0;  // lines filled from memory
+    uint64_t memory_writes = 0; // lines and writes that reached memory
+};
+
+// Where each fetch, load and store would be served from, and what it costs. The levels are
+// neither inclusive nor exclusive: an L1 fill also allocates in L2, an L2 eviction leaves the
+// L1 copies alone. Only reads stall: an L1 miss waits for the L2 and, when that misses too, for
+// memory. Writes going down (write-through, writes that do not allocate, dirty evictions) drain
+// through a write buffer that never fills, they are counted but cost nothing
+class CacheHierarchy {
+private:
+    CacheHierarchyConfig config;
+    Cache l1i;
+    Cache l1d;
+    Cache l2;
+    uint64_t memory_reads;
+    uint64_t memory_writes;
+
+    uint32_t complete_l1_access(const Cache& l1, const CacheAccess& access, uint32_t address);
+    uint32_t read_l2(uint32_t address);
+    void write_l2(uint32_t address);
+
+public:
+    // Throws std::invalid_argument when a level has an invalid geometry
+    explicit CacheHierarchy(const CacheHierarchyConfig& config = CacheHierarchyConfig{});
+
+    // Physical address of the access, returns the extra cycles it takes
+    uint32_t fetch(uint32_t address);
+    uint32_t read(uint32_t address);
+    uint32_t write(uint32_t address);
+
+    const CacheHierarchyConfig& get_config() const;
+    void set_config(const CacheHierarchyConfig& config); // starts from cold caches
+    CacheHierarchyStats get_stats() const;
+    void reset_stats();                                  // the cached lines stay
+    void invalidate();                                   // drops every line of every level
+};
@@ -0,0 +1,154 @@
+#include "TimingModel.hpp"
+#include <algorithm>
+#include <iterator>
+#include "core/cpu/isa/Instruction.hpp"
+
+TimingModel::TimingModel() {
+    reset();
+}
+
+void TimingModel::reset() {
+    stats = TimingStats{};
+    started = false;
+    last = StageTimes{};
+    pending_penalty = 0;
+    pending_flush = false;
+    std::fill(std::begin(ready), std::end(ready), 0);
+    std::fill(std::begin(ready_from_load), std::end(ready_from_load), false);
+}
+
+void TimingModel::record(uint32_t raw, uint32_t pc, uint32_t next_pc, uint32_t predicted_pc, bool trapped,
+                         uint32_t fetch_latency, uint32_t memory_latency) {
+    // --- Registers read and written, and the redirect the instruction causes ---
+    uint32_t rd = raw >> 7 & 0x1F;
+    uint32_t rs1 = raw >> 15 & 0x1F;
+    uint32_t rs2 = raw >> 20 & 0x1F;
+    uint32_t funct3 = raw >> 12 & 0x7;
+    bool reads_rs1 = false;
+    bool reads_rs2 = false;
+    bool writes_rd = false;
+    bool load = false;
+    uint32_t penalty = 0;
+    bool flush = false;
+    bool taken = next_pc != pc + 4;
+    bool mispredicted = next_pc != predicted_pc;
+
+    switch (raw & 0x7F) {
+        case opcodes::OP:
+            reads_rs1 = reads_rs2 = writes_rd = true;
+            break;
+        case opcodes::OP_IMM:
+            reads_rs1 = writes_rd = true;
+            break;
+        case opcodes::LOAD:
+            reads_rs1 = writes_rd = load = true;
+            break;
+        case opcodes::LUI:
+        case opcodes::AUIPC:
+            writes_rd = true;
+            break;
+        case opcodes::STORE:
+            reads_rs1 = reads_rs2 = true;
+            break;
+        case opcodes::AMO:
+            // The old value comes back from memory like a load, LR reads x0 as rs2
+            reads_rs1 = reads_rs2 = writes_rd = load = true;
+            break;
+        case opcodes::BRANCH:
+            reads_rs1 = reads_rs2 = true;
+            penalty = mispredicted ? config.branch_penalty : 0;
+            break;
+        case opcodes::JAL:
+            writes_rd = true;
+            penalty = mispredicted ? config.jump_penalty : 0;
+            break;
+        case opcodes::JALR:
+            reads_rs1 = writes_rd = true;
+            penalty = mispredicted ? config.branch_penalty : 0;
+            break;
+        case opcodes::MISC_MEM:
+            flush = funct3 == 0x1; // FENCE.I refetches everything behind it
+            break;
+        case opcodes::SYSTEM:
+            // Zicsr reads rs1 unless it is an immediate form, MRET redirects
+            reads_rs1 = funct3 != 0x0 && funct3 < 0x4;
+            writes_rd = funct3 != 0x0;
+            flush = taken;
+            break;
+        default:
+            break;
+    }
+    if (trapped) {
+        // Nothing is written, the handler is fetched once the trap reaches MEM
+        writes_rd = false;
+        flush = true;
+    }
+    if (flush) {
+        penalty = config.flush_penalty;
+    }
+
+    // --- Stage entry cycles, each stage waits for its latch to be free ---
+    uint64_t fetch = 0;
+    uint64_t ideal = 2; // EX right behind the last instruction
+    if (started) {
+        fetch = std::max(last.fetch + 1, last.decode);
+        if (pending_penalty != 0) {
+            // Counted from EX, a redirect that waited for its operands is resolved later
+            fetch = std::max(fetch, last.execute - 1 + pending_penalty);
+        }
+        ideal = last.execute + 1;
+    }
+    uint64_t decode = std::max(fetch + 1, last.execute);
+    uint64_t execute = std::max(ideal, decode + 1);
+    if (execute > ideal) {
+        (pending_flush ? stats.flush_stalls : stats.control_stalls) += execute - ideal;
+    }
+    // A slow fetch keeps the instruction in IF
+    if (fetch_latency != 0) {
+        decode = std::max(fetch + 1 + fetch_latency, last.execute);
+        uint64_t fetched = std::max(ideal, decode + 1);
+        stats.fetch_stalls += fetched - execute;
+        execute = fetched;
+    }
+    // MEM is busy until the instruction ahead leaves it
+    if (started && last.write_back > execute + 1) {
+        stats.memory_stalls += last.write_back - (execute + 1);
+        execute = last.write_back - 1;
+    }
+
+    // ID -> EX hazard: wait for the sources to be forwarded or written back
+    uint64_t operands = 0;
+    bool from_load = false;
+    if (reads_rs1 && rs1 != 0) {
+        operands = ready[rs1];
+        from_load = ready_from_load[rs1];
+    }
+    if (reads_rs2 && rs2 != 0 && ready[rs2] > operands) {
+        operands = ready[rs2];
+        from_load = ready_from_load[rs2];
+    }
+    if (operands > execute) {
+        (from_load ? stats.load_use_stalls : stats.data_stalls) += operands - execute;
+        execute = operands;
+    }
+
+    // Results leave EX for EX/MEM and MEM for MEM/WB, and are in the register file after WB
+    uint64_t memory = execute + 1;
+    uint64_t write_back = memory + 1 + memory_latency;
+    if (writes_rd && rd != 0) {
+        if (load) {
+            ready[rd] = config.forward_mem ? write_back : write_back + 1;
+            ready_from_load[rd] = config.forward_mem;
+        } else {
+            ready[rd] = config.forward_ex ? memory : config.forward_mem ? write_back : write_back + 1;
+            ready_from_load[rd] = false;
+        }
+    }
+
+    started = true;
+    last = StageTimes{fetch, decode, execute, write_back};
+    pending_penalty = penalty;
+    pending_flush = flush;
+    stats.cycles = write_back + 1;
+    ++(trapped ? stats.traps : stats.instructions);
+}
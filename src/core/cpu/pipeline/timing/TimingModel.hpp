@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+
+// Shape of the modelled core: a single issue, in-order IF/ID/EX/MEM/WB pipeline whose stages
+// take one cycle each
+struct TimingConfig {
+    bool forward_ex = true;       // EX/MEM latch -> EX: an ALU result feeds the next instruction
+    bool forward_mem = true;      // MEM/WB latch -> EX: loads and older results skip the register file
+    uint32_t branch_penalty = 2;  // bubbles after a mispredicted branch or JALR, resolved in EX
+    uint32_t jump_penalty = 1;    // bubbles after a mispredicted JAL, resolved in ID
+    uint32_t flush_penalty = 3;   // bubbles after a trap, MRET or FENCE.I, redirected from MEM
+};
+
+struct TimingStats {
+    uint64_t cycles = 0;          // from the first fetch to the last write back
+    uint64_t instructions = 0;    // retired, trapping instructions excluded
+    uint64_t traps = 0;           // instructions that trapped, they still went down the pipeline
+    uint64_t load_use_stalls = 0; // bubbles waiting for a load even with forwarding
+    uint64_t data_stalls = 0;     // bubbles waiting for a result the enabled forwarding paths miss
+    uint64_t control_stalls = 0;  // bubbles fetched behind mispredicted branches and jumps
+    uint64_t flush_stalls = 0;    // bubbles after traps, MRET and FENCE.I
+    uint64_t fetch_stalls = 0;    // cycles IF waited for the instruction cache
+    uint64_t memory_stalls = 0;   // cycles MEM held the pipeline waiting for the data cache
+
+    double cpi() const { return instructions != 0 ? static_cast<double>(cycles) / static_cast<double>(instructions) : 0.0; }
+};
+
+// Cycle-approximate timing of the instructions the pipeline executes, fed one instruction at a
+// time in program order once it completed functionally (execute at fetch). The functional
+// result is never affected, only the cycle each instruction spends in each stage.
+//
+// An instruction enters a stage once it left the previous one and the instruction ahead of it
+// left that stage, i.e. once the latch in front of the stage is free. Bubbles come from two places:
+//  - ID -> EX: a source register whose producer is still too close. With forwarding the value
+//    comes from the EX/MEM or MEM/WB latch; a load result only exists in MEM/WB, one cycle too
+//    late for the instruction right behind it (load-use). Without forwarding the consumer reads
+//    the register file in ID during or after the write back of the producer.
+//  - IF: after a redirect the instructions fetched on the wrong path are flushed, modelled as
+//    fetch being held for the penalty of the redirect. Fetch follows the next PC the caller
+//    says was predicted, e.g. by a BranchPredictionUnit, a branch or jump that went elsewhere
+//    redirects. Without a predictor that is PC + 4, every taken branch and jump redirects.
+//
+// Store data is needed in EX like any other operand. Fetch and memory take a single cycle plus
+// the latency the caller reports for the access, e.g. from a CacheHierarchy: a slow fetch holds
+// IF, a slow load or store holds MEM and everything behind it (blocking caches).
+class TimingModel {
+private:
+    // Cycle each stage was entered by the last instruction, the state of the latches
+    struct StageTimes {
+        uint64_t fetch = 0;
+        uint64_t decode = 0;
+        uint64_t execute = 0;
+        uint64_t write_back = 0;
+    };
+
+    TimingConfig config;
+    TimingStats stats;
+    bool started;
+    StageTimes last;
+    uint32_t pending_penalty;   // fetch bubbles owed to the last instruction
+    bool pending_flush;         // those bubbles come from a flush, not a branch
+    uint64_t ready[32];         // first cycle a consumer of each register may be in EX
+    bool ready_from_load[32];   // that cycle is set by a load
+
+public:
+    TimingModel();
+
+    // Accounts one instruction. raw is 0 when the fetch itself trapped, next_pc is where the
+    // hart went after it and predicted_pc where fetch went. The latencies are the cycles its
+    // fetch and its data access took on top of the one cycle of their stage
+    void record(uint32_t raw, uint32_t pc, uint32_t next_pc, uint32_t predicted_pc, bool trapped,
+                uint32_t fetch_latency = 0, uint32_t memory_latency = 0);
+
+    const TimingConfig& get_config() const { return config; }
+    void set_config(const TimingConfig& value) { config = value; }
+    const TimingStats& get_stats() const { return stats; }
+    void reset();               // clears the counters, the next instruction starts an empty pipeline
+};
@@ -1,9 +1,8 @@
 #include "WriteBackStage.hpp"
-#include <stdexcept>
 #include <variant>
 
 WriteBackStage::WriteBackStage(RegisterBank& register_bank)
-    : register_bank(register_bank), decoded_instruction(DecodedInstruction<InstructionFormat::INIVALID_TYPE>(0))
+    : register_bank(register_bank)
 {
 }
 
@@ -15,45 +14,25 @@ void WriteBackStage::set_memory_access_result(const MemoryAccessResult& mem_resu
     memory_access_result = mem_result;
 }
 
+void WriteBackStage::set_instruction(const CompactInstruction& decoded) {
+    instruction = decoded;
+}
+
 void WriteBackStage::set_decoded_instruction(const DecodedInstructionVariant& decoded_instr) {
-    decoded_instruction = decoded_instr;
+    instruction = decode_compact(std::visit([](const auto& inst) { return inst.raw; }, decoded_instr));
 }
 
 void WriteBackStage::process() {
-    //Use visit to decay instruction variant
-    std::visit([this](auto& inst) {
-        using T = std::decay_t<decltype(inst)>;
-
-        if constexpr (T::format == InstructionFormat::R_TYPE) {
-            //Write in rd
-            if (inst.rd != 0) {
-                register_bank.write(inst.rd, execution_result.alu_result);
-            }
-        }
-        else if constexpr (T::format == InstructionFormat::I_TYPE) {
-            //could be load or arithmetic instruction
-            if (inst.opcode == 0x03) { // load
-                if (inst.rd != 0 && memory_access_result.load_data.has_value()) {
-                    register_bank.write(inst.rd, memory_access_result.load_data.value());
-                }
-            } else {
-                // arithmetic instruction write in rd
-                if (inst.rd != 0) {
-                    register_bank.write(inst.rd, execution_result.alu_result);
-                }
-            }
-        }
-        else if constexpr (T::format == InstructionFormat::U_TYPE) {
-            //write in rd
-            if (inst.rd != 0) {
-                register_bank.write(inst.rd, execution_result.alu_result);
-            }
-        }
-        else if constexpr (T::format == InstructionFormat::J_TYPE) {
-            if (inst.rd != 0) {
-                register_bank.write(inst.rd, execution_result.alu_result);
-            }
+    if (instruction.rd == 0) {
+        return;
+    }
+    // Loads and atomics write the value read from memory, ALU operations, LUI/AUIPC and the link
+    // of jumps the ALU result. Stores and branches do not write back
+    if ((instruction.op >= Operation::LB && instruction.op <= Operation::LHU) || is_atomic(instruction.op)) {
+        if (memory_access_result.load_data.has_value()) {
+            register_bank.write(instruction.rd, memory_access_result.load_data.value());
         }
-        // s type and b type do not need WB
-    }, decoded_instruction);
+    } else if (writes_alu_result(instruction.op)) {
+        register_bank.write(instruction.rd, execution_result.alu_result);
+    }
 }
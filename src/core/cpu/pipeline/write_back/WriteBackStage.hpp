@@ -10,6 +10,7 @@ public:
 
     void set_execution_result(const ExecutionResult& exec_result);
     void set_memory_access_result(const MemoryAccessResult& mem_result);
+    void set_instruction(const CompactInstruction& decoded);
     void set_decoded_instruction(const DecodedInstructionVariant& decoded_instr);
 
     void process();
@@ -18,6 +19,6 @@ private:
     RegisterBank& register_bank;
     ExecutionResult execution_result;
     MemoryAccessResult memory_access_result;
-    DecodedInstructionVariant decoded_instruction;
+    CompactInstruction instruction;
 };
 
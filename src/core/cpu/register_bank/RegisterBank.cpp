@@ -22,6 +22,14 @@ void RegisterBank::write(uint8_t reg, uint32_t value) {
     registers[reg] = value;
 }
 
+const uint32_t* RegisterBank::data() const {
+    return registers.data();
+}
+
+uint32_t* RegisterBank::data() {
+    return registers.data();
+}
+
 uint32_t RegisterBank::get_pc() const {
     return pc;
 }
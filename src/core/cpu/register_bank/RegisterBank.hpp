@@ -13,6 +13,20 @@ public:
     uint32_t read(uint8_t reg) const;
     void write(uint8_t reg, uint32_t value);
 
+    /**
+     * @brief Gets the 32 general purpose registers as a contiguous array, x0 first.
+     * @return Pointer to the registers, valid for the lifetime of the bank.
+     */
+    const uint32_t* data() const;
+
+    /**
+     * @brief Gets the registers for in place updates by execution engines.
+     *
+     * Unlike write() nothing protects x0, the caller must leave it at zero.
+     * @return Pointer to the registers, valid for the lifetime of the bank.
+     */
+    uint32_t* data();
+
     /**
      * @brief Gets the current value of the program counter (PC).
      * @return The value of the PC.
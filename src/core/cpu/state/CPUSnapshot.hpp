@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "core/cpu/jit/JitCompiler.hpp"
+#include "core/cpu/pipeline/fetch/BranchPredictionUnit.hpp"
+#include "core/cpu/pipeline/timing/CacheHierarchy.hpp"
+#include "core/cpu/pipeline/timing/TimingModel.hpp"
+#include "core/cpu/register_bank/RegisterBank.hpp"
+#include "core/cpu/state/CSRFile.hpp"
+#include "core/cpu/state/ExecutionMode.hpp"
+#include "core/cpu/state/PrivilegeMode.hpp"
+#include "core/loader/SymbolTable.hpp"
+#include "core/memory/Bus.hpp"
+#include "core/memory/MemorySnapshot.hpp"
+#include "core/memory/MMU.hpp"
+#include "core/memory/PageTable.hpp"
+
+/**
+ * @brief Architectural state of a CPU captured at one point in time.
+ *
+ * Register and translation state are plain copies, the memory contents are shared
+ * copy-on-write by every CPU restored or forked from the snapshot.
+ *
+ * The settings of the CPU, its symbols and its ROM and device regions are only used to build a
+ * CPU from the snapshot, restoring rewinds the architectural state and keeps the configuration of
+ * the CPU.
+ * Devices hold state that cannot be copied, a CPU cannot be built from a snapshot that has any.
+ */
+struct CPUSnapshot {
+    RegisterBank register_bank;
+    CSRFile csrs;
+    PageTable page_table;
+    PrivilegeMode privilege_mode;
+    TranslationMode translation_mode;
+    uint32_t satp;
+    MemoryBacking memory_backing;
+    std::shared_ptr<const MemorySnapshot> memory;
+
+    ExecutionMode execution_mode;
+    MisalignedAccess misaligned_access;
+    bool fusion_enabled;
+    bool timing_enabled;
+    TimingConfig timing_config;
+    bool cache_enabled;
+    CacheHierarchyConfig cache_config;
+    BranchPredictorConfig branch_predictor_config;
+    JitConfig jit_config;
+    std::vector<BusRegion> bus_regions;   /**< ROM storage is shared, it is never written */
+    std::shared_ptr<const SymbolTable> symbols;
+};
@@ -0,0 +1,63 @@
+#include "CSRFile.hpp"
+
+bool CSRFile::is_accessible(uint16_t address, PrivilegeMode mode, bool is_write) {
+    uint32_t required = (address >> 8) & 0x3;
+    if (static_cast<uint32_t>(mode) < required) {
+        return false;
+    }
+    return !is_write || ((address >> 10) & 0x3) != 0x3;
+}
+
+bool CSRFile::read(uint16_t address, PrivilegeMode mode, uint32_t& value) const {
+    if (!is_accessible(address, mode, false)) {
+        return false;
+    }
+    switch (address) {
+        case MSTATUS:   value = mstatus; break;
+        case MISA:      value = MISA_RV32IMA; break;
+        case MIE:       value = mie; break;
+        case MTVEC:     value = mtvec; break;
+        case MSCRATCH:  value = mscratch; break;
+        case MEPC:      value = mepc; break;
+        case MCAUSE:    value = mcause; break;
+        case MTVAL:     value = mtval; break;
+        case MIP:       value = mip; break;
+        case MVENDORID:
+        case MARCHID:
+        case MIMPID:    value = 0; break;
+        case MHARTID:   value = mhartid; break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+bool CSRFile::write(uint16_t address, PrivilegeMode mode, uint32_t value) {
+    if (!is_accessible(address, mode, true)) {
+        return false;
+    }
+    switch (address) {
+        case MSTATUS: {
+            // Only MIE, MPIE and MPP are implemented. MPP is WARL, the reserved mode 2 is ignored
+            uint32_t mpp = (value & MSTATUS_MPP) >> MSTATUS_MPP_SHIFT;
+            uint32_t mask = MSTATUS_MIE | MSTATUS_MPIE | (mpp != 2 ? MSTATUS_MPP : 0);
+            mstatus = (mstatus & ~mask) | (value & mask);
+            break;
+        }
+        case MISA:
+            break; // Writes are ignored, the extensions cannot be turned off
+        case MIE:       mie = value; break;
+        case MTVEC:
+            // Direct (0) and vectored (1) modes, the reserved modes keep the previous mode
+            mtvec = (value & 0x3) < 2 ? value : (value & ~0x3u) | (mtvec & 0x3);
+            break;
+        case MSCRATCH:  mscratch = value; break;
+        case MEPC:      mepc = value & ~0x3u; break; // IALIGN is 32, no compressed instructions
+        case MCAUSE:    mcause = value; break;
+        case MTVAL:     mtval = value; break;
+        case MIP:       mip = value; break;
+        default:
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+
+#include "PrivilegeMode.hpp"
+
+/**
+ * @brief Machine mode control and status registers used by the trap mechanism.
+ *
+ * Only the registers needed to take and return from traps are modelled. The registers are
+ * public so the pipeline can update them on trap entry without going through the checked
+ * CSR instruction path, read() and write() implement the Zicsr view the guest sees. satp is
+ * held by the MMU, the pipeline serves it and only its address and access rules live here.
+ */
+class CSRFile {
+public:
+    static constexpr uint16_t SATP = 0x180;
+    static constexpr uint16_t MSTATUS = 0x300;
+    static constexpr uint16_t MISA = 0x301;
+    static constexpr uint16_t MIE = 0x304;
+    static constexpr uint16_t MTVEC = 0x305;
+    static constexpr uint16_t MSCRATCH = 0x340;
+    static constexpr uint16_t MEPC = 0x341;
+    static constexpr uint16_t MCAUSE = 0x342;
+    static constexpr uint16_t MTVAL = 0x343;
+    static constexpr uint16_t MIP = 0x344;
+    static constexpr uint16_t MVENDORID = 0xF11;
+    static constexpr uint16_t MARCHID = 0xF12;
+    static constexpr uint16_t MIMPID = 0xF13;
+    static constexpr uint16_t MHARTID = 0xF14;
+
+    static constexpr uint32_t MSTATUS_MIE = 1u << 3;   /**< Machine interrupt enable */
+    static constexpr uint32_t MSTATUS_MPIE = 1u << 7;  /**< MIE before the last trap */
+    static constexpr uint32_t MSTATUS_MPP_SHIFT = 11;  /**< Privilege mode before the last trap */
+    static constexpr uint32_t MSTATUS_MPP = 3u << MSTATUS_MPP_SHIFT;
+    static constexpr uint32_t SATP_WRITABLE = 0x803FFFFF; /**< MODE and PPN, ASIDs are not implemented */
+    static constexpr uint32_t MISA_RV32IMA = (1u << 30) | (1u << ('A' - 'A')) | (1u << ('I' - 'A')) | (1u << ('M' - 'A')) | (1u << ('S' - 'A')) | (1u << ('U' - 'A'));
+
+    uint32_t mstatus = 0;
+    uint32_t mie = 0;
+    uint32_t mtvec = 0;    /**< Trap handler base, 0 means no handler is installed */
+    uint32_t mscratch = 0;
+    uint32_t mepc = 0;     /**< PC of the instruction that trapped */
+    uint32_t mcause = 0;   /**< Cause of the last trap */
+    uint32_t mtval = 0;    /**< Faulting address or instruction of the last trap */
+    uint32_t mip = 0;
+    uint32_t mhartid = 0;  /**< Fixed when the hart is created, read-only to the guest */
+
+    /**
+     * @brief Reads a CSR the way a CSR instruction does.
+     * @param address The 12-bit CSR address.
+     * @param mode The privilege mode of the access.
+     * @param value Receives the register value.
+     * @return False if the CSR does not exist or is not accessible from the mode (illegal instruction).
+     */
+    bool read(uint16_t address, PrivilegeMode mode, uint32_t& value) const;
+
+    /**
+     * @brief Writes a CSR the way a CSR instruction does, WARL fields keep their legal values.
+     * @param address The 12-bit CSR address.
+     * @param mode The privilege mode of the access.
+     * @param value The value to write.
+     * @return False if the CSR does not exist, is read-only or is not accessible from the mode.
+     */
+    bool write(uint16_t address, PrivilegeMode mode, uint32_t value);
+
+    /**
+     * @brief Checks whether a CSR may be accessed from a privilege mode.
+     * @param address The 12-bit CSR address, bits [9:8] hold the lowest privilege allowed.
+     * @param mode The privilege mode of the access.
+     * @param is_write Writes are also refused on read-only CSRs, bits [11:10] set.
+     */
+    static bool is_accessible(uint16_t address, PrivilegeMode mode, bool is_write);
+};
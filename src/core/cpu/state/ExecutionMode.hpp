@@ -0,0 +1,11 @@
+#pragma once
+
+/**
+ * @brief How CPU::run executes guest code. Every mode leaves the same registers and memory behind.
+ */
+enum class ExecutionMode {
+    PIPELINE = 0,  /**< One instruction at a time through the pipeline stages */
+    THREADED = 1,  /**< Translated basic blocks with direct threaded dispatch, see ThreadedEngine */
+    JIT = 2,       /**< THREADED, with hot blocks compiled to x86-64, see JitCompiler */
+    FUNCTIONAL = 3 /**< One instruction at a time in a single step, no stages, see FunctionalEngine */
+};
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "core/memory/MMU.hpp"
+
+/**
+ * @brief Synchronous exception causes, the values are the RISC-V mcause codes.
+ */
+enum class TrapCause : uint32_t {
+    INSTRUCTION_ADDRESS_MISALIGNED = 0,
+    INSTRUCTION_ACCESS_FAULT = 1,
+    ILLEGAL_INSTRUCTION = 2,
+    BREAKPOINT = 3,
+    LOAD_ADDRESS_MISALIGNED = 4,
+    LOAD_ACCESS_FAULT = 5,
+    STORE_ADDRESS_MISALIGNED = 6,
+    STORE_ACCESS_FAULT = 7,
+    ECALL_FROM_USER = 8,
+    ECALL_FROM_SUPERVISOR = 9,
+    ECALL_FROM_MACHINE = 11,
+    INSTRUCTION_PAGE_FAULT = 12,
+    LOAD_PAGE_FAULT = 13,
+    STORE_PAGE_FAULT = 15
+};
+
+/**
+ * @brief A trap raised by a pipeline stage, returned by value instead of thrown.
+ */
+struct Trap {
+    bool raised = false;
+    TrapCause cause = TrapCause::ILLEGAL_INSTRUCTION;
+    uint32_t value = 0; /**< Written to mtval: the faulting address or instruction bits */
+};
+
+/**
+ * @brief Thrown by the CPU when the guest takes a trap and no trap handler is installed.
+ *
+ * Never thrown inside the pipeline, a trap with a handler is a jump to mtvec.
+ */
+class UnhandledTrapException : public std::runtime_error {
+public:
+    UnhandledTrapException(const std::string& msg, const Trap& trap, uint32_t pc)
+        : std::runtime_error(msg), trap(trap), pc(pc) {}
+
+    Trap trap;   /**< The trap that was not handled */
+    uint32_t pc; /**< Address of the instruction that raised it */
+};
+
+namespace trap {
+
+/**
+ * @brief Builds the trap of a failed memory access.
+ * @param status The failed status, anything but MemoryStatus::OK.
+ * @param type The kind of access, it selects between the fetch, load and store causes.
+ * @param address The faulting virtual address.
+ */
+inline Trap from_memory_status(MemoryStatus status, AccessType type, uint32_t address) {
+    if (status == MemoryStatus::MISALIGNED) {
+        TrapCause cause = type == AccessType::EXECUTE ? TrapCause::INSTRUCTION_ADDRESS_MISALIGNED
+                        : type == AccessType::WRITE   ? TrapCause::STORE_ADDRESS_MISALIGNED
+                                                      : TrapCause::LOAD_ADDRESS_MISALIGNED;
+        return Trap{true, cause, address};
+    }
+    bool page_fault = status == MemoryStatus::PAGE_FAULT;
+    TrapCause cause;
+    switch (type) {
+        case AccessType::EXECUTE:
+            cause = page_fault ? TrapCause::INSTRUCTION_PAGE_FAULT : TrapCause::INSTRUCTION_ACCESS_FAULT;
+            break;
+        case AccessType::WRITE:
+            cause = page_fault ? TrapCause::STORE_PAGE_FAULT : TrapCause::STORE_ACCESS_FAULT;
+            break;
+        default:
+            cause = page_fault ? TrapCause::LOAD_PAGE_FAULT : TrapCause::LOAD_ACCESS_FAULT;
+            break;
+    }
+    return Trap{true, cause, address};
+}
+
+/**
+ * @brief Gets a readable name of a trap cause, for log and exception messages.
+ */
+inline const char* cause_name(TrapCause cause) {
+    switch (cause) {
+        case TrapCause::INSTRUCTION_ADDRESS_MISALIGNED: return "instruction address misaligned";
+        case TrapCause::INSTRUCTION_ACCESS_FAULT: return "instruction access fault";
+        case TrapCause::ILLEGAL_INSTRUCTION: return "illegal instruction";
+        case TrapCause::BREAKPOINT: return "breakpoint";
+        case TrapCause::LOAD_ADDRESS_MISALIGNED: return "load address misaligned";
+        case TrapCause::LOAD_ACCESS_FAULT: return "load access fault";
+        case TrapCause::STORE_ADDRESS_MISALIGNED: return "store address misaligned";
+        case TrapCause::STORE_ACCESS_FAULT: return "store access fault";
+        case TrapCause::ECALL_FROM_USER: return "environment call from U-mode";
+        case TrapCause::ECALL_FROM_SUPERVISOR: return "environment call from S-mode";
+        case TrapCause::ECALL_FROM_MACHINE: return "environment call from M-mode";
+        case TrapCause::INSTRUCTION_PAGE_FAULT: return "instruction page fault";
+        case TrapCause::LOAD_PAGE_FAULT: return "load page fault";
+        case TrapCause::STORE_PAGE_FAULT: return "store page fault";
+    }
+    return "unknown trap";
+}
+
+} // namespace trap
@@ -0,0 +1,122 @@
+#include "BlockCache.hpp"
+#include <algorithm>
+
+BlockCache::BlockCache() : written(false) {
+    table.fill(nullptr);
+}
+
+ThreadedBlock* BlockCache::find_slow(uint32_t pc, uint32_t physical_pc) {
+    auto it = blocks.find(pc);
+    if (it == blocks.end() || it->second->physical_pc != physical_pc) {
+        return nullptr;
+    }
+    table[table_index(pc)] = it->second.get();
+    return it->second.get();
+}
+
+ThreadedBlock* BlockCache::insert(std::unique_ptr<ThreadedBlock> block) {
+    auto it = blocks.find(block->pc);
+    if (it != blocks.end()) {
+        // Same virtual PC translated elsewhere, the page table changed
+        remove(it->second.get());
+    }
+    ThreadedBlock* inserted = block.get();
+    pages[inserted->physical_pc >> MMU::PAGE_SHIFT].push_back(inserted);
+    table[table_index(inserted->pc)] = inserted;
+    blocks.emplace(inserted->pc, std::move(block));
+    ++stats.blocks_translated;
+    return inserted;
+}
+
+void BlockCache::remove(ThreadedBlock* block) {
+    // Compiled blocks chained to this one must stop jumping into it
+    block->unlink();
+    if (table[table_index(block->pc)] == block) {
+        table[table_index(block->pc)] = nullptr;
+    }
+    auto page = pages.find(block->physical_pc >> MMU::PAGE_SHIFT);
+    if (page != pages.end()) {
+        std::erase(page->second, block);
+        if (page->second.empty()) {
+            pages.erase(page);
+        }
+    }
+    auto it = blocks.find(block->pc);
+    if (it != blocks.end() && it->second.get() == block) {
+        retired.push_back(std::move(it->second));
+        blocks.erase(it);
+    }
+}
+
+void BlockCache::invalidate(uint32_t physical_address, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    uint64_t first = physical_address;
+    uint64_t end = first + size;
+    for (uint64_t page_number = first >> MMU::PAGE_SHIFT; page_number <= (end - 1) >> MMU::PAGE_SHIFT; ++page_number) {
+        auto page = pages.find(static_cast<uint32_t>(page_number));
+        if (page == pages.end()) {
+            continue;
+        }
+        // remove() edits the page list, work on a copy
+        std::vector<ThreadedBlock*> candidates = page->second;
+        for (ThreadedBlock* block : candidates) {
+            uint64_t block_start = block->physical_pc;
+            uint64_t block_end = block_start + 4ull * block->instruction_count;
+            if (block_start < end && first < block_end) {
+                remove(block);
+                ++stats.invalidations;
+            }
+        }
+    }
+}
+
+void BlockCache::invalidate_page(uint32_t physical_address) {
+    invalidate(physical_address & MMU::PAGE_MASK, MMU::PAGE_SIZE);
+}
+
+void BlockCache::flush() {
+    blocks.clear();
+    table.fill(nullptr);
+    pages.clear();
+    retired.clear();
+    ++stats.flushes;
+}
+
+void BlockCache::drop_compiled() {
+    for (auto& [pc, block] : blocks) {
+        block->drop_compiled();
+    }
+    for (auto& block : retired) {
+        block->drop_compiled();
+    }
+}
+
+std::vector<uint32_t> BlockCache::get_pages() const {
+    std::vector<uint32_t> addresses;
+    addresses.reserve(pages.size());
+    for (const auto& [page_number, page_blocks] : pages) {
+        addresses.push_back(page_number << MMU::PAGE_SHIFT);
+    }
+    return addresses;
+}
+
+void BlockCache::release_retired() {
+    retired.clear();
+}
+
+void BlockCache::on_code_write(uint32_t physical_address, size_t size) {
+    // Data sharing a page with code drops nothing, the running block can go on
+    uint64_t before = stats.invalidations;
+    invalidate(physical_address, size);
+    written = written || stats.invalidations != before;
+}
+
+ThreadedStats& BlockCache::get_stats() {
+    return stats;
+}
+
+const ThreadedStats& BlockCache::get_stats() const {
+    return stats;
+}
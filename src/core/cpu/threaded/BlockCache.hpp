@@ -0,0 +1,94 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "core/memory/MMU.hpp"
+#include "ThreadedBlock.hpp"
+
+// Counters of the threaded engine
+struct ThreadedStats {
+    uint64_t blocks_translated = 0; // blocks built from guest code
+    uint64_t blocks_executed = 0;   // block entries
+    uint64_t instructions = 0;      // instructions retired inside blocks
+    uint64_t fallbacks = 0;         // instructions executed by the pipeline instead
+    uint64_t invalidations = 0;     // blocks dropped because their bytes were written
+    uint64_t flushes = 0;           // whole cache flushes (FENCE.I, snapshot restore, program load)
+    uint64_t blocks_compiled = 0;   // blocks compiled to host code by the JIT
+    uint64_t evictions = 0;         // JIT code arena resets because it was full
+};
+
+// Translated blocks keyed by the virtual PC of their first instruction. A direct mapped table
+// in front of the map serves the lookups of hot code. Each block remembers the physical address
+// it was translated from, a lookup only hits when the PC still translates there, so a page
+// table change never runs stale code.
+//
+// The engine marks the pages of its blocks as code in the MMU. A write to them reaches
+// on_code_write, which drops every block overlapping the written bytes. The write may come from
+// a store of the block being executed, so dropped blocks are kept alive until release_retired
+// is called between two blocks, and code_written tells the running block to stop.
+class BlockCache : public CodeWriteListener {
+public:
+    static constexpr uint32_t TABLE_SIZE = 4096; // power of two
+
+private:
+    std::unordered_map<uint32_t, std::unique_ptr<ThreadedBlock>> blocks; // by virtual PC
+    std::array<ThreadedBlock*, TABLE_SIZE> table;                        // by word of the virtual PC
+    std::unordered_map<uint32_t, std::vector<ThreadedBlock*>> pages;     // by physical page number
+    std::vector<std::unique_ptr<ThreadedBlock>> retired;
+    bool written;
+    ThreadedStats stats;
+
+    static uint32_t table_index(uint32_t pc) {
+        return (pc >> 2) & (TABLE_SIZE - 1);
+    }
+    void remove(ThreadedBlock* block); // unlinks a block and moves it to retired
+
+public:
+    BlockCache();
+
+    // Returns the block starting at pc if it was translated from physical_pc, nullptr otherwise
+    ThreadedBlock* find(uint32_t pc, uint32_t physical_pc) {
+        ThreadedBlock* block = table[table_index(pc)];
+        if (block != nullptr && block->pc == pc && block->physical_pc == physical_pc) {
+            return block;
+        }
+        return find_slow(pc, physical_pc);
+    }
+    ThreadedBlock* find_slow(uint32_t pc, uint32_t physical_pc);
+
+    // Takes a new block, replacing any block starting at the same PC
+    ThreadedBlock* insert(std::unique_ptr<ThreadedBlock> block);
+
+    // Drops the blocks overlapping a written physical range
+    void invalidate(uint32_t physical_address, size_t size);
+
+    // Drops every block of a physical page
+    void invalidate_page(uint32_t physical_address);
+
+    // Drops everything, only called between two blocks
+    void flush();
+
+    // Forgets the compiled code of every block, the JIT code arena was reset
+    void drop_compiled();
+
+    // Physical base addresses of the pages with blocks
+    std::vector<uint32_t> get_pages() const;
+
+    // Frees the blocks dropped so far, only called between two blocks
+    void release_retired();
+
+    // True once a write dropped a block since clear_code_written
+    bool code_written() const {
+        return written;
+    }
+    void clear_code_written() {
+        written = false;
+    }
+
+    void on_code_write(uint32_t physical_address, size_t size) override;
+
+    ThreadedStats& get_stats();
+    const ThreadedStats& get_stats() const;
+};
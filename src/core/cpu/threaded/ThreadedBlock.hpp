@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Operations of the threaded engine. The order is the order of the handler table of
+// ThreadedEngine::execute, keep both in sync
+enum class ThreadedOpKind : uint8_t {
+    NOP,                                   // ALU operations writing x0
+    FENCE,                                 // full host fence, orders memory against the other harts
+    LI,                                    // LUI and AUIPC, the constant is computed at translation
+    ADD, SUB, SLL, SLT, SLTU, XOR, SRL, SRA, OR, AND,
+    MUL, MULH, MULHSU, MULHU, DIV, DIVU, REM, REMU,
+    ADDI, SLTI, SLTIU, XORI, ORI, ANDI, SLLI, SRLI, SRAI,
+    LB, LH, LW, LBU, LHU,
+    SB, SH, SW,
+    // Every op below leaves the block
+    BEQ, BNE, BLT, BGE, BLTU, BGEU,
+    JAL, JALR,
+    FENCE_I,                               // retires, then the code caches are flushed
+    FALLTHROUGH,                           // the block ends without a control transfer
+    FALLBACK,                              // the instruction is executed by the pipeline
+    COUNT
+};
+
+// Why a block returned to the engine, threaded or compiled
+enum class BlockExit : uint32_t {
+    NEXT,    // continue at next_pc
+    STEP,    // the pipeline executes the instruction at next_pc
+    FENCE_I  // continue at next_pc once the code caches are flushed
+};
+
+// One translated guest instruction: the address of its handler inside ThreadedEngine::execute
+// and its operands, extracted once at translation so the handler does no decoding. The kind is
+// kept for the JIT compiler
+struct ThreadedOp {
+    const void* handler;
+    ThreadedOpKind kind;
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+    uint32_t imm;  // immediate, shift amount, constant or control transfer target
+    uint32_t aux;  // address of the next instruction for the ops leaving the block
+};
+
+// A straight line of guest instructions ending at the first branch, jump, instruction the engine
+// leaves to the pipeline, or at the end of the page. ops[i] is the instruction at pc + 4 * i,
+// except a trailing FALLTHROUGH which only moves to the next block
+struct ThreadedBlock {
+    // A jump slot of compiled code chained to this block, and what it held before
+    struct ChainLink {
+        const void** slot;
+        const void* unlinked;
+    };
+
+    uint32_t pc;                  // virtual address of the first instruction
+    uint32_t physical_pc;         // physical address the block was translated from
+    uint32_t instruction_count;   // guest instructions covered, the block never crosses a page
+    std::vector<ThreadedOp> ops;
+
+    // JIT tier, see JitCompiler
+    uint32_t executions = 0;            // threaded executions while not compiled
+    bool compile_failed = false;        // too large for the code arena, stays threaded
+    const void* compiled = nullptr;     // entry of the compiled code
+    std::vector<ChainLink> incoming;    // slots of other blocks jumping straight to compiled
+
+    // Points every chained slot back at its exit, the compiled code of the block must no longer run
+    void unlink() {
+        for (const ChainLink& link : incoming) {
+            *link.slot = link.unlinked;
+        }
+        incoming.clear();
+    }
+
+    // Forgets the compiled code, once the code arena was reset
+    void drop_compiled() {
+        executions = 0;
+        compile_failed = false;
+        compiled = nullptr;
+        incoming.clear();
+    }
+};
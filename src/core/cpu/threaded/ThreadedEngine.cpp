@@ -0,0 +1,601 @@
+#include "ThreadedEngine.hpp"
+#include <atomic>
+#include "core/cpu/isa/MultiplyDivide.hpp"
+
+ThreadedEngine::ThreadedEngine(RegisterBank& register_bank, MMU& mmu, Bus& bus, Pipeline& pipeline)
+    : register_bank(register_bank), mmu(mmu), bus(bus), pipeline(pipeline), handlers(nullptr)
+{
+    // execute() publishes its handler table when called without a block
+    uint32_t next_pc = 0;
+    uint32_t retired = 0;
+    execute(nullptr, next_pc, retired);
+    mmu.add_code_write_listener(&cache);
+}
+
+ThreadedEngine::~ThreadedEngine() {
+    mmu.remove_code_write_listener(&cache);
+}
+
+CycleStatus ThreadedEngine::run_blocks(uint64_t budget, uint64_t stop_pc, uint64_t& executed) {
+    // No block is running, the ones dropped by the last call can go
+    cache.release_retired();
+    executed = 0;
+
+    uint32_t pc = register_bank.get_pc();
+    uint32_t physical_pc = 0;
+    // A block is at most MAX_BLOCK_INSTRUCTIONS, its fallback included, so whole blocks fit
+    uint64_t max_blocks = budget / MAX_BLOCK_INSTRUCTIONS;
+    if (max_blocks == 0 || !mmu.translate_fetch(pc, physical_pc)) {
+        // Fetch faults and code outside RAM and ROM, the pipeline knows what to do
+        return step(executed);
+    }
+    if (max_blocks > MAX_CHAINED_BLOCKS) {
+        max_blocks = MAX_CHAINED_BLOCKS;
+    }
+    const bool stop_set = stop_pc <= UINT32_MAX;
+
+    ThreadedStats& stats = cache.get_stats();
+    BlockExit exit = BlockExit::NEXT;
+    for (uint32_t chained = 0; chained < max_blocks; ++chained) {
+        ThreadedBlock* block = cache.find(pc, physical_pc);
+        if (block == nullptr) {
+            block = cache.insert(translate(pc, physical_pc));
+            // Writes to the page have to reach the cache from now on
+            mmu.mark_code_page(physical_pc);
+        }
+
+        if (stop_set && stop_pc - pc < 4ull * block->instruction_count) {
+            if (stop_pc == pc) {
+                break;
+            }
+            // The instructions before stop_pc are a straight line, the pipeline walks up to it
+            register_bank.set_pc(pc);
+            return step_to(*block, static_cast<uint32_t>(stop_pc), executed);
+        }
+
+        if (jit != nullptr && block->compiled == nullptr && !block->compile_failed
+            && ++block->executions >= jit_config.threshold) {
+            compile(*block);
+        }
+
+        cache.clear_code_written();
+        if (block->compiled != nullptr) {
+            uint32_t entered = 0;
+            uint64_t retired_before = stats.instructions;
+            // Chained compiled blocks never come back here, the stop check needs them one at a time
+            uint32_t chain_budget = stop_set ? 1 : static_cast<uint32_t>(max_blocks) - chained;
+            exit = run_compiled(*block, pc, chain_budget, entered);
+            executed += stats.instructions - retired_before;
+            chained += entered - 1;
+        } else {
+            uint32_t retired = 0;
+            exit = execute(block, pc, retired);
+            ++stats.blocks_executed;
+            stats.instructions += retired;
+            executed += retired;
+        }
+
+        // Blocks of the same virtual page share its translation, only SYSTEM instructions and
+        // traps change it and those go through the pipeline. Compiled blocks only chain inside
+        // the page too, so this holds for wherever they left
+        if (exit != BlockExit::NEXT || ((pc ^ block->pc) & MMU::PAGE_MASK) != 0) {
+            break;
+        }
+        physical_pc = (block->physical_pc & MMU::PAGE_MASK) | (pc & ~MMU::PAGE_MASK);
+    }
+    register_bank.set_pc(pc);
+
+    switch (exit) {
+        case BlockExit::STEP:
+            return step(executed);
+        case BlockExit::FENCE_I:
+            pipeline.flush_predecode_cache();
+            cache.flush();
+            return CycleStatus::RETIRED;
+        default:
+            return CycleStatus::RETIRED;
+    }
+}
+
+CycleStatus ThreadedEngine::step(uint64_t& executed) {
+    ++cache.get_stats().fallbacks;
+    CycleStatus status = pipeline.run_cycle();
+    // The host stops before ticking when a trap has no handler or the program ended
+    if (completed_instruction(status)) {
+        bus.tick(1);
+        ++executed;
+    }
+    return status;
+}
+
+CycleStatus ThreadedEngine::step_to(const ThreadedBlock& block, uint32_t stop_pc, uint64_t& executed) {
+    CycleStatus status = CycleStatus::RETIRED;
+    uint32_t pc = register_bank.get_pc();
+    while (pc != stop_pc && pc - block.pc < 4 * block.instruction_count && status == CycleStatus::RETIRED) {
+        status = step(executed);
+        pc = register_bank.get_pc();
+    }
+    return status;
+}
+
+void ThreadedEngine::compile(ThreadedBlock& block) {
+    ThreadedStats& stats = cache.get_stats();
+    JitCompiler::Result result = jit->compile(block);
+    if (result == JitCompiler::Result::ARENA_FULL) {
+        // Eviction: every compiled block goes, the hot ones come back as they run again
+        cache.drop_compiled();
+        jit->reset();
+        ++stats.evictions;
+        result = jit->compile(block);
+    }
+    if (result == JitCompiler::Result::COMPILED) {
+        ++stats.blocks_compiled;
+    } else {
+        block.compile_failed = true;
+    }
+}
+
+BlockExit ThreadedEngine::run_compiled(const ThreadedBlock& block, uint32_t& next_pc, uint32_t budget, uint32_t& entered) {
+    JitContext context;
+    context.budget = budget;
+    context.mmu = &mmu;
+    context.bus = &bus;
+    context.cache = &cache;
+    context.tick_devices = bus.has_regions();
+    // Compiled code reads the TLB without checking the page table generation
+    mmu.get_tlb(AccessType::READ);
+
+    jit->enter(block, context, register_bank.data());
+
+    ThreadedStats& stats = cache.get_stats();
+    stats.blocks_executed += context.blocks;
+    stats.instructions += context.retired;
+    if (context.tick_devices && context.retired != context.ticked) {
+        bus.tick(context.retired - context.ticked);
+    }
+    entered = static_cast<uint32_t>(context.blocks);
+    next_pc = context.next_pc;
+
+    if (context.link_slot != nullptr) {
+        // A direct exit inside the page of block, link it if its target is compiled
+        uint32_t physical_pc = (block.physical_pc & MMU::PAGE_MASK) | (next_pc & ~MMU::PAGE_MASK);
+        ThreadedBlock* target = cache.find(next_pc, physical_pc);
+        if (target != nullptr && target->compiled != nullptr) {
+            JitCompiler::link(context.link_slot, *target);
+        }
+    }
+    return context.exit;
+}
+
+ThreadedOp ThreadedEngine::make_op(ThreadedOpKind kind, uint32_t rd, uint32_t rs1, uint32_t rs2, uint32_t imm, uint32_t aux) const {
+    return ThreadedOp{handlers[static_cast<size_t>(kind)], kind, static_cast<uint8_t>(rd), static_cast<uint8_t>(rs1),
+                      static_cast<uint8_t>(rs2), imm, aux};
+}
+
+std::unique_ptr<ThreadedBlock> ThreadedEngine::translate(uint32_t pc, uint32_t physical_pc) {
+    auto block = std::make_unique<ThreadedBlock>();
+    block->pc = pc;
+    block->physical_pc = physical_pc;
+    block->instruction_count = 0;
+
+    uint32_t address = pc;
+    while (true) {
+        if (block->instruction_count == MAX_BLOCK_INSTRUCTIONS || (block->instruction_count != 0 && (address & ~MMU::PAGE_MASK) == 0)) {
+            // Blocks stay inside one page so a single translation validates all of them
+            block->ops.push_back(make_op(ThreadedOpKind::FALLTHROUGH, 0, 0, 0, 0, address));
+            break;
+        }
+        uint32_t raw = 0;
+        ThreadedOp op;
+        bool ends_block;
+        if (mmu.try_fetch_word(address, raw) == MemoryStatus::OK) {
+            ends_block = translate_instruction(raw, address, op);
+        } else {
+            op = make_op(ThreadedOpKind::FALLBACK);
+            ends_block = true;
+        }
+        block->ops.push_back(op);
+        ++block->instruction_count;
+        if (ends_block) {
+            break;
+        }
+        address += 4;
+    }
+    return block;
+}
+
+bool ThreadedEngine::translate_instruction(uint32_t raw, uint32_t pc, ThreadedOp& op) {
+    using Kind = ThreadedOpKind;
+    // Only the encodings the pipeline executes without trapping are translated, the blocks never
+    // have to reproduce its checks. Anything else falls back to it
+    op = make_op(Kind::FALLBACK);
+
+    switch (raw & 0x7F) {
+        case opcodes::OP: {
+            DecodedInstruction<InstructionFormat::R_TYPE> inst(raw);
+            static constexpr Kind base[8] = {Kind::ADD, Kind::SLL, Kind::SLT, Kind::SLTU, Kind::XOR, Kind::SRL, Kind::OR, Kind::AND};
+            static constexpr Kind multiply_divide[8] = {Kind::MUL, Kind::MULH, Kind::MULHSU, Kind::MULHU,
+                                                        Kind::DIV, Kind::DIVU, Kind::REM, Kind::REMU};
+            Kind kind = base[inst.funct3];
+            if (inst.funct7 == 0x20 && inst.funct3 == 0x0) {
+                kind = Kind::SUB;
+            } else if (inst.funct7 == 0x20 && inst.funct3 == 0x5) {
+                kind = Kind::SRA;
+            } else if (inst.funct7 == 0x01) {
+                kind = multiply_divide[inst.funct3];
+            } else if (inst.funct7 != 0x00) {
+                return true;
+            }
+            op = make_op(inst.rd == 0 ? Kind::NOP : kind, inst.rd, inst.rs1, inst.rs2);
+            return false;
+        }
+        case opcodes::OP_IMM: {
+            DecodedInstruction<InstructionFormat::I_TYPE> inst(raw);
+            uint32_t imm = static_cast<uint32_t>(inst.get_immediate());
+            uint32_t shift_type = imm >> 5 & 0x7F;
+            Kind kind;
+            switch (inst.funct3) {
+                case 0x0: kind = Kind::ADDI; break;
+                case 0x2: kind = Kind::SLTI; break;
+                case 0x3: kind = Kind::SLTIU; break;
+                case 0x4: kind = Kind::XORI; break;
+                case 0x6: kind = Kind::ORI; break;
+                case 0x7: kind = Kind::ANDI; break;
+                case 0x1:
+                    if (shift_type != 0x00) {
+                        return true;
+                    }
+                    kind = Kind::SLLI;
+                    imm &= 0x1F;
+                    break;
+                default: // 0x5
+                    if (shift_type != 0x00 && shift_type != 0x20) {
+                        return true;
+                    }
+                    kind = shift_type == 0x20 ? Kind::SRAI : Kind::SRLI;
+                    imm &= 0x1F;
+                    break;
+            }
+            op = make_op(inst.rd == 0 ? Kind::NOP : kind, inst.rd, inst.rs1, 0, imm);
+            return false;
+        }
+        case opcodes::LUI:
+        case opcodes::AUIPC: {
+            DecodedInstruction<InstructionFormat::U_TYPE> inst(raw);
+            uint32_t value = static_cast<uint32_t>(inst.get_immediate()) + ((raw & 0x7F) == opcodes::AUIPC ? pc : 0);
+            op = make_op(inst.rd == 0 ? Kind::NOP : Kind::LI, inst.rd, 0, 0, value);
+            return false;
+        }
+        case opcodes::LOAD: {
+            // Loads into x0 still access memory, they may fault
+            DecodedInstruction<InstructionFormat::I_TYPE> inst(raw);
+            static constexpr Kind kinds[8] = {Kind::LB, Kind::LH, Kind::LW, Kind::FALLBACK, Kind::LBU, Kind::LHU, Kind::FALLBACK, Kind::FALLBACK};
+            if (kinds[inst.funct3] == Kind::FALLBACK) {
+                return true;
+            }
+            op = make_op(kinds[inst.funct3], inst.rd, inst.rs1, 0, static_cast<uint32_t>(inst.get_immediate()));
+            return false;
+        }
+        case opcodes::STORE: {
+            DecodedInstruction<InstructionFormat::S_TYPE> inst(raw);
+            static constexpr Kind kinds[3] = {Kind::SB, Kind::SH, Kind::SW};
+            if (inst.funct3 > 0x2) {
+                return true;
+            }
+            op = make_op(kinds[inst.funct3], 0, inst.rs1, inst.rs2, static_cast<uint32_t>(inst.get_immediate()));
+            return false;
+        }
+        case opcodes::BRANCH: {
+            DecodedInstruction<InstructionFormat::B_TYPE> inst(raw);
+            static constexpr Kind kinds[8] = {Kind::BEQ, Kind::BNE, Kind::FALLBACK, Kind::FALLBACK, Kind::BLT, Kind::BGE, Kind::BLTU, Kind::BGEU};
+            uint32_t target = pc + static_cast<uint32_t>(inst.get_immediate());
+            if (kinds[inst.funct3] != Kind::FALLBACK && (target & 0x3) == 0) {
+                op = make_op(kinds[inst.funct3], 0, inst.rs1, inst.rs2, target, pc + 4);
+            }
+            return true;
+        }
+        case opcodes::JAL: {
+            // A jump to itself ends the program, the pipeline reports it
+            DecodedInstruction<InstructionFormat::J_TYPE> inst(raw);
+            uint32_t target = pc + static_cast<uint32_t>(inst.get_immediate());
+            if (target != pc && (target & 0x3) == 0) {
+                op = make_op(Kind::JAL, inst.rd, 0, 0, target, pc + 4);
+            }
+            return true;
+        }
+        case opcodes::JALR: {
+            DecodedInstruction<InstructionFormat::I_TYPE> inst(raw);
+            if (inst.funct3 == 0x0) {
+                op = make_op(Kind::JALR, inst.rd, inst.rs1, 0, static_cast<uint32_t>(inst.get_immediate()), pc + 4);
+            }
+            return true;
+        }
+        case opcodes::MISC_MEM: {
+            // FENCE orders the accesses of every kind, whatever its predecessor and successor sets.
+            // Encodings with rd set are left to the pipeline
+            DecodedInstruction<InstructionFormat::I_TYPE> inst(raw);
+            if (inst.rd != 0 || inst.funct3 > 0x1) {
+                return true;
+            }
+            if (inst.funct3 == 0x1) {
+                op = make_op(Kind::FENCE_I, 0, 0, 0, 0, pc + 4);
+                return true;
+            }
+            op = make_op(Kind::FENCE);
+            return false;
+        }
+        default:
+            // SYSTEM and unknown opcodes
+            return true;
+    }
+}
+
+// Labels as values are a GNU extension supported by GCC and Clang
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+BlockExit ThreadedEngine::execute(const ThreadedBlock* block, uint32_t& next_pc, uint32_t& retired) {
+    // Indexed by ThreadedOpKind
+    static const void* const labels[] = {
+        &&op_nop, &&op_fence, &&op_li,
+        &&op_add, &&op_sub, &&op_sll, &&op_slt, &&op_sltu, &&op_xor, &&op_srl, &&op_sra, &&op_or, &&op_and,
+        &&op_mul, &&op_mulh, &&op_mulhsu, &&op_mulhu, &&op_div, &&op_divu, &&op_rem, &&op_remu,
+        &&op_addi, &&op_slti, &&op_sltiu, &&op_xori, &&op_ori, &&op_andi, &&op_slli, &&op_srli, &&op_srai,
+        &&op_lb, &&op_lh, &&op_lw, &&op_lbu, &&op_lhu,
+        &&op_sb, &&op_sh, &&op_sw,
+        &&op_beq, &&op_bne, &&op_blt, &&op_bge, &&op_bltu, &&op_bgeu,
+        &&op_jal, &&op_jalr,
+        &&op_fence_i, &&op_fallthrough, &&op_fallback,
+    };
+    static_assert(sizeof(labels) / sizeof(labels[0]) == static_cast<size_t>(ThreadedOpKind::COUNT));
+    if (block == nullptr) {
+        handlers = labels;
+        return BlockExit::NEXT;
+    }
+
+    uint32_t* x = register_bank.data();
+    const ThreadedOp* first = block->ops.data();
+    const ThreadedOp* op = first;
+    BlockExit exit = BlockExit::NEXT;
+    const bool tick_devices = bus.has_regions();
+    uint32_t ticked = 0; // instructions of the block already ticked
+
+// Jumps to the handler of the next op
+#define DISPATCH() goto *(++op)->handler
+// Delivers the ticks of the instructions retired so far before a device may be accessed
+#define SYNC_DEVICES()                                              \
+    if (tick_devices) {                                             \
+        uint32_t index = static_cast<uint32_t>(op - first);         \
+        if (index != ticked) {                                      \
+            bus.tick(index - ticked);                               \
+            ticked = index;                                         \
+        }                                                           \
+    }
+
+    goto *op->handler;
+
+op_nop:   DISPATCH();
+op_fence: std::atomic_thread_fence(std::memory_order_seq_cst); DISPATCH();
+op_li:    x[op->rd] = op->imm; DISPATCH();
+
+op_add:   x[op->rd] = x[op->rs1] + x[op->rs2]; DISPATCH();
+op_sub:   x[op->rd] = x[op->rs1] - x[op->rs2]; DISPATCH();
+op_sll:   x[op->rd] = x[op->rs1] << (x[op->rs2] & 0x1F); DISPATCH();
+op_slt:   x[op->rd] = static_cast<int32_t>(x[op->rs1]) < static_cast<int32_t>(x[op->rs2]) ? 1 : 0; DISPATCH();
+op_sltu:  x[op->rd] = x[op->rs1] < x[op->rs2] ? 1 : 0; DISPATCH();
+op_xor:   x[op->rd] = x[op->rs1] ^ x[op->rs2]; DISPATCH();
+op_srl:   x[op->rd] = x[op->rs1] >> (x[op->rs2] & 0x1F); DISPATCH();
+op_sra:   x[op->rd] = static_cast<uint32_t>(static_cast<int32_t>(x[op->rs1]) >> (x[op->rs2] & 0x1F)); DISPATCH();
+op_or:    x[op->rd] = x[op->rs1] | x[op->rs2]; DISPATCH();
+op_and:   x[op->rd] = x[op->rs1] & x[op->rs2]; DISPATCH();
+
+op_mul:    x[op->rd] = m_extension::mul(x[op->rs1], x[op->rs2]); DISPATCH();
+op_mulh:   x[op->rd] = m_extension::mulh(x[op->rs1], x[op->rs2]); DISPATCH();
+op_mulhsu: x[op->rd] = m_extension::mulhsu(x[op->rs1], x[op->rs2]); DISPATCH();
+op_mulhu:  x[op->rd] = m_extension::mulhu(x[op->rs1], x[op->rs2]); DISPATCH();
+op_div:    x[op->rd] = m_extension::div(x[op->rs1], x[op->rs2]); DISPATCH();
+op_divu:   x[op->rd] = m_extension::divu(x[op->rs1], x[op->rs2]); DISPATCH();
+op_rem:    x[op->rd] = m_extension::rem(x[op->rs1], x[op->rs2]); DISPATCH();
+op_remu:   x[op->rd] = m_extension::remu(x[op->rs1], x[op->rs2]); DISPATCH();
+
+op_addi:  x[op->rd] = x[op->rs1] + op->imm; DISPATCH();
+op_slti:  x[op->rd] = static_cast<int32_t>(x[op->rs1]) < static_cast<int32_t>(op->imm) ? 1 : 0; DISPATCH();
+op_sltiu: x[op->rd] = x[op->rs1] < op->imm ? 1 : 0; DISPATCH();
+op_xori:  x[op->rd] = x[op->rs1] ^ op->imm; DISPATCH();
+op_ori:   x[op->rd] = x[op->rs1] | op->imm; DISPATCH();
+op_andi:  x[op->rd] = x[op->rs1] & op->imm; DISPATCH();
+op_slli:  x[op->rd] = x[op->rs1] << op->imm; DISPATCH();
+op_srli:  x[op->rd] = x[op->rs1] >> op->imm; DISPATCH();
+op_srai:  x[op->rd] = static_cast<uint32_t>(static_cast<int32_t>(x[op->rs1]) >> op->imm); DISPATCH();
+
+    // Loads may target x0, which is zeroed again after the write
+op_lb: {
+    SYNC_DEVICES();
+    uint8_t value;
+    if (mmu.try_read(x[op->rs1] + op->imm, value) != MemoryStatus::OK) {
+        goto fault;
+    }
+    x[op->rd] = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int8_t>(value)));
+    x[0] = 0;
+    DISPATCH();
+}
+op_lh: {
+    SYNC_DEVICES();
+    uint16_t value;
+    if (mmu.try_read_halfword(x[op->rs1] + op->imm, value) != MemoryStatus::OK) {
+        goto fault;
+    }
+    x[op->rd] = static_cast<uint32_t>(static_cast<int32_t>(static_cast<int16_t>(value)));
+    x[0] = 0;
+    DISPATCH();
+}
+op_lw: {
+    SYNC_DEVICES();
+    uint32_t value;
+    if (mmu.try_read_word(x[op->rs1] + op->imm, value) != MemoryStatus::OK) {
+        goto fault;
+    }
+    x[op->rd] = value;
+    x[0] = 0;
+    DISPATCH();
+}
+op_lbu: {
+    SYNC_DEVICES();
+    uint8_t value;
+    if (mmu.try_read(x[op->rs1] + op->imm, value) != MemoryStatus::OK) {
+        goto fault;
+    }
+    x[op->rd] = value;
+    x[0] = 0;
+    DISPATCH();
+}
+op_lhu: {
+    SYNC_DEVICES();
+    uint16_t value;
+    if (mmu.try_read_halfword(x[op->rs1] + op->imm, value) != MemoryStatus::OK) {
+        goto fault;
+    }
+    x[op->rd] = value;
+    x[0] = 0;
+    DISPATCH();
+}
+
+    // A store to code may have dropped this very block, leave it right after the store
+op_sb:
+    SYNC_DEVICES();
+    if (mmu.try_write(x[op->rs1] + op->imm, static_cast<uint8_t>(x[op->rs2])) != MemoryStatus::OK) {
+        goto fault;
+    }
+    if (cache.code_written()) {
+        goto stop_after;
+    }
+    DISPATCH();
+op_sh:
+    SYNC_DEVICES();
+    if (mmu.try_write_halfword(x[op->rs1] + op->imm, static_cast<uint16_t>(x[op->rs2])) != MemoryStatus::OK) {
+        goto fault;
+    }
+    if (cache.code_written()) {
+        goto stop_after;
+    }
+    DISPATCH();
+op_sw:
+    SYNC_DEVICES();
+    if (mmu.try_write_word(x[op->rs1] + op->imm, x[op->rs2]) != MemoryStatus::OK) {
+        goto fault;
+    }
+    if (cache.code_written()) {
+        goto stop_after;
+    }
+    DISPATCH();
+
+op_beq:   next_pc = x[op->rs1] == x[op->rs2] ? op->imm : op->aux; goto leave;
+op_bne:   next_pc = x[op->rs1] != x[op->rs2] ? op->imm : op->aux; goto leave;
+op_blt:   next_pc = static_cast<int32_t>(x[op->rs1]) < static_cast<int32_t>(x[op->rs2]) ? op->imm : op->aux; goto leave;
+op_bge:   next_pc = static_cast<int32_t>(x[op->rs1]) >= static_cast<int32_t>(x[op->rs2]) ? op->imm : op->aux; goto leave;
+op_bltu:  next_pc = x[op->rs1] < x[op->rs2] ? op->imm : op->aux; goto leave;
+op_bgeu:  next_pc = x[op->rs1] >= x[op->rs2] ? op->imm : op->aux; goto leave;
+
+op_jal:
+    x[op->rd] = op->aux;
+    x[0] = 0;
+    next_pc = op->imm;
+    goto leave;
+op_jalr: {
+    // The target is read before the link, rd may be rs1
+    uint32_t target = (x[op->rs1] + op->imm) & ~1u;
+    if (target & 0x3) {
+        goto fault;
+    }
+    x[op->rd] = op->aux;
+    x[0] = 0;
+    next_pc = target;
+    goto leave;
+}
+
+op_fence_i:
+    next_pc = op->aux;
+    exit = BlockExit::FENCE_I;
+    goto leave;
+
+op_fallthrough:
+    // Not an instruction, nothing retires
+    next_pc = op->aux;
+    retired = static_cast<uint32_t>(op - first);
+    goto done;
+
+op_fallback:
+    // The instruction did nothing, the pipeline executes it
+fault:
+    retired = static_cast<uint32_t>(op - first);
+    next_pc = block->pc + 4 * retired;
+    exit = BlockExit::STEP;
+    goto done;
+
+stop_after:
+    retired = static_cast<uint32_t>(op - first) + 1;
+    next_pc = block->pc + 4 * retired;
+    goto done;
+
+leave:
+    // The current op retired
+    retired = static_cast<uint32_t>(op - first) + 1;
+
+done:
+    if (tick_devices && retired != ticked) {
+        bus.tick(retired - ticked);
+    }
+    return exit;
+
+#undef SYNC_DEVICES
+#undef DISPATCH
+}
+
+#pragma GCC diagnostic pop
+
+void ThreadedEngine::flush() {
+    cache.flush();
+    if (jit != nullptr) {
+        jit->reset();
+    }
+}
+
+void ThreadedEngine::invalidate_written_code(const PhysicalMemory& memory) {
+    for (uint32_t page : cache.get_pages()) {
+        if (memory.is_dirty(page)) {
+            cache.invalidate_page(page);
+        }
+    }
+}
+
+const ThreadedStats& ThreadedEngine::get_stats() const {
+    return cache.get_stats();
+}
+
+void ThreadedEngine::reset_stats() {
+    cache.get_stats() = ThreadedStats{};
+}
+
+void ThreadedEngine::set_jit_enabled(bool enabled) {
+    if (enabled == (jit != nullptr)) {
+        return;
+    }
+    cache.drop_compiled();
+    jit = enabled ? std::make_unique<JitCompiler>(mmu, jit_config) : nullptr;
+}
+
+bool ThreadedEngine::is_jit_enabled() const {
+    return jit != nullptr;
+}
+
+void ThreadedEngine::set_jit_config(const JitConfig& config) {
+    jit_config = config;
+    if (jit != nullptr) {
+        cache.drop_compiled();
+        jit = std::make_unique<JitCompiler>(mmu, jit_config);
+    }
+}
+
+const JitConfig& ThreadedEngine::get_jit_config() const {
+    return jit_config;
+}
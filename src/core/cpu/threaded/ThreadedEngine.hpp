@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include "core/cpu/jit/JitCompiler.hpp"
+#include "core/cpu/pipeline/Pipeline.hpp"
+#include "core/cpu/register_bank/RegisterBank.hpp"
+#include "core/memory/Bus.hpp"
+#include "core/memory/MMU.hpp"
+#include "BlockCache.hpp"
+
+// Executes guest code a basic block at a time. A block is translated once into an array of ops,
+// each holding the address of its handler and its decoded operands, and the handlers jump
+// straight to the handler of the next op (direct threading with computed goto). Registers are
+// updated in place in the register bank and memory goes through the same MMU accessors as the
+// pipeline, so the architectural state is the same as running the pipeline one instruction at
+// a time.
+//
+// Everything the blocks do not cover is left to the pipeline, one instruction at a time:
+// SYSTEM instructions, illegal encodings, jumps to self (end of program) and control transfers
+// to misaligned targets. A load or store that faults, or a JALR to a misaligned address, leaves
+// the block before changing anything and the pipeline executes it again to take the trap.
+//
+// Devices are ticked once per retired instruction like CPU::run does. Inside a block the ticks
+// are delivered before each load or store, so a device always sees the same time as under the
+// pipeline, and at the end of the block
+//
+// With the JIT tier on, a block executed threshold times is compiled to host code by the
+// JitCompiler and runs compiled from then on, chained to the other compiled blocks of its page.
+// When the code arena is full every compiled block is dropped and compiled again once hot
+class ThreadedEngine {
+private:
+    static constexpr uint32_t MAX_BLOCK_INSTRUCTIONS = 64;
+    static constexpr uint32_t MAX_CHAINED_BLOCKS = 1024; // per run_blocks() call
+
+    RegisterBank& register_bank;
+    MMU& mmu;
+    Bus& bus;
+    Pipeline& pipeline;
+    BlockCache cache;
+    const void* const* handlers; // label addresses of execute(), indexed by ThreadedOpKind
+    JitConfig jit_config;
+    std::unique_ptr<JitCompiler> jit; // null while the JIT tier is off
+
+    BlockExit execute(const ThreadedBlock* block, uint32_t& next_pc, uint32_t& retired);
+    std::unique_ptr<ThreadedBlock> translate(uint32_t pc, uint32_t physical_pc);
+    bool translate_instruction(uint32_t raw, uint32_t pc, ThreadedOp& op); // returns true if op ends the block
+    ThreadedOp make_op(ThreadedOpKind kind, uint32_t rd = 0, uint32_t rs1 = 0, uint32_t rs2 = 0,
+                       uint32_t imm = 0, uint32_t aux = 0) const;
+    CycleStatus step(uint64_t& executed); // one instruction through the pipeline
+    // Steps through the pipeline from inside block until the PC reaches stop_pc or leaves the block
+    CycleStatus step_to(const ThreadedBlock& block, uint32_t stop_pc, uint64_t& executed);
+    void compile(ThreadedBlock& block);
+    // Runs compiled code from block with a budget of chained blocks, returns the blocks entered
+    BlockExit run_compiled(const ThreadedBlock& block, uint32_t& next_pc, uint32_t budget, uint32_t& entered);
+
+public:
+    ThreadedEngine(RegisterBank& register_bank, MMU& mmu, Bus& bus, Pipeline& pipeline);
+    ~ThreadedEngine();
+    ThreadedEngine(const ThreadedEngine&) = delete;            // the MMU points at the block cache
+    ThreadedEngine& operator=(const ThreadedEngine&) = delete;
+
+    // Runs blocks from the PC, chaining the ones of the same page, until the code leaves the page,
+    // an instruction has to go through the pipeline, which then executes it, or the PC reaches
+    // stop_pc. At most budget instructions are executed, a budget below a whole block runs one
+    // instruction through the pipeline. executed counts the instructions retired or trapped.
+    // Returns the status of the pipeline for the instruction it executed, RETIRED otherwise. A
+    // stop_pc above 32 bits never matches, while one is set compiled blocks run one at a time
+    CycleStatus run_blocks(uint64_t budget, uint64_t stop_pc, uint64_t& executed);
+
+    void flush();                                                  // drops every block
+    void invalidate_written_code(const PhysicalMemory& memory);    // drops the blocks of the pages memory reports dirty
+    const ThreadedStats& get_stats() const;
+    void reset_stats();
+
+    void set_jit_enabled(bool enabled);                           // off by default, drops compiled code when turned off
+    bool is_jit_enabled() const;
+    void set_jit_config(const JitConfig& config);                 // drops compiled code
+    const JitConfig& get_jit_config() const;
+};
@@ -0,0 +1,96 @@
+#include "Timer.hpp"
+
+namespace {
+
+uint32_t low_half(uint64_t value) {
+    return static_cast<uint32_t>(value);
+}
+
+uint32_t high_half(uint64_t value) {
+    return static_cast<uint32_t>(value >> 32);
+}
+
+void set_half(uint64_t& target, bool high, uint32_t value) {
+    if (high) {
+        target = (target & 0xFFFFFFFFull) | (static_cast<uint64_t>(value) << 32);
+    } else {
+        target = (target & ~0xFFFFFFFFull) | value;
+    }
+}
+
+} // namespace
+
+uint32_t Timer::read32(uint32_t offset) {
+    switch (offset) {
+        case MSIP: return msip;
+        case MTIMECMP: return low_half(mtimecmp);
+        case MTIMECMP + 4: return high_half(mtimecmp);
+        case MTIME: return low_half(mtime);
+        case MTIME + 4: return high_half(mtime);
+        default: return 0;
+    }
+}
+
+void Timer::write32(uint32_t offset, uint32_t value) {
+    switch (offset) {
+        case MSIP: msip = value & 1; break;
+        case MTIMECMP: set_half(mtimecmp, false, value); break;
+        case MTIMECMP + 4: set_half(mtimecmp, true, value); break;
+        case MTIME: set_half(mtime, false, value); break;
+        case MTIME + 4: set_half(mtime, true, value); break;
+        default: break;
+    }
+}
+
+// Narrow accesses read or merge into the 32-bit register that contains them
+uint8_t Timer::read8(uint32_t offset) {
+    return static_cast<uint8_t>(read32(offset & ~3u) >> ((offset & 3) * 8));
+}
+
+uint16_t Timer::read16(uint32_t offset) {
+    return static_cast<uint16_t>(read32(offset & ~3u) >> ((offset & 2) * 8));
+}
+
+void Timer::write8(uint32_t offset, uint8_t value) {
+    uint32_t shift = (offset & 3) * 8;
+    uint32_t word = read32(offset & ~3u);
+    write32(offset & ~3u, (word & ~(0xFFu << shift)) | (static_cast<uint32_t>(value) << shift));
+}
+
+void Timer::write16(uint32_t offset, uint16_t value) {
+    uint32_t shift = (offset & 2) * 8;
+    uint32_t word = read32(offset & ~3u);
+    write32(offset & ~3u, (word & ~(0xFFFFu << shift)) | (static_cast<uint32_t>(value) << shift));
+}
+
+void Timer::tick(uint64_t cycles) {
+    mtime += cycles;
+}
+
+std::string Timer::get_name() const {
+    return "timer";
+}
+
+uint64_t Timer::get_mtime() const {
+    return mtime;
+}
+
+void Timer::set_mtime(uint64_t value) {
+    mtime = value;
+}
+
+uint64_t Timer::get_mtimecmp() const {
+    return mtimecmp;
+}
+
+void Timer::set_mtimecmp(uint64_t value) {
+    mtimecmp = value;
+}
+
+bool Timer::timer_interrupt_pending() const {
+    return mtime >= mtimecmp;
+}
+
+bool Timer::software_interrupt_pending() const {
+    return msip & 1;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "core/memory/Device.hpp"
+
+/**
+ * @brief Machine timer with the register layout of the RISC-V CLINT, for a single hart.
+ *
+ * mtime advances by one per tick, that is once per retired instruction, which keeps runs
+ * deterministic. The timer interrupt is pending while mtime >= mtimecmp and the software
+ * interrupt while bit 0 of msip is set. 64-bit registers are accessed as two 32-bit halves.
+ */
+class Timer : public Device {
+public:
+    static constexpr uint32_t SIZE = 0x10000;    /**< Size of the MMIO window */
+    static constexpr uint32_t MSIP = 0x0000;
+    static constexpr uint32_t MTIMECMP = 0x4000;
+    static constexpr uint32_t MTIME = 0xBFF8;
+
+private:
+    uint64_t mtime = 0;
+    uint64_t mtimecmp = ~uint64_t{0};
+    uint32_t msip = 0;
+
+public:
+    uint8_t read8(uint32_t offset) override;
+    uint16_t read16(uint32_t offset) override;
+    uint32_t read32(uint32_t offset) override;
+    void write8(uint32_t offset, uint8_t value) override;
+    void write16(uint32_t offset, uint16_t value) override;
+    void write32(uint32_t offset, uint32_t value) override;
+    void tick(uint64_t cycles) override;
+    std::string get_name() const override;
+
+    uint64_t get_mtime() const;
+    void set_mtime(uint64_t value);
+    uint64_t get_mtimecmp() const;
+    void set_mtimecmp(uint64_t value);
+
+    /**
+     * @brief Checks the machine timer interrupt condition (MTIP).
+     */
+    bool timer_interrupt_pending() const;
+
+    /**
+     * @brief Checks the machine software interrupt condition (MSIP).
+     */
+    bool software_interrupt_pending() const;
+};
@@ -0,0 +1,72 @@
+#include "Uart.hpp"
+#include <iostream>
+
+Uart::Uart(bool echo) : echo(echo) {}
+
+uint8_t Uart::read8(uint32_t offset) {
+    switch (offset) {
+        case RBR_THR: {
+            if (input.empty()) {
+                return 0;
+            }
+            uint8_t value = input.front();
+            input.pop_front();
+            return value;
+        }
+        case IER: return ier;
+        case IIR_FCR: return 0x01; // No interrupt pending
+        case LCR: return lcr;
+        case MCR: return mcr;
+        case LSR: return LSR_THR_EMPTY | LSR_TRANSMITTER_EMPTY | (input.empty() ? 0 : LSR_DATA_READY);
+        case SCR: return scr;
+        default: return 0;
+    }
+}
+
+uint16_t Uart::read16(uint32_t offset) {
+    return read8(offset);
+}
+
+uint32_t Uart::read32(uint32_t offset) {
+    return read8(offset);
+}
+
+void Uart::write8(uint32_t offset, uint8_t value) {
+    switch (offset) {
+        case RBR_THR:
+            output.push_back(static_cast<char>(value));
+            if (echo) {
+                std::cout.put(static_cast<char>(value)).flush();
+            }
+            break;
+        case IER: ier = value; break;
+        case LCR: lcr = value; break;
+        case MCR: mcr = value; break;
+        case SCR: scr = value; break;
+        default: break; // FCR and read-only registers
+    }
+}
+
+void Uart::write16(uint32_t offset, uint16_t value) {
+    write8(offset, static_cast<uint8_t>(value));
+}
+
+void Uart::write32(uint32_t offset, uint32_t value) {
+    write8(offset, static_cast<uint8_t>(value));
+}
+
+std::string Uart::get_name() const {
+    return "uart";
+}
+
+const std::string& Uart::get_output() const {
+    return output;
+}
+
+void Uart::clear_output() {
+    output.clear();
+}
+
+void Uart::push_input(const std::string& data) {
+    input.insert(input.end(), data.begin(), data.end());
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include "core/memory/Device.hpp"
+
+/**
+ * @brief Minimal 16550 compatible UART.
+ *
+ * Implements the byte wide register file of a 16550 with the FIFOs always ready: writes to THR
+ * are appended to an output buffer (and optionally echoed to stdout), reads of RBR pop bytes
+ * queued by the host with push_input. No interrupts are raised. Wider accesses use the low byte.
+ */
+class Uart : public Device {
+public:
+    static constexpr uint32_t SIZE = 0x100;    /**< Size of the MMIO window */
+    static constexpr uint32_t RBR_THR = 0;     /**< Receive buffer (read) / transmit holding (write) */
+    static constexpr uint32_t IER = 1;         /**< Interrupt enable */
+    static constexpr uint32_t IIR_FCR = 2;     /**< Interrupt identification (read) / FIFO control (write) */
+    static constexpr uint32_t LCR = 3;         /**< Line control */
+    static constexpr uint32_t MCR = 4;         /**< Modem control */
+    static constexpr uint32_t LSR = 5;         /**< Line status */
+    static constexpr uint32_t MSR = 6;         /**< Modem status */
+    static constexpr uint32_t SCR = 7;         /**< Scratch */
+
+    static constexpr uint8_t LSR_DATA_READY = 0x01;
+    static constexpr uint8_t LSR_THR_EMPTY = 0x20;
+    static constexpr uint8_t LSR_TRANSMITTER_EMPTY = 0x40;
+
+private:
+    std::string output;
+    std::deque<uint8_t> input;
+    bool echo;
+    uint8_t ier = 0;
+    uint8_t lcr = 0;
+    uint8_t mcr = 0;
+    uint8_t scr = 0;
+
+public:
+    /**
+     * @param echo Also print every transmitted byte to stdout.
+     */
+    explicit Uart(bool echo = false);
+
+    uint8_t read8(uint32_t offset) override;
+    uint16_t read16(uint32_t offset) override;
+    uint32_t read32(uint32_t offset) override;
+    void write8(uint32_t offset, uint8_t value) override;
+    void write16(uint32_t offset, uint16_t value) override;
+    void write32(uint32_t offset, uint32_t value) override;
+    std::string get_name() const override;
+
+    /**
+     * @brief Gets every byte transmitted by the guest since construction or the last clear.
+     */
+    const std::string& get_output() const;
+    void clear_output();
+
+    /**
+     * @brief Queues bytes for the guest to receive.
+     */
+    void push_input(const std::string& data);
+};
@@ -0,0 +1,86 @@
+#include "FuzzHarness.hpp"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <sstream>
+#include <stdexcept>
+
+FuzzHarness::FuzzHarness(CPU& cpu, uint32_t input_address, size_t max_input_size, uint64_t instruction_budget)
+    : cpu(cpu), base(cpu.snapshot()), input_address(input_address), max_input_size(max_input_size),
+      instruction_budget(instruction_budget)
+{
+    check_no_devices();
+}
+
+void FuzzHarness::check_no_devices() const {
+    for (const BusRegion& region : cpu.get_bus().get_regions()) {
+        if (region.kind == RegionKind::MMIO) {
+            throw std::invalid_argument("FuzzHarness - Device " + region.name
+                                        + " is attached, its state is not rewound between inputs");
+        }
+    }
+}
+
+FuzzResult FuzzHarness::run(const uint8_t* data, size_t size) {
+    check_no_devices();
+    auto start = std::chrono::steady_clock::now();
+    FuzzResult result;
+    size = std::min(size, max_input_size);
+
+    try {
+        cpu.write_block(input_address, data, size);
+        cpu.set_register(INPUT_ADDRESS_REGISTER, input_address);
+        cpu.set_register(INPUT_SIZE_REGISTER, static_cast<uint32_t>(size));
+
+        RunResult run = cpu.run(instruction_budget);
+        result.instructions = run.instructions;
+        switch (run.reason) {
+            case StopReason::HALTED:
+            case StopReason::EXIT:
+                result.outcome = FuzzOutcome::HALTED;
+                break;
+            case StopReason::TRAP: {
+                const Trap& trap = cpu.get_last_trap();
+                std::ostringstream message;
+                message << "Unhandled trap: " << trap::cause_name(trap.cause) << " at pc 0x" << std::hex << run.pc
+                        << " (mtval 0x" << trap.value << ")";
+                result.outcome = FuzzOutcome::CRASHED;
+                result.message = message.str();
+                break;
+            }
+            default:
+                result.outcome = FuzzOutcome::BUDGET_EXHAUSTED;
+                break;
+        }
+    } catch (const std::exception& e) {
+        result.outcome = FuzzOutcome::CRASHED;
+        result.message = e.what();
+    }
+    result.pc = cpu.get_pc();
+
+    // Rewind to the base state, only the pages written by this input are copied
+    result.dirty_pages = cpu.restore_dirty(*base);
+
+    ++stats.executions;
+    stats.instructions += result.instructions;
+    stats.dirty_pages_restored += result.dirty_pages;
+    stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.execs_per_second = stats.seconds > 0.0 ? static_cast<double>(stats.executions) / stats.seconds : 0.0;
+    return result;
+}
+
+const FuzzStats& FuzzHarness::get_stats() const {
+    return stats;
+}
+
+void FuzzHarness::reset_stats() {
+    stats = FuzzStats{};
+}
+
+uint64_t FuzzHarness::get_instruction_budget() const {
+    return instruction_budget;
+}
+
+void FuzzHarness::set_instruction_budget(uint64_t budget) {
+    instruction_budget = budget;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "core/cpu/CPU.hpp"
+
+/**
+ * @brief How a single fuzz execution ended.
+ */
+enum class FuzzOutcome {
+    HALTED = 0,           /**< The program reached its end (jump to self) */
+    BUDGET_EXHAUSTED = 1, /**< The instruction budget ran out first */
+    CRASHED = 2           /**< The program raised an exception (fault, illegal instruction...) */
+};
+
+/**
+ * @brief Result of running one input.
+ */
+struct FuzzResult {
+    FuzzOutcome outcome = FuzzOutcome::HALTED;
+    uint64_t instructions = 0; /**< Instructions retired, the faulting one excluded */
+    uint32_t pc = 0;           /**< Program counter when the execution stopped */
+    size_t dirty_pages = 0;    /**< Pages copied back by the reset */
+    std::string message;       /**< Exception message when the outcome is CRASHED */
+};
+
+/**
+ * @brief Aggregated counters over every input run by a harness.
+ */
+struct FuzzStats {
+    uint64_t executions = 0;
+    uint64_t instructions = 0;
+    uint64_t dirty_pages_restored = 0;
+    double seconds = 0.0;          /**< Wall time spent running and resetting */
+    double execs_per_second = 0.0;
+};
+
+/**
+ * @brief Runs many short executions of a CPU from the same starting state.
+ *
+ * The harness snapshots the CPU once at construction. Each run copies the input into guest
+ * memory, passes its address and size in a0/a1, executes with CPU::run(instruction_budget) in the
+ * execution mode of the CPU until the program halts or exits, crashes or exhausts the budget,
+ * then rewinds the CPU to the snapshot. The rewind copies back only the pages dirtied by the run,
+ * so its cost is proportional to what the input touched instead of the size of the memory.
+ *
+ * Only RAM and the registers are rewound. Devices keep their state from one input to the next, so
+ * a crash could not be reproduced from its input alone: a CPU with devices attached is rejected.
+ */
+class FuzzHarness {
+private:
+    CPU& cpu;
+    std::shared_ptr<CPUSnapshot> base;
+    uint32_t input_address;
+    size_t max_input_size;
+    uint64_t instruction_budget;
+    FuzzStats stats;
+
+    void check_no_devices() const;
+
+public:
+    static constexpr uint8_t INPUT_ADDRESS_REGISTER = 10; /**< a0 */
+    static constexpr uint8_t INPUT_SIZE_REGISTER = 11;    /**< a1 */
+
+    /**
+     * @brief Takes the base snapshot of a CPU already loaded with its program.
+     * @param cpu The CPU to fuzz, it must outlive the harness.
+     * @param input_address Virtual address the inputs are copied to.
+     * @param max_input_size Inputs longer than this are truncated.
+     * @param instruction_budget Maximum instructions per execution.
+     * @throws std::invalid_argument if a device is attached to the CPU.
+     */
+    FuzzHarness(CPU& cpu, uint32_t input_address, size_t max_input_size, uint64_t instruction_budget);
+
+    /**
+     * @brief Runs one input and resets the CPU to the base state.
+     * @param data The input bytes.
+     * @param size Number of input bytes.
+     * @return How the execution ended.
+     * @throws std::invalid_argument if a device was attached to the CPU since construction.
+     */
+    FuzzResult run(const uint8_t* data, size_t size);
+
+    /**
+     * @brief Gets the counters accumulated since construction or the last reset_stats.
+     * @return The counters, execs_per_second is computed from the wall time.
+     */
+    const FuzzStats& get_stats() const;
+
+    /**
+     * @brief Resets the accumulated counters.
+     */
+    void reset_stats();
+
+    uint64_t get_instruction_budget() const;
+    void set_instruction_budget(uint64_t budget);
+};
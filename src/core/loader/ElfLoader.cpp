@@ -0,0 +1,191 @@
+#include "ElfLoader.hpp"
+#include <bit>
+#include <cerrno>
+#include <cstring>
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef EM_RISCV
+#define EM_RISCV 243
+#endif
+
+namespace {
+
+/**
+ * @brief Read-only mapping of a whole file, unmapped and closed on destruction.
+ */
+class MappedFile {
+private:
+    int fd = -1;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+public:
+    explicit MappedFile(const std::string& filepath) {
+        fd = open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throw ElfLoadException("ElfLoader - Unable to open " + filepath + ": " + std::strerror(errno));
+        }
+        struct stat status;
+        if (fstat(fd, &status) != 0) {
+            close(fd);
+            throw ElfLoadException("ElfLoader - Unable to stat " + filepath + ": " + std::strerror(errno));
+        }
+        size = static_cast<size_t>(status.st_size);
+        if (size == 0) {
+            return;
+        }
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            throw ElfLoadException("ElfLoader - Unable to map " + filepath + ": " + std::strerror(errno));
+        }
+        data = static_cast<const uint8_t*>(mapping);
+    }
+
+    ~MappedFile() {
+        if (data != nullptr) {
+            munmap(const_cast<uint8_t*>(data), size);
+        }
+        close(fd);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    int get_fd() const { return fd; }
+    size_t get_size() const { return size; }
+
+    // Returns a typed pointer to [offset, offset + count * sizeof(T)) after checking it lies in the file
+    template <typename T>
+    const T* at(size_t offset, size_t count = 1) const {
+        if (offset > size || count > (size - offset) / sizeof(T) || offset % alignof(T) != 0) {
+            throw ElfLoadException("ElfLoader - Truncated file");
+        }
+        return reinterpret_cast<const T*>(data + offset);
+    }
+};
+
+void check_header(const Elf32_Ehdr& header) {
+    if (std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0) {
+        throw ElfLoadException("ElfLoader - Not an ELF file");
+    }
+    if (header.e_ident[EI_CLASS] != ELFCLASS32 || header.e_ident[EI_DATA] != ELFDATA2LSB) {
+        throw ElfLoadException("ElfLoader - Only little-endian ELF32 files are supported");
+    }
+    if (header.e_machine != EM_RISCV) {
+        throw ElfLoadException("ElfLoader - Not a RISC-V executable");
+    }
+    if (header.e_type != ET_EXEC) {
+        throw ElfLoadException("ElfLoader - Only statically linked executables are supported");
+    }
+}
+
+void load_segment(const MappedFile& file, const Elf32_Phdr& header, PhysicalMemory& physical_memory, ElfSegment& segment) {
+    if (header.p_filesz > header.p_memsz) {
+        throw ElfLoadException("ElfLoader - Segment file size exceeds its memory size");
+    }
+    if (static_cast<size_t>(header.p_paddr) + header.p_memsz > physical_memory.get_size()) {
+        throw ElfLoadException("ElfLoader - Segment does not fit in physical memory");
+    }
+    const uint8_t* contents = file.at<uint8_t>(header.p_offset, header.p_filesz);
+
+    // Read-only pages are mapped straight from the file, a guest write only copies that page
+    size_t copied_from = 0;
+    if (!segment.writable) {
+        size_t whole_pages = header.p_filesz & ~size_t{PhysicalMemory::PAGE_SIZE - 1};
+        if (whole_pages > 0 && physical_memory.map_file(header.p_paddr, file.get_fd(), header.p_offset, whole_pages)) {
+            segment.file_mapped = true;
+            copied_from = whole_pages;
+        }
+    }
+    if (copied_from < header.p_filesz) {
+        physical_memory.write_block(header.p_paddr + static_cast<uint32_t>(copied_from), contents + copied_from,
+                                    header.p_filesz - copied_from);
+    }
+    if (header.p_memsz > header.p_filesz) {
+        physical_memory.zero_fill(header.p_paddr + header.p_filesz, header.p_memsz - header.p_filesz);
+    }
+}
+
+SymbolTable read_symbols(const MappedFile& file, const Elf32_Ehdr& header) {
+    if (header.e_shoff == 0 || header.e_shnum == 0) {
+        return SymbolTable();
+    }
+    const Elf32_Shdr* sections = file.at<Elf32_Shdr>(header.e_shoff, header.e_shnum);
+
+    std::vector<Symbol> symbols;
+    for (size_t i = 0; i < header.e_shnum; ++i) {
+        const Elf32_Shdr& section = sections[i];
+        if (section.sh_type != SHT_SYMTAB || section.sh_link >= header.e_shnum) {
+            continue;
+        }
+        const Elf32_Shdr& strings = sections[section.sh_link];
+        const char* names = file.at<char>(strings.sh_offset, strings.sh_size);
+        const Elf32_Sym* entries = file.at<Elf32_Sym>(section.sh_offset, section.sh_size / sizeof(Elf32_Sym));
+
+        for (size_t j = 0; j < section.sh_size / sizeof(Elf32_Sym); ++j) {
+            const Elf32_Sym& entry = entries[j];
+            unsigned type = ELF32_ST_TYPE(entry.st_info);
+            if (entry.st_name == 0 || entry.st_name >= strings.sh_size || entry.st_shndx == SHN_UNDEF
+                || type == STT_SECTION || type == STT_FILE) {
+                continue;
+            }
+            // strnlen keeps a corrupted string table from reading past its section
+            const char* name = names + entry.st_name;
+            symbols.push_back(Symbol{std::string(name, strnlen(name, strings.sh_size - entry.st_name)),
+                                     entry.st_value, entry.st_size, type == STT_FUNC});
+        }
+    }
+    return SymbolTable(std::move(symbols));
+}
+
+} // namespace
+
+bool ElfLoader::is_elf(const std::string& filepath) {
+    int fd = open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    unsigned char magic[SELFMAG];
+    bool result = read(fd, magic, SELFMAG) == SELFMAG && std::memcmp(magic, ELFMAG, SELFMAG) == 0;
+    close(fd);
+    return result;
+}
+
+ElfImage ElfLoader::load(const std::string& filepath, PhysicalMemory& physical_memory) {
+    static_assert(std::endian::native == std::endian::little, "ElfLoader reads the file headers in place");
+
+    MappedFile file(filepath);
+    const Elf32_Ehdr& header = *file.at<Elf32_Ehdr>(0);
+    check_header(header);
+    if (header.e_phentsize != sizeof(Elf32_Phdr)) {
+        throw ElfLoadException("ElfLoader - Unexpected program header size");
+    }
+
+    ElfImage image;
+    image.entry = header.e_entry;
+    const Elf32_Phdr* program_headers = file.at<Elf32_Phdr>(header.e_phoff, header.e_phnum);
+    for (size_t i = 0; i < header.e_phnum; ++i) {
+        const Elf32_Phdr& program_header = program_headers[i];
+        if (program_header.p_type != PT_LOAD || program_header.p_memsz == 0) {
+            continue;
+        }
+        ElfSegment segment;
+        segment.virtual_address = program_header.p_vaddr;
+        segment.physical_address = program_header.p_paddr;
+        segment.file_size = program_header.p_filesz;
+        segment.memory_size = program_header.p_memsz;
+        segment.readable = program_header.p_flags & PF_R;
+        segment.writable = program_header.p_flags & PF_W;
+        segment.executable = program_header.p_flags & PF_X;
+        load_segment(file, program_header, physical_memory, segment);
+        image.segments.push_back(segment);
+    }
+
+    image.symbols = read_symbols(file, header);
+    return image;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "SymbolTable.hpp"
+#include "core/memory/PhysicalMemory.hpp"
+
+class ElfLoadException : public std::runtime_error {
+public:
+    explicit ElfLoadException(const std::string& msg) : std::runtime_error(msg) {}
+};
+
+/**
+ * @brief A PT_LOAD segment as placed in memory.
+ */
+struct ElfSegment {
+    uint32_t virtual_address = 0;
+    uint32_t physical_address = 0;
+    uint32_t file_size = 0;   /**< Bytes initialised from the file */
+    uint32_t memory_size = 0; /**< Bytes occupied in memory, the tail past file_size is zero (.bss) */
+    bool readable = false;
+    bool writable = false;
+    bool executable = false;
+    bool file_mapped = false; /**< The file pages were mapped instead of copied */
+};
+
+/**
+ * @brief What the loader learned about a program.
+ */
+struct ElfImage {
+    uint32_t entry = 0;
+    std::vector<ElfSegment> segments;
+    SymbolTable symbols;
+};
+
+/**
+ * @brief Loads statically linked little-endian RV32 ELF executables into physical memory.
+ *
+ * The file is mapped instead of read. Every PT_LOAD segment is placed at its physical address
+ * with one copy, or with no copy at all when the memory has RESERVED backing and the segment is
+ * read-only and page aligned, in which case its pages are mapped privately from the file. The
+ * zero initialised tail of a segment is cleared with PhysicalMemory::zero_fill, which gives
+ * untouched .bss pages no cost with RESERVED backing.
+ */
+class ElfLoader {
+public:
+    /**
+     * @brief Checks for the ELF magic number at the start of a file.
+     * @param filepath Path of the file.
+     * @return True if the file starts like an ELF file.
+     */
+    static bool is_elf(const std::string& filepath);
+
+    /**
+     * @brief Loads the segments of an executable and reads its symbol table.
+     * @param filepath Path of the executable.
+     * @param physical_memory The memory the segments are placed in.
+     * @return The entry point, segments and symbols.
+     * @throws ElfLoadException if the file cannot be read, is not an RV32 executable or a segment
+     * does not fit in physical memory.
+     */
+    static ElfImage load(const std::string& filepath, PhysicalMemory& physical_memory);
+};
@@ -0,0 +1,45 @@
+#include "SymbolTable.hpp"
+#include <algorithm>
+#include <utility>
+
+SymbolTable::SymbolTable(std::vector<Symbol> unordered_symbols) : symbols(std::move(unordered_symbols)) {
+    std::stable_sort(symbols.begin(), symbols.end(),
+                     [](const Symbol& a, const Symbol& b) { return a.address < b.address; });
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        by_name[symbols[i].name] = i;
+    }
+}
+
+const Symbol* SymbolTable::find(const std::string& name) const {
+    auto it = by_name.find(name);
+    return it == by_name.end() ? nullptr : &symbols[it->second];
+}
+
+const Symbol* SymbolTable::find_containing(uint32_t address) const {
+    // Last symbol starting at or before the address, walk back over zero sized neighbours
+    auto position = std::upper_bound(symbols.begin(), symbols.end(), address,
+                                     [](uint32_t value, const Symbol& symbol) { return value < symbol.address; });
+    while (position != symbols.begin()) {
+        --position;
+        const Symbol& symbol = *position;
+        if (address == symbol.address || address - symbol.address < symbol.size) {
+            return &symbol;
+        }
+        if (symbol.size != 0) {
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+const std::vector<Symbol>& SymbolTable::get_symbols() const {
+    return symbols;
+}
+
+size_t SymbolTable::size() const {
+    return symbols.size();
+}
+
+bool SymbolTable::empty() const {
+    return symbols.empty();
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief A named address taken from the symbol table of a program.
+ */
+struct Symbol {
+    std::string name;
+    uint32_t address = 0;
+    uint32_t size = 0;
+    bool is_function = false;
+};
+
+/**
+ * @brief Symbols of a loaded program, searchable by name and by address.
+ */
+class SymbolTable {
+private:
+    std::vector<Symbol> symbols;                    /**< Sorted by address */
+    std::unordered_map<std::string, size_t> by_name; /**< Index into symbols */
+
+public:
+    SymbolTable() = default;
+
+    /**
+     * @brief Builds the table from unordered symbols.
+     *
+     * When several symbols share a name the one with the highest address wins the name lookup.
+     * @param symbols The symbols to index.
+     */
+    explicit SymbolTable(std::vector<Symbol> symbols);
+
+    /**
+     * @brief Finds a symbol by name.
+     * @param name The symbol name.
+     * @return The symbol, or nullptr if there is none.
+     */
+    const Symbol* find(const std::string& name) const;
+
+    /**
+     * @brief Finds the symbol whose [address, address + size) range contains an address.
+     *
+     * Symbols without a size only match their exact address.
+     * @param address Any address.
+     * @return The symbol, or nullptr if no symbol covers the address.
+     */
+    const Symbol* find_containing(uint32_t address) const;
+
+    /**
+     * @brief Gets every symbol.
+     * @return The symbols sorted by address.
+     */
+    const std::vector<Symbol>& get_symbols() const;
+
+    size_t size() const;
+    bool empty() const;
+};
@@ -0,0 +1,160 @@
+#include "Machine.hpp"
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+Machine::Machine(size_t hart_count, size_t memory_size, MemoryBacking backing, ExecutionMode mode)
+    : memory(std::make_shared<PhysicalMemory>(memory_size, backing))
+{
+    if (hart_count == 0) {
+        throw std::invalid_argument("A machine needs at least one hart");
+    }
+    for (size_t hart_id = 0; hart_id < hart_count; ++hart_id) {
+        auto hart = std::make_unique<CPU>(memory, static_cast<uint32_t>(hart_id), mode);
+        hart->set_translation_mode(TranslationMode::SATP);
+        harts.push_back(std::move(hart));
+    }
+}
+
+size_t Machine::get_hart_count() const {
+    return harts.size();
+}
+
+CPU& Machine::get_hart(size_t hart_id) {
+    if (hart_id >= harts.size()) {
+        throw std::out_of_range("No hart " + std::to_string(hart_id));
+    }
+    return *harts[hart_id];
+}
+
+PhysicalMemory& Machine::get_physical_memory() {
+    return *memory;
+}
+
+const MachineConfig& Machine::get_config() const {
+    return config;
+}
+
+void Machine::set_config(const MachineConfig& new_config) {
+    if (new_config.quantum == 0) {
+        throw std::invalid_argument("The quantum must be at least one instruction");
+    }
+    config = new_config;
+}
+
+int Machine::load_program(const std::string& filepath) {
+    if (harts[0]->load_program(filepath) != 0) {
+        return -1;
+    }
+    uint32_t entry = harts[0]->get_pc();
+    for (const std::unique_ptr<CPU>& hart : harts) {
+        hart->get_register_bank().set_pc(entry);
+        // Hart 0 wrote the code, the others may have decoded what was there before
+        hart->flush_predecode_cache();
+    }
+    return 0;
+}
+
+std::vector<RunResult> Machine::run(uint64_t max_instructions) {
+    if (config.scheduling == SchedulingMode::DETERMINISTIC || harts.size() == 1) {
+        return run_deterministic(max_instructions);
+    }
+    return run_parallel(max_instructions);
+}
+
+std::vector<RunResult> Machine::run_parallel(uint64_t max_instructions) {
+    std::vector<RunResult> results(harts.size());
+    std::vector<std::exception_ptr> errors(harts.size());
+    std::vector<std::thread> threads;
+    threads.reserve(harts.size());
+    for (size_t hart_id = 0; hart_id < harts.size(); ++hart_id) {
+        threads.emplace_back([&, hart_id] {
+            try {
+                results[hart_id] = harts[hart_id]->run(max_instructions);
+            } catch (...) {
+                // A hart that failed does not stop the others, its exception is rethrown once all are done
+                errors[hart_id] = std::current_exception();
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    return results;
+}
+
+std::vector<RunResult> Machine::run_deterministic(uint64_t max_instructions) {
+    std::vector<RunResult> results(harts.size());
+    std::vector<bool> running(harts.size(), true);
+    size_t remaining_harts = harts.size();
+    while (remaining_harts > 0) {
+        for (size_t hart_id = 0; hart_id < harts.size(); ++hart_id) {
+            if (!running[hart_id]) {
+                continue;
+            }
+            RunResult& total = results[hart_id];
+            uint64_t left = max_instructions == CPU::UNLIMITED ? CPU::UNLIMITED : max_instructions - total.instructions;
+            RunResult turn = harts[hart_id]->run(std::min(config.quantum, left));
+            uint64_t instructions = total.instructions + turn.instructions;
+            total = turn;
+            total.instructions = instructions;
+            // A turn ends with BUDGET when the quantum is spent, the hart is done on anything else
+            if (turn.reason != StopReason::BUDGET || instructions == max_instructions) {
+                running[hart_id] = false;
+                --remaining_harts;
+            }
+        }
+    }
+    return results;
+}
+
+void Machine::request_stop() {
+    for (const std::unique_ptr<CPU>& hart : harts) {
+        hart->request_stop();
+    }
+}
+
+std::shared_ptr<MachineSnapshot> Machine::snapshot() {
+    auto snapshot = std::make_shared<MachineSnapshot>();
+    snapshot->memory = memory->snapshot();
+    for (const std::unique_ptr<CPU>& hart : harts) {
+        snapshot->harts.push_back(hart->capture_state(snapshot->memory));
+    }
+    return snapshot;
+}
+
+void Machine::restore(const MachineSnapshot& snapshot) {
+    check_hart_count(snapshot);
+    memory->restore(*snapshot.memory);
+    for (size_t hart_id = 0; hart_id < harts.size(); ++hart_id) {
+        harts[hart_id]->restore_state(snapshot.harts[hart_id]);
+        harts[hart_id]->flush_code_caches();
+    }
+}
+
+size_t Machine::restore_dirty(const MachineSnapshot& snapshot) {
+    check_hart_count(snapshot);
+    // Every hart asks for the pages it has to drop before the restore clears the dirty bits
+    for (const std::unique_ptr<CPU>& hart : harts) {
+        hart->invalidate_written_code();
+    }
+    size_t restored = memory->restore_dirty_pages(*snapshot.memory);
+    for (size_t hart_id = 0; hart_id < harts.size(); ++hart_id) {
+        harts[hart_id]->restore_state(snapshot.harts[hart_id]);
+    }
+    return restored;
+}
+
+void Machine::check_hart_count(const MachineSnapshot& snapshot) const {
+    if (snapshot.harts.size() != harts.size()) {
+        throw std::invalid_argument("The snapshot has " + std::to_string(snapshot.harts.size()) + " harts, the machine "
+                                    + std::to_string(harts.size()));
+    }
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/cpu/CPU.hpp"
+
+/**
+ * @brief How Machine::run shares the host between the harts.
+ */
+enum class SchedulingMode {
+    PARALLEL = 0,     /**< One host thread per hart, the host decides how the harts interleave */
+    DETERMINISTIC = 1 /**< The harts take turns on the calling thread, quantum instructions each */
+};
+
+/**
+ * @brief Settings of Machine::run.
+ */
+struct MachineConfig {
+    SchedulingMode scheduling = SchedulingMode::PARALLEL;
+    uint64_t quantum = 1000; /**< Instructions of a turn in DETERMINISTIC mode */
+};
+
+/**
+ * @brief State of every hart of a Machine and of their shared memory, see Machine::snapshot.
+ */
+struct MachineSnapshot {
+    std::shared_ptr<const MemorySnapshot> memory;
+    std::vector<CPUSnapshot> harts; /**< Indexed by hart id, each refers to the shared memory snapshot */
+};
+
+/**
+ * @brief Harts sharing one physical memory, hart i reads i from mhartid.
+ *
+ * Every hart is a full CPU with its own registers, CSRs, TLB, code caches and bus devices, only
+ * the memory is shared. The harts run in machine mode with translation from satp, bare at
+ * reset, so all of the memory is reachable at its physical address. The A extension and FENCE
+ * go through host atomics and fences, so guest code synchronizes the way it would on hardware.
+ *
+ * Like on hardware, FENCE.I only flushes the code caches of the hart that executes it.
+ *
+ * Snapshots of the machine go through Machine::snapshot and its restores. A hart only sees its
+ * own TLB and code caches, so CPU::snapshot and CPU::restore called on one hart leave the others
+ * with write translations that skip the dirty page tracking and with decoded instructions of
+ * the memory that was replaced.
+ */
+class Machine {
+private:
+    std::shared_ptr<PhysicalMemory> memory;
+    std::vector<std::unique_ptr<CPU>> harts;
+    MachineConfig config;
+
+    std::vector<RunResult> run_parallel(uint64_t max_instructions);
+    std::vector<RunResult> run_deterministic(uint64_t max_instructions);
+    void check_hart_count(const MachineSnapshot& snapshot) const; // throws std::invalid_argument on a mismatch
+
+public:
+    /**
+     * @brief Builds the harts, all with the PC at 0.
+     * @param hart_count Number of harts, at least one.
+     * @param memory_size Size of the shared memory in bytes.
+     * @param backing How the memory is allocated.
+     * @param mode Execution mode of every hart, each can be changed through get_hart().
+     * @throws std::invalid_argument if hart_count is 0.
+     */
+    Machine(size_t hart_count, size_t memory_size, MemoryBacking backing = MemoryBacking::HEAP,
+            ExecutionMode mode = ExecutionMode::PIPELINE);
+
+    size_t get_hart_count() const;
+    /**
+     * @brief The hart with an id.
+     * @throws std::out_of_range if there is no such hart.
+     */
+    CPU& get_hart(size_t hart_id);
+    PhysicalMemory& get_physical_memory();
+
+    const MachineConfig& get_config() const;
+    /**
+     * @brief Changes how the next runs schedule the harts.
+     * @throws std::invalid_argument if the quantum is 0.
+     */
+    void set_config(const MachineConfig& config);
+
+    /**
+     * @brief Loads a program through hart 0 and starts every hart at its entry.
+     *
+     * The harts tell themselves apart with mhartid. The code caches of every hart are flushed.
+     * @return 0 on success, -1 if the file cannot be loaded.
+     */
+    int load_program(const std::string& filepath);
+
+    /**
+     * @brief Runs every hart until it stops, see CPU::run(max_instructions).
+     *
+     * A hart stops on its own: halt, trap without handler, exit system call, or its budget spent.
+     * In DETERMINISTIC mode the harts take turns in hart id order, so the same program and
+     * configuration always interleave the same way.
+     * @param max_instructions Instruction budget of each hart, UNLIMITED for none.
+     * @return Why each hart stopped, indexed by hart id, with its instructions over the whole run.
+     */
+    std::vector<RunResult> run(uint64_t max_instructions = CPU::UNLIMITED);
+
+    /**
+     * @brief Makes every hart of the current or next run return STOPPED. Safe to call from another thread.
+     */
+    void request_stop();
+
+    /**
+     * @brief Captures the registers, CSRs and translation state of every hart and the shared memory.
+     *
+     * The memory is copied once for all harts. Flushes the TLB of every hart, so the writes of
+     * each one mark their pages dirty again. Only call it between runs.
+     * @return The snapshot, it can be restored any number of times.
+     */
+    std::shared_ptr<MachineSnapshot> snapshot();
+
+    /**
+     * @brief Rewinds every hart and the shared memory to a snapshot.
+     *
+     * Every hart drops its cached translations and decoded instructions.
+     * @param snapshot A snapshot of a machine with the same number of harts and memory size.
+     * @throws std::invalid_argument if the number of harts differs.
+     */
+    void restore(const MachineSnapshot& snapshot);
+
+    /**
+     * @brief Rewinds every hart and the shared memory copying back only the pages written since then.
+     *
+     * Only valid when the snapshot was the last one taken or restored on this machine, like
+     * CPU::restore_dirty. Each hart drops the decoded instructions of the pages copied back.
+     * @param snapshot The snapshot this machine last took or restored.
+     * @return Number of pages copied back.
+     * @throws std::invalid_argument if the number of harts differs.
+     */
+    size_t restore_dirty(const MachineSnapshot& snapshot);
+};
@@ -0,0 +1,123 @@
+#include "Bus.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "MMU.hpp"
+
+Bus::Bus(PhysicalMemory* ram) : ram(ram) {}
+
+void Bus::add_region(BusRegion region) {
+    if (region.size == 0 || static_cast<size_t>(region.base) + region.size > PhysicalMemory::ADDRESS_SPACE_SIZE) {
+        throw std::invalid_argument("Bus::add_region - Region " + region.name + " is empty or exceeds the address space");
+    }
+    if (overlaps(region.base, region.size)) {
+        throw std::invalid_argument("Bus::add_region - Region " + region.name + " overlaps another region");
+    }
+    auto position = std::upper_bound(regions.begin(), regions.end(), region.base,
+                                     [](uint32_t base, const BusRegion& other) { return base < other.base; });
+    regions.insert(position, std::move(region));
+}
+
+void Bus::add_device(uint32_t base, size_t size, std::shared_ptr<Device> device) {
+    if (!device) {
+        throw std::invalid_argument("Bus::add_device - Null device");
+    }
+    BusRegion region;
+    region.base = base;
+    region.size = size;
+    region.kind = RegionKind::MMIO;
+    region.name = device->get_name();
+    region.device = std::move(device);
+    add_region(std::move(region));
+}
+
+void Bus::add_rom(uint32_t base, const uint8_t* data, size_t size, const std::string& name) {
+    BusRegion region;
+    region.base = base;
+    region.size = size;
+    region.kind = RegionKind::ROM;
+    region.name = name;
+    region.storage = std::shared_ptr<uint8_t[]>(new uint8_t[size]);
+    std::memcpy(region.storage.get(), data, size);
+    add_region(std::move(region));
+}
+
+const BusRegion* Bus::find(uint32_t address) const {
+    // Last region starting at or below the address
+    auto position = std::upper_bound(regions.begin(), regions.end(), address,
+                                     [](uint32_t value, const BusRegion& region) { return value < region.base; });
+    if (position == regions.begin()) {
+        return nullptr;
+    }
+    --position;
+    return position->contains(address) ? &*position : nullptr;
+}
+
+bool Bus::overlaps(uint32_t address, size_t size) const {
+    size_t end = static_cast<size_t>(address) + size;
+    return std::any_of(regions.begin(), regions.end(), [&](const BusRegion& region) {
+        return region.base < end && address < region.base + region.size;
+    });
+}
+
+RegionKind Bus::get_kind(uint32_t address) const {
+    if (const BusRegion* region = find(address)) {
+        return region->kind;
+    }
+    if (address < ram->get_size()) {
+        return RegionKind::RAM;
+    }
+    throw AccessViolationException("Bus - Nothing is mapped at the physical address");
+}
+
+uint64_t Bus::read_device(uint32_t address, size_t size) {
+    const BusRegion* region = find(address);
+    if (region == nullptr || region->kind != RegionKind::MMIO) {
+        throw AccessViolationException("Bus::read_device - No device at the physical address");
+    }
+    Device& device = *region->device;
+    uint32_t offset = address - region->base;
+    switch (size) {
+        case 1: return device.read8(offset);
+        case 2: return device.read16(offset);
+        case 4: return device.read32(offset);
+        case 8: return device.read32(offset) | (static_cast<uint64_t>(device.read32(offset + 4)) << 32);
+        default: throw std::invalid_argument("Bus::read_device - Unsupported access size");
+    }
+}
+
+void Bus::write_device(uint32_t address, size_t size, uint64_t value) {
+    const BusRegion* region = find(address);
+    if (region == nullptr || region->kind != RegionKind::MMIO) {
+        throw AccessViolationException("Bus::write_device - No device at the physical address");
+    }
+    Device& device = *region->device;
+    uint32_t offset = address - region->base;
+    switch (size) {
+        case 1: device.write8(offset, static_cast<uint8_t>(value)); break;
+        case 2: device.write16(offset, static_cast<uint16_t>(value)); break;
+        case 4: device.write32(offset, static_cast<uint32_t>(value)); break;
+        case 8:
+            device.write32(offset, static_cast<uint32_t>(value));
+            device.write32(offset + 4, static_cast<uint32_t>(value >> 32));
+            break;
+        default: throw std::invalid_argument("Bus::write_device - Unsupported access size");
+    }
+}
+
+void Bus::tick(uint64_t cycles) {
+    for (const BusRegion& region : regions) {
+        if (region.device) {
+            region.device->tick(cycles);
+        }
+    }
+}
+
+const std::vector<BusRegion>& Bus::get_regions() const {
+    return regions;
+}
+
+PhysicalMemory* Bus::get_ram() const {
+    return ram;
+}
@@ -0,0 +1,124 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Device.hpp"
+#include "PhysicalMemory.hpp"
+
+/**
+ * @brief What answers at a physical address.
+ */
+enum class RegionKind {
+    RAM = 0,  /**< PhysicalMemory, the default for every address below its size */
+    ROM = 1,  /**< Read-only bytes owned by the bus, writes raise an access fault */
+    MMIO = 2  /**< Accesses are forwarded to a Device */
+};
+
+/**
+ * @brief A ROM or MMIO range of the physical address space.
+ */
+struct BusRegion {
+    uint32_t base = 0;
+    size_t size = 0;
+    RegionKind kind = RegionKind::MMIO;
+    std::string name;
+    std::shared_ptr<Device> device;     /**< MMIO only */
+    std::shared_ptr<uint8_t[]> storage; /**< ROM only, `size` bytes */
+
+    bool contains(uint32_t address) const { return address >= base && address - base < size; }
+};
+
+/**
+ * @brief Physical address bus between the MMU and the RAM, ROM and devices.
+ *
+ * RAM is implicit: every physical address below the PhysicalMemory size that is not claimed by a
+ * region is RAM. ROM and MMIO regions are kept sorted by base address and may shadow RAM, the
+ * usual layout maps devices low and RAM behind them. Regions never overlap each other.
+ *
+ * The bus is only consulted on the MMU TLB miss path. RAM and ROM pages are installed in the TLB
+ * as host pointers and never look at the regions again, MMIO accesses are dispatched on every
+ * access by a binary search over the regions. Cached RAM pages are not invalidated when a region
+ * is added, attach regions before running or flush the MMU TLB afterwards.
+ */
+class Bus {
+private:
+    PhysicalMemory* ram;
+    std::vector<BusRegion> regions; /**< Sorted by base */
+
+    void add_region(BusRegion region);
+
+public:
+    explicit Bus(PhysicalMemory* ram);
+
+    /**
+     * @brief Attaches a device to a range of physical addresses.
+     * @param base First physical address of the device.
+     * @param size Number of addresses the device answers to.
+     * @param device The device, shared with the caller.
+     * @throws std::invalid_argument if the range is empty, wraps or overlaps another region.
+     */
+    void add_device(uint32_t base, size_t size, std::shared_ptr<Device> device);
+
+    /**
+     * @brief Maps a copy of a buffer as read-only memory.
+     * @param base First physical address of the ROM.
+     * @param data Contents of the ROM.
+     * @param size Number of bytes.
+     * @param name Name used in error messages.
+     * @throws std::invalid_argument if the range is empty, wraps or overlaps another region.
+     */
+    void add_rom(uint32_t base, const uint8_t* data, size_t size, const std::string& name = "rom");
+
+    /**
+     * @brief Finds the ROM or MMIO region covering an address.
+     * @param address A physical address.
+     * @return The region, or nullptr when the address is RAM or unmapped.
+     */
+    const BusRegion* find(uint32_t address) const;
+
+    /**
+     * @brief Checks whether any ROM or MMIO region intersects [address, address + size).
+     */
+    bool overlaps(uint32_t address, size_t size) const;
+
+    /**
+     * @brief Tells what answers at an address, RAM is only reported below the memory size.
+     * @throws AccessViolationException if nothing is mapped at the address.
+     */
+    RegionKind get_kind(uint32_t address) const;
+
+    /**
+     * @brief Reads from the device mapped at an address.
+     * @param address The physical address, it must belong to an MMIO region.
+     * @param size Access width in bytes: 1, 2, 4 or 8.
+     * @return The value read, zero extended.
+     * @throws AccessViolationException if no device is mapped at the address.
+     */
+    uint64_t read_device(uint32_t address, size_t size);
+
+    /**
+     * @brief Writes to the device mapped at an address.
+     * @param address The physical address, it must belong to an MMIO region.
+     * @param size Access width in bytes: 1, 2, 4 or 8.
+     * @param value The value, only the low `size` bytes are used.
+     * @throws AccessViolationException if no device is mapped at the address.
+     */
+    void write_device(uint32_t address, size_t size, uint64_t value);
+
+    /**
+     * @brief Advances the clock of every device.
+     * @param cycles Number of cycles elapsed.
+     */
+    void tick(uint64_t cycles);
+
+    /**
+     * @brief Checks whether at least one ROM or MMIO region is attached.
+     */
+    bool has_regions() const { return !regions.empty(); }
+
+    const std::vector<BusRegion>& get_regions() const;
+    PhysicalMemory* get_ram() const;
+};
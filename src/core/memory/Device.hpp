@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief A memory-mapped device attached to the physical address bus.
+ *
+ * Handlers receive the offset of the access from the base of the device region. Accesses are
+ * never cached by the MMU, every load and store of the guest reaches the device. Doubleword
+ * accesses are split into two word accesses, low word first.
+ */
+class Device {
+public:
+    virtual ~Device() = default;
+
+    virtual uint8_t read8(uint32_t offset) = 0;
+    virtual uint16_t read16(uint32_t offset) = 0;
+    virtual uint32_t read32(uint32_t offset) = 0;
+    virtual void write8(uint32_t offset, uint8_t value) = 0;
+    virtual void write16(uint32_t offset, uint16_t value) = 0;
+    virtual void write32(uint32_t offset, uint32_t value) = 0;
+
+    /**
+     * @brief Advances the device clock, called by the CPU once per retired instruction.
+     * @param cycles Number of cycles elapsed since the last call.
+     */
+    virtual void tick(uint64_t cycles) { (void)cycles; }
+
+    /**
+     * @brief Gets a short name used in error messages.
+     */
+    virtual std::string get_name() const = 0;
+};
@@ -1,57 +1,548 @@
 #include "MMU.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
 #include <stdexcept>
+
+#include "utils/bitutils.hpp"
+
 MMU::MMU(PhysicalMemory* phys_mem, PageTable* pt, PrivilegeMode mode)
-    : physical_memory(phys_mem), page_table(pt), privilege_mode(mode) {}
+    : physical_memory(phys_mem), bus(nullptr), page_table(pt), privilege_mode(mode), translation_mode(TranslationMode::HOST_MANAGED),
+      page_table_walker(phys_mem), satp(0), tlb_generation(pt->get_generation()), device_address(0),
+      misaligned_access(MisalignedAccess::SPLIT), code_pages((phys_mem->get_size() + PAGE_SIZE - 1) / PAGE_SIZE, 0) {}
+
+void MMU::set_bus(Bus* physical_bus) {
+    bus = physical_bus;
+    flush_tlb();
+}
 
 uint32_t MMU::translate_address(uint32_t virtual_address, bool is_write) {
+    return translate_address(virtual_address, is_write ? AccessType::WRITE : AccessType::READ);
+}
+
+uint32_t MMU::translate_address(uint32_t virtual_address, AccessType type) {
+    uint32_t physical_address = 0;
+    MemoryStatus status = try_translate(virtual_address, type, physical_address);
+    if (status != MemoryStatus::OK) {
+        raise(status, virtual_address, "MMU::translate_address");
+    }
+    return physical_address;
+}
+
+MemoryStatus MMU::try_translate(uint32_t virtual_address, AccessType type, uint32_t& physical_address) {
+    if (translation_mode == TranslationMode::SATP) {
+        // Bare mode and machine mode access physical memory directly
+        if (!(satp & PageTableWalker::SATP_MODE_SV32) || privilege_mode == PrivilegeMode::MACHINE) {
+            physical_address = virtual_address;
+            return MemoryStatus::OK;
+        }
+        return page_table_walker.walk(satp, virtual_address, type, privilege_mode, physical_address);
+    }
+
     // 4KB pages and direct mapping
-    uint32_t page_number = virtual_address & 0xFFFFF000;
+    const PageTableEntry* entry = page_table->find_entry(virtual_address & PAGE_MASK);
+    if (entry == nullptr || !entry->is_valid()) {
+        return MemoryStatus::PAGE_FAULT;
+    }
+
+    bool permitted = type == AccessType::WRITE   ? entry->is_writable(privilege_mode)
+                   : type == AccessType::EXECUTE ? entry->is_executable(privilege_mode)
+                                                 : entry->is_readable(privilege_mode);
+    if (!permitted) {
+        return MemoryStatus::ACCESS_FAULT;
+    }
+    physical_address = entry->get_physical_address(virtual_address);
+    return MemoryStatus::OK;
+}
+
+void MMU::raise(MemoryStatus status, uint32_t virtual_address, const char* operation) {
+    std::ostringstream message;
+    message << operation << " - "
+            << (status == MemoryStatus::PAGE_FAULT ? "Page fault" : status == MemoryStatus::MISALIGNED ? "Misaligned access" : "Access fault")
+            << " at address 0x" << std::hex << virtual_address;
+    if (status == MemoryStatus::PAGE_FAULT) {
+        throw PageFaultException(message.str());
+    }
+    throw AccessViolationException(message.str());
+}
+
+inline MemoryStatus MMU::get_host_pointer(uint32_t virtual_address, AccessType type, size_t size, uint8_t*& host) {
+    // Any page table update invalidates every cached translation
+    if (page_table->get_generation() != tlb_generation) {
+        flush_tlb();
+    }
+    const TLBEntry& entry = tlb[static_cast<size_t>(type)][(virtual_address >> PAGE_SHIFT) & (TLB_ENTRIES - 1)];
+    if (entry.tag == (virtual_address & PAGE_MASK)) {
+        ++tlb_stats.hits;
+        host = reinterpret_cast<uint8_t*>(entry.addend + virtual_address);
+        return MemoryStatus::OK;
+    }
+    return tlb_fill(virtual_address, type, size, host);
+}
+
+MemoryStatus MMU::tlb_fill(uint32_t virtual_address, AccessType type, size_t size, uint8_t*& host) {
+    ++tlb_stats.misses;
+
+    // Failed checks are never cached, the next access walks again
+    uint32_t physical_address = 0;
+    MemoryStatus status = try_translate(virtual_address, type, physical_address);
+    if (status != MemoryStatus::OK) {
+        return status;
+    }
+    uint32_t physical_page = physical_address & PAGE_MASK;
+    uint8_t* host_pointer;
+    bool cacheable;
+
+    const BusRegion* region = (bus != nullptr) ? bus->find(physical_address) : nullptr;
+    if (region == nullptr) {
+        if (static_cast<size_t>(physical_address) + size > physical_memory->get_size()) {
+            return MemoryStatus::ACCESS_FAULT;
+        }
+        host_pointer = physical_memory->get_host_pointer(physical_address, size);
+
+        // Only cache pages that are fully backed by physical memory and not shared with a
+        // device, partial pages keep going through the checked path
+        cacheable = static_cast<size_t>(physical_page) + PAGE_SIZE <= physical_memory->get_size()
+                    && (bus == nullptr || !bus->overlaps(physical_page, PAGE_SIZE));
+
+        // Writes that hit the TLB are not seen by PhysicalMemory, so the page is marked dirty
+        // when the write translation is installed. Writes to code pages are never cached so
+        // the decoded instruction cache sees each one of them
+        if (type == AccessType::WRITE) {
+            physical_memory->mark_dirty(physical_address);
+            if (code_pages[physical_page >> PAGE_SHIFT]) {
+                for (CodeWriteListener* listener : code_write_listeners) {
+                    listener->on_code_write(physical_address, size);
+                }
+                cacheable = false;
+            }
+        }
+    } else if (region->kind == RegionKind::MMIO) {
+        device_address = physical_address;
+        host = nullptr;
+        return MemoryStatus::OK;
+    } else {
+        // Writes to ROM and accesses running past its end
+        if (type == AccessType::WRITE || physical_address - region->base + size > region->size) {
+            return MemoryStatus::ACCESS_FAULT;
+        }
+        host_pointer = region->storage.get() + (physical_address - region->base);
+        cacheable = region->contains(physical_page) && physical_page - region->base + PAGE_SIZE <= region->size;
+    }
+
+    if (cacheable) {
+        TLBEntry& entry = tlb[static_cast<size_t>(type)][(virtual_address >> PAGE_SHIFT) & (TLB_ENTRIES - 1)];
+        entry.tag = virtual_address & PAGE_MASK;
+        entry.physical_page = physical_page;
+        entry.addend = reinterpret_cast<uintptr_t>(host_pointer) - virtual_address;
+    }
+    host = host_pointer;
+    return MemoryStatus::OK;
+}
+
+template <typename T>
+inline MemoryStatus MMU::load(uint32_t virtual_address, AccessType type, T& value) {
+    // Tags are page aligned, keeping the alignment bits in the compare sends misaligned addresses
+    // to the slow path. An aligned access never crosses a page
+    const TLBEntry& entry = tlb[static_cast<size_t>(type)][(virtual_address >> PAGE_SHIFT) & (TLB_ENTRIES - 1)];
+    if (entry.tag == (virtual_address & (PAGE_MASK | (sizeof(T) - 1))) && page_table->get_generation() == tlb_generation) {
+        ++tlb_stats.hits;
+        value = bitutils::load_le<T>(reinterpret_cast<const uint8_t*>(entry.addend + virtual_address));
+        return MemoryStatus::OK;
+    }
+    return load_slow<T>(virtual_address, type, value);
+}
+
+template <typename T>
+MemoryStatus MMU::load_slow(uint32_t virtual_address, AccessType type, T& value) {
+    if (virtual_address & (sizeof(T) - 1)) {
+        return load_misaligned<T>(virtual_address, type, value);
+    }
+    uint8_t* host = nullptr;
+    MemoryStatus status = get_host_pointer(virtual_address, type, sizeof(T), host);
+    if (status != MemoryStatus::OK) {
+        return status;
+    }
+    value = host != nullptr ? bitutils::load_le<T>(host)
+                            : static_cast<T>(bus->read_device(device_address, sizeof(T)));
+    return MemoryStatus::OK;
+}
+
+template <typename T>
+MemoryStatus MMU::load_misaligned(uint32_t virtual_address, AccessType type, T& value) {
+    if (misaligned_access == MisalignedAccess::TRAP) {
+        return MemoryStatus::MISALIGNED;
+    }
+    uint32_t page_offset = virtual_address & ~PAGE_MASK;
+    uint8_t* host = nullptr;
+    if (page_offset <= PAGE_SIZE - sizeof(T)) {
+        MemoryStatus status = get_host_pointer(virtual_address, type, sizeof(T), host);
+        if (status != MemoryStatus::OK) {
+            return status;
+        }
+        value = host != nullptr ? bitutils::load_le<T>(host)
+                                : static_cast<T>(bus->read_device(device_address, sizeof(T)));
+        return MemoryStatus::OK;
+    }
+
+    // The access crosses into the next page, gather the bytes from both pages
+    size_t first_part = PAGE_SIZE - page_offset;
+    uint8_t* second = nullptr;
+    MemoryStatus status = get_host_pointer(virtual_address, type, first_part, host);
+    if (status == MemoryStatus::OK) {
+        status = get_host_pointer(virtual_address + first_part, type, sizeof(T) - first_part, second);
+    }
+    if (status != MemoryStatus::OK) {
+        return status;
+    }
+    if (host == nullptr || second == nullptr) {
+        // Device accesses crossing a page boundary
+        return MemoryStatus::ACCESS_FAULT;
+    }
+    uint8_t bytes[sizeof(T)];
+    std::memcpy(bytes, host, first_part);
+    std::memcpy(bytes + first_part, second, sizeof(T) - first_part);
+    value = bitutils::load_le<T>(bytes);
+    return MemoryStatus::OK;
+}
+
+template <typename T>
+inline MemoryStatus MMU::store(uint32_t virtual_address, T value) {
+    const TLBEntry& entry = tlb[static_cast<size_t>(AccessType::WRITE)][(virtual_address >> PAGE_SHIFT) & (TLB_ENTRIES - 1)];
+    if (entry.tag == (virtual_address & (PAGE_MASK | (sizeof(T) - 1))) && page_table->get_generation() == tlb_generation) {
+        ++tlb_stats.hits;
+        bitutils::store_le<T>(reinterpret_cast<uint8_t*>(entry.addend + virtual_address), value);
+        return MemoryStatus::OK;
+    }
+    return store_slow<T>(virtual_address, value);
+}
+
+template <typename T>
+MemoryStatus MMU::store_slow(uint32_t virtual_address, T value) {
+    if (virtual_address & (sizeof(T) - 1)) {
+        return store_misaligned<T>(virtual_address, value);
+    }
+    uint8_t* host = nullptr;
+    MemoryStatus status = get_host_pointer(virtual_address, AccessType::WRITE, sizeof(T), host);
+    if (status != MemoryStatus::OK) {
+        return status;
+    }
+    if (host == nullptr) {
+        bus->write_device(device_address, sizeof(T), value);
+    } else {
+        bitutils::store_le<T>(host, value);
+    }
+    return MemoryStatus::OK;
+}
+
+template <typename T>
+MemoryStatus MMU::store_misaligned(uint32_t virtual_address, T value) {
+    if (misaligned_access == MisalignedAccess::TRAP) {
+        return MemoryStatus::MISALIGNED;
+    }
+    uint32_t page_offset = virtual_address & ~PAGE_MASK;
+    uint8_t* host = nullptr;
+    if (page_offset <= PAGE_SIZE - sizeof(T)) {
+        MemoryStatus status = get_host_pointer(virtual_address, AccessType::WRITE, sizeof(T), host);
+        if (status != MemoryStatus::OK) {
+            return status;
+        }
+        if (host == nullptr) {
+            bus->write_device(device_address, sizeof(T), value);
+        } else {
+            bitutils::store_le<T>(host, value);
+        }
+        return MemoryStatus::OK;
+    }
+
+    // Both pages are translated before writing so a fault on the second page does not leave
+    // a partially written value behind
+    size_t first_part = PAGE_SIZE - page_offset;
+    uint8_t* second = nullptr;
+    MemoryStatus status = get_host_pointer(virtual_address, AccessType::WRITE, first_part, host);
+    if (status == MemoryStatus::OK) {
+        status = get_host_pointer(virtual_address + first_part, AccessType::WRITE, sizeof(T) - first_part, second);
+    }
+    if (status != MemoryStatus::OK) {
+        return status;
+    }
+    if (host == nullptr || second == nullptr) {
+        return MemoryStatus::ACCESS_FAULT;
+    }
+    uint8_t bytes[sizeof(T)];
+    bitutils::store_le<T>(bytes, value);
+    std::memcpy(host, bytes, first_part);
+    std::memcpy(second, bytes + first_part, sizeof(T) - first_part);
+    return MemoryStatus::OK;
+}
+
+template <typename Chunk>
+void MMU::for_each_page(uint32_t virtual_address, size_t size, AccessType type, Chunk&& chunk) {
+    size_t offset = 0;
+    while (offset < size) {
+        uint32_t address = virtual_address + static_cast<uint32_t>(offset);
+        size_t length = std::min<size_t>(PAGE_SIZE - (address & ~PAGE_MASK), size - offset);
+        uint8_t* host = nullptr;
+        MemoryStatus status = get_host_pointer(address, type, length, host);
+        if (status != MemoryStatus::OK) {
+            raise(status, address, "MMU - Block access");
+        }
+        if (host == nullptr) {
+            throw AccessViolationException("MMU - Block access to a device");
+        }
+        chunk(host, offset, length);
+        offset += length;
+    }
+}
+
+void MMU::read_block(uint32_t virtual_address, uint8_t* data, size_t size) {
+    for_each_page(virtual_address, size, AccessType::READ, [&](uint8_t* host, size_t offset, size_t length) {
+        std::memcpy(data + offset, host, length);
+    });
+}
+
+void MMU::write_block(uint32_t virtual_address, const uint8_t* data, size_t size) {
+    for_each_page(virtual_address, size, AccessType::WRITE, [&](uint8_t* host, size_t offset, size_t length) {
+        std::memcpy(host, data + offset, length);
+    });
+}
+
+void MMU::fill(uint32_t virtual_address, uint8_t value, size_t size) {
+    for_each_page(virtual_address, size, AccessType::WRITE, [&](uint8_t* host, size_t, size_t length) {
+        std::memset(host, value, length);
+    });
+}
+
+MemoryStatus MMU::try_read(uint32_t virtual_address, uint8_t& value) {
+    return load<uint8_t>(virtual_address, AccessType::READ, value);
+}
+
+MemoryStatus MMU::try_read_halfword(uint32_t virtual_address, uint16_t& value) {
+    return load<uint16_t>(virtual_address, AccessType::READ, value);
+}
+
+MemoryStatus MMU::try_read_word(uint32_t virtual_address, uint32_t& value) {
+    return load<uint32_t>(virtual_address, AccessType::READ, value);
+}
 
-    PageTableEntry entry = page_table->get_entry(page_number);
+MemoryStatus MMU::try_write(uint32_t virtual_address, uint8_t value) {
+    return store<uint8_t>(virtual_address, value);
+}
+
+MemoryStatus MMU::try_write_halfword(uint32_t virtual_address, uint16_t value) {
+    return store<uint16_t>(virtual_address, value);
+}
+
+MemoryStatus MMU::try_write_word(uint32_t virtual_address, uint32_t value) {
+    return store<uint32_t>(virtual_address, value);
+}
 
-    if (!entry.is_valid()) {
-        throw PageFaultException("MMU::translate_address - Invalid page entry");
+MemoryStatus MMU::try_fetch_word(uint32_t virtual_address, uint32_t& value) {
+    return load<uint32_t>(virtual_address, AccessType::EXECUTE, value);
+}
+
+MemoryStatus MMU::try_atomic_word(uint32_t virtual_address, AccessType type, uint32_t*& word) {
+    if (virtual_address & 0x3) {
+        return MemoryStatus::MISALIGNED;
+    }
+    uint8_t* host = nullptr;
+    MemoryStatus status = get_host_pointer(virtual_address, type, sizeof(uint32_t), host);
+    if (status != MemoryStatus::OK) {
+        return status;
     }
+    if (host == nullptr) {
+        // A device has no word to operate on atomically
+        return MemoryStatus::ACCESS_FAULT;
+    }
+    word = reinterpret_cast<uint32_t*>(host);
+    return MemoryStatus::OK;
+}
 
-    if (is_write && !entry.is_writable(privilege_mode)) {
-        throw AccessViolationException("MMU::translate_address - Write not permitted on this page");
+bool MMU::translate_fetch(uint32_t virtual_address, uint32_t& physical_address) {
+    const TLBEntry& entry = tlb[static_cast<size_t>(AccessType::EXECUTE)][(virtual_address >> PAGE_SHIFT) & (TLB_ENTRIES - 1)];
+    uint32_t tag = virtual_address & (PAGE_MASK | 0x3);
+    if (entry.tag != tag || page_table->get_generation() != tlb_generation) {
+        // Fill the TLB, faults and pages that cannot be cached are left to the fetch path
+        uint8_t* host = nullptr;
+        if (get_host_pointer(virtual_address, AccessType::EXECUTE, sizeof(uint32_t), host) != MemoryStatus::OK
+            || entry.tag != tag) {
+            return false;
+        }
+    } else {
+        ++tlb_stats.hits;
     }
+    physical_address = entry.physical_page | (virtual_address & ~PAGE_MASK);
+    return true;
+}
 
-    if (!is_write && !entry.is_readable(privilege_mode)) {
-        throw AccessViolationException("MMU::translate_address - Read not permitted on this page");
+bool MMU::translate_cacheable(uint32_t virtual_address, AccessType type, uint32_t& physical_address) {
+    const TLBEntry& entry = tlb[static_cast<size_t>(type)][(virtual_address >> PAGE_SHIFT) & (TLB_ENTRIES - 1)];
+    if (entry.tag == (virtual_address & PAGE_MASK) && page_table->get_generation() == tlb_generation) {
+        physical_address = entry.physical_page | (virtual_address & ~PAGE_MASK);
+        return true;
+    }
+    // Pages the TLB does not hold, e.g. code pages for writes, are translated again
+    uint32_t physical = 0;
+    if (try_translate(virtual_address, type, physical) != MemoryStatus::OK) {
+        return false;
     }
+    const BusRegion* region = (bus != nullptr) ? bus->find(physical) : nullptr;
+    if (region != nullptr ? region->kind == RegionKind::MMIO : physical >= physical_memory->get_size()) {
+        return false;
+    }
+    physical_address = physical;
+    return true;
+}
 
-    return entry.get_physical_address(virtual_address);
+const MMU::TLBEntry* MMU::get_tlb(AccessType type) {
+    if (page_table->get_generation() != tlb_generation) {
+        flush_tlb();
+    }
+    return tlb[static_cast<size_t>(type)].data();
+}
+
+void MMU::add_code_write_listener(CodeWriteListener* listener) {
+    code_write_listeners.push_back(listener);
+}
+
+void MMU::remove_code_write_listener(CodeWriteListener* listener) {
+    std::erase(code_write_listeners, listener);
+}
+
+void MMU::mark_code_page(uint32_t physical_address) {
+    uint32_t page = physical_address >> PAGE_SHIFT;
+    if (page >= code_pages.size() || code_pages[page]) {
+        return;
+    }
+    code_pages[page] = 1;
+
+    // Write translations already installed for the page would bypass the miss path
+    for (TLBEntry& entry : tlb[static_cast<size_t>(AccessType::WRITE)]) {
+        if (entry.tag != TLBEntry::INVALID_TAG && entry.physical_page == (physical_address & PAGE_MASK)) {
+            entry = TLBEntry{};
+        }
+    }
+}
+
+void MMU::clear_code_pages() {
+    std::fill(code_pages.begin(), code_pages.end(), 0);
+}
+
+template <typename T>
+T MMU::checked_load(uint32_t virtual_address, AccessType type, const char* operation) {
+    T value = 0;
+    MemoryStatus status = load<T>(virtual_address, type, value);
+    if (status != MemoryStatus::OK) {
+        raise(status, virtual_address, operation);
+    }
+    return value;
+}
+
+template <typename T>
+void MMU::checked_store(uint32_t virtual_address, T value, const char* operation) {
+    MemoryStatus status = store<T>(virtual_address, value);
+    if (status != MemoryStatus::OK) {
+        raise(status, virtual_address, operation);
+    }
 }
 
 uint8_t MMU::read(uint32_t virtual_address) {
-    uint32_t physical_address = translate_address(virtual_address, false);
-    return physical_memory->read(physical_address);
+    return checked_load<uint8_t>(virtual_address, AccessType::READ, "MMU::read");
 }
 
 void MMU::write(uint32_t virtual_address, uint8_t value) {
-    uint32_t physical_address = translate_address(virtual_address, true);
-    physical_memory->write(physical_address, value);
+    checked_store<uint8_t>(virtual_address, value, "MMU::write");
+}
+
+uint8_t MMU::fetch(uint32_t virtual_address) {
+    return checked_load<uint8_t>(virtual_address, AccessType::EXECUTE, "MMU::fetch");
+}
+
+uint16_t MMU::read_halfword(uint32_t virtual_address) {
+    return checked_load<uint16_t>(virtual_address, AccessType::READ, "MMU::read_halfword");
+}
+
+void MMU::write_halfword(uint32_t virtual_address, uint16_t value) {
+    checked_store<uint16_t>(virtual_address, value, "MMU::write_halfword");
 }
 
 uint32_t MMU::read_word(uint32_t virtual_address) {
-    // Read 4 bytes from memory and combine them into a 32-bit word
-    uint32_t word = 0;
-    word |= static_cast<uint32_t>(read(virtual_address));
-    word |= static_cast<uint32_t>(read(virtual_address + 1)) << 8;
-    word |= static_cast<uint32_t>(read(virtual_address + 2)) << 16;
-    word |= static_cast<uint32_t>(read(virtual_address + 3)) << 24;
-    return word;
+    return checked_load<uint32_t>(virtual_address, AccessType::READ, "MMU::read_word");
 }
 
 void MMU::write_word(uint32_t virtual_address, uint32_t value) {
-    // Write 4 bytes to memory from a 32-bit word
-    write(virtual_address, static_cast<uint8_t>(value & 0xFF));
-    write(virtual_address + 1, static_cast<uint8_t>((value >> 8) & 0xFF));
-    write(virtual_address + 2, static_cast<uint8_t>((value >> 16) & 0xFF));
-    write(virtual_address + 3, static_cast<uint8_t>((value >> 24) & 0xFF));
+    checked_store<uint32_t>(virtual_address, value, "MMU::write_word");
+}
+
+uint64_t MMU::read_doubleword(uint32_t virtual_address) {
+    return checked_load<uint64_t>(virtual_address, AccessType::READ, "MMU::read_doubleword");
+}
+
+void MMU::write_doubleword(uint32_t virtual_address, uint64_t value) {
+    checked_store<uint64_t>(virtual_address, value, "MMU::write_doubleword");
+}
+
+uint32_t MMU::fetch_word(uint32_t virtual_address) {
+    return checked_load<uint32_t>(virtual_address, AccessType::EXECUTE, "MMU::fetch_word");
 }
 
 void MMU::set_privilege_mode(PrivilegeMode mode) {
     privilege_mode = mode;
+    flush_tlb();
+}
+
+PrivilegeMode MMU::get_privilege_mode() const {
+    return privilege_mode;
+}
+
+void MMU::set_translation_mode(TranslationMode mode) {
+    translation_mode = mode;
+    flush_tlb();
+}
+
+TranslationMode MMU::get_translation_mode() const {
+    return translation_mode;
+}
+
+void MMU::set_satp(uint32_t value) {
+    satp = value;
+    flush_tlb();
+}
+
+uint32_t MMU::get_satp() const {
+    return satp;
+}
+
+void MMU::set_misaligned_access(MisalignedAccess policy) {
+    misaligned_access = policy;
+}
+
+MisalignedAccess MMU::get_misaligned_access() const {
+    return misaligned_access;
+}
+
+void MMU::flush_tlb() {
+    for (auto& type_tlb : tlb) {
+        type_tlb.fill(TLBEntry{});
+    }
+    tlb_generation = page_table->get_generation();
+    ++tlb_stats.flushes;
+}
+
+void MMU::flush_tlb_page(uint32_t virtual_address) {
+    uint32_t page = virtual_address & PAGE_MASK;
+    for (auto& type_tlb : tlb) {
+        TLBEntry& entry = type_tlb[(virtual_address >> PAGE_SHIFT) & (TLB_ENTRIES - 1)];
+        if (entry.tag == page) {
+            entry = TLBEntry{};
+        }
+    }
+}
+
+const TLBStats& MMU::get_tlb_stats() const {
+    return tlb_stats;
+}
+
+void MMU::reset_tlb_stats() {
+    tlb_stats = TLBStats{};
 }
@@ -1,8 +1,13 @@
 #pragma once
+#include <array>
+#include <cstdint>
 #include <stdexcept>
+#include <vector>
 
+#include "Bus.hpp"
 #include "PhysicalMemory.hpp"
 #include "PageTable.hpp"
+#include "PageTableWalker.hpp"
 #include "core/cpu/state/PrivilegeMode.hpp"
 
 //Todo: define this in other place eg memoryexceptions
@@ -16,17 +21,211 @@ public:
  explicit AccessViolationException(const std::string& msg) : std::runtime_error(msg) {}
 };
 
+/**
+ * @brief Kind of memory access, each kind is checked against its own permission bit
+ * and cached in its own TLB.
+ */
+enum class AccessType {
+    READ = 0,
+    WRITE = 1,
+    EXECUTE = 2
+};
+
+/**
+ * @brief Outcome of a memory access on the non-throwing path.
+ *
+ * The pipeline turns a failed status into a RISC-V trap, the throwing accessors turn it into
+ * a PageFaultException or an AccessViolationException.
+ */
+enum class MemoryStatus {
+    OK = 0,
+    PAGE_FAULT = 1,   /**< No valid translation, or the page table denies the access */
+    ACCESS_FAULT = 2, /**< The permission check failed, or nothing answers at the physical address */
+    MISALIGNED = 3    /**< Misaligned access refused by MisalignedAccess::TRAP */
+};
+
+/**
+ * @brief How accesses whose address is not a multiple of their size are handled.
+ */
+enum class MisalignedAccess {
+    SPLIT = 0, /**< Performed in software, split in two when they cross a page boundary */
+    TRAP = 1   /**< Refused with MemoryStatus::MISALIGNED, the guest takes an address misaligned trap */
+};
+
+/**
+ * @brief Where the MMU takes its translations from.
+ */
+enum class TranslationMode {
+    HOST_MANAGED = 0, /**< Host side PageTable map, used by the directed tests */
+    SATP = 1          /**< Guest managed page tables selected by satp (Bare or Sv32) */
+};
+
+/**
+ * @brief Counters of the MMU software TLB.
+ */
+struct TLBStats {
+    uint64_t hits = 0;    /**< Accesses served directly from the TLB */
+    uint64_t misses = 0;  /**< Accesses that had to go through the page table */
+    uint64_t flushes = 0; /**< Number of times the whole TLB was invalidated */
+};
+
+/**
+ * @brief Told about writes to physical pages that hold cached code.
+ *
+ * Implemented by decoded instruction caches, see MMU::mark_code_page.
+ */
+class CodeWriteListener {
+public:
+    virtual ~CodeWriteListener() = default;
+
+    /**
+     * @brief Called before the MMU writes to a page marked as code.
+     * @param physical_address First physical address written.
+     * @param size Number of bytes written.
+     */
+    virtual void on_code_write(uint32_t physical_address, size_t size) = 0;
+};
+
 /**
  * @brief Memory Management Unit responsible for address translation and access control.
  *
  * The MMU translates virtual addresses to physical addresses using the page table
  * and enforces access permissions based on the CPU's privilege mode.
+ *
+ * Successful translations are cached in a direct-mapped software TLB, one per access type.
+ * An entry holds the virtual page and the difference between the host address backing the
+ * page and the virtual page, so a hit costs a tag compare plus an add. An entry is only
+ * installed when the access is permitted in the current privilege mode, the TLB is flushed
+ * whenever the privilege mode or the page table change.
+ *
+ * In HOST_MANAGED mode translations come from the PageTable map. In SATP mode the guest
+ * owns its page tables: satp selects Bare (no translation) or Sv32, in which case the TLB miss
+ * path walks the page table stored in physical memory. Machine mode accesses are never
+ * translated in SATP mode.
+ *
+ * Naturally aligned accesses of every width are translated once and performed as a single host
+ * load or store: the hit path compares the TLB tag with the address masked to its page and its
+ * alignment bits, so one compare checks both and a misaligned address always misses. Misaligned
+ * accesses take a separate slow path selected by MisalignedAccess. With SPLIT they are performed
+ * in software, accesses that cross a page boundary translate both pages before touching memory so
+ * a fault on the second page leaves memory untouched. With TRAP they fail with MISALIGNED.
+ *
+ * With a Bus attached, the miss path asks the bus what answers at the physical address. RAM and
+ * ROM pages are cached like before, MMIO pages are never cached so each access reaches its device.
+ * The TLB hit path is the same with or without a bus.
+ *
+ * Physical RAM pages holding cached decoded instructions can be marked as code. Write translations
+ * of code pages are never cached, so every write to them reaches the miss path, which tells the
+ * listeners about it before writing. Writes to other pages keep the plain TLB hit path.
+ *
+ * Every access is implemented once on a non-throwing path that returns a MemoryStatus, the
+ * try_* accessors used by the pipeline expose it directly. The plain accessors used by the host
+ * and the tests wrap it and throw on failure.
  */
 class MMU {
+public:
+    static constexpr uint32_t PAGE_SIZE = 0x1000;      /**< 4KB pages */
+    static constexpr uint32_t PAGE_MASK = ~(PAGE_SIZE - 1);
+    static constexpr uint32_t PAGE_SHIFT = 12;
+    static constexpr uint32_t TLB_ENTRIES = 256;       /**< Entries per access type, power of two */
+
+    /**
+     * @brief A cached translation, tag is the virtual page base address.
+     *
+     * Page bases are 4KB aligned, so an all ones tag can never match and marks an empty entry.
+     * The layout is read by the code the JIT generates.
+     */
+    struct TLBEntry {
+        static constexpr uint32_t INVALID_TAG = 0xFFFFFFFF;
+        uint32_t tag = INVALID_TAG;
+        uint32_t physical_page = 0; /**< Physical page base, kept for the predecode cache */
+        uintptr_t addend = 0;       /**< host address of the page minus the virtual page base */
+    };
+
 private:
     PhysicalMemory* physical_memory;
+    Bus* bus;                                             /**< Optional, RAM only when null */
     PageTable* page_table;
     PrivilegeMode privilege_mode;
+    TranslationMode translation_mode;
+    PageTableWalker page_table_walker;
+    uint32_t satp;                                        /**< Address translation and protection register */
+
+    std::array<std::array<TLBEntry, TLB_ENTRIES>, 3> tlb; /**< Indexed by AccessType then by page */
+    uint64_t tlb_generation;                              /**< Page table generation the TLB was filled with */
+    TLBStats tlb_stats;
+    uint32_t device_address;                              /**< Physical address of the last MMIO miss */
+    MisalignedAccess misaligned_access;
+    std::vector<uint8_t> code_pages;                      /**< Non-zero for RAM pages marked as code */
+    std::vector<CodeWriteListener*> code_write_listeners; /**< Told about writes to code pages */
+
+    /**
+     * @brief Returns the host pointer of a virtual address, using the TLB when possible.
+     *
+     * The `size` bytes starting at the address must belong to the same page. Leaves nullptr in
+     * `host` when the address belongs to a device, its physical address is then left in device_address.
+     */
+    MemoryStatus get_host_pointer(uint32_t virtual_address, AccessType type, size_t size, uint8_t*& host);
+
+    /**
+     * @brief TLB miss path: walks the page table, checks permissions and installs the entry.
+     */
+    MemoryStatus tlb_fill(uint32_t virtual_address, AccessType type, size_t size, uint8_t*& host);
+
+    /**
+     * @brief Loads a value of any width, a TLB hit inside one page is a single host load.
+     */
+    template <typename T>
+    MemoryStatus load(uint32_t virtual_address, AccessType type, T& value);
+
+    /**
+     * @brief Stores a value of any width, a TLB hit inside one page is a single host store.
+     */
+    template <typename T>
+    MemoryStatus store(uint32_t virtual_address, T value);
+
+    /**
+     * @brief Miss and device path of load.
+     */
+    template <typename T>
+    MemoryStatus load_slow(uint32_t virtual_address, AccessType type, T& value);
+
+    /**
+     * @brief Miss and device path of store.
+     */
+    template <typename T>
+    MemoryStatus store_slow(uint32_t virtual_address, T value);
+
+    /**
+     * @brief Misaligned path of load, applies the MisalignedAccess policy.
+     */
+    template <typename T>
+    MemoryStatus load_misaligned(uint32_t virtual_address, AccessType type, T& value);
+
+    /**
+     * @brief Misaligned path of store, applies the MisalignedAccess policy.
+     */
+    template <typename T>
+    MemoryStatus store_misaligned(uint32_t virtual_address, T value);
+
+    /**
+     * @brief Calls `chunk(host_pointer, offset, length)` for each page sized piece of a range.
+     */
+    template <typename Chunk>
+    void for_each_page(uint32_t virtual_address, size_t size, AccessType type, Chunk&& chunk);
+
+    /**
+     * @brief Throwing wrappers of load and store.
+     */
+    template <typename T>
+    T checked_load(uint32_t virtual_address, AccessType type, const char* operation);
+    template <typename T>
+    void checked_store(uint32_t virtual_address, T value, const char* operation);
+
+    /**
+     * @brief Throws the exception matching a failed status, used by the throwing accessors.
+     */
+    [[noreturn]] static void raise(MemoryStatus status, uint32_t virtual_address, const char* operation);
 
 public:
     /**
@@ -37,6 +236,12 @@ public:
      */
     MMU(PhysicalMemory* phys_mem, PageTable* pt, PrivilegeMode mode);
 
+    /**
+     * @brief Routes physical accesses through a bus with ROM and devices, flushes the TLB.
+     * @param physical_bus The bus, its RAM must be the MMU physical memory. Null for RAM only.
+     */
+    void set_bus(Bus* physical_bus);
+
     /**
      * @brief Translates a virtual address to a physical address.
      * @param virtual_address The virtual address to translate.
@@ -47,6 +252,115 @@ public:
      */
     uint32_t translate_address(uint32_t virtual_address, bool is_write);
 
+    /**
+     * @brief Translates a virtual address to a physical address for a given access type.
+     * @param virtual_address The virtual address to translate.
+     * @param type The kind of access whose permission is checked.
+     * @return The corresponding physical address.
+     * @throws PageFaultException if the page is not valid.
+     * @throws AccessViolationException if access is not permitted.
+     */
+    uint32_t translate_address(uint32_t virtual_address, AccessType type);
+
+    /**
+     * @brief Translates a virtual address without throwing.
+     * @param virtual_address The virtual address to translate.
+     * @param type The kind of access whose permission is checked.
+     * @param physical_address Receives the corresponding physical address on success.
+     * @return OK, or why the access is not possible.
+     */
+    MemoryStatus try_translate(uint32_t virtual_address, AccessType type, uint32_t& physical_address);
+
+    /**
+     * @brief Non-throwing accessors used by the pipeline, a failed access leaves `value` and memory untouched.
+     * @param virtual_address The virtual address of the access.
+     * @param value The value read or written.
+     * @return OK, or the fault the guest has to take.
+     */
+    MemoryStatus try_read(uint32_t virtual_address, uint8_t& value);
+    MemoryStatus try_read_halfword(uint32_t virtual_address, uint16_t& value);
+    MemoryStatus try_read_word(uint32_t virtual_address, uint32_t& value);
+    MemoryStatus try_write(uint32_t virtual_address, uint8_t value);
+    MemoryStatus try_write_halfword(uint32_t virtual_address, uint16_t value);
+    MemoryStatus try_write_word(uint32_t virtual_address, uint32_t value);
+    MemoryStatus try_fetch_word(uint32_t virtual_address, uint32_t& value);
+
+    /**
+     * @brief Host word behind a virtual address, for the atomic accesses of the A extension.
+     *
+     * The caller operates on the word with host atomics, so only RAM and ROM words qualify:
+     * device addresses fail with ACCESS_FAULT. WRITE translations also cover the read of an AMO.
+     * @param virtual_address The address, MISALIGNED unless it is a multiple of 4 whatever the policy.
+     * @param type READ for LR, WRITE for SC and the AMOs.
+     * @param word Receives the host word, left untouched on failure.
+     * @return OK, or the fault the guest has to take.
+     */
+    MemoryStatus try_atomic_word(uint32_t virtual_address, AccessType type, uint32_t*& word);
+
+    /**
+     * @brief Translates an instruction address through the execute TLB, for decoded instruction caches.
+     *
+     * Only succeeds for pages the TLB can cache (RAM and ROM). The caller falls back to
+     * try_fetch_word otherwise, which reports the fault or reads the device.
+     * @param virtual_address The address of the instruction.
+     * @param physical_address Receives the physical address of the instruction.
+     * @return True if the address translated to a cacheable page.
+     */
+    bool translate_fetch(uint32_t virtual_address, uint32_t& physical_address);
+
+    /**
+     * @brief Translates the address of a completed access through its TLB, for the cache model.
+     *
+     * Only succeeds for RAM and ROM, device accesses are not cached. TLB hits are not counted in
+     * the TLB stats, the access itself already was.
+     * @param virtual_address The address of the access, any alignment.
+     * @param type The kind of access.
+     * @param physical_address Receives the physical address.
+     * @return True if the address translated to RAM or ROM.
+     */
+    bool translate_cacheable(uint32_t virtual_address, AccessType type, uint32_t& physical_address);
+
+    /**
+     * @brief Gives direct access to the TLB of one access type, for generated code.
+     *
+     * Drops the translations made stale by a page table change first. Generated code performs the
+     * hit path on its own: index with the virtual page, compare the tag with the address masked to
+     * its page and alignment bits, add the addend. Misses go through the try_* accessors. Hits
+     * taken this way are not counted in the TLB stats.
+     * @param type The access type.
+     * @return The TLB_ENTRIES entries of the access type, valid for the lifetime of the MMU.
+     */
+    const TLBEntry* get_tlb(AccessType type);
+
+    /**
+     * @brief Adds a listener told about writes to pages marked as code.
+     *
+     * Code marks are shared by every listener, each one drops what the write overlaps.
+     * @param listener The listener, it must be removed before it is destroyed.
+     */
+    void add_code_write_listener(CodeWriteListener* listener);
+
+    /**
+     * @brief Stops notifying a listener, unknown listeners are ignored.
+     */
+    void remove_code_write_listener(CodeWriteListener* listener);
+
+    /**
+     * @brief Marks the RAM page of a physical address as holding cached code.
+     *
+     * Drops the write translations of the page, later writes to it notify the listener.
+     * Addresses outside RAM are ignored, ROM cannot be written.
+     * @param physical_address Any physical address inside the page.
+     */
+    void mark_code_page(uint32_t physical_address);
+
+    /**
+     * @brief Clears every code mark, writes to former code pages take the TLB hit path again.
+     *
+     * Only safe once every listener dropped its cached code, marks are shared between them.
+     */
+    void clear_code_pages();
+
     /**
      * @brief Reads a byte from a virtual memory address.
      * @param virtual_address The virtual address to read from.
@@ -61,6 +375,20 @@ public:
      */
     void write(uint32_t virtual_address, uint8_t value);
 
+    /**
+     * @brief Reads a 16-bit halfword from a virtual memory address.
+     * @param virtual_address The virtual address to read from.
+     * @return The 16-bit halfword at the specified address.
+     */
+    uint16_t read_halfword(uint32_t virtual_address);
+
+    /**
+     * @brief Writes a 16-bit halfword to a virtual memory address.
+     * @param virtual_address The virtual address to write to.
+     * @param value The 16-bit halfword to write.
+     */
+    void write_halfword(uint32_t virtual_address, uint16_t value);
+
     /**
      * @brief Reads a 32-bit word from a virtual memory address.
      * @param virtual_address The virtual address to read from.
@@ -75,9 +403,136 @@ public:
      */
     void write_word(uint32_t virtual_address, uint32_t value);
 
+    /**
+     * @brief Reads a 64-bit doubleword from a virtual memory address.
+     * @param virtual_address The virtual address to read from.
+     * @return The 64-bit doubleword at the specified address.
+     */
+    uint64_t read_doubleword(uint32_t virtual_address);
+
+    /**
+     * @brief Writes a 64-bit doubleword to a virtual memory address.
+     * @param virtual_address The virtual address to write to.
+     * @param value The 64-bit doubleword to write.
+     */
+    void write_doubleword(uint32_t virtual_address, uint64_t value);
+
+    /**
+     * @brief Copies a range of virtual memory into a host buffer.
+     *
+     * The range is split at page boundaries, each page is translated once and copied with memcpy.
+     * @param virtual_address The first virtual address to read.
+     * @param data Destination buffer of at least `size` bytes.
+     * @param size Number of bytes to read.
+     */
+    void read_block(uint32_t virtual_address, uint8_t* data, size_t size);
+
+    /**
+     * @brief Copies a host buffer into a range of virtual memory.
+     *
+     * The range is split at page boundaries, each page is translated once and copied with memcpy.
+     * A fault stops the copy at the start of the faulting page, the pages before it are written.
+     * Block accesses to devices raise an AccessViolationException.
+     * @param virtual_address The first virtual address to write.
+     * @param data The bytes to copy.
+     * @param size Number of bytes to write.
+     */
+    void write_block(uint32_t virtual_address, const uint8_t* data, size_t size);
+
+    /**
+     * @brief Sets every byte of a range of virtual memory to a value, one memset per page.
+     * @param virtual_address The first virtual address to write.
+     * @param value The byte value to store.
+     * @param size Number of bytes to write.
+     */
+    void fill(uint32_t virtual_address, uint8_t value, size_t size);
+
+    /**
+     * @brief Reads a byte for instruction fetch, checking the execute permission.
+     * @param virtual_address The virtual address to fetch from.
+     * @return The byte value at the specified address.
+     */
+    uint8_t fetch(uint32_t virtual_address);
+
+    /**
+     * @brief Fetches a 32-bit instruction word, checking the execute permission.
+     * @param virtual_address The virtual address to fetch from.
+     * @return The 32-bit word at the specified address.
+     */
+    uint32_t fetch_word(uint32_t virtual_address);
+
     /**
      * @brief Sets the current privilege mode of the MMU.
+     *
+     * Cached permissions depend on the privilege mode, so this flushes the TLB.
      * @param mode The new privilege mode.
      */
     void set_privilege_mode(PrivilegeMode mode);
-};
\ No newline at end of file
+
+    /**
+     * @brief Gets the current privilege mode of the MMU.
+     * @return The privilege mode.
+     */
+    PrivilegeMode get_privilege_mode() const;
+
+    /**
+     * @brief Selects where translations come from, flushes the TLB.
+     * @param mode The new translation mode.
+     */
+    void set_translation_mode(TranslationMode mode);
+
+    /**
+     * @brief Gets the current translation mode.
+     * @return The translation mode.
+     */
+    TranslationMode get_translation_mode() const;
+
+    /**
+     * @brief Writes the satp register, flushes the TLB.
+     *
+     * Only used in SATP translation mode: MODE (bit 31) enables Sv32 and PPN (bits [21:0])
+     * is the physical page number of the root page table.
+     * @param value The new satp value.
+     */
+    void set_satp(uint32_t value);
+
+    /**
+     * @brief Reads the satp register.
+     * @return The satp value.
+     */
+    uint32_t get_satp() const;
+
+    /**
+     * @brief Selects how misaligned accesses are handled, SPLIT by default.
+     * @param policy The new policy.
+     */
+    void set_misaligned_access(MisalignedAccess policy);
+
+    /**
+     * @brief Gets how misaligned accesses are handled.
+     * @return The policy.
+     */
+    MisalignedAccess get_misaligned_access() const;
+
+    /**
+     * @brief Invalidates every entry of the TLB.
+     */
+    void flush_tlb();
+
+    /**
+     * @brief Invalidates the TLB entries of a single virtual page (SFENCE.VMA with an address).
+     * @param virtual_address Any address inside the page.
+     */
+    void flush_tlb_page(uint32_t virtual_address);
+
+    /**
+     * @brief Gets the TLB hit/miss counters.
+     * @return The TLB counters since construction or the last reset.
+     */
+    const TLBStats& get_tlb_stats() const;
+
+    /**
+     * @brief Resets the TLB hit/miss counters to zero.
+     */
+    void reset_tlb_stats();
+};
@@ -0,0 +1,91 @@
+#include "MemorySnapshot.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t SNAPSHOT_PAGE_SIZE = 0x1000;
+
+bool is_zero_page(const uint8_t* page, size_t length) {
+    const uint8_t* end = page + length;
+    return std::all_of(page, end, [](uint8_t byte) { return byte == 0; });
+}
+
+void write_fully(int fd, const uint8_t* data, size_t length, size_t offset) {
+    while (length > 0) {
+        ssize_t written = pwrite(fd, data, length, static_cast<off_t>(offset));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("MemorySnapshot - Unable to write snapshot: " + std::string(std::strerror(errno)));
+        }
+        data += written;
+        offset += static_cast<size_t>(written);
+        length -= static_cast<size_t>(written);
+    }
+}
+
+} // namespace
+
+MemorySnapshot::MemorySnapshot(const uint8_t* memory, size_t size)
+    : fd(-1), size(size), mapped_size((size + SNAPSHOT_PAGE_SIZE - 1) & ~(SNAPSHOT_PAGE_SIZE - 1)), view(nullptr)
+{
+    fd = memfd_create("virtuv-snapshot", MFD_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("MemorySnapshot - Unable to create memory file: " + std::string(std::strerror(errno)));
+    }
+    if (ftruncate(fd, static_cast<off_t>(mapped_size)) != 0) {
+        close(fd);
+        throw std::runtime_error("MemorySnapshot - Unable to size memory file: " + std::string(std::strerror(errno)));
+    }
+
+    try {
+        // Copy runs of non-zero pages, zero pages stay as holes in the file
+        size_t run_start = 0;
+        size_t run_length = 0;
+        for (size_t offset = 0; offset < size; offset += SNAPSHOT_PAGE_SIZE) {
+            size_t length = std::min(SNAPSHOT_PAGE_SIZE, size - offset);
+            if (is_zero_page(memory + offset, length)) {
+                if (run_length > 0) {
+                    write_fully(fd, memory + run_start, run_length, run_start);
+                    run_length = 0;
+                }
+                continue;
+            }
+            if (run_length == 0) {
+                run_start = offset;
+            }
+            run_length += length;
+        }
+        if (run_length > 0) {
+            write_fully(fd, memory + run_start, run_length, run_start);
+        }
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+
+    if (mapped_size > 0) {
+        void* mapping = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("MemorySnapshot - Unable to map snapshot: " + std::string(std::strerror(errno)));
+        }
+        view = static_cast<const uint8_t*>(mapping);
+    }
+}
+
+MemorySnapshot::~MemorySnapshot() {
+    if (view != nullptr) {
+        munmap(const_cast<uint8_t*>(view), mapped_size);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Immutable copy of the contents of a PhysicalMemory.
+ *
+ * The contents live in an anonymous memory file (memfd) that is only written while the snapshot
+ * is captured. Restoring maps the file privately over the RAM of a PhysicalMemory, so the kernel
+ * shares every page with the snapshot until it is first written: restoring or forking costs
+ * O(pages touched afterwards) instead of O(memory size). All-zero pages are never stored, the file
+ * keeps holes for them.
+ */
+class MemorySnapshot {
+private:
+    int fd;               /**< memfd holding the page contents */
+    size_t size;          /**< Size of the captured RAM in bytes */
+    size_t mapped_size;   /**< Size rounded up to whole pages */
+    const uint8_t* view;  /**< Read-only shared mapping of the contents */
+
+public:
+    /**
+     * @brief Captures a memory image.
+     * @param memory Host pointer to the first byte of RAM.
+     * @param size Size of the RAM in bytes.
+     * @throws std::runtime_error if the backing file cannot be created.
+     */
+    MemorySnapshot(const uint8_t* memory, size_t size);
+    ~MemorySnapshot();
+
+    MemorySnapshot(const MemorySnapshot&) = delete;
+    MemorySnapshot& operator=(const MemorySnapshot&) = delete;
+
+    /**
+     * @brief Gets the file descriptor of the backing file, used to map it copy-on-write.
+     * @return The memfd of the snapshot.
+     */
+    int get_fd() const { return fd; }
+
+    /**
+     * @brief Gets the size of the captured RAM.
+     * @return Size in bytes.
+     */
+    size_t get_size() const { return size; }
+
+    /**
+     * @brief Gets the size of the backing file, the RAM size rounded up to whole pages.
+     * @return Size in bytes.
+     */
+    size_t get_mapped_size() const { return mapped_size; }
+
+    /**
+     * @brief Gets a read-only view of the captured contents.
+     * @return Pointer to the first captured byte.
+     */
+    const uint8_t* data() const { return view; }
+};
@@ -5,6 +5,7 @@
 
 void PageTable::add_entry(uint32_t virtual_address, PageTableEntry entry) {
     entries[virtual_address] = entry;
+    ++generation;
 }
 
 PageTableEntry PageTable::get_entry(uint32_t virtual_address) {
@@ -14,4 +15,8 @@ PageTableEntry PageTable::get_entry(uint32_t virtual_address) {
     } else {
         throw PageFaultException("PageTable::get_entry - No entry for virtual address");
     }
-}
\ No newline at end of file
+}
+const PageTableEntry* PageTable::find_entry(uint32_t virtual_address) const {
+    auto it = entries.find(virtual_address & 0xFFFFF000);
+    return it != entries.end() ? &it->second : nullptr;
+}
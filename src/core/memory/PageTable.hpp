@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <unordered_map>
 #include "PageTableEntry.hpp"
 /**
@@ -9,6 +10,7 @@
 class PageTable {
 private:
     std::unordered_map<uint32_t, PageTableEntry> entries;
+    uint64_t generation = 0; /**< Bumped on every change so translation caches know when to flush */
 
 public:
     /**
@@ -25,4 +27,20 @@ public:
      * @throws std::out_of_range if no entry exists for the given address.
      */
     PageTableEntry get_entry(uint32_t virtual_address);
+
+    /**
+     * @brief Looks up the page table entry for a given virtual address without throwing.
+     * @param virtual_address The virtual address to look up.
+     * @return The entry of the page, nullptr if there is none. Valid until the table changes.
+     */
+    const PageTableEntry* find_entry(uint32_t virtual_address) const;
+
+    /**
+     * @brief Gets the generation of the page table.
+     *
+     * The generation changes every time an entry is added or replaced, the MMU compares it
+     * against the generation its TLB was filled with to detect stale translations.
+     * @return The current generation counter.
+     */
+    uint64_t get_generation() const { return generation; }
 };
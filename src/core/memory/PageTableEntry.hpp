@@ -16,6 +16,9 @@ public:
     static constexpr uint32_t WRITE_BIT = 0x4; // Allow write operations 100
     static constexpr uint32_t EXECUTE_BIT = 0x8; // Allow execution operations 1000
     static constexpr uint32_t USER_ACCESSIBLE_BIT = 0x10; //Indicates if the page is accessible in USER mode 1010
+    static constexpr uint32_t GLOBAL_BIT = 0x20; //Mapping exists in all address spaces (Sv32)
+    static constexpr uint32_t ACCESSED_BIT = 0x40; //Page was read, written or fetched since the bit was cleared (Sv32)
+    static constexpr uint32_t DIRTY_BIT = 0x80; //Page was written since the bit was cleared (Sv32)
 public:
     /**
      * @brief Default constructor for an invalid entry.
@@ -56,4 +59,9 @@ public:
       * @return The corresponding physical address.
       */
     uint32_t get_physical_address(uint32_t virtual_address) const;
+    /**
+     * @brief Gets the raw value of the entry.
+     * @return The raw 32-bit entry.
+     */
+    uint32_t get_value() const { return entry_value; }
 };
\ No newline at end of file
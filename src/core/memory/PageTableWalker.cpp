@@ -0,0 +1,83 @@
+#include "PageTableWalker.hpp"
+#include "MMU.hpp"
+
+PageTableWalker::PageTableWalker(PhysicalMemory* phys_mem) : physical_memory(phys_mem) {}
+
+bool PageTableWalker::read_pte(uint64_t pte_address, uint32_t& pte) {
+    // Page tables may live anywhere in the 34-bit Sv32 physical space, only our memory is backed
+    if (pte_address + PTE_SIZE > physical_memory->get_size()) {
+        return false;
+    }
+    pte = physical_memory->read_word(static_cast<uint32_t>(pte_address));
+    return true;
+}
+
+MemoryStatus PageTableWalker::walk(uint32_t satp, uint32_t virtual_address, AccessType type, PrivilegeMode mode,
+                                   uint32_t& physical_address) {
+    const uint32_t vpn[LEVELS] = {
+        (virtual_address >> 12) & 0x3FF, // VPN[0]
+        (virtual_address >> 22) & 0x3FF  // VPN[1]
+    };
+
+    uint64_t table_address = static_cast<uint64_t>(satp & SATP_PPN_MASK) * MMU::PAGE_SIZE;
+    uint64_t pte_address = 0;
+    uint32_t pte = 0;
+    int level = LEVELS - 1;
+
+    // Descend until a leaf (R or X set) is found
+    while (true) {
+        pte_address = table_address + vpn[level] * PTE_SIZE;
+        if (!read_pte(pte_address, pte)) {
+            return MemoryStatus::ACCESS_FAULT;
+        }
+
+        if (!(pte & PageTableEntry::VALID_BIT) ||
+            (!(pte & PageTableEntry::READ_BIT) && (pte & PageTableEntry::WRITE_BIT))) {
+            return MemoryStatus::PAGE_FAULT;
+        }
+        if (pte & (PageTableEntry::READ_BIT | PageTableEntry::EXECUTE_BIT)) {
+            break;
+        }
+        if (--level < 0) {
+            return MemoryStatus::PAGE_FAULT;
+        }
+        table_address = static_cast<uint64_t>(pte >> 10) * MMU::PAGE_SIZE;
+    }
+
+    // Permission checks on the leaf. S-mode may not touch user pages (SUM is not modelled)
+    bool user_page = pte & PageTableEntry::USER_ACCESSIBLE_BIT;
+    if ((mode == PrivilegeMode::USER && !user_page) || (mode == PrivilegeMode::SUPERVISOR && user_page)) {
+        return MemoryStatus::PAGE_FAULT;
+    }
+    uint32_t required_bit = type == AccessType::WRITE   ? PageTableEntry::WRITE_BIT
+                          : type == AccessType::EXECUTE ? PageTableEntry::EXECUTE_BIT
+                                                        : PageTableEntry::READ_BIT;
+    if (!(pte & required_bit)) {
+        return MemoryStatus::PAGE_FAULT;
+    }
+
+    // A megapage must be aligned to 4MB, PPN[0] has to be zero
+    uint32_t ppn0 = (pte >> 10) & 0x3FF;
+    uint32_t ppn1 = (pte >> 20) & 0xFFF;
+    if (level == 1 && ppn0 != 0) {
+        return MemoryStatus::PAGE_FAULT;
+    }
+
+    // Hardware update of the accessed and dirty bits
+    uint32_t updated_pte = pte | PageTableEntry::ACCESSED_BIT;
+    if (type == AccessType::WRITE) {
+        updated_pte |= PageTableEntry::DIRTY_BIT;
+    }
+    if (updated_pte != pte) {
+        physical_memory->write_word(static_cast<uint32_t>(pte_address), updated_pte);
+    }
+
+    // Megapages take PPN[0] from the virtual address
+    uint64_t physical_page = (static_cast<uint64_t>(ppn1) << 10) | (level == 1 ? vpn[0] : ppn0);
+    uint64_t address = physical_page * MMU::PAGE_SIZE + (virtual_address & ~MMU::PAGE_MASK);
+    if (address > 0xFFFFFFFF) {
+        return MemoryStatus::ACCESS_FAULT;
+    }
+    physical_address = static_cast<uint32_t>(address);
+    return MemoryStatus::OK;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+
+#include "PhysicalMemory.hpp"
+#include "PageTableEntry.hpp"
+#include "core/cpu/state/PrivilegeMode.hpp"
+
+enum class AccessType;
+enum class MemoryStatus;
+
+/**
+ * @brief Hardware page table walker for the RISC-V Sv32 translation scheme.
+ *
+ * Walks the two-level page table stored in guest physical memory, rooted at the
+ * physical page number held in satp. Supports 4KB pages and 4MB megapages and updates
+ * the accessed/dirty bits of the leaf entry the way hardware does. The walker is only
+ * used on the TLB miss path of the MMU.
+ */
+class PageTableWalker {
+public:
+    static constexpr uint32_t SATP_MODE_SV32 = 0x80000000; /**< satp.MODE, bit 31 */
+    static constexpr uint32_t SATP_PPN_MASK = 0x003FFFFF;  /**< satp.PPN, bits [21:0] */
+    static constexpr uint32_t PTE_SIZE = 4;
+    static constexpr uint32_t LEVELS = 2;
+
+private:
+    PhysicalMemory* physical_memory;
+
+    bool read_pte(uint64_t pte_address, uint32_t& pte);
+
+public:
+    /**
+     * @brief Constructs a walker that reads page tables from the given physical memory.
+     * @param phys_mem Pointer to the physical memory holding the page tables.
+     */
+    explicit PageTableWalker(PhysicalMemory* phys_mem);
+
+    /**
+     * @brief Translates a virtual address by walking the Sv32 page table.
+     * @param satp Value of the satp register, its PPN field is the root page table.
+     * @param virtual_address The virtual address to translate.
+     * @param type The kind of access, checked against the leaf permissions.
+     * @param mode The privilege mode the access is performed in.
+     * @param physical_address Receives the corresponding physical address on success.
+     * @return OK, PAGE_FAULT if the walk fails or the access is not permitted, ACCESS_FAULT if
+     *         a page table entry or the final address is outside physical memory.
+     */
+    MemoryStatus walk(uint32_t satp, uint32_t virtual_address, AccessType type, PrivilegeMode mode,
+                      uint32_t& physical_address);
+};
@@ -1,18 +1,258 @@
 #include "PhysicalMemory.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <stdexcept>
+#include <string>
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
 
-PhysicalMemory::PhysicalMemory(size_t size) : memory(size, 0) {}
+#include "utils/bitutils.hpp"
+#include "utils/plt.hpp"
 
-uint8_t PhysicalMemory::read(uint32_t address) {
-    if (address >= memory.size()) {
+PhysicalMemory::PhysicalMemory(size_t size) : PhysicalMemory(size, MemoryBacking::HEAP) {}
+
+PhysicalMemory::PhysicalMemory(size_t size, MemoryBacking backing, bool huge_pages)
+    : memory(nullptr), memory_size(size), backing(backing),
+      dirty_pages((((size + PAGE_SIZE - 1) >> PAGE_SHIFT) + 63) / 64, 0)
+{
+    if (size > ADDRESS_SPACE_SIZE) {
+        throw std::invalid_argument("PhysicalMemory - Size exceeds the 32-bit physical address space");
+    }
+
+    if (backing == MemoryBacking::HEAP) {
+        heap_memory.assign(size, 0);
+        memory = heap_memory.data();
+        return;
+    }
+
+    // Reserve the whole physical space without committing swap, nothing is accessible yet
+    void* reservation = mmap(nullptr, ADDRESS_SPACE_SIZE + GUARD_SIZE, PROT_NONE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reservation == MAP_FAILED) {
+        throw std::runtime_error("PhysicalMemory - Unable to reserve address space: " + std::string(std::strerror(errno)));
+    }
+    memory = static_cast<uint8_t*>(reservation);
+
+    // Open up the RAM, anonymous pages read as zero until they are first written
+    if (size > 0 && mprotect(memory, size, PROT_READ | PROT_WRITE) != 0) {
+        munmap(memory, ADDRESS_SPACE_SIZE + GUARD_SIZE);
+        throw std::runtime_error("PhysicalMemory - Unable to map RAM: " + std::string(std::strerror(errno)));
+    }
+
+    if (huge_pages && size > 0) {
+#ifdef MADV_HUGEPAGE
+        if (madvise(memory, size, MADV_HUGEPAGE) != 0) {
+            PLT_WARN("PhysicalMemory - Transparent huge pages are not available: " + std::string(std::strerror(errno)));
+        }
+#else
+        PLT_WARN("PhysicalMemory - Transparent huge pages are not supported on this host");
+#endif
+    }
+}
+
+PhysicalMemory::~PhysicalMemory() {
+    if (backing == MemoryBacking::RESERVED && memory != nullptr) {
+        munmap(memory, ADDRESS_SPACE_SIZE + GUARD_SIZE);
+    }
+}
+
+template <typename T>
+T PhysicalMemory::load(uint32_t address) {
+    // One bounds check covers every byte of the access
+    if (static_cast<size_t>(address) + sizeof(T) > memory_size) {
         throw std::out_of_range("PhysicalMemory::read - Address out of range");
     }
-    return memory[address];
+    return bitutils::load_le<T>(memory + address);
 }
 
-void PhysicalMemory::write(uint32_t address, uint8_t value) {
-    if (address >= memory.size()) {
+template <typename T>
+void PhysicalMemory::store(uint32_t address, T value) {
+    if (static_cast<size_t>(address) + sizeof(T) > memory_size) {
         throw std::out_of_range("PhysicalMemory::write - Address out of range");
     }
-    memory[address] = value;
+    mark_dirty(address, sizeof(T));
+    bitutils::store_le<T>(memory + address, value);
+}
+uint8_t PhysicalMemory::read(uint32_t address) {
+    return load<uint8_t>(address);
+}
+
+void PhysicalMemory::write(uint32_t address, uint8_t value) {
+    store<uint8_t>(address, value);
+}
+
+uint16_t PhysicalMemory::read_halfword(uint32_t address) {
+    return load<uint16_t>(address);
+}
+
+uint32_t PhysicalMemory::read_word(uint32_t address) {
+    return load<uint32_t>(address);
+}
+
+uint64_t PhysicalMemory::read_doubleword(uint32_t address) {
+    return load<uint64_t>(address);
+}
+
+void PhysicalMemory::write_halfword(uint32_t address, uint16_t value) {
+    store<uint16_t>(address, value);
+}
+
+void PhysicalMemory::write_word(uint32_t address, uint32_t value) {
+    store<uint32_t>(address, value);
+}
+
+void PhysicalMemory::write_doubleword(uint32_t address, uint64_t value) {
+    store<uint64_t>(address, value);
+}
+
+uint8_t* PhysicalMemory::get_host_pointer(uint32_t address, size_t size) {
+    if (static_cast<size_t>(address) + size > memory_size) {
+        throw std::out_of_range("PhysicalMemory::get_host_pointer - Address out of range");
+    }
+    return memory + address;
+}
+
+void PhysicalMemory::write_block(uint32_t address, const uint8_t* data, size_t size) {
+    uint8_t* destination = get_host_pointer(address, size);
+    mark_dirty(address, size);
+    std::memcpy(destination, data, size);
+}
+
+void PhysicalMemory::zero_fill(uint32_t address, size_t size) {
+    uint8_t* destination = get_host_pointer(address, size);
+    mark_dirty(address, size);
+
+    size_t start = address;
+    size_t end = start + size;
+    size_t first_page = (start + PAGE_SIZE - 1) & ~size_t{PAGE_SIZE - 1};
+    size_t last_page = end & ~size_t{PAGE_SIZE - 1};
+    if (backing == MemoryBacking::HEAP || first_page >= last_page) {
+        std::memset(destination, 0, size);
+        return;
+    }
+
+    // Whole pages get fresh zero pages from the kernel, allocated on first touch
+    std::memset(destination, 0, first_page - start);
+    void* mapping = mmap(memory + first_page, last_page - first_page, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("PhysicalMemory::zero_fill - Unable to map zero pages: " + std::string(std::strerror(errno)));
+    }
+    std::memset(memory + last_page, 0, end - last_page);
+}
+
+bool PhysicalMemory::map_file(uint32_t address, int fd, size_t offset, size_t size) {
+    get_host_pointer(address, size);
+    if (backing != MemoryBacking::RESERVED || size == 0
+        || (address | offset | size) & (PAGE_SIZE - 1)) {
+        return false;
+    }
+    void* mapping = mmap(memory + address, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+                         fd, static_cast<off_t>(offset));
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    mark_dirty(address, size);
+    return true;
+}
+
+const uint8_t* PhysicalMemory::data() const {
+    return memory;
+}
+
+size_t PhysicalMemory::get_size() const {
+    return memory_size;
+}
+
+MemoryBacking PhysicalMemory::get_backing() const {
+    return backing;
+}
+
+void PhysicalMemory::mark_dirty(uint32_t address, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    size_t first_page = address >> PAGE_SHIFT;
+    size_t last_page = (static_cast<size_t>(address) + size - 1) >> PAGE_SHIFT;
+    for (size_t page = first_page; page <= last_page; ++page) {
+        // Harts sharing the memory mark pages of the same word concurrently, the atomic or keeps
+        // every bit. Already set is the common case and costs a plain load
+        uint64_t bit = uint64_t{1} << (page % 64);
+        std::atomic_ref<uint64_t> word(dirty_pages[page / 64]);
+        if ((word.load(std::memory_order_relaxed) & bit) == 0) {
+            word.fetch_or(bit, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool PhysicalMemory::is_dirty(uint32_t address) const {
+    size_t page = address >> PAGE_SHIFT;
+    if (page / 64 >= dirty_pages.size()) {
+        return false;
+    }
+    return dirty_pages[page / 64] & (uint64_t{1} << (page % 64));
+}
+
+size_t PhysicalMemory::count_dirty_pages() const {
+    size_t count = 0;
+    for (uint64_t bits : dirty_pages) {
+        count += std::popcount(bits);
+    }
+    return count;
+}
+
+void PhysicalMemory::clear_dirty_pages() {
+    std::fill(dirty_pages.begin(), dirty_pages.end(), 0);
+}
+
+std::shared_ptr<MemorySnapshot> PhysicalMemory::snapshot() {
+    // Every page is read: residency says nothing about the contents, swapped out pages hold data
+    auto snapshot = std::make_shared<MemorySnapshot>(memory, memory_size);
+    clear_dirty_pages();
+    return snapshot;
+}
+
+void PhysicalMemory::restore(const MemorySnapshot& snapshot) {
+    if (snapshot.get_size() != memory_size) {
+        throw std::invalid_argument("PhysicalMemory::restore - Snapshot size does not match memory size");
+    }
+    clear_dirty_pages();
+    if (memory_size == 0) {
+        return;
+    }
+
+    if (backing == MemoryBacking::HEAP) {
+        std::memcpy(memory, snapshot.data(), memory_size);
+        return;
+    }
+
+    // Replace the RAM pages with a private mapping of the snapshot, the kernel copies a page on its first write
+    void* mapping = mmap(memory, snapshot.get_mapped_size(), PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_FIXED, snapshot.get_fd(), 0);
+    if (mapping == MAP_FAILED) {
+        throw std::runtime_error("PhysicalMemory::restore - Unable to map snapshot: " + std::string(std::strerror(errno)));
+    }
+}
+
+size_t PhysicalMemory::restore_dirty_pages(const MemorySnapshot& snapshot) {
+    if (snapshot.get_size() != memory_size) {
+        throw std::invalid_argument("PhysicalMemory::restore_dirty_pages - Snapshot size does not match memory size");
+    }
+
+    // Walk the set bits only, clean pages are never touched
+    size_t restored = 0;
+    for (size_t word = 0; word < dirty_pages.size(); ++word) {
+        uint64_t bits = dirty_pages[word];
+        while (bits != 0) {
+            size_t page = word * 64 + static_cast<size_t>(std::countr_zero(bits));
+            bits &= bits - 1;
+            size_t offset = page << PAGE_SHIFT;
+            std::memcpy(memory + offset, snapshot.data() + offset, std::min<size_t>(PAGE_SIZE, memory_size - offset));
+            ++restored;
+        }
+        dirty_pages[word] = 0;
+    }
+    return restored;
 }
@@ -1,14 +1,48 @@
 #pragma once
 #include <vector>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+
+#include "MemorySnapshot.hpp"
+
+/**
+ * @brief How the host memory behind the guest physical memory is allocated.
+ */
+enum class MemoryBacking {
+    HEAP = 0,     /**< Heap buffer of exactly the memory size, zero filled at construction */
+    RESERVED = 1  /**< Whole 32-bit physical space reserved with mmap, pages are zeroed on first touch */
+};
+
 /**
  * @brief Represents the physical memory of the system.
  *
  * This class simulates the physical memory (RAM) where data and instructions are stored.
+ *
+ * With RESERVED backing the full 4GB physical address space plus a trailing guard region is
+ * reserved with mmap(MAP_NORESERVE). Only [0, size) is accessible, untouched pages cost no
+ * memory, and everything above the RAM stays PROT_NONE so a host side overrun faults instead of
+ * corrupting other data. Since any 32-bit physical address maps into the reservation, host
+ * pointers handed to the MMU never need a range check on the hot path.
  */
 class PhysicalMemory {
+public:
+    static constexpr size_t ADDRESS_SPACE_SIZE = size_t{1} << 32; /**< Bytes addressable with 32 bits */
+    static constexpr size_t GUARD_SIZE = 64 * 1024;                /**< Inaccessible bytes after the address space */
+    static constexpr uint32_t PAGE_SHIFT = 12;                     /**< Dirty tracking granularity, 4KB pages */
+    static constexpr uint32_t PAGE_SIZE = 1u << PAGE_SHIFT;
+
 private:
-    std::vector<uint8_t> memory; /**< The memory storage represented as a byte array */
+    std::vector<uint8_t> heap_memory; /**< Storage for HEAP backing */
+    uint8_t* memory;                  /**< Base of the storage, physical address 0 */
+    size_t memory_size;               /**< Size of the RAM in bytes */
+    MemoryBacking backing;
+    std::vector<uint64_t> dirty_pages; /**< One bit per page written since the last snapshot or restore */
+
+    template <typename T>
+    T load(uint32_t address);
+    template <typename T>
+    void store(uint32_t address, T value);
 
 public:
     /**
@@ -16,6 +50,20 @@ public:
      * @param size The size of the memory in bytes.
      */
     explicit PhysicalMemory(size_t size);
+    /**
+     * @brief Constructs a PhysicalMemory object with a given size and backing.
+     * @param size The size of the memory in bytes, at most 4GB.
+     * @param backing How the host memory is allocated.
+     * @param huge_pages Advise the kernel to back the RAM with transparent huge pages (RESERVED only).
+     * @throws std::invalid_argument if the size does not fit the 32-bit physical space.
+     * @throws std::runtime_error if the address space reservation fails.
+     */
+    PhysicalMemory(size_t size, MemoryBacking backing, bool huge_pages = false);
+    ~PhysicalMemory();
+
+    PhysicalMemory(const PhysicalMemory&) = delete;
+    PhysicalMemory& operator=(const PhysicalMemory&) = delete;
+
     /**
      * @brief Reads a byte from a physical memory address.
      * @param address The physical address to read from.
@@ -30,4 +78,159 @@ public:
      * @throws std::out_of_range if the address is out of bounds.
      */
     void write(uint32_t address, uint8_t value);
+    /**
+     * @brief Reads a little-endian 16-bit halfword, the address does not need to be aligned.
+     * @param address The physical address to read from.
+     * @return The halfword at the specified address.
+     * @throws std::out_of_range if any byte of the access is out of bounds.
+     */
+    uint16_t read_halfword(uint32_t address);
+    /**
+     * @brief Reads a little-endian 32-bit word, the address does not need to be aligned.
+     * @param address The physical address to read from.
+     * @return The word at the specified address.
+     * @throws std::out_of_range if any byte of the access is out of bounds.
+     */
+    uint32_t read_word(uint32_t address);
+    /**
+     * @brief Reads a little-endian 64-bit doubleword, the address does not need to be aligned.
+     * @param address The physical address to read from.
+     * @return The doubleword at the specified address.
+     * @throws std::out_of_range if any byte of the access is out of bounds.
+     */
+    uint64_t read_doubleword(uint32_t address);
+    /**
+     * @brief Writes a little-endian 16-bit halfword, the address does not need to be aligned.
+     * @param address The physical address to write to.
+     * @param value The halfword to write.
+     * @throws std::out_of_range if any byte of the access is out of bounds.
+     */
+    void write_halfword(uint32_t address, uint16_t value);
+    /**
+     * @brief Writes a little-endian 32-bit word, the address does not need to be aligned.
+     * @param address The physical address to write to.
+     * @param value The word to write.
+     * @throws std::out_of_range if any byte of the access is out of bounds.
+     */
+    void write_word(uint32_t address, uint32_t value);
+    /**
+     * @brief Writes a little-endian 64-bit doubleword, the address does not need to be aligned.
+     * @param address The physical address to write to.
+     * @param value The doubleword to write.
+     * @throws std::out_of_range if any byte of the access is out of bounds.
+     */
+    void write_doubleword(uint32_t address, uint64_t value);
+    /**
+     * @brief Returns the host pointer backing a range of physical memory.
+     *
+     * Used by the MMU to cache host addresses in its TLB, the returned pointer stays
+     * valid for the lifetime of the PhysicalMemory object.
+     * @param address The physical address.
+     * @param size Number of bytes that will be accessed through the pointer.
+     * @return Pointer to the host byte that stores the address.
+     * @throws std::out_of_range if any byte of the range is out of bounds.
+     */
+    uint8_t* get_host_pointer(uint32_t address, size_t size = 1);
+    /**
+     * @brief Copies a buffer into physical memory with a single bounds check.
+     * @param address The first physical address to write.
+     * @param data The bytes to copy.
+     * @param size Number of bytes to copy.
+     * @throws std::out_of_range if any byte of the range is out of bounds.
+     */
+    void write_block(uint32_t address, const uint8_t* data, size_t size);
+    /**
+     * @brief Sets a range of physical memory to zero.
+     *
+     * With RESERVED backing the whole pages of the range are replaced by fresh anonymous
+     * pages, so they cost nothing until they are touched. Only the partial pages at both
+     * ends are cleared with memset.
+     * @param address The first physical address to clear.
+     * @param size Number of bytes to clear.
+     * @throws std::out_of_range if any byte of the range is out of bounds.
+     * @throws std::runtime_error if the pages cannot be remapped.
+     */
+    void zero_fill(uint32_t address, size_t size);
+    /**
+     * @brief Maps part of a file over physical memory instead of copying it.
+     *
+     * Only possible with RESERVED backing when the address, the file offset and the size are page
+     * aligned. The mapping is private: the kernel copies a page on its first write and the file is
+     * never modified. The file descriptor can be closed afterwards.
+     * @param address The first physical address of the mapping.
+     * @param fd An open file descriptor.
+     * @param offset Offset of the data in the file.
+     * @param size Number of bytes to map.
+     * @return False if the range cannot be mapped and has to be copied instead.
+     * @throws std::out_of_range if any byte of the range is out of bounds.
+     */
+    bool map_file(uint32_t address, int fd, size_t offset, size_t size);
+    /**
+     * @brief Gets the host storage of the whole memory, physical address 0 first.
+     *
+     * Meant for read-only views: writing through the pointer bypasses the dirty page tracking.
+     * @return Pointer to get_size() contiguous bytes.
+     */
+    const uint8_t* data() const;
+    /**
+     * @brief Gets the size of the memory.
+     * @return The size of the memory in bytes.
+     */
+    size_t get_size() const;
+    /**
+     * @brief Gets how the memory is backed.
+     * @return The backing mode.
+     */
+    MemoryBacking get_backing() const;
+    /**
+     * @brief Marks the pages covered by a range as written.
+     *
+     * Stores through this class mark their pages themselves. The MMU marks a page when it installs
+     * a write translation in its TLB, so every TLB has to be flushed whenever the dirty pages are
+     * cleared.
+     * @param address First physical address of the range.
+     * @param size Number of bytes in the range.
+     */
+    void mark_dirty(uint32_t address, size_t size = 1);
+    /**
+     * @brief Checks whether the page containing an address was written since the last snapshot or restore.
+     * @param address Any physical address inside the page.
+     * @return True if the page is dirty.
+     */
+    bool is_dirty(uint32_t address) const;
+    /**
+     * @brief Counts the pages written since the last snapshot or restore.
+     * @return Number of dirty pages.
+     */
+    size_t count_dirty_pages() const;
+    /**
+     * @brief Forgets every dirty page.
+     */
+    void clear_dirty_pages();
+    /**
+     * @brief Captures the current contents of the memory and clears the dirty pages.
+     * @return An immutable snapshot that can be restored into any memory of the same size.
+     */
+    std::shared_ptr<MemorySnapshot> snapshot();
+    /**
+     * @brief Replaces the contents of the memory with a snapshot.
+     *
+     * With RESERVED backing the snapshot is mapped copy-on-write over the RAM, pages are only
+     * copied when they are written. HEAP backing copies the whole snapshot.
+     * Host pointers into the memory stay valid.
+     * @param snapshot The snapshot to restore.
+     * @throws std::invalid_argument if the snapshot was taken from a memory of a different size.
+     * @throws std::runtime_error if the snapshot cannot be mapped.
+     */
+    void restore(const MemorySnapshot& snapshot);
+    /**
+     * @brief Copies back only the pages written since the snapshot was taken or last restored.
+     *
+     * Only valid when the memory was last snapshotted into, or restored from, the given snapshot.
+     * Costs O(dirty pages) and clears the dirty pages.
+     * @param snapshot The snapshot the memory is reset to.
+     * @return Number of pages that were copied back.
+     * @throws std::invalid_argument if the snapshot was taken from a memory of a different size.
+     */
+    size_t restore_dirty_pages(const MemorySnapshot& snapshot);
 };
@@ -1,16 +1,25 @@
 #include <iostream>
 
 #include "core/cpu/CPU.hpp"
+#include "core/devices/Timer.hpp"
+#include "core/devices/Uart.hpp"
+#include "core/loader/ElfLoader.hpp"
 
 int main(int argc, char* argv[]) {
-    // CPU instance with 1 MB of memory
-    CPU cpu(1024 * 1024);
-
     if (argc < 2) {
-        std::cerr << "Usage: virtuv <program[.bin]>" << std::endl;
+        std::cerr << "Usage: virtuv <program[.bin|.elf]>" << std::endl;
         return 1;
     }
 
+    // CPU instance with 1 MB of memory. ELF programs are usually linked high (0x80000000), they get
+    // the whole physical space, reserved memory only costs the pages that are used
+    bool is_elf = ElfLoader::is_elf(argv[1]);
+    CPU cpu = is_elf ? CPU(PhysicalMemory::ADDRESS_SPACE_SIZE, MemoryBacking::RESERVED) : CPU(1024 * 1024);
+
+    // Devices at their QEMU virt machine addresses, shadowing the RAM when it is that large
+    cpu.attach_device(0x02000000, Timer::SIZE, std::make_shared<Timer>());
+    cpu.attach_device(0x10000000, Uart::SIZE, std::make_shared<Uart>(true));
+
     if (cpu.load_program(argv[1]) != 0) {
         std::cerr << "Failed to load program: " << argv[1] << std::endl;
         return 1;
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
 namespace bitutils{
 
 /**
@@ -14,4 +18,30 @@ constexpr T sign_extend(T value, int bit_width) {
     return (value ^ sign_bit) - sign_bit;    // Flip and subtract sign bit for extension
 }
 
+/**
+ * @brief Loads a little-endian value from a possibly unaligned host address.
+ *
+ * memcpy is lowered to a single load on hosts that allow unaligned accesses.
+ */
+template <typename T>
+inline T load_le(const uint8_t* ptr) {
+    T value;
+    std::memcpy(&value, ptr, sizeof(T));
+    if constexpr (std::endian::native == std::endian::big) {
+        value = std::byteswap(value);
+    }
+    return value;
+}
+
+/**
+ * @brief Stores a value in little-endian order to a possibly unaligned host address.
+ */
+template <typename T>
+inline void store_le(uint8_t* ptr, T value) {
+    if constexpr (std::endian::native == std::endian::big) {
+        value = std::byteswap(value);
+    }
+    std::memcpy(ptr, &value, sizeof(T));
+}
+
 };
\ No newline at end of file
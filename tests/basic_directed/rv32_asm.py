@@ -0,0 +1,121 @@
+# Minimal RV32IMA encoder for the guest programs of the directed tests, with the few Zicsr
+# instructions they need, and the CPU fixture the pipeline tests share. Branch and jump offsets are
+# in bytes relative to the instruction itself.
+import struct
+
+from virtuv_bindings import CPU, ExecutionMode, MemoryBacking, TranslationMode
+
+HALT = 0x0000006F   # jal x0, 0, ends CPU.run
+NOP = 0x00000013    # addi x0, x0, 0
+ECALL = 0x00000073
+MRET = 0x30200073
+
+
+def i_type(opcode, rd, funct3, rs1, imm):
+    return ((imm & 0xFFF) << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | opcode
+
+
+def r_type(funct7, rs2, rs1, funct3, rd):
+    return (funct7 << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | (rd << 7) | 0x33
+
+
+def s_type(funct3, rs1, rs2, imm):
+    return (((imm >> 5) & 0x7F) << 25) | (rs2 << 20) | (rs1 << 15) | (funct3 << 12) | ((imm & 0x1F) << 7) | 0x23
+
+
+def b_type(funct3, rs1, rs2, offset):
+    return (((offset >> 12) & 1) << 31) | (((offset >> 5) & 0x3F) << 25) | (rs2 << 20) | (rs1 << 15) \
+        | (funct3 << 12) | (((offset >> 1) & 0xF) << 8) | (((offset >> 11) & 1) << 7) | 0x63
+
+
+def m_type(funct3, rd, rs1, rs2):
+    return r_type(0x01, rs2, rs1, funct3, rd)
+
+
+def amo(funct5, rd, rs1, rs2):
+    return (funct5 << 27) | (rs2 << 20) | (rs1 << 15) | (2 << 12) | (rd << 7) | 0x2F
+
+
+def lui(rd, upper):
+    return (upper << 12) | (rd << 7) | 0x37
+
+
+def auipc(rd, upper):
+    return (upper << 12) | (rd << 7) | 0x17
+
+
+def jal(rd, offset):
+    return (((offset >> 20) & 1) << 31) | (((offset >> 1) & 0x3FF) << 21) | (((offset >> 11) & 1) << 20) \
+        | (((offset >> 12) & 0xFF) << 12) | (rd << 7) | 0x6F
+
+
+def jalr(rd, rs1, imm):
+    return i_type(0x67, rd, 0, rs1, imm)
+
+
+def addi(rd, rs1, imm):
+    return i_type(0x13, rd, 0, rs1, imm)
+
+
+def slli(rd, rs1, shamt):
+    return i_type(0x13, rd, 1, rs1, shamt)
+
+
+def srli(rd, rs1, shamt):
+    return i_type(0x13, rd, 5, rs1, shamt)
+
+
+def add(rd, rs1, rs2):
+    return r_type(0x00, rs2, rs1, 0, rd)
+
+
+def load(funct3, rd, rs1, imm):
+    return i_type(0x03, rd, funct3, rs1, imm)
+
+
+def lw(rd, rs1, imm):
+    return load(2, rd, rs1, imm)
+
+
+def lbu(rd, rs1, imm):
+    return load(4, rd, rs1, imm)
+
+
+def sw(rs2, rs1, imm):
+    return s_type(2, rs1, rs2, imm)
+
+
+def sb(rs2, rs1, imm):
+    return s_type(0, rs1, rs2, imm)
+
+
+def bne(rs1, rs2, offset):
+    return b_type(1, rs1, rs2, offset)
+
+
+def lr_w(rd, rs1):
+    return amo(0x02, rd, rs1, 0)
+
+
+def sc_w(rd, rs1, rs2):
+    return amo(0x03, rd, rs1, rs2)
+
+
+def csrr(rd, csr):
+    return i_type(0x73, rd, 2, 0, csr)
+
+
+def csrw(csr, rs1):
+    return i_type(0x73, 0, 1, rs1, csr)
+
+
+def words(program):
+    return struct.pack("<%dI" % len(program), *program)
+
+
+def make_cpu(program, memory_size=64 * 1024):
+    """Pipeline CPU with SATP translation, the program at address 0 and the PC on it."""
+    cpu = CPU(memory_size, MemoryBacking.HEAP, ExecutionMode.PIPELINE)
+    cpu.set_translation_mode(TranslationMode.SATP)
+    cpu.write_block(0, words(program))
+    return cpu
@@ -0,0 +1,97 @@
+import struct
+import unittest
+
+from virtuv_bindings import BatchConfig, BatchJob, BatchRunner, ExecutionMode, MemoryCheck, StopReason
+from rv32_asm import ECALL, HALT, add, addi, b_type, bne, i_type, sw, words
+
+MODES = [ExecutionMode.PIPELINE, ExecutionMode.THREADED, ExecutionMode.JIT, ExecutionMode.FUNCTIONAL]
+
+
+def sum_job(k, memory_size=64 * 1024):
+    # Sums 1..k, stores the sum at 0x400 and exits with it
+    job = BatchJob()
+    job.image = words([
+        addi(5, 0, 0),
+        addi(6, 0, k),
+        add(5, 5, 6),
+        addi(6, 6, -1),
+        bne(6, 0, -8),
+        sw(5, 0, 0x400),
+        addi(10, 5, 0),
+        addi(17, 0, 93),
+        ECALL,
+    ])
+    job.memory_size = memory_size
+    job.expected_exit_code = k * (k + 1) // 2
+    job.expected_registers = [(5, k * (k + 1) // 2)]
+    job.expected_memory = [MemoryCheck(0x400, struct.pack("<I", k * (k + 1) // 2))]
+    return job
+
+
+def make_runner(threads, mode=ExecutionMode.THREADED):
+    config = BatchConfig()
+    config.threads = threads
+    config.mode = mode
+    return BatchRunner(config)
+
+
+class TestBatchRunner(unittest.TestCase):
+    def test_jobs_pass(self):
+        # Long jobs first, so the workers given the short ones steal them
+        jobs = [sum_job(2000 if i < 20 else 10, 1024 * 1024 if i % 3 else 64 * 1024) for i in range(120)]
+        for mode in MODES:
+            with self.subTest(mode=mode):
+                runner = make_runner(4, mode)
+                results = runner.run(jobs)
+                self.assertEqual(len(results), len(jobs))
+                for result in results:
+                    self.assertTrue(result.passed, result.failure)
+                    self.assertEqual(result.run.reason, StopReason.EXIT)
+                stats = runner.get_stats()
+                self.assertEqual(stats.jobs, 120)
+                self.assertEqual(stats.passed, 120)
+                self.assertEqual(stats.failed, 0)
+                self.assertEqual(stats.threads, 4)
+                self.assertEqual(stats.instructions, sum(result.run.instructions for result in results))
+
+    def test_reused_cpu_starts_clean(self):
+        # The second job reads what the first wrote and the register the first set
+        first = BatchJob()
+        first.image = words([addi(7, 0, 99), sw(7, 0, 0x400), HALT])
+        second = BatchJob()
+        second.image = words([i_type(0x03, 8, 2, 0, 0x400), HALT])
+        second.expected_registers = [(7, 0), (8, 0)]
+        results = make_runner(1).run([first, second])
+        self.assertTrue(results[1].passed, results[1].failure)
+
+    def test_failures(self):
+        trap = BatchJob()
+        trap.image = words([0xFFFFFFFF])
+        too_big = BatchJob()
+        too_big.memory_size = 4096
+        too_big.image = bytes(8192)
+        wrong = sum_job(10)
+        wrong.expected_exit_code = 54
+        budget = BatchJob()
+        budget.image = words([b_type(0, 0, 0, 4), b_type(0, 0, 0, -4)])
+        budget.max_instructions = 10
+        budget.expected_reason = StopReason.BUDGET
+
+        results = make_runner(2).run([trap, too_big, wrong, budget, sum_job(5)])
+        self.assertFalse(results[0].passed)
+        self.assertIn("illegal instruction", results[0].failure)
+        self.assertFalse(results[1].passed)
+        self.assertNotEqual(results[1].failure, "")
+        self.assertFalse(results[2].passed)
+        self.assertIn("exit code 55", results[2].failure)
+        self.assertTrue(results[3].passed, results[3].failure)
+        self.assertEqual(results[3].run.instructions, 10)
+        # A job after an error still runs on a good CPU
+        self.assertTrue(results[4].passed, results[4].failure)
+
+    def test_empty_batch(self):
+        self.assertEqual(make_runner(0).run([]), [])
+
+
+if __name__ == "__main__":
+    unittest.main()
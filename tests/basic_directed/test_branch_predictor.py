@@ -0,0 +1,125 @@
+import unittest
+
+from virtuv_bindings import BranchPredictorConfig, BranchPredictorKind
+from rv32_asm import HALT, addi, bne, jal, jalr, make_cpu, words
+
+FUNCTION = 0x40
+
+
+# 100 outer iterations of an inner loop running 4 times, inner branch at 0x10, outer at 0x18
+LOOPS = [
+    addi(10, 0, 100),
+    addi(5, 0, 4),
+    addi(12, 12, 1),        # 8
+    addi(5, 5, -1),
+    bne(5, 0, -8),
+    addi(10, 10, -1),
+    bne(10, 0, -20),
+    HALT,
+]
+
+# 100 iterations calling FUNCTION from 0x4 and 0x8, its return at 0x44 alternates between them
+CALLS = [
+    addi(10, 0, 100),
+    jal(1, FUNCTION - 4),
+    jal(1, FUNCTION - 8),
+    addi(10, 10, -1),
+    bne(10, 0, -12),
+    HALT,
+]
+
+
+def predicted_cpu(program, kind=BranchPredictorKind.STATIC, ras_depth=8):
+    cpu = make_cpu(program)
+    cpu.write_block(FUNCTION, words([addi(12, 12, 1), jalr(0, 1, 0)]))
+    config = BranchPredictorConfig()
+    config.kind = kind
+    config.ras_depth = ras_depth
+    cpu.set_branch_predictor_config(config)
+    cpu.set_timing_enabled(True)
+    return cpu
+
+
+class TestBranchPredictor(unittest.TestCase):
+    def test_static_predicts_not_taken(self):
+        cpu = predicted_cpu(LOOPS)
+        self.assertEqual(cpu.get_branch_predictor_config().kind, BranchPredictorKind.STATIC)
+        cpu.run(100000)
+        stats = cpu.get_branch_predictor_stats()
+        self.assertEqual(stats.conditional, 500)
+        self.assertEqual(stats.conditional_mispredicts, 399)
+        # Every taken branch costs the branch penalty of 2
+        self.assertEqual(cpu.get_timing_stats().control_stalls, 2 * 399)
+        self.assertEqual(cpu.get_branch_predictor_storage_bits(), 0)
+
+    def test_site_stats(self):
+        cpu = predicted_cpu(LOOPS)
+        cpu.run(100000)
+        sites = cpu.get_branch_site_stats()
+        self.assertEqual([site.pc for site in sites], [0x10, 0x18])
+        self.assertEqual((sites[0].executions, sites[0].taken, sites[0].mispredicts), (400, 300, 300))
+        self.assertEqual((sites[1].executions, sites[1].taken, sites[1].mispredicts), (100, 99, 99))
+        cpu.reset_branch_predictor_stats()
+        self.assertEqual(cpu.get_branch_site_stats(), [])
+        self.assertEqual(cpu.get_branch_predictor_stats().predictions, 0)
+
+    def test_history_beats_bimodal(self):
+        # Bimodal misses every loop exit, the history based predictors learn them
+        mispredicts = {}
+        for kind in (BranchPredictorKind.BIMODAL, BranchPredictorKind.GSHARE, BranchPredictorKind.TAGE):
+            cpu = predicted_cpu(LOOPS, kind)
+            cpu.run(100000)
+            mispredicts[kind] = cpu.get_branch_predictor_stats().conditional_mispredicts
+        self.assertEqual(mispredicts[BranchPredictorKind.BIMODAL], 103)
+        self.assertEqual(mispredicts[BranchPredictorKind.GSHARE], 15)
+        self.assertEqual(mispredicts[BranchPredictorKind.TAGE], 6)
+
+    def test_return_address_stack(self):
+        cpu = predicted_cpu(CALLS, BranchPredictorKind.BIMODAL)
+        cpu.run(100000)
+        stats = cpu.get_branch_predictor_stats()
+        self.assertEqual(stats.returns, 200)
+        self.assertEqual(stats.return_mispredicts, 0)
+        # Each call misses the target buffer once
+        self.assertEqual(stats.jumps, 200)
+        self.assertEqual(stats.jump_mispredicts, 2)
+        self.assertEqual(cpu.get_timing_stats().control_stalls, 4)
+
+        # The target buffer alone always has the other call site
+        cpu = predicted_cpu(CALLS, BranchPredictorKind.BIMODAL, ras_depth=0)
+        cpu.run(100000)
+        self.assertEqual(cpu.get_branch_predictor_stats().return_mispredicts, 200)
+        self.assertEqual(cpu.get_branch_site_stats()[0].pc, FUNCTION + 4)
+        self.assertEqual(cpu.get_timing_stats().control_stalls, 404)
+
+    def test_storage_bits(self):
+        config = BranchPredictorConfig()
+        config.kind = BranchPredictorKind.BIMODAL
+        config.table_bits = 10
+        config.btb_bits = 4
+        config.ras_depth = 2
+        cpu = predicted_cpu(LOOPS)
+        cpu.set_branch_predictor_config(config)
+        # 1K 2-bit counters, 16 target entries of 26 tag, 30 target and 1 valid bits, 2 return addresses
+        self.assertEqual(cpu.get_branch_predictor_storage_bits(), 2048 + 16 * 57 + 2 * 30)
+
+    def test_needs_timing_model(self):
+        cpu = predicted_cpu(LOOPS, BranchPredictorKind.GSHARE)
+        cpu.set_timing_enabled(False)
+        cpu.run(100000)
+        self.assertEqual(cpu.get_branch_predictor_stats().predictions, 0)
+
+    def test_invalid_config(self):
+        cpu = predicted_cpu(LOOPS)
+        for field, value in (("table_bits", 0), ("table_bits", 25), ("history_bits", 65), ("tage_tables", 9),
+                             ("tage_tag_bits", 3), ("btb_bits", 21), ("ras_depth", 1025)):
+            with self.subTest(field=field, value=value):
+                config = BranchPredictorConfig()
+                setattr(config, field, value)
+                with self.assertRaises(ValueError):
+                    cpu.set_branch_predictor_config(config)
+        self.assertEqual(cpu.get_branch_predictor_config().table_bits, 12)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,111 @@
+import unittest
+
+from virtuv_bindings import (
+    PhysicalMemory,
+    PageTable,
+    MMU,
+    Bus,
+    Device,
+    Uart,
+    Timer,
+    RegionKind,
+    PrivilegeMode,
+    TranslationMode,
+    AccessViolationException,
+)
+
+UART_BASE = 0x10000000
+TIMER_BASE = 0x02000000
+ROM_BASE = 0x20000000
+
+
+class RecordingDevice(Device):
+    """Device implemented in Python, remembers every write."""
+
+    def __init__(self):
+        super().__init__()
+        self.writes = []
+
+    def read8(self, offset):
+        return offset & 0xFF
+
+    def read16(self, offset):
+        return 0xBEEF
+
+    def read32(self, offset):
+        return 0xC0DE0000 | offset
+
+    def write8(self, offset, value):
+        self.writes.append((offset, value, 1))
+
+    def write16(self, offset, value):
+        self.writes.append((offset, value, 2))
+
+    def write32(self, offset, value):
+        self.writes.append((offset, value, 4))
+
+    def get_name(self):
+        return "recorder"
+
+
+class TestBus(unittest.TestCase):
+    def setUp(self):
+        self.physical_memory = PhysicalMemory(1024 * 1024)
+        self.page_table = PageTable()
+        self.mmu = MMU(self.physical_memory, self.page_table, PrivilegeMode.MACHINE)
+        # Machine mode with satp = 0: virtual addresses are physical addresses
+        self.mmu.set_translation_mode(TranslationMode.SATP)
+
+        self.bus = Bus(self.physical_memory)
+        self.uart = Uart()
+        self.timer = Timer()
+        self.bus.add_device(UART_BASE, Uart.SIZE, self.uart)
+        self.bus.add_device(TIMER_BASE, Timer.SIZE, self.timer)
+        self.bus.add_rom(ROM_BASE, bytes(range(16)), "bootrom")
+        self.mmu.set_bus(self.bus)
+
+    def test_uart(self):
+        for char in b"hello":
+            self.mmu.write(UART_BASE, char)
+        self.assertEqual(self.uart.get_output(), "hello")
+        self.assertEqual(self.mmu.read(UART_BASE + 5) & 0x01, 0)  # no data ready
+        self.uart.push_input("k")
+        self.assertEqual(self.mmu.read(UART_BASE + 5) & 0x01, 1)
+        self.assertEqual(self.mmu.read(UART_BASE), ord("k"))
+
+    def test_timer(self):
+        self.mmu.write_doubleword(TIMER_BASE + Timer.MTIMECMP, 100)
+        self.assertFalse(self.timer.timer_interrupt_pending())
+        self.bus.tick(100)
+        self.assertEqual(self.mmu.read_doubleword(TIMER_BASE + Timer.MTIME), 100)
+        self.assertTrue(self.timer.timer_interrupt_pending())
+
+    def test_rom(self):
+        self.assertEqual(self.mmu.read_word(ROM_BASE + 4), 0x07060504)
+        self.assertEqual(self.bus.get_kind(ROM_BASE), RegionKind.ROM)
+        with self.assertRaises(AccessViolationException):
+            self.mmu.write(ROM_BASE, 0xFF)
+
+    def test_python_device(self):
+        device = RecordingDevice()
+        self.bus.add_device(0x30000000, 0x1000, device)
+        self.mmu.write_halfword(0x30000010, 0x1234)
+        self.mmu.write_word(0x30000020, 0xAABBCCDD)
+        self.assertEqual(device.writes, [(0x10, 0x1234, 2), (0x20, 0xAABBCCDD, 4)])
+        self.assertEqual(self.mmu.read_word(0x30000008), 0xC0DE0008)
+        self.assertEqual(self.mmu.read(0x30000042), 0x42)
+
+    def test_device_accesses_are_not_cached(self):
+        self.mmu.reset_tlb_stats()
+        self.mmu.read(UART_BASE + 5)
+        self.mmu.read(UART_BASE + 5)
+        self.assertEqual(self.mmu.get_tlb_stats().hits, 0)
+        self.assertEqual(self.bus.get_kind(0x1000), RegionKind.RAM)
+
+    def test_overlapping_regions(self):
+        with self.assertRaises(ValueError):
+            self.bus.add_device(UART_BASE + 0x80, 0x10, Uart())
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,152 @@
+import unittest
+
+from virtuv_bindings import (CacheHierarchyConfig, CPU, ExecutionMode, MemoryBacking, ReplacementPolicy,
+                             StopReason, WritePolicy)
+from rv32_asm import HALT, add, addi, bne, lui, lw, make_cpu, sw
+
+DATA = 0x10000
+
+
+# Sums the 8 KB at DATA twice, the second pass fits in the 16 KB L1D
+SUM_TWICE = [
+    lui(10, 0x10),
+    lui(11, 0x12),
+    lw(5, 10, 0),           # 8
+    add(12, 12, 5),
+    addi(10, 10, 4),
+    bne(10, 11, -12),
+    lui(10, 0x10),
+    addi(7, 7, 1),
+    addi(28, 0, 2),
+    bne(7, 28, -28),
+    HALT,
+]
+
+# Stores over 32 KB, twice the L1D
+STORE_32K = [
+    lui(10, 0x10),
+    lui(11, 0x18),
+    sw(10, 10, 0),          # 8
+    addi(10, 10, 4),
+    bne(10, 11, -8),
+    HALT,
+]
+
+
+def cached_cpu(program, caches=True, config=None):
+    cpu = make_cpu(program, 256 * 1024)
+    cpu.set_timing_enabled(True)
+    if config is not None:
+        cpu.set_cache_config(config)
+    cpu.set_cache_enabled(caches)
+    return cpu
+
+
+class TestCacheModel(unittest.TestCase):
+    def test_single_load(self):
+        # The fetch and the load both go to memory: L2 latency 10 plus memory latency 100 each
+        program = [lui(10, 0x10), lw(11, 10, 0), HALT]
+        cold = cached_cpu(program)
+        cold.run(100)
+        ideal = cached_cpu(program, caches=False)
+        ideal.run(100)
+        self.assertEqual(ideal.get_timing_stats().cycles, 6)
+        self.assertEqual(cold.get_timing_stats().cycles, 6 + 2 * 110)
+        self.assertEqual(cold.get_timing_stats().fetch_stalls, 110)
+
+    def test_sequential_sum(self):
+        cpu = cached_cpu(SUM_TWICE)
+        self.assertTrue(cpu.is_cache_enabled())
+        result = cpu.run(100000)
+        self.assertEqual(result.reason, StopReason.BUDGET)
+        stats = cpu.get_cache_stats()
+        # One miss per 64-byte line on the first pass, the second pass hits every time
+        self.assertEqual(stats.l1d.accesses, 4096)
+        self.assertEqual(stats.l1d.misses, 128)
+        self.assertEqual(stats.l1d.hits, 3968)
+        self.assertAlmostEqual(stats.l1d.miss_rate, 128 / 4096)
+        # The whole loop sits in one instruction line
+        self.assertEqual(stats.l1i.misses, 1)
+        self.assertEqual(stats.l2.accesses, 129)
+        self.assertEqual(stats.memory_reads, 129)
+
+        timing = cpu.get_timing_stats()
+        self.assertEqual(timing.fetch_stalls, 110)
+        self.assertEqual(timing.memory_stalls, 128 * 110)
+
+        ideal = cached_cpu(SUM_TWICE, caches=False)
+        ideal.run(100000)
+        self.assertEqual(ideal.get_timing_stats().instructions, timing.instructions)
+        self.assertGreater(timing.cycles, ideal.get_timing_stats().cycles)
+
+    def test_disabled_by_default(self):
+        cpu = CPU(256 * 1024, MemoryBacking.HEAP, ExecutionMode.PIPELINE)
+        self.assertFalse(cpu.is_cache_enabled())
+        cpu = cached_cpu(SUM_TWICE, caches=False)
+        cpu.run(100000)
+        self.assertEqual(cpu.get_cache_stats().l1d.accesses, 0)
+        self.assertEqual(cpu.get_timing_stats().memory_stalls, 0)
+        self.assertEqual(cpu.get_timing_stats().fetch_stalls, 0)
+
+    def test_needs_timing_model(self):
+        cpu = cached_cpu(SUM_TWICE)
+        cpu.set_timing_enabled(False)
+        cpu.run(100000)
+        self.assertEqual(cpu.get_cache_stats().l1d.accesses, 0)
+
+    def test_reset_stats(self):
+        cpu = cached_cpu(SUM_TWICE)
+        cpu.run(1000)
+        cpu.reset_cache_stats()
+        stats = cpu.get_cache_stats()
+        self.assertEqual(stats.l1d.accesses, 0)
+        self.assertEqual(stats.l2.accesses, 0)
+        self.assertEqual(stats.memory_reads, 0)
+
+    def test_write_policies(self):
+        back = CacheHierarchyConfig()
+        back.l1d.write_policy = WritePolicy.WRITE_BACK
+        cpu = cached_cpu(STORE_32K, config=back)
+        cpu.run(100000)
+        stats = cpu.get_cache_stats()
+        self.assertEqual(stats.l1d.evictions, 256)
+        self.assertEqual(stats.l1d.writebacks, 256)
+
+        through = CacheHierarchyConfig()
+        through.l1d.write_policy = WritePolicy.WRITE_THROUGH
+        cpu = cached_cpu(STORE_32K, config=through)
+        cpu.run(100000)
+        stats = cpu.get_cache_stats()
+        self.assertEqual(stats.l1d.writebacks, 0)
+        # Every store goes on to the L2
+        self.assertEqual(stats.l2.accesses, 8192 + 1)
+
+    def test_replacement_policies(self):
+        # A, B, C, D, A, E, B in a single 4-way set: LRU evicts B for E, tree PLRU evicts C
+        program = [lui(10, 0x10)] + [lw(5, 10, offset) for offset in (0, 256, 512, 768, 0, 1024, 256)] + [HALT]
+        for policy, misses in ((ReplacementPolicy.LRU, 6), (ReplacementPolicy.PLRU, 5)):
+            with self.subTest(policy=policy):
+                config = CacheHierarchyConfig()
+                config.l1d.size = 256
+                config.l1d.ways = 4
+                config.l1d.line_size = 64
+                config.l1d.replacement = policy
+                cpu = cached_cpu(program, config=config)
+                cpu.run(100)
+                self.assertEqual(cpu.get_cache_stats().l1d.misses, misses)
+                self.assertEqual(cpu.get_cache_config().l1d.replacement, policy)
+
+    def test_invalid_config(self):
+        cpu = cached_cpu(SUM_TWICE)
+        for field, value in (("size", 1000), ("ways", 3), ("line_size", 2), ("ways", 64)):
+            with self.subTest(field=field, value=value):
+                config = CacheHierarchyConfig()
+                setattr(config.l1d, field, value)
+                with self.assertRaises(ValueError):
+                    cpu.set_cache_config(config)
+        # A rejected config leaves the old one in place
+        self.assertEqual(cpu.get_cache_config().l1d.size, 16 * 1024)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,106 @@
+import random
+import unittest
+
+from virtuv_bindings import CompactInstruction, Operation
+
+SEED = 0x5EED1234
+RANDOM_WORDS = 200000
+
+
+def sign_extend(value, bits):
+    value &= (1 << bits) - 1
+    return value - (1 << bits) if value >> (bits - 1) else value
+
+
+# Reference decoder written from the RISC-V specification, one branch per opcode, independent of
+# the instruction table the decoder is generated from. Returns the operation name and the immediate
+def reference_decode(raw):
+    opcode = raw & 0x7F
+    funct3 = (raw >> 12) & 0x7
+    funct7 = raw >> 25
+    imm_i = sign_extend(raw >> 20, 12)
+    imm_s = sign_extend((funct7 << 5) | ((raw >> 7) & 0x1F), 12)
+    imm_b = sign_extend((((raw >> 31) & 1) << 12) | (((raw >> 7) & 1) << 11) | (((raw >> 25) & 0x3F) << 5)
+                        | (((raw >> 8) & 0xF) << 1), 13)
+    imm_u = sign_extend(raw & 0xFFFFF000, 32)
+    imm_j = sign_extend((((raw >> 31) & 1) << 20) | (((raw >> 12) & 0xFF) << 12) | (((raw >> 20) & 1) << 11)
+                        | (((raw >> 21) & 0x3FF) << 1), 21)
+
+    if opcode == 0x37:
+        return "LUI", imm_u
+    if opcode == 0x17:
+        return "AUIPC", imm_u
+    if opcode == 0x6F:
+        return "JAL", imm_j
+    if opcode == 0x67 and funct3 == 0:
+        return "JALR", imm_i
+    if opcode == 0x63 and funct3 not in (2, 3):
+        return ["BEQ", "BNE", None, None, "BLT", "BGE", "BLTU", "BGEU"][funct3], imm_b
+    if opcode == 0x03 and funct3 in (0, 1, 2, 4, 5):
+        return ["LB", "LH", "LW", None, "LBU", "LHU"][funct3], imm_i
+    if opcode == 0x23 and funct3 <= 2:
+        return ["SB", "SH", "SW"][funct3], imm_s
+    if opcode == 0x13:
+        if funct3 == 1 and funct7 == 0x00:
+            return "SLLI", (raw >> 20) & 0x1F
+        if funct3 == 5 and funct7 in (0x00, 0x20):
+            return ("SRLI" if funct7 == 0 else "SRAI"), (raw >> 20) & 0x1F
+        if funct3 not in (1, 5):
+            return ["ADDI", None, "SLTI", "SLTIU", "XORI", None, "ORI", "ANDI"][funct3], imm_i
+    if opcode == 0x33:
+        if funct7 == 0x00:
+            return ["ADD", "SLL", "SLT", "SLTU", "XOR", "SRL", "OR", "AND"][funct3], 0
+        if funct7 == 0x20 and funct3 in (0, 5):
+            return ("SUB" if funct3 == 0 else "SRA"), 0
+        if funct7 == 0x01:
+            return ["MUL", "MULH", "MULHSU", "MULHU", "DIV", "DIVU", "REM", "REMU"][funct3], 0
+    if opcode == 0x0F and funct3 <= 1:
+        return ("FENCE" if funct3 == 0 else "FENCE_I"), 0
+    if opcode == 0x2F and funct3 == 2:
+        # aq and rl, funct7[1:0], do not change the operation
+        name = {0x02: "LR_W", 0x03: "SC_W", 0x01: "AMOSWAP_W", 0x00: "AMOADD_W", 0x04: "AMOXOR_W",
+                0x0C: "AMOAND_W", 0x08: "AMOOR_W", 0x10: "AMOMIN_W", 0x14: "AMOMAX_W", 0x18: "AMOMINU_W",
+                0x1C: "AMOMAXU_W"}.get(funct7 >> 2)
+        if name is not None:
+            return name, 0
+    if opcode == 0x73:
+        return "SYSTEM", raw >> 20
+    return "ILLEGAL", 0
+
+
+class TestCompactDecoder(unittest.TestCase):
+    def check(self, raw):
+        name, imm = reference_decode(raw)
+        decoded = CompactInstruction(raw)
+        expected = (getattr(Operation, name), (raw >> 7) & 0x1F, (raw >> 15) & 0x1F, (raw >> 20) & 0x1F, imm)
+        actual = (decoded.op, decoded.rd, decoded.rs1, decoded.rs2, decoded.imm)
+        if actual != expected:
+            self.fail("0x%08X decodes to %s, expected %s" % (raw, actual, expected))
+
+    def test_every_opcode_funct3_funct7(self):
+        # The generated table is keyed by these fields, every key is checked once with the other
+        # fields all clear and once with them all set
+        for opcode in range(128):
+            for funct3 in range(8):
+                for funct7 in range(128):
+                    fields = (funct7 << 25) | (funct3 << 12) | opcode
+                    self.check(fields)
+                    self.check(fields | 0x01FF8F80)
+
+    def test_random_words(self):
+        generator = random.Random(SEED)
+        for _ in range(RANDOM_WORDS):
+            self.check(generator.getrandbits(32))
+
+    def test_known_encodings(self):
+        self.assertEqual(reference_decode(0xFFF00013), ("ADDI", -1))       # addi x0, x0, -1
+        self.assertEqual(reference_decode(0xFE002E23), ("SW", -4))         # sw x0, -4(x0)
+        self.assertEqual(reference_decode(0xFE000EE3), ("BEQ", -4))        # beq x0, x0, -4
+        self.assertEqual(reference_decode(0xFFDFF06F), ("JAL", -4))        # jal x0, -4
+        self.assertEqual(reference_decode(0x40315093), ("SRAI", 3))        # srai x1, x2, 3
+        self.assertEqual(reference_decode(0x0E05A2AF), ("AMOSWAP_W", 0))   # amoswap.w.aqrl t0, zero, (a1)
+        self.assertEqual(reference_decode(0x30200073), ("SYSTEM", 0x302))  # mret
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -3,7 +3,9 @@ import tempfile
 import unittest
 import sys
 
-from virtuv_bindings import CPU
+from virtuv_bindings import CPU, ExecutionMode, MemoryBacking, MisalignedAccess, Timer, TranslationMode
+from rv32_asm import HALT, addi, bne, words
+from test_elf_loader import STT_FUNC, TEXT_ADDRESS, build_elf
 
 class TestCPU(unittest.TestCase):
     def setUp(self):
@@ -18,6 +20,15 @@ class TestCPU(unittest.TestCase):
                 pass
         self.temp_files.clear()
 
+    def _create_temp_file(self, contents):
+        """Helper to create a temporary file holding the given bytes."""
+        temp_file = tempfile.NamedTemporaryFile(delete=False)
+        temp_file.write(contents)
+        temp_file.flush()
+        temp_file.close()
+        self.temp_files.append(temp_file.name)
+        return temp_file.name
+
     def _create_temp_program(self, program):
         """Helper to create a temporary file containing the given program instructions."""
         temp_file = tempfile.NamedTemporaryFile(delete=False)
@@ -99,6 +110,91 @@ class TestCPU(unittest.TestCase):
         
         self.assertEqual(sorted_array, unsorted_array.sort(), "Bubble sort did not produce the expected sorted array")
 
+    def test_snapshot_restore_and_fork(self):
+        program = [
+            0x02A00093,  # addi x1, x0, 42
+            0x3A08113,   # addi x2, x1, 58
+            0x0000006F   # jal x0, 0 -> jump to self (end of program)
+        ]
+        other_program = [0x11111111, 0x22222222]
+
+        for backing in (MemoryBacking.HEAP, MemoryBacking.RESERVED):
+            cpu = CPU(1024 * 1024, backing)
+            self.assertEqual(cpu.load_program(self._create_temp_program(program)), 0)
+            cpu.run()
+            base = cpu.snapshot()
+
+            # Overwrite memory after the snapshot
+            self.assertEqual(cpu.load_program(self._create_temp_program(other_program)), 0)
+            self.assertEqual(cpu.read_word_from_memory(0), 0x11111111)
+
+            # A CPU built from the snapshot sees the old registers and memory
+            branch = CPU(base)
+            self.assertEqual(branch.get_register(2), 100)
+            self.assertEqual(branch.read_word_from_memory(0), 0x02A00093)
+
+            # Restoring rewinds the original CPU
+            cpu.restore(base)
+            self.assertEqual(cpu.read_word_from_memory(0), 0x02A00093)
+
+            # Pages mapped from the snapshot by the restore are captured again
+            self.assertEqual(CPU(cpu.snapshot()).read_word_from_memory(4), 0x3A08113)
+
+            # Writes in a fork are not visible to its parent
+            child = cpu.fork()
+            self.assertEqual(child.load_program(self._create_temp_program(other_program)), 0)
+            self.assertEqual(cpu.read_word_from_memory(0), 0x02A00093)
+            self.assertEqual(child.get_register(1), 42)
+
+    def test_fork_keeps_mode_and_settings(self):
+        cpu = CPU(1024 * 1024, MemoryBacking.HEAP, ExecutionMode.JIT)
+        elf_file = self._create_temp_file(build_elf(bytes(4), b"", 0, [("_start", TEXT_ADDRESS, 4, STT_FUNC)]))
+        self.assertEqual(cpu.load_elf(elf_file), 0)
+        cpu.set_translation_mode(TranslationMode.SATP)
+        cpu.set_misaligned_access(MisalignedAccess.TRAP)
+        cpu.set_fusion_enabled(False)
+        config = cpu.get_jit_config()
+        config.threshold = 3
+        cpu.set_jit_config(config)
+        cpu.attach_rom(0x8000, bytes(range(1, 9)), "boot")
+        cpu.write_block(0, words([addi(5, 0, 20), addi(6, 6, 1), addi(5, 5, -1), bne(5, 0, -8), HALT]))
+        cpu.get_register_bank().set_pc(0)
+
+        child = cpu.fork()
+        self.assertEqual(child.lookup_symbol("_start"), TEXT_ADDRESS)
+        self.assertEqual(child.get_execution_mode(), ExecutionMode.JIT)
+        self.assertEqual(child.get_misaligned_access(), MisalignedAccess.TRAP)
+        self.assertFalse(child.is_fusion_enabled())
+        self.assertEqual(child.get_jit_config().threshold, 3)
+        self.assertEqual(child.read_word_from_memory(0x8004), 0x08070605)
+        child.run()
+        self.assertEqual(child.get_register(6), 20)
+        self.assertEqual(child.get_threaded_stats().blocks_compiled, 1)
+
+        # Devices hold state that cannot be copied
+        cpu.attach_device(0x02000000, Timer.SIZE, Timer())
+        with self.assertRaises(ValueError):
+            cpu.fork()
+
+    def test_block_access_and_buffers(self):
+        # Result buffers are checked with one call instead of one call per word
+        cpu = CPU(1024 * 1024)
+        cpu.fill(0x100, 0x5A, 0x200)
+        cpu.write_block(0x100, bytearray(b"\x01\x02\x03\x04"))
+        block = cpu.read_block(0x100, 0x200)
+        self.assertEqual(block[:4], b"\x01\x02\x03\x04")
+        self.assertEqual(block[4:], b"\x5A" * 0x1FC)
+
+        # Zero-copy views of the memory and of the registers
+        memory = memoryview(cpu.get_physical_memory())
+        self.assertEqual(memory[0x100:0x300].tobytes(), block)
+        cpu.set_register(5, 0xCAFEBABE)
+        registers = memoryview(cpu.get_register_bank())
+        self.assertEqual(registers.format, "I")
+        self.assertEqual(len(registers), 32)
+        self.assertEqual(registers[5], 0xCAFEBABE)
+        self.assertEqual(registers[0], 0)
+
     def test_invalid_instruction(self):
         """
         Test that the CPU throws an exception when encountering a non recognized instruction.
@@ -0,0 +1,99 @@
+import os
+import struct
+import tempfile
+import unittest
+
+from virtuv_bindings import CPU, MemoryBacking
+
+TEXT_ADDRESS = 0x10000
+DATA_ADDRESS = 0x20000
+
+PF_X, PF_W, PF_R = 1, 2, 4
+STT_OBJECT, STT_FUNC = 1, 2
+
+
+def build_elf(text, data, bss_size, symbols):
+    """Builds a static RV32 executable: a page aligned text segment at file offset 0x1000,
+    a data segment followed by .bss at offset 0x3000, and a symbol table."""
+    text_offset, data_offset = 0x1000, 0x3000
+    strtab = b"\0"
+    symtab = bytes(16)  # null symbol
+    for name, value, size, kind in symbols:
+        symtab += struct.pack("<IIIBBH", len(strtab), value, size, 0x10 | kind, 0, 1)  # global
+        strtab += name.encode() + b"\0"
+    symtab_offset = data_offset + len(data)
+    strtab_offset = symtab_offset + len(symtab)
+    shoff = (strtab_offset + len(strtab) + 3) & ~3
+
+    header = b"\x7fELF" + bytes([1, 1, 1]) + bytes(9)
+    header += struct.pack("<HHIIIIIHHHHHH", 2, 243, 1, TEXT_ADDRESS, 52, shoff, 0, 52, 32, 2, 40, 3, 0)
+    header += struct.pack("<IIIIIIII", 1, text_offset, TEXT_ADDRESS, TEXT_ADDRESS, len(text), len(text), PF_R | PF_X, 0x1000)
+    header += struct.pack("<IIIIIIII", 1, data_offset, DATA_ADDRESS, DATA_ADDRESS, len(data), len(data) + bss_size,
+                          PF_R | PF_W, 0x1000)
+
+    image = bytearray(shoff + 3 * 40)
+    image[0:len(header)] = header
+    image[text_offset:text_offset + len(text)] = text
+    image[data_offset:data_offset + len(data)] = data
+    image[symtab_offset:symtab_offset + len(symtab)] = symtab
+    image[strtab_offset:strtab_offset + len(strtab)] = strtab
+    sections = bytes(40)
+    sections += struct.pack("<IIIIIIIIII", 0, 2, 0, 0, symtab_offset, len(symtab), 2, 1, 4, 16)  # .symtab
+    sections += struct.pack("<IIIIIIIIII", 0, 3, 0, 0, strtab_offset, len(strtab), 0, 0, 1, 0)   # .strtab
+    image[shoff:] = sections
+    return bytes(image)
+
+
+class TestElfLoader(unittest.TestCase):
+    def setUp(self):
+        program = [
+            0x02A00093,  # addi x1, x0, 42
+            0x00020137,  # lui x2, 0x20
+            0x00112223,  # sw x1, 4(x2)
+            0x0000006F,  # jal x0, 0 -> end of program
+        ]
+        # One whole page plus a tail, so both the mapped and the copied paths are used
+        text = b"".join(instr.to_bytes(4, "little") for instr in program).ljust(0x1000 + 8, b"\0")
+        data = struct.pack("<I", 0x11223344)
+        symbols = [("_start", TEXT_ADDRESS, 16, STT_FUNC), ("buffer", DATA_ADDRESS + 4, 0x100, STT_OBJECT)]
+
+        temp_file = tempfile.NamedTemporaryFile(delete=False)
+        temp_file.write(build_elf(text, data, 0x3000, symbols))
+        temp_file.close()
+        self.elf_file = temp_file.name
+
+    def tearDown(self):
+        os.remove(self.elf_file)
+
+    def check_program(self, cpu):
+        self.assertEqual(cpu.load_program(self.elf_file), 0)
+        self.assertEqual(cpu.get_pc(), TEXT_ADDRESS)
+        cpu.run()
+        self.assertEqual(cpu.get_register(1), 42)
+        self.assertEqual(cpu.read_word_from_memory(DATA_ADDRESS), 0x11223344)
+        self.assertEqual(cpu.read_word_from_memory(DATA_ADDRESS + 4), 42)
+        self.assertEqual(cpu.read_word_from_memory(DATA_ADDRESS + 0x2FFC), 0)  # .bss
+
+    def test_load_and_run(self):
+        self.check_program(CPU(1024 * 1024))
+
+    def test_load_and_run_reserved(self):
+        # The text page is mapped from the file instead of copied
+        self.check_program(CPU(1024 * 1024, MemoryBacking.RESERVED))
+
+    def test_symbols(self):
+        cpu = CPU(1024 * 1024)
+        self.assertEqual(cpu.load_elf(self.elf_file), 0)
+        self.assertEqual(cpu.lookup_symbol("_start"), TEXT_ADDRESS)
+        self.assertEqual(cpu.lookup_symbol("buffer"), DATA_ADDRESS + 4)
+        self.assertIsNone(cpu.lookup_symbol("missing"))
+        self.assertEqual(cpu.find_symbol(DATA_ADDRESS + 0x80), "buffer")
+        self.assertIsNone(cpu.find_symbol(DATA_ADDRESS))
+
+    def test_segment_outside_memory(self):
+        cpu = CPU(64 * 1024)
+        self.assertEqual(cpu.load_elf(self.elf_file), -1)
+
+
+if __name__ == "__main__":
+    unittest.main()
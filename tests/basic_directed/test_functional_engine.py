@@ -0,0 +1,103 @@
+import struct
+import unittest
+
+from virtuv_bindings import CPU, ExecutionMode, MemoryBacking, UnhandledTrapException
+from rv32_asm import ECALL, HALT, MRET, addi, b_type, csrr, csrw, i_type, jal, lw, sw, words
+
+DATA = 0x700
+
+
+# Bubble sort of the signed words at DATA, x11 holds their count
+BUBBLE_SORT = [
+    addi(10, 0, DATA),              # 0
+    addi(11, 11, -1),               # 4: outer loop
+    b_type(5, 0, 11, 48),           # bge x0, x11, done
+    addi(5, 10, 0),
+    addi(6, 11, 0),
+    lw(7, 5, 0),                    # 20: inner loop
+    lw(28, 5, 4),
+    b_type(5, 28, 7, 12),           # bge x28, x7, no swap
+    sw(28, 5, 0),
+    sw(7, 5, 4),
+    addi(5, 5, 4),                  # no swap
+    addi(6, 6, -1),
+    b_type(1, 6, 0, -28),           # bne x6, x0, inner loop
+    jal(0, -48),                    # outer loop
+    HALT,                           # 56: done
+]
+VALUES = [5, 3, 4, 1, 2, -7, 100, 0]
+
+
+class TestFunctionalEngine(unittest.TestCase):
+    def make_cpu(self, mode, program, handler=None):
+        cpu = CPU(1024 * 1024, MemoryBacking.HEAP, mode)
+        cpu.write_block(0, words(program))
+        cpu.write_block(DATA, struct.pack("<%di" % len(VALUES), *VALUES))
+        cpu.set_register(11, len(VALUES))
+        if handler is not None:
+            cpu.get_csrs().mtvec = 0x400
+            cpu.write_block(0x400, words(handler))
+        return cpu
+
+    def assert_same_state(self, program, handler=None):
+        pipeline = self.make_cpu(ExecutionMode.PIPELINE, program, handler)
+        functional = self.make_cpu(ExecutionMode.FUNCTIONAL, program, handler)
+        for cpu in (pipeline, functional):
+            cpu.run()
+        for reg in range(32):
+            self.assertEqual(pipeline.get_register(reg), functional.get_register(reg), "x%d" % reg)
+        self.assertEqual(pipeline.get_pc(), functional.get_pc())
+        self.assertEqual(pipeline.read_block(0, 0x1000), functional.read_block(0, 0x1000))
+        self.assertEqual(pipeline.get_trap_count(), functional.get_trap_count())
+        return functional
+
+    def test_mode_from_constructor(self):
+        self.assertEqual(CPU(4096, mode=ExecutionMode.FUNCTIONAL).get_execution_mode(), ExecutionMode.FUNCTIONAL)
+        self.assertEqual(CPU(4096).get_execution_mode(), ExecutionMode.PIPELINE)
+
+    def test_bubble_sort_matches_pipeline(self):
+        cpu = self.assert_same_state(BUBBLE_SORT)
+        data = cpu.read_block(DATA, 4 * len(VALUES))
+        self.assertEqual(list(struct.unpack("<%di" % len(VALUES), data)), sorted(VALUES))
+        stats = cpu.get_functional_stats()
+        # Only the final jump to self goes through the pipeline
+        self.assertGreater(stats.instructions, 100)
+        self.assertEqual(stats.fallbacks, 1)
+
+    def test_traps_go_through_the_pipeline(self):
+        # The handler skips the ECALL and the faulting load
+        handler = [csrr(28, 0x341), addi(28, 28, 4), csrw(0x341, 28), addi(9, 9, 1), MRET]
+        cpu = self.assert_same_state([
+            addi(5, 0, 1),
+            ECALL,
+            addi(5, 5, 1),
+            i_type(0x37, 6, 0, 0, 0) | (5 << 12),  # lui x6, 5, unmapped page
+            lw(7, 6, 0),
+            addi(5, 5, 1),
+            HALT,
+        ], handler)
+        self.assertEqual(cpu.get_register(5), 3)
+        self.assertEqual(cpu.get_register(9), 2)
+
+    def test_store_into_next_instruction(self):
+        cpu = self.assert_same_state([
+            lw(28, 0, 0x40),
+            sw(28, 0, 12),
+            addi(29, 0, 0),
+            addi(29, 0, 1),   # replaced by addi x29, x0, 7
+            HALT,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            addi(29, 0, 7),   # 0x40
+        ])
+        self.assertEqual(cpu.get_register(29), 7)
+
+    def test_unhandled_trap_leaves_same_pc(self):
+        cpu = self.make_cpu(ExecutionMode.FUNCTIONAL, [addi(5, 0, 1), 0xFFFFFFFF, HALT])
+        with self.assertRaises(UnhandledTrapException):
+            cpu.run()
+        self.assertEqual(cpu.get_pc(), 4)
+        self.assertEqual(cpu.get_register(5), 1)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,172 @@
+import struct
+import unittest
+
+from virtuv_bindings import StopReason, Timer, TrapCause
+from rv32_asm import HALT, NOP, add, addi, auipc, bne, jalr, lui, lw, make_cpu, slli, srli
+
+DATA = 0x3000
+SEED = 0xCAFEF00D
+
+
+# Ten iterations of every idiom, the function called with AUIPC+JALR is at 0x5C
+ITERATIONS = 10
+IDIOMS = [
+    addi(5, 0, ITERATIONS),
+    lui(10, 0x12345),       # 4
+    addi(10, 10, 0x678),
+    auipc(11, 0x3),         # 12: DATA + 12
+    lw(12, 11, -12),
+    slli(13, 10, 16),       # 20
+    srli(13, 13, 16),
+    auipc(1, 0),            # 28
+    jalr(1, 1, 0x40),
+    addi(5, 5, -1),         # 36
+    bne(5, 0, -36),
+    HALT,
+] + [NOP] * 11 + [
+    add(14, 14, 12),        # 0x5C
+    jalr(0, 1, 0),
+]
+
+
+def fusion_cpu(program, fusion=True):
+    cpu = make_cpu(program)
+    cpu.set_fusion_enabled(fusion)
+    cpu.write_block(DATA, struct.pack("<I", SEED))
+    return cpu
+
+
+def restart(cpu, pc=0):
+    cpu.get_register_bank().set_pc(pc)
+    cpu.reset_fusion_stats()
+
+
+class TestFusion(unittest.TestCase):
+    def test_idioms(self):
+        cpu = fusion_cpu(IDIOMS)
+        result = cpu.run(1000)
+        self.assertEqual(result.reason, StopReason.HALTED)
+        self.assertEqual(result.instructions, 1 + 12 * ITERATIONS)
+        self.assertEqual(cpu.get_register(10), 0x12345678)
+        self.assertEqual(cpu.get_register(11), DATA + 12)
+        self.assertEqual(cpu.get_register(12), SEED)
+        self.assertEqual(cpu.get_register(13), 0x5678)
+        self.assertEqual(cpu.get_register(14), (SEED * ITERATIONS) & 0xFFFFFFFF)
+        self.assertEqual(cpu.get_register(1), 36)
+        # The first iteration decodes the second instructions, the others fuse
+        stats = cpu.get_fusion_stats()
+        self.assertEqual(stats.lui_addi, ITERATIONS - 1)
+        self.assertEqual(stats.auipc_jalr, ITERATIONS - 1)
+        self.assertEqual(stats.auipc_lw, ITERATIONS - 1)
+        self.assertEqual(stats.slli_srli, ITERATIONS - 1)
+        self.assertEqual(stats.total, 4 * (ITERATIONS - 1))
+        # Every fused instruction still counts as a predecode hit
+        self.assertEqual(cpu.get_predecode_stats().misses, 14)
+
+    def test_same_state_without_fusion(self):
+        fused = fusion_cpu(IDIOMS)
+        unfused = fusion_cpu(IDIOMS, fusion=False)
+        self.assertTrue(fused.is_fusion_enabled())
+        self.assertFalse(unfused.is_fusion_enabled())
+        fused_result = fused.run(1000)
+        unfused_result = unfused.run(1000)
+        self.assertEqual(fused_result.instructions, unfused_result.instructions)
+        self.assertEqual([fused.get_register(reg) for reg in range(32)],
+                         [unfused.get_register(reg) for reg in range(32)])
+        self.assertEqual(unfused.get_fusion_stats().total, 0)
+
+    def test_same_timing_without_fusion(self):
+        cycles = []
+        for fusion in [True, False]:
+            cpu = fusion_cpu(IDIOMS, fusion)
+            cpu.set_timing_enabled(True)
+            cpu.run(1000)
+            cycles.append((cpu.get_timing_stats().cycles, cpu.get_timing_stats().instructions))
+        self.assertEqual(cycles[0], cycles[1])
+
+    def test_branch_into_second_instruction(self):
+        cpu = fusion_cpu([lui(10, 1), addi(10, 10, 1), HALT])
+        cpu.run(100)
+        self.assertEqual(cpu.get_register(10), 0x1001)
+        # Both are cached now, entering at the ADDI runs it on its own
+        cpu.set_register(10, 5)
+        restart(cpu, 4)
+        cpu.run(100)
+        self.assertEqual(cpu.get_register(10), 6)
+        self.assertEqual(cpu.get_fusion_stats().total, 0)
+        restart(cpu)
+        cpu.run(100)
+        self.assertEqual(cpu.get_register(10), 0x1001)
+        self.assertEqual(cpu.get_fusion_stats().lui_addi, 1)
+
+    def test_budget_and_breakpoint_between(self):
+        cpu = fusion_cpu([lui(10, 1), addi(10, 10, 1), HALT])
+        cpu.run(100)
+        restart(cpu)
+        result = cpu.run(1)
+        self.assertEqual(result.reason, StopReason.BUDGET)
+        self.assertEqual(result.pc, 4)
+        self.assertEqual(cpu.get_register(10), 0x1000)
+        restart(cpu)
+        result = cpu.run_until(4)
+        self.assertEqual(result.reason, StopReason.BREAKPOINT)
+        self.assertEqual(result.instructions, 1)
+        self.assertEqual(cpu.get_fusion_stats().total, 0)
+
+    def test_load_trap_in_pair(self):
+        # The load is past the end of memory: the AUIPC retires, the LW traps at its own PC
+        program = [auipc(11, 0x100), lw(12, 11, 0), HALT]
+        for warm in [False, True]:
+            with self.subTest(warm=warm):
+                cpu = fusion_cpu(program)
+                if warm:
+                    cpu.run(100)
+                    restart(cpu)
+                result = cpu.run(100)
+                self.assertEqual(result.reason, StopReason.TRAP)
+                self.assertEqual(result.pc, 4)
+                self.assertEqual(result.instructions, 1)
+                self.assertEqual(cpu.get_register(11), 0x100000)
+                self.assertEqual(cpu.get_last_trap().cause, TrapCause.LOAD_ACCESS_FAULT)
+
+        cpu = fusion_cpu(program + [NOP] * 5 + [HALT])
+        cpu.get_csrs().mtvec = 0x20
+        cpu.run(100)
+        restart(cpu)
+        result = cpu.run(100)
+        self.assertEqual(result.reason, StopReason.HALTED)
+        self.assertEqual(result.instructions, 2)
+        self.assertEqual(cpu.get_csrs().mepc, 4)
+        self.assertEqual(cpu.get_csrs().mcause, int(TrapCause.LOAD_ACCESS_FAULT))
+        self.assertEqual(cpu.get_fusion_stats().auipc_lw, 0)
+
+    def test_misaligned_call_target_traps_at_jalr(self):
+        cpu = fusion_cpu([auipc(1, 0), jalr(1, 1, 14), HALT])
+        cpu.run(100)
+        restart(cpu)
+        result = cpu.run(100)
+        self.assertEqual(result.reason, StopReason.TRAP)
+        self.assertEqual(result.pc, 4)
+        self.assertEqual(cpu.get_last_trap().cause, TrapCause.INSTRUCTION_ADDRESS_MISALIGNED)
+
+    def test_device_load_sees_the_auipc_tick(self):
+        # mtime is read five times, one iteration apart: the bus is ticked once per retired
+        # instruction, the load has to see the tick of its AUIPC whether the pair fuses or not
+        timer = 0x02000000
+        program = [NOP, NOP, auipc(5, 0x200C), lw(5, 5, -16), add(9, 9, 5),  # 8: timer + MTIME
+                   addi(12, 12, -1), bne(12, 0, -16), HALT]
+        totals = []
+        for fusion in [True, False]:
+            cpu = fusion_cpu(program, fusion)
+            cpu.attach_device(timer, Timer.SIZE, Timer())
+            cpu.set_register(12, 5)
+            result = cpu.run(100)
+            self.assertEqual(result.reason, StopReason.HALTED)
+            self.assertEqual(cpu.get_fusion_stats().auipc_lw, 0)
+            totals.append(cpu.get_register(9))
+        self.assertEqual(totals[0], totals[1])
+        self.assertEqual(totals[0], 65)
+
+
+if __name__ == "__main__":
+    unittest.main()
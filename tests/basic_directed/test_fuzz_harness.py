@@ -0,0 +1,79 @@
+import os
+import tempfile
+import unittest
+
+from virtuv_bindings import CPU, FuzzHarness, FuzzOutcome, Timer
+
+INPUT_ADDRESS = 0x800
+OUTPUT_ADDRESS = 0x400
+
+
+class TestFuzzHarness(unittest.TestCase):
+    def setUp(self):
+        # Stores the input size (a1) then halts with a jump to self
+        program = [
+            0x40B02023,  # sw x11, 0x400(x0)
+            0x0000006F,  # jal x0, 0 -> end of program
+        ]
+        temp_file = tempfile.NamedTemporaryFile(delete=False)
+        for instr in program:
+            temp_file.write(instr.to_bytes(4, byteorder='little'))
+        temp_file.close()
+        self.program_file = temp_file.name
+
+        self.cpu = CPU(1024 * 1024)
+        self.assertEqual(self.cpu.load_program(self.program_file), 0)
+
+    def tearDown(self):
+        os.remove(self.program_file)
+
+    def test_run_and_reset(self):
+        harness = FuzzHarness(self.cpu, INPUT_ADDRESS, 64, 1000)
+        for data in (b"abc", b"0123456789", b""):
+            result = harness.run(data)
+            self.assertEqual(result.outcome, FuzzOutcome.HALTED)
+            self.assertEqual(result.instructions, 1)
+            # The input and the program output share page 0, the only page copied back
+            self.assertEqual(result.dirty_pages, 1)
+
+            # Memory and registers are back to the base state after every run
+            self.assertEqual(self.cpu.read_word_from_memory(OUTPUT_ADDRESS), 0)
+            self.assertEqual(self.cpu.read_word_from_memory(INPUT_ADDRESS), 0)
+            self.assertEqual(self.cpu.get_register(11), 0)
+            self.assertEqual(self.cpu.get_pc(), 0)
+            self.assertEqual(self.cpu.count_dirty_pages(), 0)
+
+        stats = harness.get_stats()
+        self.assertEqual(stats.executions, 3)
+        self.assertEqual(stats.dirty_pages_restored, 3)
+        self.assertGreater(stats.execs_per_second, 0)
+
+    def test_budget(self):
+        harness = FuzzHarness(self.cpu, INPUT_ADDRESS, 4, 1)
+        result = harness.run(b"\xff" * 16)
+        self.assertEqual(result.outcome, FuzzOutcome.BUDGET_EXHAUSTED)
+        self.assertEqual(result.instructions, 1)
+        self.assertEqual(self.cpu.read_word_from_memory(INPUT_ADDRESS), 0)
+
+        harness.set_instruction_budget(10)
+        self.assertEqual(harness.run(b"\xff" * 16).outcome, FuzzOutcome.HALTED)
+
+    def test_crash(self):
+        # The input page is unmapped, so copying the input faults
+        harness = FuzzHarness(self.cpu, 0x10000, 16, 10)
+        result = harness.run(b"x")
+        self.assertEqual(result.outcome, FuzzOutcome.CRASHED)
+        self.assertNotEqual(result.message, "")
+
+    def test_devices_are_rejected(self):
+        # Device state is not rewound, the runs would depend on the inputs before them
+        harness = FuzzHarness(self.cpu, INPUT_ADDRESS, 64, 1000)
+        self.cpu.attach_device(0x02000000, Timer.SIZE, Timer())
+        with self.assertRaises(ValueError):
+            harness.run(b"abc")
+        with self.assertRaises(ValueError):
+            FuzzHarness(self.cpu, INPUT_ADDRESS, 64, 1000)
+
+
+if __name__ == "__main__":
+    unittest.main()
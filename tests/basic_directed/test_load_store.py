@@ -0,0 +1,93 @@
+import unittest
+
+from virtuv_bindings import CPU, MisalignedAccess, TranslationMode, TrapCause, UnhandledTrapException
+from rv32_asm import HALT, addi, b_type, i_type, load, s_type, words
+
+DATA = 0x700
+
+
+LB, LH, LW, LBU, LHU = 0, 1, 2, 4, 5
+SB, SH, SW = 0, 1, 2
+
+
+class TestLoadStore(unittest.TestCase):
+    def setUp(self):
+        self.cpu = CPU(1024 * 1024)
+        self.cpu.write_block(DATA, bytes([0x80, 0xFF, 0x34, 0x12, 0x78, 0x56, 0x00, 0x00]))
+
+    def run_program(self, program):
+        self.cpu.write_block(0, words([addi(1, 0, DATA)] + program + [HALT]))
+        self.cpu.run()
+
+    def test_sub_word_loads_extend(self):
+        self.run_program([
+            load(LB, 2, 1, 0),
+            load(LBU, 3, 1, 0),
+            load(LH, 4, 1, 0),
+            load(LHU, 5, 1, 0),
+            load(LW, 6, 1, 0),
+        ])
+        self.assertEqual(self.cpu.get_register(2), 0xFFFFFF80)
+        self.assertEqual(self.cpu.get_register(3), 0x80)
+        self.assertEqual(self.cpu.get_register(4), 0xFFFFFF80)
+        self.assertEqual(self.cpu.get_register(5), 0xFF80)
+        self.assertEqual(self.cpu.get_register(6), 0x1234FF80)
+
+    def test_sub_word_stores_keep_neighbours(self):
+        self.cpu.set_register(7, 0xAABBCCDD)
+        self.run_program([
+            s_type(SB, 1, 7, 0),
+            s_type(SH, 1, 7, 2),
+            load(LW, 2, 1, 0),
+            load(LW, 3, 1, 4),
+        ])
+        self.assertEqual(self.cpu.get_register(2), 0xCCDDFFDD)
+        self.assertEqual(self.cpu.get_register(3), 0x00005678)
+
+    def test_misaligned_split(self):
+        self.run_program([load(LW, 2, 1, 1), load(LH, 3, 1, 3)])
+        self.assertEqual(self.cpu.get_register(2), 0x781234FF)
+        self.assertEqual(self.cpu.get_register(3), 0x7812)
+
+    def test_misaligned_across_pages(self):
+        # Bare machine mode, the word straddles the first and second page
+        self.cpu.set_translation_mode(TranslationMode.SATP)
+        self.cpu.write_block(0xFFE, bytes([0x11, 0x22, 0x33, 0x44]))
+        self.run_program([addi(1, 0, 0x7FF), addi(1, 1, 0x7FF), load(LW, 2, 1, 0)])
+        self.assertEqual(self.cpu.get_register(2), 0x44332211)
+
+    def test_misaligned_trap(self):
+        self.cpu.set_misaligned_access(MisalignedAccess.TRAP)
+        with self.assertRaises(UnhandledTrapException):
+            self.run_program([load(LHU, 2, 1, 0), load(LW, 3, 1, 2)])
+        self.assertEqual(self.cpu.get_register(2), 0xFF80)
+        self.assertEqual(self.cpu.get_last_trap().cause, TrapCause.LOAD_ADDRESS_MISALIGNED)
+        self.assertEqual(self.cpu.get_last_trap().value, DATA + 2)
+
+        self.cpu.write_block(0, words([addi(1, 0, DATA), s_type(SH, 1, 0, 1), HALT]))
+        self.cpu.get_register_bank().set_pc(0)
+        with self.assertRaises(UnhandledTrapException):
+            self.cpu.run()
+        self.assertEqual(self.cpu.get_last_trap().cause, TrapCause.STORE_ADDRESS_MISALIGNED)
+
+    def test_auipc_jalr_and_signed_compares(self):
+        self.run_program([
+            0x00000117,                      # 4: auipc x2, 0
+            i_type(0x67, 3, 0, 2, 12),       # 8: jalr x3, 12(x2) -> 16
+            addi(4, 0, 1),                   # 12: skipped
+            addi(5, 0, -8),                  # 16: x5 = -8
+            i_type(0x13, 6, 5, 5, 0x401),    # 20: srai x6, x5, 1
+            b_type(4, 5, 0, 8),              # 24: blt x5, x0, +8
+            addi(4, 0, 2),                   # 28: skipped
+            b_type(6, 5, 0, 8),              # 32: bltu x5, x0 is never taken
+            addi(7, 0, 3),                   # 36
+        ])
+        self.assertEqual(self.cpu.get_register(2), 4)
+        self.assertEqual(self.cpu.get_register(3), 12)
+        self.assertEqual(self.cpu.get_register(4), 0)
+        self.assertEqual(self.cpu.get_register(6), 0xFFFFFFFC)
+        self.assertEqual(self.cpu.get_register(7), 3)
+
+
+if __name__ == "__main__":
+    unittest.main()
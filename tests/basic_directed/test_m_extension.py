@@ -0,0 +1,85 @@
+import unittest
+
+from virtuv_bindings import CPU, CompactInstruction, ExecutionMode, MemoryBacking, Operation, TranslationMode
+from rv32_asm import HALT, addi, bne, m_type, r_type, words
+
+ITERATIONS = 20    # enough for the JIT to compile the block
+MODES = (ExecutionMode.PIPELINE, ExecutionMode.FUNCTIONAL, ExecutionMode.THREADED, ExecutionMode.JIT)
+OPERATIONS = (Operation.MUL, Operation.MULH, Operation.MULHSU, Operation.MULHU,
+              Operation.DIV, Operation.DIVU, Operation.REM, Operation.REMU)
+
+
+# MUL to REMU of x11 and x12 into x13 to x20, in a loop counted by x21
+PROGRAM = [m_type(funct3, 13 + funct3, 11, 12) for funct3 in range(8)] + [
+    addi(21, 21, -1),
+    bne(21, 0, -36),
+    HALT,
+]
+
+# rs1, rs2, then MUL, MULH, MULHSU, MULHU, DIV, DIVU, REM, REMU
+CASES = [
+    # Division by zero: all ones, the remainder is the dividend
+    (7, 0, [0, 0, 0, 0, 0xFFFFFFFF, 0xFFFFFFFF, 7, 7]),
+    # INT_MIN / -1 overflows to INT_MIN with no remainder
+    (0x80000000, 0xFFFFFFFF, [0x80000000, 0, 0x80000000, 0x7FFFFFFF, 0x80000000, 0, 0, 0x80000000]),
+    # Signed division rounds towards zero, the remainder has the sign of the dividend
+    (0xFFFFFFF9, 2, [0xFFFFFFF2, 0xFFFFFFFF, 0xFFFFFFFF, 1, 0xFFFFFFFD, 0x7FFFFFFC, 0xFFFFFFFF, 1]),
+    (100, 0xFFFFFFF9, [0xFFFFFD44, 0xFFFFFFFF, 0x63, 0x63, 0xFFFFFFF2, 0, 2, 100]),
+    # -1 * -1: the high half depends on how each operand is extended
+    (0xFFFFFFFF, 0xFFFFFFFF, [1, 0, 0xFFFFFFFF, 0xFFFFFFFE, 1, 1, 0, 0]),
+    (0x12345678, 0x9ABCDEF0, [0x242D2080, 0xF8CC93D6, 0x0B00EA4E, 0x0B00EA4E, 0, 0, 0x12345678, 0x12345678]),
+]
+
+
+def run(mode, rs1, rs2):
+    cpu = CPU(64 * 1024, MemoryBacking.HEAP, mode)
+    cpu.set_translation_mode(TranslationMode.SATP)
+    cpu.write_block(0, words(PROGRAM))
+    cpu.set_register(11, rs1)
+    cpu.set_register(12, rs2)
+    cpu.set_register(21, ITERATIONS)
+    cpu.run(100000)
+    return cpu
+
+
+class TestMExtension(unittest.TestCase):
+    def test_decode(self):
+        for funct3, op in enumerate(OPERATIONS):
+            decoded = CompactInstruction(m_type(funct3, 3, 1, 2))
+            self.assertEqual(decoded.op, op)
+            self.assertEqual((decoded.rd, decoded.rs1, decoded.rs2), (3, 1, 2))
+        # Other funct7 values of OP stay illegal
+        self.assertEqual(CompactInstruction(r_type(0x03, 2, 1, 0, 3)).op, Operation.ILLEGAL)
+
+    def test_results(self):
+        for mode in MODES:
+            for rs1, rs2, expected in CASES:
+                with self.subTest(mode=mode, rs1=hex(rs1), rs2=hex(rs2)):
+                    cpu = run(mode, rs1, rs2)
+                    self.assertEqual([cpu.get_register(13 + funct3) for funct3 in range(8)], expected)
+
+    def test_misa(self):
+        cpu = CPU(64 * 1024, MemoryBacking.HEAP, ExecutionMode.PIPELINE)
+        cpu.write_block(0, words([(0x301 << 20) | (2 << 12) | (10 << 7) | 0x73, HALT]))  # csrr x10, misa
+        cpu.run(100)
+        self.assertEqual(cpu.get_register(10), 0x40141101)  # RV32 I, M, A, S and U
+
+    def test_never_traps(self):
+        cpu = run(ExecutionMode.PIPELINE, 0x80000000, 0)
+        self.assertEqual(cpu.get_trap_count(), 0)
+        self.assertEqual(cpu.get_pc(), 4 * (len(PROGRAM) - 1))
+
+    def test_engines_run_it_natively(self):
+        # Only the final jump to self goes through the pipeline
+        self.assertEqual(run(ExecutionMode.FUNCTIONAL, 0x80000000, 0xFFFFFFFF).get_functional_stats().fallbacks, 1)
+        for mode in (ExecutionMode.THREADED, ExecutionMode.JIT):
+            with self.subTest(mode=mode):
+                stats = run(mode, 0x80000000, 0xFFFFFFFF).get_threaded_stats()
+                self.assertEqual(stats.fallbacks, 1)
+                self.assertEqual(stats.instructions, ITERATIONS * 10)
+                if mode == ExecutionMode.JIT:
+                    self.assertEqual(stats.blocks_compiled, 1)
+
+
+if __name__ == "__main__":
+    unittest.main()
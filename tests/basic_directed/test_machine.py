@@ -0,0 +1,236 @@
+import struct
+import unittest
+
+from virtuv_bindings import (CPU, ExecutionMode, Machine, MachineConfig, MemoryBacking, SchedulingMode, StopReason,
+                             TranslationMode, TrapCause)
+from rv32_asm import HALT, add, addi, amo, b_type, bne, csrr, i_type, lr_w, lui, lw, sc_w, sw, words
+
+FENCE = 0x0FF0000F  # fence iorw, iorw
+MHARTID = 0xF14
+DATA = 0x1000
+MODES = [ExecutionMode.PIPELINE, ExecutionMode.THREADED, ExecutionMode.JIT, ExecutionMode.FUNCTIONAL]
+
+
+# funct5, memory, rs2, memory afterwards
+AMOS = {
+    "amoswap": (0x01, 5, 9, 9),
+    "amoadd": (0x00, 5, 9, 14),
+    "amoxor": (0x04, 0xF0, 0x3C, 0xCC),
+    "amoand": (0x0C, 0xF0, 0x3C, 0x30),
+    "amoor": (0x08, 0xF0, 0x3C, 0xFC),
+    "amomin": (0x10, 0xFFFFFFFE, 3, 0xFFFFFFFE),
+    "amomax": (0x14, 0xFFFFFFFE, 3, 3),
+    "amominu": (0x18, 0xFFFFFFFE, 3, 3),
+    "amomaxu": (0x1C, 0xFFFFFFFE, 3, 0xFFFFFFFE),
+}
+
+# Each hart takes a lock 200 times with LR/SC and increments a counter with plain loads and stores
+# while holding it. The counter is at DATA + 4, the lock at DATA
+LOCKED_INCREMENTS = 200
+LOCKED_COUNTER = [
+    lui(10, DATA >> 12),
+    addi(11, 0, LOCKED_INCREMENTS),
+    addi(6, 0, 1),
+    lr_w(5, 10),                    # 12: acquire
+    bne(5, 0, -4),
+    sc_w(5, 10, 6),
+    bne(5, 0, -12),
+    FENCE,
+    lw(7, 10, 4),
+    addi(7, 7, 1),
+    sw(7, 10, 4),
+    FENCE,
+    sw(0, 10, 0),                   # release
+    addi(11, 11, -1),
+    bne(11, 0, -44),
+    csrr(12, MHARTID),
+    HALT,
+]
+
+# Each hart adds 1 to DATA 300 times with amoadd and sums the values it got back in a3
+AMO_COUNTER = [
+    lui(10, DATA >> 12),
+    addi(11, 0, 300),
+    addi(6, 0, 1),
+    amo(0x00, 5, 10, 6),            # 12
+    add(13, 13, 5),
+    addi(11, 11, -1),
+    bne(11, 0, -12),
+    HALT,
+]
+
+
+class TestAtomics(unittest.TestCase):
+    def make_cpu(self, mode, program):
+        cpu = CPU(1024 * 1024, MemoryBacking.HEAP, mode)
+        cpu.set_translation_mode(TranslationMode.SATP)
+        cpu.write_block(0, words(program))
+        return cpu
+
+    def test_amo(self):
+        for mode in MODES:
+            for name, (funct5, memory, operand, expected) in AMOS.items():
+                with self.subTest(mode=mode, amo=name):
+                    cpu = self.make_cpu(mode, [lui(10, DATA >> 12), amo(funct5, 12, 10, 11), HALT])
+                    cpu.write_block(DATA, struct.pack("<I", memory))
+                    cpu.set_register(11, operand)
+                    self.assertEqual(cpu.run(100).reason, StopReason.HALTED)
+                    self.assertEqual(cpu.get_register(12), memory)
+                    self.assertEqual(cpu.read_word_from_memory(DATA), expected)
+
+    def test_lr_sc(self):
+        program = [
+            lui(10, DATA >> 12),
+            addi(11, 0, 42),
+            lr_w(12, 10),
+            sc_w(13, 10, 11),   # succeeds
+            sc_w(14, 10, 11),   # no reservation left
+            lr_w(15, 10),
+            sw(0, 10, 0),
+            sc_w(5, 10, 11),    # the word changed
+            HALT,
+        ]
+        for mode in MODES:
+            with self.subTest(mode=mode):
+                cpu = self.make_cpu(mode, program)
+                self.assertEqual(cpu.run(100).reason, StopReason.HALTED)
+                self.assertEqual(cpu.get_register(13), 0)
+                self.assertEqual(cpu.get_register(14), 1)
+                self.assertEqual(cpu.get_register(15), 42)
+                self.assertEqual(cpu.get_register(5), 1)
+                self.assertEqual(cpu.read_word_from_memory(DATA), 0)
+
+    def test_misaligned(self):
+        for mode in MODES:
+            with self.subTest(mode=mode):
+                cpu = self.make_cpu(mode, [lui(10, DATA >> 12), addi(10, 10, 2), amo(0x00, 12, 10, 11), HALT])
+                result = cpu.run(100)
+                self.assertEqual(result.reason, StopReason.TRAP)
+                self.assertEqual(result.pc, 8)
+                self.assertEqual(cpu.get_last_trap().cause, TrapCause.STORE_ADDRESS_MISALIGNED)
+                cpu = self.make_cpu(mode, [lui(10, DATA >> 12), addi(10, 10, 2), lr_w(12, 10), HALT])
+                cpu.run(100)
+                self.assertEqual(cpu.get_last_trap().cause, TrapCause.LOAD_ADDRESS_MISALIGNED)
+
+    def test_misa(self):
+        cpu = self.make_cpu(ExecutionMode.PIPELINE, [i_type(0x73, 5, 2, 0, 0x301), HALT])
+        cpu.run(100)
+        self.assertTrue(cpu.get_register(5) & 1)  # A
+
+
+class TestMachine(unittest.TestCase):
+    def make_machine(self, harts, program, mode=ExecutionMode.THREADED, scheduling=SchedulingMode.PARALLEL,
+                     quantum=1000):
+        machine = Machine(harts, 1024 * 1024, MemoryBacking.HEAP, mode)
+        config = MachineConfig()
+        config.scheduling = scheduling
+        config.quantum = quantum
+        machine.set_config(config)
+        machine.get_hart(0).write_block(0, words(program))
+        return machine
+
+    def test_hart_ids(self):
+        machine = self.make_machine(4, [csrr(10, MHARTID), HALT])
+        results = machine.run()
+        self.assertEqual(len(results), 4)
+        for hart in range(4):
+            self.assertEqual(results[hart].reason, StopReason.HALTED)
+            self.assertEqual(machine.get_hart(hart).get_register(10), hart)
+            self.assertEqual(machine.get_hart(hart).get_csrs().mhartid, hart)
+        with self.assertRaises(IndexError):
+            machine.get_hart(4)
+
+    def test_locked_counter(self):
+        for scheduling in [SchedulingMode.PARALLEL, SchedulingMode.DETERMINISTIC]:
+            for mode in MODES:
+                with self.subTest(scheduling=scheduling, mode=mode):
+                    machine = self.make_machine(4, LOCKED_COUNTER, mode, scheduling, quantum=37)
+                    results = machine.run(10000000)
+                    self.assertTrue(all(result.reason == StopReason.HALTED for result in results))
+                    self.assertEqual(machine.get_hart(1).read_word_from_memory(DATA + 4), 4 * LOCKED_INCREMENTS)
+
+    def test_deterministic_is_reproducible(self):
+        sums = []
+        for _ in range(2):
+            machine = self.make_machine(4, AMO_COUNTER, scheduling=SchedulingMode.DETERMINISTIC, quantum=13)
+            results = machine.run()
+            self.assertTrue(all(result.instructions == 3 + 4 * 300 for result in results))
+            self.assertEqual(machine.get_hart(0).read_word_from_memory(DATA), 4 * 300)
+            sums.append([machine.get_hart(hart).get_register(13) for hart in range(4)])
+        self.assertEqual(sums[0], sums[1])
+
+    def test_budget_per_hart(self):
+        machine = self.make_machine(2, [addi(10, 10, 1), b_type(0, 0, 0, -4)],
+                                    scheduling=SchedulingMode.DETERMINISTIC, quantum=7)
+        results = machine.run(100)
+        for hart in range(2):
+            self.assertEqual(results[hart].reason, StopReason.BUDGET)
+            self.assertEqual(results[hart].instructions, 100)
+            self.assertEqual(machine.get_hart(hart).get_register(10), 50)
+
+    def test_request_stop(self):
+        machine = self.make_machine(2, [addi(10, 10, 1), b_type(0, 0, 0, -4)])
+        machine.request_stop()
+        results = machine.run()
+        self.assertTrue(all(result.reason == StopReason.STOPPED for result in results))
+
+    def test_snapshot_covers_every_hart(self):
+        # Hart 1 stores t0 to 0x8000. Its write translation survives the run, the machine
+        # snapshot has to flush it or the next store would not mark the page dirty
+        store = [lui(8, 0x8), sw(5, 8, 0), HALT]
+        for mode in MODES:
+            with self.subTest(mode=mode):
+                machine = self.make_machine(2, store, mode)
+                hart = machine.get_hart(1)
+
+                def store_value(value):
+                    hart.set_register(5, value)
+                    hart.get_register_bank().set_pc(0)
+                    hart.run(100)
+
+                store_value(1)
+                snapshot = machine.snapshot()
+                self.assertEqual(snapshot.hart_count, 2)
+                store_value(2)
+                self.assertEqual(machine.get_physical_memory().count_dirty_pages(), 1)
+                self.assertEqual(machine.restore_dirty(snapshot), 1)
+                self.assertEqual(machine.get_physical_memory().read_word(0x8000), 1)
+                self.assertEqual(hart.get_register(5), 1)
+
+                store_value(3)
+                machine.restore(snapshot)
+                self.assertEqual(machine.get_physical_memory().read_word(0x8000), 1)
+
+    def test_restore_drops_the_code_of_every_hart(self):
+        for mode in MODES:
+            with self.subTest(mode=mode):
+                machine = self.make_machine(2, [addi(10, 0, 1), HALT], mode)
+                snapshot = machine.snapshot()
+                # Hart 0 rewrites the code, hart 1 runs the new code often enough to compile it
+                machine.get_hart(0).write_block(0, words([addi(10, 0, 2), HALT]))
+                hart = machine.get_hart(1)
+                hart.flush_predecode_cache()
+                for _ in range(40):
+                    hart.get_register_bank().set_pc(0)
+                    hart.run(100)
+                self.assertEqual(hart.get_register(10), 2)
+                machine.restore_dirty(snapshot)
+                hart.run(100)
+                self.assertEqual(hart.get_register(10), 1)
+
+    def test_snapshot_of_another_machine(self):
+        with self.assertRaises(ValueError):
+            Machine(2, 4096).restore(Machine(3, 4096).snapshot())
+
+    def test_invalid_config(self):
+        with self.assertRaises(ValueError):
+            Machine(0, 4096)
+        machine = Machine(1, 4096)
+        config = MachineConfig()
+        config.quantum = 0
+        with self.assertRaises(ValueError):
+            machine.set_config(config)
+
+
+if __name__ == "__main__":
+    unittest.main()
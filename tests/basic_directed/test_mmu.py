@@ -4,10 +4,12 @@ import sys
 sys.path.insert(0, '/src/core/')
 from virtuv_bindings import (
     PhysicalMemory,
+    MemoryBacking,
     PageTableEntry,
     PageTable,
     MMU,
     PrivilegeMode,
+    TranslationMode,
     PageFaultException,
     AccessViolationException,
 )
@@ -18,6 +20,9 @@ READ_BIT = 0x2
 WRITE_BIT = 0x4
 EXECUTE_BIT = 0x8
 USER_ACCESSIBLE_BIT = 0x10
+ACCESSED_BIT = 0x40
+DIRTY_BIT = 0x80
+SATP_MODE_SV32 = 0x80000000
 
 
 class TestMMU(unittest.TestCase):
@@ -56,6 +61,51 @@ class TestMMU(unittest.TestCase):
         value = self.mmu.read_word(self.virtual_address)
         self.assertEqual(value, 0xDEADBEEF)
 
+    def test_read_write_halfword_and_doubleword(self):
+        self.mmu.write_halfword(self.virtual_address + 1, 0xBEEF)  # unaligned
+        self.assertEqual(self.mmu.read_halfword(self.virtual_address + 1), 0xBEEF)
+        self.mmu.write_doubleword(self.virtual_address + 8, 0x0123456789ABCDEF)
+        self.assertEqual(self.mmu.read_doubleword(self.virtual_address + 8), 0x0123456789ABCDEF)
+        self.assertEqual(self.mmu.read_word(self.virtual_address + 12), 0x01234567)
+
+    def test_word_crossing_page_boundary(self):
+        # Map the next page so a word can straddle both pages
+        next_page = self.page_number + 0x1000
+        entry_value = next_page | VALID_BIT | READ_BIT | WRITE_BIT | EXECUTE_BIT | USER_ACCESSIBLE_BIT
+        self.page_table.add_entry(next_page, PageTableEntry(entry_value))
+        self.mmu.write_word(next_page - 2, 0xCAFEBABE)
+        self.assertEqual(self.mmu.read_word(next_page - 2), 0xCAFEBABE)
+        self.assertEqual(self.mmu.read_halfword(next_page), 0xCAFE)
+
+    def test_crossing_store_faults_without_partial_write(self):
+        # The page after self.virtual_address is not mapped
+        last_word = self.page_number + 0x1000 - 4
+        self.mmu.write_word(last_word, 0)
+        with self.assertRaises(PageFaultException):
+            self.mmu.write_word(last_word + 2, 0xFFFFFFFF)
+        self.assertEqual(self.mmu.read_word(last_word), 0)
+
+    def test_block_read_write_fill(self):
+        # A block spanning two pages is copied one page at a time
+        next_page = self.page_number + 0x1000
+        entry_value = next_page | VALID_BIT | READ_BIT | WRITE_BIT | EXECUTE_BIT | USER_ACCESSIBLE_BIT
+        self.page_table.add_entry(next_page, PageTableEntry(entry_value))
+        data = bytes(range(256)) * 32
+        self.mmu.write_block(self.virtual_address + 0x800, data)
+        self.assertEqual(self.mmu.read_block(self.virtual_address + 0x800, len(data)), data)
+        self.assertEqual(self.mmu.read_word(next_page), 0x03020100)
+
+        self.mmu.fill(next_page - 4, 0xAA, 8)
+        self.assertEqual(self.mmu.read_doubleword(next_page - 4), 0xAAAAAAAAAAAAAAAA)
+        self.assertEqual(self.mmu.read_block(self.virtual_address, 0), b"")
+
+    def test_physical_memory_buffer(self):
+        self.physical_memory.write_block(0x100, b"\x78\x56\x34\x12")
+        view = memoryview(self.physical_memory)
+        self.assertTrue(view.readonly)
+        self.assertEqual(view.nbytes, 1024 * 1024)
+        self.assertEqual(view[0x100:0x104].cast("I")[0], 0x12345678)
+
     def test_access_violation_read(self):
         # Remove read permission but keep VALID_BIT
         entry_value = (
@@ -108,6 +158,21 @@ class TestMMU(unittest.TestCase):
         self.mmu.set_privilege_mode(PrivilegeMode.MACHINE)
         self.mmu.read(self.virtual_address)
 
+    def test_tlb_hits_and_flush(self):
+        # First access misses, the following ones on the same page hit the TLB
+        self.mmu.reset_tlb_stats()
+        self.mmu.write_word(self.virtual_address, 0x12345678)
+        self.assertEqual(self.mmu.read_word(self.virtual_address), 0x12345678)
+        self.assertEqual(self.mmu.read_word(self.virtual_address + 4), 0)
+        stats = self.mmu.get_tlb_stats()
+        self.assertEqual(stats.misses, 2)  # one write fill and one read fill
+        self.assertEqual(stats.hits, 1)
+
+        # After an explicit flush the next access misses again
+        self.mmu.flush_tlb()
+        self.mmu.read(self.virtual_address)
+        self.assertEqual(self.mmu.get_tlb_stats().misses, 3)
+
     def test_translate_address(self):
         # Test that virtual to physical address translation works correctly
         physical_address = self.mmu.translate_address(
@@ -120,5 +185,74 @@ class TestMMU(unittest.TestCase):
         self.assertEqual(physical_address, expected_physical_address)
 
 
+class TestReservedBacking(unittest.TestCase):
+    def test_large_memory_is_lazily_zeroed(self):
+        # 3 GB of guest RAM, only the touched pages are ever allocated
+        memory = PhysicalMemory(3 * 1024 * 1024 * 1024, MemoryBacking.RESERVED)
+        self.assertEqual(memory.get_backing(), MemoryBacking.RESERVED)
+        self.assertEqual(memory.read_word(0xB0000000), 0)
+        memory.write_word(0xB0000000, 0xDEADBEEF)
+        self.assertEqual(memory.read_word(0xB0000000), 0xDEADBEEF)
+
+    def test_out_of_range(self):
+        memory = PhysicalMemory(1024 * 1024, MemoryBacking.RESERVED, huge_pages=True)
+        with self.assertRaises(IndexError):
+            memory.read(1024 * 1024)
+
+
+class TestSv32(unittest.TestCase):
+    ROOT_TABLE = 0x10000
+    LEAF_TABLE = 0x11000
+
+    @staticmethod
+    def make_pte(physical_address, flags):
+        return ((physical_address >> 12) << 10) | flags
+
+    def setUp(self):
+        # 8 MB so a 4 MB megapage fits
+        self.physical_memory = PhysicalMemory(8 * 1024 * 1024)
+        self.page_table = PageTable()
+        self.mmu = MMU(self.physical_memory, self.page_table, PrivilegeMode.SUPERVISOR)
+
+        # 0x40001000 -> 0x20000 through a second level table
+        self.physical_memory.write_word(self.ROOT_TABLE + (0x40001000 >> 22) * 4,
+                                        self.make_pte(self.LEAF_TABLE, VALID_BIT))
+        self.leaf_pte_address = self.LEAF_TABLE + ((0x40001000 >> 12) & 0x3FF) * 4
+        self.physical_memory.write_word(self.leaf_pte_address,
+                                        self.make_pte(0x20000, VALID_BIT | READ_BIT | WRITE_BIT))
+        # 0xC0000000 -> 0x400000 as a 4 MB megapage
+        self.physical_memory.write_word(self.ROOT_TABLE + (0xC0000000 >> 22) * 4,
+                                        self.make_pte(0x400000, VALID_BIT | READ_BIT | WRITE_BIT | EXECUTE_BIT))
+
+        self.mmu.set_translation_mode(TranslationMode.SATP)
+        self.mmu.set_satp(SATP_MODE_SV32 | (self.ROOT_TABLE >> 12))
+
+    def test_walk_and_dirty_bit(self):
+        self.mmu.read_word(0x40001010)
+        self.assertTrue(self.physical_memory.read_word(self.leaf_pte_address) & ACCESSED_BIT)
+        self.assertFalse(self.physical_memory.read_word(self.leaf_pte_address) & DIRTY_BIT)
+        self.mmu.write_word(0x40001010, 0x1234)
+        self.assertEqual(self.physical_memory.read_word(0x20010), 0x1234)
+        self.assertTrue(self.physical_memory.read_word(self.leaf_pte_address) & DIRTY_BIT)
+
+    def test_megapage(self):
+        self.mmu.write_word(0xC0123456, 0xABCD)
+        self.assertEqual(self.physical_memory.read_word(0x523456), 0xABCD)
+
+    def test_faults(self):
+        with self.assertRaises(PageFaultException):
+            self.mmu.read(0x50000000)  # no root entry
+        with self.assertRaises(PageFaultException):
+            self.mmu.fetch_word(0x40001000)  # not executable
+        self.mmu.set_privilege_mode(PrivilegeMode.USER)
+        with self.assertRaises(PageFaultException):
+            self.mmu.read(0x40001000)  # supervisor page
+
+    def test_machine_mode_is_untranslated(self):
+        self.mmu.set_privilege_mode(PrivilegeMode.MACHINE)
+        self.mmu.write_word(0x20010, 0x55)
+        self.assertEqual(self.physical_memory.read_word(0x20010), 0x55)
+
+
 if __name__ == "__main__":
     unittest.main()
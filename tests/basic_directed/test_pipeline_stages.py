@@ -21,7 +21,9 @@ from virtuv_bindings import (
     DecodedInstructionIType,
     DecodedInstructionSType,
     DecodedInstructionUType,
-    InstructionFormat
+    InstructionFormat,
+    CompactInstruction,
+    Operation
 )
 
 VALID_BIT = 0x1
@@ -80,6 +82,37 @@ class TestDecodeStage(unittest.TestCase):
         self.assertEqual(decoded.funct3, 0)
         self.assertEqual(decoded.funct7, 0)
 
+    def test_decode_compact(self):
+        # addi x5, x6, -3: the immediate comes out sign extended
+        instruction = ((-3 & 0xFFF) << 20) | (6 << 15) | (0 << 12) | (5 << 7) | 0x13
+        self.decode_stage.set_fetched_instruction(instruction)
+        self.decode_stage.process()
+        decoded = self.decode_stage.get_instruction()
+        self.assertEqual(decoded.op, Operation.ADDI)
+        self.assertEqual(decoded.rd, 5)
+        self.assertEqual(decoded.rs1, 6)
+        self.assertEqual(decoded.imm, -3)
+        self.assertEqual(decoded.raw, instruction)
+
+    def test_compact_immediates(self):
+        # beq x1, x2, -8
+        offset = -8 & 0x1FFF
+        beq = (((offset >> 12) & 1) << 31) | (((offset >> 5) & 0x3F) << 25) | (2 << 20) | (1 << 15) \
+            | (((offset >> 1) & 0xF) << 8) | (((offset >> 11) & 1) << 7) | 0x63
+        decoded = CompactInstruction(beq)
+        self.assertEqual(decoded.op, Operation.BEQ)
+        self.assertEqual(decoded.imm, -8)
+        # sw x2, -4(x1)
+        sw = ((-4 & 0xFE0) << 20) | (2 << 20) | (1 << 15) | (2 << 12) | ((-4 & 0x1F) << 7) | 0x23
+        self.assertEqual(CompactInstruction(sw).imm, -4)
+        # srai x1, x1, 3 keeps only the shift amount
+        srai = (0x20 << 25) | (3 << 20) | (1 << 15) | (5 << 12) | (1 << 7) | 0x13
+        self.assertEqual(CompactInstruction(srai).op, Operation.SRAI)
+        self.assertEqual(CompactInstruction(srai).imm, 3)
+        # Reserved widths and unknown opcodes are illegal
+        self.assertEqual(CompactInstruction((3 << 12) | 0x23).op, Operation.ILLEGAL)
+        self.assertEqual(CompactInstruction(0xFFFFFFFF).op, Operation.ILLEGAL)
+
 # -------------------------------------------------------
 # Test the ExecuteStage 
 # -------------------------------------------------------
@@ -105,6 +138,13 @@ class TestExecuteStage(unittest.TestCase):
         exec_result = self.execute_stage.get_result()
         self.assertEqual(exec_result.alu_result, 15)  # 10 + 5 = 15
 
+    def test_execute_compact(self):
+        # sub x3, x1, x0 from the compact form
+        sub = (0x20 << 25) | (0 << 20) | (1 << 15) | (0 << 12) | (3 << 7) | 0x33
+        self.execute_stage.set_instruction(CompactInstruction(sub))
+        self.execute_stage.process()
+        self.assertEqual(self.execute_stage.get_result().alu_result, 10)
+
 # -------------------------------------------------------
 # Test the MemoryAccessStage individually
 # -------------------------------------------------------
@@ -133,6 +173,7 @@ class TestMemoryAccessStage(unittest.TestCase):
         # Create a dummy I-type load instruction (using opcode 0x03 for loads)
         load_inst = DecodedInstructionIType(0)
         load_inst.opcode = 0x03
+        load_inst.funct3 = 2  # LW
         load_inst.rd = 5  # destination register 
         
         mem_stage = MemoryAccessStage(self.mmu, self.reg_bank)
@@ -157,6 +198,7 @@ class TestMemoryAccessStage(unittest.TestCase):
         # Create a dummy S-type store instruction
         store_inst = DecodedInstructionSType(0)
         store_inst.opcode = 0x23  # store opcode
+        store_inst.funct3 = 2  # SW
         store_inst.rs2 = 4  
         
         # Set register x4
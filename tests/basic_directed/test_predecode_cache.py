@@ -0,0 +1,80 @@
+import unittest
+
+from virtuv_bindings import CPU
+from rv32_asm import HALT, addi, bne, lw, sw, words
+
+FENCE_I = 0x0000100F
+PATCH = 0x40
+
+
+class TestPredecodeCache(unittest.TestCase):
+    def setUp(self):
+        self.cpu = CPU(1024 * 1024)
+
+    def test_loop_runs_from_cache(self):
+        self.cpu.write_block(0, words([
+            addi(5, 0, 1000),
+            addi(6, 6, 3),
+            addi(5, 5, -1),
+            bne(5, 0, -8),
+            HALT,
+        ]))
+        self.cpu.run()
+        stats = self.cpu.get_predecode_stats()
+        self.assertEqual(self.cpu.get_register(6), 3000)
+        # Each instruction is decoded once, every later iteration hits
+        self.assertEqual(stats.misses, 5)
+        self.assertGreater(stats.hit_rate, 0.99)
+
+    def self_modifying_program(self, first):
+        # Runs the loop 3 times, each iteration copies the word at PATCH over the instruction at 4
+        return words([
+            first,
+            addi(29, 29, 1),       # 4: patched to addi x29, x29, 16
+            addi(6, 6, 1),
+            lw(28, 0, PATCH),
+            sw(28, 0, 4),
+            addi(7, 0, 3),
+            bne(6, 7, -20 if first != FENCE_I else -24),
+            HALT,
+        ])
+
+    def test_store_invalidates_cached_instruction(self):
+        self.cpu.write_block(0, self.self_modifying_program(addi(0, 0, 0)))
+        self.cpu.write_block(PATCH, words([addi(29, 29, 16)]))
+        self.cpu.run()
+        self.assertEqual(self.cpu.get_register(29), 33)
+        self.assertGreater(self.cpu.get_predecode_stats().invalidations, 0)
+
+    def test_fence_i_flushes(self):
+        self.cpu.write_block(0, self.self_modifying_program(FENCE_I))
+        self.cpu.write_block(PATCH, words([addi(29, 29, 16)]))
+        self.cpu.run()
+        stats = self.cpu.get_predecode_stats()
+        # Code cached after each FENCE.I is still watched for writes
+        self.assertEqual(self.cpu.get_register(29), 33)
+        self.assertEqual(stats.flushes, 3)
+        self.assertEqual(stats.hits, 0)
+
+    def test_host_write_invalidates(self):
+        self.cpu.write_block(0, words([addi(5, 0, 1), HALT]))
+        self.cpu.run()
+        self.cpu.write_block(0, words([addi(5, 0, 2)]))
+        self.cpu.get_register_bank().set_pc(0)
+        self.cpu.run()
+        self.assertEqual(self.cpu.get_register(5), 2)
+
+    def test_restore_drops_written_code(self):
+        self.cpu.write_block(0, words([addi(5, 0, 1), HALT]))
+        base = self.cpu.snapshot()
+        self.cpu.run()
+        self.cpu.write_block(0, words([addi(5, 0, 2)]))
+        self.cpu.get_register_bank().set_pc(0)
+        self.cpu.run()
+        self.cpu.restore_dirty(base)
+        self.cpu.run()
+        self.assertEqual(self.cpu.get_register(5), 1)
+
+
+if __name__ == "__main__":
+    unittest.main()
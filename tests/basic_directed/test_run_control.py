@@ -0,0 +1,162 @@
+import unittest
+
+from virtuv_bindings import CPU, CycleStatus, ExecutionMode, MemoryBacking, StopReason, Timer, UnhandledTrapException
+from rv32_asm import ECALL, HALT, add, addi, b_type, lw, sw, words
+
+DATA = 0x700
+MODES = [ExecutionMode.PIPELINE, ExecutionMode.THREADED, ExecutionMode.JIT, ExecutionMode.FUNCTIONAL]
+
+
+# Sums 0..ITERATIONS-1 into a0 through memory, then makes the exit system call with the sum
+ITERATIONS = 300
+SUM_LOOP = [
+    addi(5, 0, 0),
+    addi(6, 0, ITERATIONS),
+    addi(10, 0, 0),
+    add(10, 10, 5),                 # 12: loop
+    sw(10, 0, DATA),
+    lw(7, 0, DATA),
+    addi(5, 5, 1),                  # 24
+    b_type(1, 5, 6, -16),           # bne x5, x6, loop
+    addi(17, 0, 93),                # a7 = exit
+    ECALL,
+    HALT,
+]
+# The ECALL traps without a handler, it is not counted
+LOOP_INSTRUCTIONS = 3 + 5 * ITERATIONS + 1
+
+
+class TestRunControl(unittest.TestCase):
+    def make_cpu(self, mode, program=SUM_LOOP):
+        cpu = CPU(1024 * 1024, MemoryBacking.HEAP, mode)
+        cpu.write_block(0, words(program))
+        return cpu
+
+    def test_exit_code(self):
+        for mode in MODES:
+            with self.subTest(mode=mode):
+                result = self.make_cpu(mode).run(CPU.UNLIMITED)
+                self.assertEqual(result.reason, StopReason.EXIT)
+                self.assertEqual(result.exit_code, sum(range(ITERATIONS)))
+                self.assertEqual(result.instructions, LOOP_INSTRUCTIONS)
+                self.assertEqual(result.pc, 4 * (len(SUM_LOOP) - 2))
+
+    def test_budget_is_exact(self):
+        for budget in [0, 1, 5, 63, 64, 65, 129, 1000, LOOP_INSTRUCTIONS - 1]:
+            reference = self.make_cpu(ExecutionMode.PIPELINE)
+            expected = reference.step(budget)
+            self.assertEqual(expected.instructions, budget)
+            self.assertEqual(expected.reason, StopReason.BUDGET)
+            for mode in MODES:
+                with self.subTest(budget=budget, mode=mode):
+                    cpu = self.make_cpu(mode)
+                    result = cpu.run(budget)
+                    self.assertEqual(result.reason, StopReason.BUDGET)
+                    self.assertEqual(result.instructions, budget)
+                    self.assertEqual(result.pc, expected.pc)
+                    for reg in range(32):
+                        self.assertEqual(cpu.get_register(reg), reference.get_register(reg))
+
+    def test_budget_resumes(self):
+        for mode in MODES:
+            with self.subTest(mode=mode):
+                cpu = self.make_cpu(mode)
+                total = 0
+                result = cpu.run(37)
+                while result.reason == StopReason.BUDGET:
+                    total += result.instructions
+                    result = cpu.run(37)
+                self.assertEqual(result.reason, StopReason.EXIT)
+                self.assertEqual(total + result.instructions, LOOP_INSTRUCTIONS)
+
+    def test_halt(self):
+        for mode in MODES:
+            with self.subTest(mode=mode):
+                cpu = self.make_cpu(mode, [addi(5, 0, 1), HALT])
+                result = cpu.run(100)
+                self.assertEqual(result.reason, StopReason.HALTED)
+                self.assertEqual(result.instructions, 1)
+                self.assertEqual(result.pc, 4)
+                # The jump to self changes nothing, running again stops right away
+                result = cpu.run(100)
+                self.assertEqual(result.reason, StopReason.HALTED)
+                self.assertEqual(result.instructions, 0)
+
+    def test_breakpoint(self):
+        for mode in MODES:
+            with self.subTest(mode=mode):
+                cpu = self.make_cpu(mode)
+                hits = 0
+                result = cpu.run_until(24)
+                while result.reason == StopReason.BREAKPOINT:
+                    self.assertEqual(result.pc, 24)
+                    hits += 1
+                    self.assertEqual(cpu.get_register(5), hits - 1)
+                    result = cpu.run_until(24)
+                self.assertEqual(hits, ITERATIONS)
+                self.assertEqual(result.reason, StopReason.EXIT)
+
+    def test_breakpoint_budget(self):
+        cpu = self.make_cpu(ExecutionMode.THREADED)
+        result = cpu.run_until(0x100, 10)
+        self.assertEqual(result.reason, StopReason.BUDGET)
+        self.assertEqual(result.instructions, 10)
+
+    def test_trap_without_handler(self):
+        for mode in MODES:
+            with self.subTest(mode=mode):
+                cpu = self.make_cpu(mode, [addi(5, 0, 1), 0xFFFFFFFF, HALT])
+                result = cpu.run(100)
+                self.assertEqual(result.reason, StopReason.TRAP)
+                self.assertEqual(result.instructions, 1)
+                self.assertEqual(result.pc, 4)
+                self.assertEqual(cpu.get_last_trap().value, 0xFFFFFFFF)
+                # The blocking run still raises
+                with self.assertRaises(UnhandledTrapException):
+                    cpu.run()
+
+    def test_ecall_is_not_exit(self):
+        cpu = self.make_cpu(ExecutionMode.FUNCTIONAL, [addi(17, 0, 64), ECALL, HALT])
+        self.assertEqual(cpu.run(100).reason, StopReason.TRAP)
+
+    def test_step(self):
+        cpu = self.make_cpu(ExecutionMode.JIT)
+        result = cpu.step(3)
+        self.assertEqual(result.reason, StopReason.BUDGET)
+        self.assertEqual(result.instructions, 3)
+        self.assertEqual(result.pc, 12)
+        self.assertEqual(cpu.get_register(6), ITERATIONS)
+
+    def test_request_stop(self):
+        cpu = self.make_cpu(ExecutionMode.THREADED)
+        cpu.request_stop()
+        result = cpu.run(CPU.UNLIMITED)
+        self.assertEqual(result.reason, StopReason.STOPPED)
+        self.assertEqual(result.instructions, 0)
+        # The request is consumed by the run that saw it
+        self.assertEqual(cpu.run(CPU.UNLIMITED).reason, StopReason.EXIT)
+
+    def test_halted_cycle(self):
+        cpu = self.make_cpu(ExecutionMode.PIPELINE, [HALT])
+        cpu.step()
+        self.assertEqual(cpu.get_pc(), 0)
+        self.assertEqual(CycleStatus.HALTED.value, 3)
+
+    def test_step_ticks_devices_per_instruction(self):
+        # Two instructions retire, the cycles that find the HALT advance nothing
+        program = [addi(5, 0, 1), addi(5, 5, 1), HALT]
+        stepped = self.make_cpu(ExecutionMode.PIPELINE, program)
+        stepped_timer = Timer()
+        stepped.attach_device(0x02000000, Timer.SIZE, stepped_timer)
+        for _ in range(5):
+            stepped.step()
+        run = self.make_cpu(ExecutionMode.PIPELINE, program)
+        run_timer = Timer()
+        run.attach_device(0x02000000, Timer.SIZE, run_timer)
+        run.run(CPU.UNLIMITED)
+        self.assertEqual(stepped_timer.get_mtime(), 2)
+        self.assertEqual(run_timer.get_mtime(), 2)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,155 @@
+import unittest
+
+from virtuv_bindings import CPU, ExecutionMode, JitConfig, UnhandledTrapException
+from rv32_asm import ECALL, HALT, MRET, addi, b_type, csrr, csrw, i_type, lbu, lw, r_type, sb, sw, words
+
+DATA = 0x700
+
+
+# Sums and scrambles DATA[0..16) into x10, copies it to DATA + 0x40 and counts down x5
+KERNEL = [
+    addi(5, 0, 16),                 # 0
+    addi(6, 0, DATA),               # 4
+    lbu(7, 6, 0),                   # 8: loop
+    r_type(0x00, 7, 10, 0, 10),     # add x10, x10, x7
+    i_type(0x13, 11, 1, 10, 3),     # slli x11, x10, 3
+    r_type(0x00, 11, 10, 4, 10),    # xor x10, x10, x11
+    r_type(0x20, 7, 10, 5, 12),     # sra x12, x10, x7
+    sb(7, 6, 0x40),
+    addi(6, 6, 1),
+    addi(5, 5, -1),
+    b_type(1, 5, 0, -32),           # bne x5, x0, loop
+    sw(10, 0, DATA + 0x80),
+    HALT,
+]
+
+
+class TestThreadedEngine(unittest.TestCase):
+    def make_cpu(self, mode, program, handler=None, arena_size=None):
+        cpu = CPU(1024 * 1024)
+        cpu.set_execution_mode(mode)
+        if mode == ExecutionMode.JIT:
+            # Compile on the first execution so every block runs compiled
+            config = JitConfig()
+            config.threshold = 1
+            if arena_size is not None:
+                config.arena_size = arena_size
+            cpu.set_jit_config(config)
+        cpu.write_block(0, words(program))
+        cpu.write_block(DATA, bytes(range(0x90, 0xA0)))
+        if handler is not None:
+            cpu.get_csrs().mtvec = 0x400
+            cpu.write_block(0x400, words(handler))
+        return cpu
+
+    def assert_same_state(self, program, handler=None, mode=ExecutionMode.THREADED, arena_size=None):
+        pipeline = self.make_cpu(ExecutionMode.PIPELINE, program, handler)
+        other = self.make_cpu(mode, program, handler, arena_size)
+        for cpu in (pipeline, other):
+            cpu.run()
+        for reg in range(32):
+            self.assertEqual(pipeline.get_register(reg), other.get_register(reg), "x%d" % reg)
+        self.assertEqual(pipeline.get_pc(), other.get_pc())
+        self.assertEqual(pipeline.read_block(0, 0x1000), other.read_block(0, 0x1000))
+        self.assertEqual(pipeline.get_trap_count(), other.get_trap_count())
+        return other
+
+    def test_default_mode_is_pipeline(self):
+        self.assertEqual(CPU(4096).get_execution_mode(), ExecutionMode.PIPELINE)
+
+    def test_kernel_state_matches_pipeline(self):
+        cpu = self.assert_same_state(KERNEL)
+        stats = cpu.get_threaded_stats()
+        # The loop body is translated once and entered for every iteration
+        self.assertLess(stats.blocks_translated, 5)
+        self.assertGreaterEqual(stats.blocks_executed, 16)
+        self.assertEqual(stats.instructions, 2 + 16 * 9 + 1)
+
+    def test_traps_go_through_the_pipeline(self):
+        # The handler skips the ECALL and the faulting load, the blocks around them keep their results
+        handler = [csrr(28, 0x341), addi(28, 28, 4), csrw(0x341, 28), addi(9, 9, 1), MRET]
+        cpu = self.assert_same_state([
+            addi(5, 0, 1),
+            ECALL,
+            addi(5, 5, 1),
+            i_type(0x37, 6, 0, 0, 0) | (5 << 12),  # lui x6, 5, unmapped page
+            lw(7, 6, 0),
+            addi(5, 5, 1),
+            HALT,
+        ], handler)
+        self.assertEqual(cpu.get_register(5), 3)
+        self.assertEqual(cpu.get_register(9), 2)
+        self.assertGreater(cpu.get_threaded_stats().fallbacks, 0)
+
+    def test_store_into_running_block(self):
+        # The store overwrites the next instruction of its own block
+        cpu = self.assert_same_state([
+            lw(28, 0, 0x40),
+            sw(28, 0, 12),
+            addi(29, 0, 0),
+            addi(29, 0, 1),   # replaced by addi x29, x0, 7
+            HALT,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            addi(29, 0, 7),   # 0x40
+        ])
+        self.assertEqual(cpu.get_register(29), 7)
+        self.assertGreater(cpu.get_threaded_stats().invalidations, 0)
+
+    def test_host_write_drops_blocks(self):
+        cpu = self.make_cpu(ExecutionMode.THREADED, [addi(5, 0, 1), HALT])
+        cpu.run()
+        cpu.write_block(0, words([addi(5, 0, 2)]))
+        cpu.get_register_bank().set_pc(0)
+        cpu.run()
+        self.assertEqual(cpu.get_register(5), 2)
+
+    def test_unhandled_trap_leaves_same_pc(self):
+        for mode in (ExecutionMode.PIPELINE, ExecutionMode.THREADED, ExecutionMode.JIT):
+            cpu = self.make_cpu(mode, [addi(5, 0, 1), 0xFFFFFFFF, HALT])
+            with self.assertRaises(UnhandledTrapException):
+                cpu.run()
+            self.assertEqual(cpu.get_pc(), 4)
+            self.assertEqual(cpu.get_register(5), 1)
+
+    def test_jit_kernel_state_matches_pipeline(self):
+        cpu = self.assert_same_state(KERNEL, mode=ExecutionMode.JIT)
+        stats = cpu.get_threaded_stats()
+        self.assertGreater(stats.blocks_compiled, 0)
+        self.assertEqual(stats.instructions, 2 + 16 * 9 + 1)
+
+    def test_jit_traps_and_self_modifying_code(self):
+        handler = [csrr(28, 0x341), addi(28, 28, 4), csrw(0x341, 28), addi(9, 9, 1), MRET]
+        cpu = self.assert_same_state([
+            addi(5, 0, 1),
+            ECALL,
+            addi(5, 5, 1),
+            i_type(0x37, 6, 0, 0, 0) | (5 << 12),  # lui x6, 5, unmapped page
+            lw(7, 6, 0),
+            addi(5, 5, 1),
+            HALT,
+        ], handler, mode=ExecutionMode.JIT)
+        self.assertEqual(cpu.get_register(9), 2)
+        cpu = self.assert_same_state([
+            lw(28, 0, 0x40),
+            sw(28, 0, 12),
+            addi(29, 0, 0),
+            addi(29, 0, 1),
+            HALT,
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+            addi(29, 0, 7),
+        ], mode=ExecutionMode.JIT)
+        self.assertEqual(cpu.get_register(29), 7)
+
+    def test_jit_eviction_keeps_state(self):
+        # The blocks of the kernel do not all fit, the arena is reset to make room
+        cpu = self.assert_same_state(KERNEL, mode=ExecutionMode.JIT, arena_size=1024)
+        self.assertGreater(cpu.get_threaded_stats().evictions, 0)
+
+    def test_jit_config_defaults(self):
+        config = CPU(4096).get_jit_config()
+        self.assertGreater(config.threshold, 1)
+        self.assertFalse(config.perf_map)
+
+
+if __name__ == "__main__":
+    unittest.main()
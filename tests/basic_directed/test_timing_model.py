@@ -0,0 +1,76 @@
+import unittest
+
+from virtuv_bindings import CPU, ExecutionMode, TimingConfig
+from rv32_asm import ECALL, HALT, MRET, addi, b_type, i_type, lw, words
+
+
+class TestTimingModel(unittest.TestCase):
+    def run_timed(self, program, config=None, handler=None):
+        cpu = CPU(1024 * 1024)
+        cpu.set_timing_enabled(True)
+        if config is not None:
+            cpu.set_timing_config(config)
+        cpu.write_block(0, words(program))
+        if handler is not None:
+            cpu.get_csrs().mtvec = 0x400
+            cpu.write_block(0x400, words(handler))
+        cpu.run()
+        return cpu.get_timing_stats()
+
+    def test_independent_instructions_overlap(self):
+        # Three instructions fill the pipeline in 3 + 4 cycles, the final jump to self ends the run
+        stats = self.run_timed([addi(5, 0, 1), addi(6, 0, 2), addi(7, 0, 3), HALT])
+        self.assertEqual(stats.instructions, 3)
+        self.assertEqual(stats.cycles, 7)
+        self.assertAlmostEqual(stats.cpi, 7 / 3)
+
+    def test_forwarding_paths(self):
+        chain = [addi(5, 0, 1), addi(5, 5, 2), addi(5, 5, 3), HALT]
+        self.assertEqual(self.run_timed(chain).data_stalls, 0)
+
+        config = TimingConfig()
+        config.forward_ex = False
+        self.assertEqual(self.run_timed(chain, config).data_stalls, 2)
+
+        config.forward_mem = False
+        stats = self.run_timed(chain, config)
+        self.assertEqual(stats.data_stalls, 4)
+        self.assertEqual(stats.cycles, 11)
+
+    def test_load_use_stall(self):
+        stats = self.run_timed([lw(5, 0, 0x100), addi(6, 5, 1), HALT])
+        self.assertEqual(stats.load_use_stalls, 1)
+        # An independent instruction in between hides it
+        stats = self.run_timed([lw(5, 0, 0x100), addi(7, 0, 1), addi(6, 5, 1), HALT])
+        self.assertEqual(stats.load_use_stalls, 0)
+
+    def test_branch_penalty(self):
+        taken = [b_type(0, 0, 0, 8), addi(5, 0, 1), addi(6, 0, 1), HALT]
+        stats = self.run_timed(taken)
+        self.assertEqual(stats.control_stalls, 2)
+        config = TimingConfig()
+        config.branch_penalty = 5
+        self.assertEqual(self.run_timed(taken, config).control_stalls, 5)
+        not_taken = [b_type(1, 0, 0, 8), addi(5, 0, 1), addi(6, 0, 1), HALT]
+        self.assertEqual(self.run_timed(not_taken).control_stalls, 0)
+
+    def test_trap_flushes(self):
+        handler = [i_type(0x73, 28, 2, 0, 0x341), addi(28, 28, 4), i_type(0x73, 0, 1, 28, 0x341), MRET]
+        stats = self.run_timed([addi(5, 0, 1), ECALL, addi(6, 0, 1), HALT], handler=handler)
+        self.assertEqual(stats.traps, 1)
+        self.assertEqual(stats.instructions, 6)
+        # The ECALL and the MRET both redirect from MEM
+        self.assertEqual(stats.flush_stalls, 2 * TimingConfig().flush_penalty)
+
+    def test_timing_uses_the_pipeline(self):
+        cpu = CPU(1024 * 1024, mode=ExecutionMode.FUNCTIONAL)
+        cpu.set_timing_enabled(True)
+        cpu.write_block(0, words([addi(5, 0, 1), addi(6, 0, 2), HALT]))
+        cpu.run()
+        self.assertEqual(cpu.get_timing_stats().instructions, 2)
+        self.assertEqual(cpu.get_functional_stats().instructions, 0)
+        self.assertEqual(cpu.get_register(6), 2)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,155 @@
+import unittest
+
+from virtuv_bindings import (CPU, ExecutionMode, MemoryBacking, PrivilegeMode, TranslationMode, TrapCause,
+                             UnhandledTrapException)
+from rv32_asm import ECALL, HALT, MRET, addi, csrr, csrw, jal, lui, sw, words
+
+HANDLER = 0x100
+MCAUSE_REGISTER = 11
+MTVAL_REGISTER = 12
+
+
+EBREAK = 0x00100073
+
+
+class TestTraps(unittest.TestCase):
+    def setUp(self):
+        self.cpu = CPU(1024 * 1024)
+        # The handler records mcause/mtval, counts the trap in x10 and skips the trapping instruction
+        self.cpu.write_block(HANDLER, words([
+            csrr(MCAUSE_REGISTER, 0x342),
+            csrr(MTVAL_REGISTER, 0x343),
+            addi(10, 10, 1),
+            csrr(7, 0x341),
+            addi(7, 7, 4),
+            csrw(0x341, 7),
+            MRET,
+        ]))
+
+    def install_handler(self):
+        self.cpu.write_block(0, words([addi(5, 0, HANDLER), csrw(0x305, 5)]))
+
+    def test_ecall_round_trip(self):
+        self.install_handler()
+        self.cpu.write_block(8, words([ECALL, ECALL, addi(1, 0, 7), HALT]))
+        self.cpu.run()
+        self.assertEqual(self.cpu.get_register(10), 2)
+        self.assertEqual(self.cpu.get_register(1), 7)
+        self.assertEqual(self.cpu.get_register(MCAUSE_REGISTER), int(TrapCause.ECALL_FROM_MACHINE))
+        self.assertEqual(self.cpu.get_csrs().mepc, 0x10)
+        self.assertEqual(self.cpu.get_trap_count(), 2)
+
+    def test_illegal_instruction_and_breakpoint(self):
+        self.install_handler()
+        self.cpu.write_block(8, words([0xFFFFFFFF, EBREAK, HALT]))
+        self.cpu.run()
+        self.assertEqual(self.cpu.get_register(10), 2)
+        self.assertEqual(self.cpu.get_register(MCAUSE_REGISTER), int(TrapCause.BREAKPOINT))
+        self.assertEqual(self.cpu.get_register(MTVAL_REGISTER), 0xC)
+        self.assertEqual(self.cpu.get_last_trap().cause, TrapCause.BREAKPOINT)
+
+    def test_store_page_fault(self):
+        self.install_handler()
+        self.cpu.write_block(8, words([
+            0x000052B7,                                   # lui t0, 0x5 (unmapped page)
+            (6 << 20) | (5 << 15) | (2 << 12) | 0x23,     # sw t1, 0(t0)
+            HALT,
+        ]))
+        self.cpu.run()
+        self.assertEqual(self.cpu.get_register(MCAUSE_REGISTER), int(TrapCause.STORE_PAGE_FAULT))
+        self.assertEqual(self.cpu.get_register(MTVAL_REGISTER), 0x5000)
+
+    def test_user_mode_ecall_and_mret(self):
+        # Drop to user mode through mret, the ecall comes back in machine mode
+        self.cpu.get_csrs().mtvec = HANDLER
+        self.cpu.get_csrs().mepc = 0x20
+        self.cpu.write_block(0, words([MRET]))
+        self.cpu.write_block(0x20, words([ECALL, csrr(1, 0x300), HALT]))
+        self.cpu.step()
+        self.assertEqual(self.cpu.get_privilege_mode(), PrivilegeMode.USER)
+        self.cpu.step()
+        self.assertEqual(self.cpu.get_privilege_mode(), PrivilegeMode.MACHINE)
+        self.assertEqual(self.cpu.get_pc(), HANDLER)
+        self.cpu.run()
+
+        # The handler returned to user mode, where reading mstatus is illegal
+        self.assertEqual(self.cpu.get_register(10), 2)
+        self.assertEqual(self.cpu.get_register(MCAUSE_REGISTER), int(TrapCause.ILLEGAL_INSTRUCTION))
+        self.assertEqual(self.cpu.get_register(1), 0)
+
+    def test_unhandled_trap(self):
+        # Without a handler in mtvec the trap stops the CPU with the state left untouched
+        self.cpu.write_block(0, words([addi(1, 0, 42), 0xFFFFFFFF]))
+        with self.assertRaises(UnhandledTrapException):
+            self.cpu.run()
+        self.assertEqual(self.cpu.get_pc(), 4)
+        self.assertEqual(self.cpu.get_register(1), 42)
+        self.assertEqual(self.cpu.get_last_trap().value, 0xFFFFFFFF)
+
+    def test_snapshot_keeps_csrs(self):
+        self.install_handler()
+        self.cpu.step()
+        self.cpu.step()
+        base = self.cpu.snapshot()
+        self.cpu.get_csrs().mtvec = 0
+        self.cpu.restore(base)
+        self.assertEqual(self.cpu.get_csrs().mtvec, HANDLER)
+
+
+class TestSatp(unittest.TestCase):
+    SATP = 0x180
+    ROOT_TABLE = 0x10000
+    LEAF_TABLE = 0x11000
+
+    @staticmethod
+    def make_pte(physical_address, flags):
+        return ((physical_address >> 12) << 10) | flags
+
+    def test_guest_enables_sv32(self):
+        # Machine mode code writes satp and drops to supervisor mode at 0x40000000, which maps to
+        # 0x20000. The supervisor stores to 0x40001004, which maps to 0x21004
+        satp = 0x80000000 | (self.ROOT_TABLE >> 12)
+        for mode in (ExecutionMode.PIPELINE, ExecutionMode.FUNCTIONAL, ExecutionMode.THREADED, ExecutionMode.JIT):
+            with self.subTest(mode=mode):
+                cpu = CPU(1024 * 1024, MemoryBacking.HEAP, mode)
+                cpu.set_translation_mode(TranslationMode.SATP)
+                cpu.write_block(0, words([
+                    lui(5, 0x80000),
+                    addi(5, 5, self.ROOT_TABLE >> 12),
+                    csrw(self.SATP, 5),
+                    csrr(6, self.SATP),
+                    lui(7, 0x1),
+                    addi(7, 7, -0x800),     # mstatus.MPP = supervisor
+                    csrw(0x300, 7),
+                    lui(7, 0x40000),
+                    csrw(0x341, 7),
+                    MRET,
+                ]))
+                cpu.write_block(0x20000, words([lui(28, 0x40001), addi(10, 0, 42), sw(10, 28, 4), csrr(11, self.SATP), HALT]))
+                memory = cpu.get_physical_memory()
+                memory.write_word(self.ROOT_TABLE + (0x40000000 >> 22) * 4, self.make_pte(self.LEAF_TABLE, 0x1))
+                memory.write_word(self.LEAF_TABLE, self.make_pte(0x20000, 0x1 | 0x2 | 0x8))
+                memory.write_word(self.LEAF_TABLE + 4, self.make_pte(0x21000, 0x1 | 0x2 | 0x4))
+                cpu.run(1000)
+                self.assertEqual(cpu.get_privilege_mode(), PrivilegeMode.SUPERVISOR)
+                self.assertEqual(cpu.get_pc(), 0x40000010)
+                self.assertEqual(cpu.get_trap_count(), 0)
+                self.assertEqual((cpu.get_register(6), cpu.get_register(11)), (satp, satp))
+                self.assertEqual(memory.read_word(0x21004), 42)
+
+    def test_asid_is_not_writable_and_user_mode_traps(self):
+        cpu = CPU(64 * 1024)
+        cpu.set_translation_mode(TranslationMode.SATP)
+        cpu.get_csrs().mtvec = HANDLER
+        cpu.get_csrs().mepc = 0x20
+        cpu.write_block(0, words([addi(5, 0, -1), csrw(self.SATP, 5), csrr(6, self.SATP), csrw(self.SATP, 0), MRET]))
+        cpu.write_block(0x20, words([csrr(7, self.SATP), HALT]))
+        cpu.write_block(HANDLER, words([csrr(MCAUSE_REGISTER, 0x342), jal(0, 0)]))
+        cpu.run(100)
+        self.assertEqual(cpu.get_register(6), 0x803FFFFF)
+        self.assertEqual(cpu.get_register(MCAUSE_REGISTER), int(TrapCause.ILLEGAL_INSTRUCTION))
+        self.assertEqual(cpu.get_register(7), 0)
+
+
+if __name__ == "__main__":
+    unittest.main()